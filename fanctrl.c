@@ -3,12 +3,24 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <ctype.h> /* For isspace() */
 #include <limits.h>
+#include <stddef.h> /* For offsetof */
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h> /* For PRIu64 */
 #include <time.h>
+#include <signal.h> /* For sig_atomic_t */
+#include <unistd.h> /* For access() */
+#include <fcntl.h>
+#include <grp.h> /* For getgrnam() */
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 
 #include "fanctrl.h"
+#include "fanctrl_fixp.h"
+#include "fanctrl_ctrl.h"
 
 #define STRINGIFY(x) STRINGIFY_DETAIL(x)
 #define STRINGIFY_DETAIL(x) #x
@@ -18,9 +30,11 @@
 #define ERR_PFX "fanctrl Error: @line:" STRINGIFY(__LINE__) ": "
 #define ERR_PRINTF(str,...)  fprintf(stderr,ERR_PFX str "\n",__VA_ARGS__)
 #define ERR_PUTS(str)        fputs(ERR_PFX str "\n",stderr)
+#define LOG_PRINTF(str,...)  fprintf(stdout,"fanctrl: " str "\n",__VA_ARGS__),fflush(stdout)
 
 
 #define MAX_TEMP_POINTS 32
+#define SYSFS_TABLE_MAX_SIZE 4096 /* Multi-line sysfs files (pp_dpm_sclk, pp_power_profile_mode), read at once */
 
 typedef enum
 {
@@ -33,13 +47,71 @@ typedef enum
 #define AMDGPU_FAN_ENABLE               "1\n"
 #define AMDGPU_FAN_DISABLE              "0\n"
 
+#define AMDGPU_SENSOR_SUFFIX_INPUT      "_input"
+#define AMDGPU_SENSOR_SUFFIX_CRIT       "_crit"
+#define AMDGPU_SENSOR_SUFFIX_EMERGENCY  "_emergency"
+#define AMDGPU_POWER_CAP_SUFFIX_MAX     "_max"
+#define AMDGPU_POWER_CAP_SUFFIX_DEFAULT "_default"
+#define AMDGPU_PROFILE_NAME_DEFAULT     "default"
+#define STATE_FILE_PATH_BOOT_ID         "/proc/sys/kernel/random/boot_id"
+
 enum
 {
   AMDGPU_RAW_TO_TENTH_CELSUIS_DIVISOR   =100,
 
   CFG_LIMIT_MAX_DELAY_TIME              =300,   /* 30 seconds */
   CFG_LIMIT_MAX_TEMP                    =1500,  /* 150°C */
-  CFG_LIMIT_MAX_HYSTERESIS              =30,    /* 30% */
+  CFG_LIMIT_MAX_DEADBAND                =200,   /* 20°C */
+  CFG_LIMIT_MAX_DWELL_TIME              =600,   /* 60 seconds */
+  CFG_LIMIT_MAX_OVERSAMPLING            =10,
+  CFG_LIMIT_MAX_CRITICAL_COOLDOWN       =3000,  /* 5 minutes */
+  CFG_LIMIT_MAX_PID_GAIN                =10000,
+  CFG_LIMIT_MAX_MPC_HORIZON             =60,
+  CFG_LIMIT_MIN_MPC_FORGETTING          =900,
+  CFG_LIMIT_MAX_MPC_FORGETTING          =1000,
+  CFG_LIMIT_MAX_FEEDFORWARD_GAIN        =10000,
+  CFG_LIMIT_MAX_FEEDFORWARD_DECAY       =3000,  /* 5 minutes */
+  CFG_LIMIT_MAX_THROTTLE_BIAS_STEP      =255,
+  CFG_LIMIT_MAX_POWER_CAP_HYSTERESIS    =200,   /* 20°C */
+  CFG_LIMIT_MAX_PROFILE_FADE            =100,
+  CFG_LIMIT_MAX_HINT_GAIN               =10000,
+  CFG_LIMIT_MAX_HINT_TTL                =3600,  /* 1 hour */
+  CFG_LIMIT_MAX_HINT_SOCKET_MODE        =0777,
+  CFG_LIMIT_MAX_FAN_RPM                 =30000,
+  CFG_LIMIT_MAX_FAN_RPM_GAIN            =100,
+  CFG_LIMIT_MAX_STALL_TIME              =600,   /* 60 seconds */
+  CFG_LIMIT_MAX_ZERO_RPM_TIME           =6000,  /* 10 minutes */
+  CFG_LIMIT_MAX_ZERO_RPM_KICK_TIME      =100,   /* 10 seconds */
+  CFG_LIMIT_MAX_SLEW_RATE               =2550,  /* PWM/s */
+
+  AMDGPU_RAW_POWER_TO_WATT_DIVISOR      =1000000, /* µW */
+
+  /* Throttle bias is removed slower than it is added, to avoid cycling around the throttle point */
+  THROTTLE_BIAS_RELEASE_DIVISOR         =4,
+  /* Power cap boost is backed off faster than it is raised */
+  POWER_CAP_BOOST_BACKOFF_STEPS         =4,
+  /* Max. hint messages read per update, so a flooding client can't delay the update */
+  HINT_MAX_MESSAGES_PER_UPDATE          =16,
+
+  SENSOR_CRIT_CRITICAL                  =1,
+  SENSOR_CRIT_EMERGENCY                 =2,
+
+  /* Fan stall detection */
+  STALL_STATE_OK                        =0,
+  STALL_STATE_KICK,                     /* Stalled, max. PWM to spin it up */
+  STALL_STATE_FAILED,                   /* Didn't spin up, stays at max. PWM */
+
+  /* Persistent state file */
+  STATE_FILE_MAGIC                      =0x54534346, /* "FCST" */
+  STATE_FILE_VERSION                    =3,
+  STATE_FILE_MAX_SENSORS                =16,
+  STATE_FILE_BOOT_ID_SIZE               =40,    /* UUID string, zero terminated and padded */
+  STATE_FILE_HEARTBEAT_MS               =10000, /* Rewritten at least this often, for the age check */
+
+  /* Zero-RPM state machine */
+  ZERO_RPM_STATE_ON                     =0,
+  ZERO_RPM_STATE_KICK,                  /* Just started, full duty for the kick time */
+  ZERO_RPM_STATE_OFF,
 
   SENSOR_READ_MAX_RETRIES               =3,
 
@@ -48,10 +120,15 @@ enum
   SENSOR_READ_RET_FAILURE               =2,
 };
 
+/* Objects in the storage of the application are aligned for any type */
+#define STORAGE_ALIGNMENT 16
+#define STORAGE_ALIGN(size) (((size)+STORAGE_ALIGNMENT-1) & ~(size_t)(STORAGE_ALIGNMENT-1))
+
 #define AMDGPU_PWM_VAL_MIN 0
 #define AMDGPU_PWM_VAL_MAX 255
 
-#define AMDGPU_FANSPEED_PERCENT_TO_PWM ((float)(AMDGPU_PWM_VAL_MAX-AMDGPU_PWM_VAL_MIN)/100.0)
+#define AMDGPU_FANSPEED_PERCENT_TO_PWM(percent) fixp_PercentToPWM((percent),AMDGPU_PWM_VAL_MIN,AMDGPU_PWM_VAL_MAX)
+#define AMDGPU_FANSPEED_PWM_TO_PERMILLE(pwm)    fixp_PWMToPermille((pwm),AMDGPU_PWM_VAL_MIN,AMDGPU_PWM_VAL_MAX)
 
 typedef struct
 {
@@ -59,11 +136,75 @@ typedef struct
   unsigned int uiFanSpeedPWM; /* PWM value */
 }TagFanCtrlTempPoint;
 
+typedef struct
+{
+  const char *pcName;
+  unsigned int uiPointsCount;
+  TagFanCtrlTempPoint *ptagPoints;
+  /* Rules, profiles only */
+  int iRuleBusy;                /* 0 if disabled */
+  unsigned long ulRuleBusyTimeMs;
+  const char *pcRulePowerProfile; /* NULL if disabled */
+  const char *pcRuleHint;         /* NULL if disabled */
+  int iBusyMatch;
+  unsigned long ulBusyChangeMs; /* Since when the GPU load differs from iBusyMatch, 0 if not */
+  /* Lookup table, PWM per 1/10 °C from the lowest to the highest point, clamped outside */
+  int iLUTTemp;
+  unsigned int uiLUTSize;
+  const unsigned char *pucLUT;
+}TagFanCtrlCurve;
+
+/**
+ * Persistent controller state, written to one of two slots alternately.
+ * The slot with the highest generation and a valid checksum is current, so a torn write leaves the previous one.
+ * Timestamps are CLOCK_MONOTONIC, which keeps counting across a restart of the daemon, but not across a reboot.
+ * So the boot ID is stored as well, a record of another boot is never restored.
+ */
+typedef struct
+{
+  unsigned int uiGeneration;
+  unsigned int uiChecksum;    /* FNV-1a over the record, without this field */
+  unsigned long long ullSavedMs;
+  unsigned int uiSensorsCount;
+  unsigned int uiRequestPWM;
+  int iHysteresisTemp;        /* Reference temperature of the hysteresis */
+  int iPIDValid;
+  int iPIDPrevTemp;
+  int iReserved;
+  unsigned long long ullHysteresisMs;
+  long long llPIDIntegral;
+  unsigned long long ullPowerCapOrigUW; /* Original power cap, if not provided by the driver, 0 if unknown */
+  char caBootId[STATE_FILE_BOOT_ID_SIZE]; /* Empty if unknown */
+  int iaTempFiltered[STATE_FILE_MAX_SENSORS];
+  int iaCurveTemp[STATE_FILE_MAX_SENSORS];
+}TagFanCtrlStateRecord;
+
+typedef struct
+{
+  unsigned int uiMagic;
+  unsigned int uiVersion;
+  unsigned int uiSize;
+  unsigned int uiReserved;
+  TagFanCtrlStateRecord tagaSlots[2];
+}TagFanCtrlStateFile;
+
 typedef struct
 {
   const char *pcSensorReadPath;
   long lRawValue;
-  int iTempCelsius;
+  int iTempCelsius;           /* Last raw value, in 1/10 °C */
+  int iTempFiltered;          /* Filtered value, in 1/10 °C, used for control */
+  int iCriticalTemp;          /* In 1/10 °C, 0 if disabled */
+  int iEmergencyTemp;         /* In 1/10 °C, 0 if disabled */
+  unsigned long ulSampleMs;   /* Timestamp of last sample */
+  unsigned int uiOversampling;
+  TagCtrlFilter tagFilter;
+  /* Per-sensor curve, CONTROL_MODE_CURVE only */
+  const TagFanCtrlCurve *ptagCurve; /* NULL to use the active curve */
+  TagFanCtrlCurve tagCurve;
+  TagCtrlHysteresis tagHysteresis;  /* Own curve only */
+  unsigned int uiWeight;      /* In Percent */
+  int iCurveTemp;             /* Temperature of the last accepted change, in 1/10 °C */
 }TagFanCtrlSensor;
 
 typedef struct
@@ -71,25 +212,355 @@ typedef struct
   const char *pcPathSetFanCtrlMode;
   const char *pcPathEnableFan;
   const char *pcPathSetPWM;
-  int iLastUpdateTemp;
-  unsigned int uiPointsCount;
   unsigned int uiSensorsCount;
-  TagFanCtrlTempPoint *ptagPoints;
+  unsigned int uiSubTicks;    /* Sensor sampling steps per update interval, max. oversampling of all sensors */
   TagFanCtrlSensor *ptagSensors;
+  /* Curves: [0] is the curve of the AMDGPU section, followed by the profiles. All precomputed at init */
+  unsigned int uiCurvesCount;
+  TagFanCtrlCurve *ptagCurves;
+  const TagFanCtrlCurve *ptagCurve;        /* Active curve */
+  const TagFanCtrlCurve *ptagCurveFade;    /* Curve faded out, NULL if no cross-fade is running */
+  const TagFanCtrlCurve *ptagCurveApplied; /* Curve of the last curve update, NULL during cross-fade */
+  unsigned int uiFadeTicks;
+  unsigned int uiFadeTick;
+  unsigned int uiSensorReducer;
+  const char *pcPathPowerProfile;
+  const char *pcPathProfileHint;
+  char caPowerProfile[32];
+  char caProfileHint[64];
+  /* Load hints of a job scheduler, optional */
+  const char *pcPathHintSocket;
+  const char *pcHintDevice;
+  int iHintSocket;              /* -1 if not used */
+  unsigned int uiHintSocketMode;  /* 0 to keep the default */
+  const char *pcHintSocketGroup;  /* NULL to keep the default */
+  unsigned int uiHintGain;
+  unsigned long ulHintMaxTTLMs;
+  int iHintPowerW;              /* 0 if no hint is active */
+  unsigned long ulHintExpiresMs;
+  unsigned int uiHintPWM;
+  TagCtrlHysteresis tagHysteresis;
+  int iFanState;
+  unsigned int uiLastPWM;     /* Last written PWM, UINT_MAX if unknown */
+  /* RPM mode: The fanspeed is a target RPM, scaled from the PWM range to uiRPMMax */
+  unsigned int uiFanMode;
+  const char *pcPathFanTarget;  /* NULL to use the inner loop */
+  const char *pcPathFanInput;
+  unsigned int uiRPMMax;
+  unsigned int uiRPMGain;
+  unsigned int uiRPMTarget;     /* 0 while the fan is disabled */
+  long lRPMPWM;                 /* Inner loop output, in Q8 PWM */
+  unsigned int uiRPMPWM;        /* Last PWM written by the inner loop, UINT_MAX if unknown */
+  int iRPM;
+  int iRPMError;
+  /* Fan calibration: In PWM mode, fanspeeds are remapped through ucaPWMMap before writing */
+  unsigned int uiCalibrated;
+  unsigned int uiMinStartPWM;
+  unsigned int uiMinSustainPWM;
+  unsigned int uiCalibratedRPMMax;
+  unsigned char ucaPWMMap[AMDGPU_PWM_VAL_MAX+1];
+  /* Fan stall detection, uiStallPWM 0 if disabled */
+  unsigned int uiStallPWM;
+  unsigned int uiStallTime;     /* In ms */
+  unsigned int uiStallKickTime; /* In ms */
+  unsigned long ulStallPowerCapUW;
+  unsigned int uiStallState;
+  unsigned long ulStallSinceMs; /* Start of the current state, 0 while spinning */
+  /* Zero-RPM state machine, iZeroRPMStartTemp 0 if disabled */
+  int iZeroRPMStartTemp;
+  int iZeroRPMStopTemp;
+  unsigned int uiZeroRPMMinOnTime;  /* In ms */
+  unsigned int uiZeroRPMMinOffTime; /* In ms */
+  unsigned int uiZeroRPMKickTime;   /* In ms */
+  unsigned int uiZeroRPMMinPWM;     /* Lowest running fanspeed of the curve, used while on */
+  unsigned int uiZeroRPMState;
+  unsigned long ulZeroRPMSinceMs;   /* Start of the current state */
+  unsigned long ulZeroRPMStartReqMs; /* Start temperature reached while off, 0 if not */
+  unsigned long ulFanEnableLastMs;
+  /* PWM slew limiter, both rates 0 if disabled */
+  unsigned int uiSlewUp;   /* PWM/s, 0 for unlimited */
+  unsigned int uiSlewDown; /* PWM/s, 0 for unlimited */
+  int iSlewCriticalUnlimited;
+  long lSlewPWM;           /* Limited fanspeed (Q8), -1 while the fan is off */
+  unsigned int uiSlewStepMs; /* Sampling step */
+  unsigned long ulSlewLastMs;
+  unsigned int uiRequestPWM; /* Fanspeed requested by the control, before the stall/zero-RPM overrides */
+  /* Persistent state, ptagState NULL if not used */
+  const char *pcPathState;
+  TagFanCtrlStateFile *ptagState; /* mmap'd */
+  unsigned int uiStateSlot;       /* Slot of the last write */
+  char caBootId[STATE_FILE_BOOT_ID_SIZE]; /* Of the running system, empty if unknown */
+  unsigned long ulStateMaxAgeMs;
+  unsigned long ulStateLastMs;
+  unsigned int uiControlMode;
+  TagCtrlPID tagPID;
+  TagCtrlMPC tagMPC;
+  unsigned long ulLastUpdateMs;
+  /* Power draw, optional */
+  const char *pcPathPowerRead;
+  int iPowerW;
+  /* GPU load, optional */
+  const char *pcPathBusyRead;
+  int iBusyPercent;
+  /* Feed-forward from power draw/GPU load, in PWM */
+  TagCtrlFeedForward tagFeedForwardPower;
+  TagCtrlFeedForward tagFeedForwardBusy;
+  unsigned int uiFeedForwardPWM;
+  unsigned long ulFeedForwardLastMs;
+  /* GPU clock and throttle detection, optional */
+  const char *pcPathClockRead;
+  unsigned int uiClockMHz;
+  unsigned int uiClockMaxMHz;   /* Highest clock level */
+  int iThrottleTemp;            /* 0 if disabled */
+  unsigned int uiThrottleClock;
+  int iThrottleBusy;
+  unsigned int uiThrottleBiasStep;
+  int iThrottled;
+  unsigned int uiThrottleBiasPWM;
+  unsigned int uiBiasAppliedPWM; /* Feed-forward and throttle bias of the last curve update */
+  /* Power cap actuator, optional, values in µW */
+  const char *pcPathPowerCap;
+  int iPowerCapTemp;            /* 0 if disabled */
+  int iPowerCapHysteresis;
+  unsigned long ulPowerCapOrigUW;
+  int iPowerCapOrigDefault;     /* Original cap read from power1_cap_default, otherwise the cap at start or from the state file */
+  unsigned long ulPowerCapMinUW;
+  unsigned long ulPowerCapStepUW;
+  unsigned long ulPowerCapUW;
+  int iPowerCapBoostTemp;       /* 0 if disabled */
+  unsigned int uiPowerCapBoostPWM;
+  unsigned long ulPowerCapMaxUW;
+  /* Critical temperature handling */
+  unsigned int uiCriticalTickTime;
+  unsigned int uiCriticalCooldown;
+  int iCriticalActive;
+  int iCriticalPWMPending;
+  unsigned long ulCriticalSinceMs;
+  unsigned long ulCriticalBelowSinceMs;
+  /* Statistics */
+  unsigned long ulPWMWrites;
+  unsigned long ulFanEnableWrites;
+  unsigned long ulCriticalEvents;
+  unsigned long ulEmergencyEvents;
+  unsigned long ulCriticalLastLatencyMs;
+  unsigned long ulCriticalMaxLatencyMs;
+  unsigned long ulPowerReadErrors;
+  unsigned long ulBusyReadErrors;
+  unsigned int uiFeedForwardMaxPWM;
+  unsigned long ulClockReadErrors;
+  unsigned long ulThrottleEvents;
+  unsigned long ulThrottleUpdates;
+  unsigned int uiThrottleMaxBiasPWM;
+  unsigned long ulPowerCapDecreases;
+  unsigned long ulPowerCapIncreases;
+  unsigned long ulPowerCapLowestUW;
+  unsigned long ulPowerCapWriteErrors;
+  unsigned long ulPowerCapBoostBackoffs;
+  unsigned long ulPowerCapHighestUW;
+  unsigned long ulProfileSwitches;
+  unsigned long ulProfileReadErrors;
+  unsigned long ulHintsReceived;
+  unsigned long ulHintsRejected;
+  unsigned long ulHintsExpired;
+  unsigned long ulHintUpdates;
+  unsigned int uiHintMaxPWM;
+  unsigned long ulRPMTargetWrites;
+  unsigned long ulRPMSteps;
+  unsigned long ulRPMSaturated;
+  unsigned long ulRPMReadErrors;
+  unsigned long ulStallEvents;
+  unsigned long ulStallKickRecoveries;
+  unsigned long ulFanFailures;
+  unsigned long ulStallReadErrors;
+  time_t tStallLastFault;
+  unsigned long ulZeroRPMStarts;
+  unsigned long ulZeroRPMStops;
+  unsigned long ulZeroRPMKicks;
+  unsigned long ulZeroRPMLastLatencyMs;
+  unsigned long ulZeroRPMMaxLatencyMs;
+  unsigned long ulFanEnableMinIntervalMs; /* ULONG_MAX until the fan was enabled/disabled twice */
+  unsigned long ulSlewClips;
+  unsigned int uiSlewMaxClipPWM;
+  unsigned long ulStateWrites;
+  unsigned long ulStateRestoredAgeMs; /* ULONG_MAX if not restored */
 }TagFanConfigAMDGPU;
 
 struct TagFanCtrl_t
 {
   unsigned int uiUpdateDelayTime;
-  unsigned char ucTempHysteresisPercent;
+  TagCfg_Hysteresis tagHysteresis;
   volatile unsigned int *puiQuitRunFlag;
+  volatile sig_atomic_t iStatsRequested;
   unsigned int uiFlags;
+  FanCtrlReloadHook pfnReloadHook; /* NULL if not used */
   TagFanConfigAMDGPU *ptagAMDGPU;
 };
 
 static int iFanCtrl_UpdateSensor_m(EFanCtrlType eSensorType,
                                    TagFanCtrlSensor *ptagSensor);
 
+static int iFanCtrl_SampleSensors_m(TagFanCtrlSensor *ptagSensors,
+                                    unsigned int uiSensorsCount,
+                                    unsigned int uiSubTick,
+                                    unsigned int uiSubTicks,
+                                    int *piRetryCount);
+
+static long lFanCtrl_ReadFile_m(const char *pcPath,
+                                char *pcBuffer,
+                                size_t szBufSize);
+
+static int iFanCtrl_WriteFile_m(const char *pcPath,
+                                const char *pcData);
+
+static int iFanCtrl_ReadSysfsLong_m(const char *pcPath,
+                                    long *plValue);
+
+static int iFanCtrl_ReadDPMClock_m(const char *pcPath,
+                                   unsigned int *puiClockMHz,
+                                   unsigned int *puiClockMaxMHz);
+
+static int iFanCtrl_ReadPowerProfile_m(const char *pcPath,
+                                       char *pcBuffer,
+                                       size_t szBufSize);
+
+static int iFanCtrl_ReadHint_m(const char *pcPath,
+                               char *pcBuffer,
+                               size_t szBufSize);
+
+static int iFanCtrl_WriteSysfsULong_m(const char *pcPath,
+                                      unsigned long ulValue);
+
+static int iFanCtrl_ReadCriticalTemp_m(const char *pcSensorReadPath,
+                                       const char *pcSuffix,
+                                       int *piTemp);
+
+static int iFanCtrl_AMDGPU_CheckCritical_m(const TagFanConfigAMDGPU *ptagAMDGPU);
+
+static int iFanCtrl_AMDGPU_CheckStall_m(TagFanCtrl *ptagFanCtrl,
+                                        unsigned long ulNowMs);
+
+static const char *pcFanCtrl_FormatTime_m(time_t tTime,
+                                          char *pcBuffer,
+                                          size_t sizeBuffer);
+
+static int iFanCtrl_AMDGPU_UpdateZeroRPM_m(TagFanCtrl *ptagFanCtrl,
+                                           int iTemp,
+                                           int iControlTick);
+
+static void vFanCtrl_AMDGPU_StartZeroRPM_m(TagFanConfigAMDGPU *ptagAMDGPU,
+                                           unsigned long ulNowMs);
+
+static unsigned int uiFanCtrl_AMDGPU_SlewLimit_m(TagFanConfigAMDGPU *ptagAMDGPU,
+                                                 unsigned int uiPWM);
+
+static int iFanCtrl_AMDGPU_UpdateSlew_m(TagFanCtrl *ptagFanCtrl);
+
+static int iFanCtrl_AMDGPU_OpenState_m(TagFanCtrl *ptagFanCtrl);
+
+static void vFanCtrl_ReadBootId_m(char *pcBootId,
+                                  size_t szSize);
+
+static int iFanCtrl_StateCurrentSlot_m(const TagFanCtrlStateFile *ptagFile,
+                                       unsigned int uiSensorsCount);
+
+static unsigned int uiFanCtrl_StateChecksum_m(const TagFanCtrlStateRecord *ptagRecord);
+
+static int iFanCtrl_AMDGPU_RestoreState_m(TagFanCtrl *ptagFanCtrl);
+
+static void vFanCtrl_AMDGPU_RestorePowerCap_m(TagFanCtrl *ptagFanCtrl,
+                                              const TagFanCtrlStateRecord *ptagRecord);
+
+static void vFanCtrl_AMDGPU_SaveState_m(TagFanCtrl *ptagFanCtrl);
+
+static void vFanCtrl_AMDGPU_GetStateRecord_m(const TagFanConfigAMDGPU *ptagAMDGPU,
+                                             TagFanCtrlStateRecord *ptagRecord);
+
+static void vFanCtrl_AMDGPU_ApplyStateRecord_m(TagFanConfigAMDGPU *ptagAMDGPU,
+                                               const TagFanCtrlStateRecord *ptagRecord);
+
+static void vFanCtrl_AMDGPU_InitCalibration_m(TagFanConfigAMDGPU *ptagAMDGPU,
+                                              const TagCfg_Calibration *ptagCalibration);
+
+static int iFanCtrl_AMDGPU_CalibrateStep_m(TagFanCtrl *ptagFanCtrl,
+                                           const TagCfg_Calibrate *ptagCfg,
+                                           unsigned int uiPWM,
+                                           int *piSensorReadRetryCount,
+                                           long *plRPM);
+
+static void vFanCtrl_AMDGPU_ReadLoad_m(TagFanConfigAMDGPU *ptagAMDGPU);
+
+static void vFanCtrl_AMDGPU_CheckThrottle_m(TagFanCtrl *ptagFanCtrl,
+                                           int iTemp);
+
+static unsigned int uiFanCtrl_AMDGPU_AddBias_m(const TagFanConfigAMDGPU *ptagAMDGPU,
+                                               unsigned int uiPWM,
+                                               unsigned int uiBias);
+
+static void vFanCtrl_AMDGPU_SelectProfile_m(TagFanConfigAMDGPU *ptagAMDGPU,
+                                            unsigned long ulNowMs);
+
+static int iFanCtrl_OpenHintSocket_m(const char *pcPath,
+                                     unsigned int uiMode,
+                                     const char *pcGroup);
+
+static int iFanCtrl_SetHintSocketAccess_m(const char *pcPath,
+                                          unsigned int uiMode,
+                                          const char *pcGroup);
+
+static void vFanCtrl_AMDGPU_ReadHints_m(TagFanCtrl *ptagFanCtrl,
+                                       unsigned long ulNowMs);
+
+static void vFanCtrl_AMDGPU_UpdatePowerCap_m(TagFanCtrl *ptagFanCtrl,
+                                            int iTemp);
+
+static int iFanCtrl_AMDGPU_SetPowerCap_m(TagFanCtrl *ptagFanCtrl,
+                                         unsigned long ulPowerCapUW);
+
+static int iFanCtrl_AMDGPU_Start_m(TagFanCtrl *ptagFanCtrl);
+
+static int iFanCtrl_AMDGPU_Update_m(TagFanCtrl *ptagFanCtrl);
+
+static int iFanCtrl_AMDGPU_ApplyPWM_m(TagFanCtrl *ptagFanCtrl,
+                                      unsigned int uiPWM);
+
+static int iFanCtrl_AMDGPU_WritePWM_m(TagFanCtrl *ptagFanCtrl,
+                                      unsigned int uiPWM);
+
+static int iFanCtrl_AMDGPU_SetRPMTarget_m(TagFanCtrl *ptagFanCtrl,
+                                          unsigned int uiPWM);
+
+static int iFanCtrl_AMDGPU_UpdateRPM_m(TagFanCtrl *ptagFanCtrl);
+
+static unsigned int uiFanCtrl_CurveGetPWM_m(const TagFanCtrlTempPoint *ptagPoints,
+                                            unsigned int uiPointsCount,
+                                            int iTemp);
+
+static unsigned int uiFanCtrl_CurveLookup_m(const TagFanCtrlCurve *ptagCurve,
+                                            int iTemp);
+
+#ifndef FANCTRL_STATIC
+static int iFanCtrl_VerifyCurve_m(const TagCfg_Temperatures *ptagTemps,
+                                  unsigned int uiTempsCount);
+#endif /* !FANCTRL_STATIC */
+
+static long lFanCtrl_SplineSlope_m(const TagFanCtrlTempPoint *ptagPoints,
+                                   unsigned int uiPointsCount,
+                                   unsigned int uiIndex);
+
+static int iFanCtrl_InitCurve_m(const TagFanCtrl *ptagFanCtrl,
+                                TagFanCtrlCurve *ptagCurve,
+                                const char *pcName,
+                                TagFanCtrlTempPoint *ptagPoints,
+                                unsigned char *pucLUT,
+                                unsigned int uiInterpolation,
+                                const TagCfg_Temperatures *ptagTemps,
+                                unsigned int uiTempsCount);
+
+static unsigned int uiFanCtrl_AMDGPU_CurveGetPWM_m(const TagFanConfigAMDGPU *ptagAMDGPU,
+                                                   int iTemp);
+
+static unsigned int uiFanCtrl_AMDGPU_SensorsGetPWM_m(const TagFanCtrl *ptagFanCtrl);
+
 static int iFanCtrl_EnableFan(EFanCtrlType eSensorType,
                               const char *pcEnableFanPath,
                               int iEnable);
@@ -101,37 +572,118 @@ static int iFanCtrl_SetFanSpeed(EFanCtrlType eSensorType,
 static int amdgpu_SetMode(TagFanCtrl *ptagFanCtrl,
                           int iModeManual);
 
+static unsigned long ulFanCtrl_GetTimeMs_m(void);
+
+#ifndef FANCTRL_STATIC
+static int iFanCtrl_VerifyTiming_m(unsigned int uiUpdateDelayTime,
+                                   const TagCfg_Hysteresis *ptagHysteresis);
+#endif /* !FANCTRL_STATIC */
+
+static void *pvFanCtrl_Alloc_m(size_t szSize);
+
+static void vFanCtrl_Free_m(void *pvMem);
+
+static size_t szFanCtrl_AMDGPU_GetBlockSize_m(const TagCfg_Sensor *ptagSensors,
+                                              unsigned int uiSensorsCount,
+                                              const TagCfg_Temperatures *ptagTemps,
+                                              unsigned int uiTempsCount,
+                                              const TagCfg_Profile *ptagProfiles,
+                                              unsigned int uiProfilesCount,
+                                              unsigned int *puiPointsCount,
+                                              unsigned int *puiLUTSize);
+
+static int iFanCtrl_AMDGPU_Build_m(TagFanCtrl *ptagFanCtrl,
+                                   const TagFanConfigAMDGPU *ptagPrev,
+                                   const TagCfg_AMDGPU *pConfig,
+                                   const TagCfg_Sensor *ptagSensors,
+                                   unsigned int uiSensorsCount,
+                                   const TagCfg_Temperatures *ptagTemps,
+                                   unsigned int uiTempsCount,
+                                   const TagCfg_Profile *ptagProfiles,
+                                   unsigned int uiProfilesCount);
+
+static int iFanCtrl_AMDGPU_OpenHandles_m(TagFanCtrl *ptagFanCtrl,
+                                         TagFanConfigAMDGPU *ptagPrev);
+
+static void vFanCtrl_AMDGPU_Free_m(TagFanConfigAMDGPU *ptagAMDGPU);
+
+static int iFanCtrl_AMDGPU_SameDevice_m(const TagFanConfigAMDGPU *ptagA,
+                                        const TagFanConfigAMDGPU *ptagB);
+
+static void vFanCtrl_AMDGPU_CarryState_m(TagFanConfigAMDGPU *ptagAMDGPU,
+                                         const TagFanConfigAMDGPU *ptagOld);
+
+static void vFanCtrl_GetWaitTimes_m(const TagFanCtrl *ptagFanCtrl,
+                                    struct timespec *ptagWaitTime,
+                                    struct timespec *ptagCriticalWaitTime,
+                                    unsigned int *puiSubTicks);
+
+/* Storage of the application for the objects, see fanCtrl_SetStorage(). NULL to use the heap */
+static unsigned char *pucStorage_m;
+static size_t szStorage_m;
+static size_t szStorageUsed_m;
+static size_t szHeapUsed_m;         /* Objects outside the storage, e.g. the device of a reload */
+
+/* Set by fanCtrl_Run() after the first tick, see fanCtrl_IsSteadyState() */
+static volatile sig_atomic_t iSteadyState_m;
+
+void fanCtrl_SetStorage(void *pvStorage,
+                        size_t szStorage)
+{
+  pucStorage_m=(unsigned char*)pvStorage;
+  szStorage_m=(pvStorage)?szStorage:0;
+  szStorageUsed_m=0;
+}
+
+size_t fanCtrl_AMDGPU_StorageSize(const TagCfg_Sensor *ptagSensors,
+                                  unsigned int uiSensorsCount,
+                                  const TagCfg_Temperatures *ptagTemps,
+                                  unsigned int uiTempsCount,
+                                  const TagCfg_Profile *ptagProfiles,
+                                  unsigned int uiProfilesCount)
+{
+  unsigned int uiPointsCount;
+  unsigned int uiLUTSize;
+
+  return(STORAGE_ALIGN(sizeof(TagFanCtrl)) +
+         STORAGE_ALIGN(szFanCtrl_AMDGPU_GetBlockSize_m(ptagSensors,
+                                                       uiSensorsCount,
+                                                       ptagTemps,
+                                                       uiTempsCount,
+                                                       ptagProfiles,
+                                                       uiProfilesCount,
+                                                       &uiPointsCount,
+                                                       &uiLUTSize)));
+}
+
+int fanCtrl_IsSteadyState(void)
+{
+  return(iSteadyState_m);
+}
+
 TagFanCtrl *fanCtrl_Create(unsigned int uiUpdateDelayTime,
-                           unsigned char ucTempHysteresisPercent,
+                           const TagCfg_Hysteresis *ptagHysteresis,
                            unsigned int *puiQuitRunFlag,
                            unsigned int uiFlags)
 {
   TagFanCtrl *ptagFanCtrl;
 
-  if(uiUpdateDelayTime > CFG_LIMIT_MAX_DELAY_TIME)
-  {
-    ERR_PRINTF("Invalid value: uiUpdateDelayTime too high(=%u), max=%u",
-               uiUpdateDelayTime,
-               CFG_LIMIT_MAX_DELAY_TIME);
-    return(NULL);
-  }
-  if(ucTempHysteresisPercent > CFG_LIMIT_MAX_HYSTERESIS)
-  {
-    ERR_PRINTF("Invalid value: ucTempHysteresisPercent too high(=%u%%), max=%u%%",
-               ucTempHysteresisPercent,
-               CFG_LIMIT_MAX_HYSTERESIS);
+#ifndef FANCTRL_STATIC
+  if(iFanCtrl_VerifyTiming_m(uiUpdateDelayTime,ptagHysteresis))
     return(NULL);
-  }
+#endif /* !FANCTRL_STATIC */
 
-  if(!(ptagFanCtrl=malloc(sizeof(TagFanCtrl))))
+  if(!(ptagFanCtrl=pvFanCtrl_Alloc_m(sizeof(TagFanCtrl))))
   {
-    ERR_PUTS("malloc() failed");
+    ERR_PUTS("Out of memory");
     return(NULL);
   }
   ptagFanCtrl->uiUpdateDelayTime=uiUpdateDelayTime;
-  ptagFanCtrl->ucTempHysteresisPercent=ucTempHysteresisPercent;
+  ptagFanCtrl->tagHysteresis=*ptagHysteresis;
   ptagFanCtrl->puiQuitRunFlag=puiQuitRunFlag;
+  ptagFanCtrl->iStatsRequested=0;
   ptagFanCtrl->uiFlags=0;
+  ptagFanCtrl->pfnReloadHook=NULL;
 
   if(uiFlags & CREATE_FLAG_DEBUG)
     ptagFanCtrl->uiFlags|=CREATE_FLAG_DEBUG;
@@ -140,10 +692,13 @@ TagFanCtrl *fanCtrl_Create(unsigned int uiUpdateDelayTime,
 
   DBG_PRINTF("Created New FanCtrl-Object\n"
              "->uiUpdateDelayTime=%u\n"
-             "->ucTempHysteresisPercent=%u%%\n"
+             "->Hysteresis: rising=%u, falling=%u, min. dwell time=%u, slope bypass=%u\n"
              "->uiFlags=0x%X",
              ptagFanCtrl->uiUpdateDelayTime,
-             ptagFanCtrl->ucTempHysteresisPercent,
+             ptagFanCtrl->tagHysteresis.usRisingDeadband,
+             ptagFanCtrl->tagHysteresis.usFallingDeadband,
+             ptagFanCtrl->tagHysteresis.usMinDwellTime,
+             ptagFanCtrl->tagHysteresis.usRisingSlopeBypass,
              ptagFanCtrl->uiFlags);
 
   return(ptagFanCtrl);
@@ -151,8 +706,15 @@ TagFanCtrl *fanCtrl_Create(unsigned int uiUpdateDelayTime,
 
 void fanCtrl_Destroy(TagFanCtrl *ptagFanCtrl)
 {
-  free(ptagFanCtrl->ptagAMDGPU);
-  free(ptagFanCtrl);
+  if(ptagFanCtrl->ptagAMDGPU)
+    vFanCtrl_AMDGPU_Free_m(ptagFanCtrl->ptagAMDGPU);
+  vFanCtrl_Free_m(ptagFanCtrl);
+}
+
+void fanCtrl_SetReloadHook(TagFanCtrl *ptagFanCtrl,
+                           FanCtrlReloadHook pfnReloadHook)
+{
+  ptagFanCtrl->pfnReloadHook=pfnReloadHook;
 }
 
 int fanCtrl_ResetDevices(TagFanCtrl *ptagFanCtrl)
@@ -164,6 +726,14 @@ int fanCtrl_ResetDevices(TagFanCtrl *ptagFanCtrl)
   {
     DBG_PUTS("AMDGPU: Reset to automode");
     iRc|=amdgpu_SetMode(ptagFanCtrl,0);
+    if((ptagFanCtrl->ptagAMDGPU->pcPathPowerCap) &&
+       (ptagFanCtrl->ptagAMDGPU->ulPowerCapUW != ptagFanCtrl->ptagAMDGPU->ulPowerCapOrigUW))
+    {
+      LOG_PRINTF("AMDGPU: Power cap %luW -> %luW (reset)",
+                 ptagFanCtrl->ptagAMDGPU->ulPowerCapUW/AMDGPU_RAW_POWER_TO_WATT_DIVISOR,
+                 ptagFanCtrl->ptagAMDGPU->ulPowerCapOrigUW/AMDGPU_RAW_POWER_TO_WATT_DIVISOR);
+      iRc|=iFanCtrl_AMDGPU_SetPowerCap_m(ptagFanCtrl,ptagFanCtrl->ptagAMDGPU->ulPowerCapOrigUW);
+    }
   }
   return(iRc);
 }
@@ -173,301 +743,4016 @@ int fanCtrl_AMDGPU_Init(TagFanCtrl *ptagFanCtrl,
                         const TagCfg_Sensor *ptagSensors,
                         unsigned int uiSensorsCount,
                         const TagCfg_Temperatures *ptagTemps,
-                        unsigned int uiTempsCount)
+                        unsigned int uiTempsCount,
+                        const TagCfg_Profile *ptagProfiles,
+                        unsigned int uiProfilesCount)
+{
+  int iRc;
+
+  if((iRc=iFanCtrl_AMDGPU_Build_m(ptagFanCtrl,
+                                  NULL,
+                                  pConfig,
+                                  ptagSensors,
+                                  uiSensorsCount,
+                                  ptagTemps,
+                                  uiTempsCount,
+                                  ptagProfiles,
+                                  uiProfilesCount)))
+    return(iRc);
+  if(iFanCtrl_AMDGPU_OpenHandles_m(ptagFanCtrl,NULL))
+  {
+    vFanCtrl_Free_m(ptagFanCtrl->ptagAMDGPU);
+    ptagFanCtrl->ptagAMDGPU=NULL;
+    return(3);
+  }
+  return(0);
+}
+
+int fanCtrl_AMDGPU_Reload(TagFanCtrl *ptagFanCtrl,
+                          unsigned int uiUpdateDelayTime,
+                          const TagCfg_Hysteresis *ptagHysteresis,
+                          const TagCfg_AMDGPU *pConfig,
+                          const TagCfg_Sensor *ptagSensors,
+                          unsigned int uiSensorsCount,
+                          const TagCfg_Temperatures *ptagTemps,
+                          unsigned int uiTempsCount,
+                          const TagCfg_Profile *ptagProfiles,
+                          unsigned int uiProfilesCount)
+{
+  TagFanConfigAMDGPU *ptagOld=ptagFanCtrl->ptagAMDGPU;
+  TagFanConfigAMDGPU *ptagNew;
+  TagFanCtrl tagShadow;
+  int iSameDevice;
+  int iKeepPowerCap;
+  int iRc;
+
+  if(!ptagOld)
+  {
+    ERR_PUTS("Reload needs an initialized AMDGPU device");
+    return(1);
+  }
+#ifndef FANCTRL_STATIC
+  if(iFanCtrl_VerifyTiming_m(uiUpdateDelayTime,ptagHysteresis))
+    return(2);
+#endif /* !FANCTRL_STATIC */
+
+  /* The new device is built aside, the running one is not touched until it is published */
+  tagShadow=*ptagFanCtrl;
+  tagShadow.uiUpdateDelayTime=uiUpdateDelayTime;
+  tagShadow.tagHysteresis=*ptagHysteresis;
+  tagShadow.ptagAMDGPU=NULL;
+  if((iRc=iFanCtrl_AMDGPU_Build_m(&tagShadow,
+                                  ptagOld,
+                                  pConfig,
+                                  ptagSensors,
+                                  uiSensorsCount,
+                                  ptagTemps,
+                                  uiTempsCount,
+                                  ptagProfiles,
+                                  uiProfilesCount)))
+    return(iRc);
+  ptagNew=tagShadow.ptagAMDGPU;
+  /* Another fan is switched to manual mode, before the handles are taken from the running device */
+  iSameDevice=iFanCtrl_AMDGPU_SameDevice_m(ptagNew,ptagOld);
+  if((!iSameDevice) &&
+     (iFanCtrl_AMDGPU_Start_m(&tagShadow) != RUN_RET_OK))
+  {
+    ERR_PRINTF("Reload: Starting the new device \"%s\" failed",
+               ptagNew->pcPathSetFanCtrlMode);
+    amdgpu_SetMode(&tagShadow,0);
+    vFanCtrl_Free_m(ptagNew);
+    return(3);
+  }
+  if(iFanCtrl_AMDGPU_OpenHandles_m(&tagShadow,ptagOld))
+  {
+    if(!iSameDevice)
+      amdgpu_SetMode(&tagShadow,0);
+    vFanCtrl_Free_m(ptagNew);
+    return(3);
+  }
+  if(iSameDevice)
+    vFanCtrl_AMDGPU_CarryState_m(ptagNew,ptagOld);
+
+  /* A lowered power cap is kept, only if the same cap is controlled further on */
+  iKeepPowerCap=((iSameDevice) &&
+                 (ptagNew->pcPathPowerCap) &&
+                 (ptagOld->pcPathPowerCap) &&
+                 (strcmp(ptagNew->pcPathPowerCap,ptagOld->pcPathPowerCap) == 0) &&
+                 ((ptagNew->iPowerCapTemp) ||
+                  (ptagNew->iPowerCapBoostTemp) ||
+                  (ptagNew->uiStallState == STALL_STATE_FAILED)))?1:0;
+  if(iKeepPowerCap)
+    ptagNew->ulPowerCapUW=ptagOld->ulPowerCapUW;
+  if(!iSameDevice)
+    fanCtrl_ResetDevices(ptagFanCtrl);
+  else if((!iKeepPowerCap) &&
+          (ptagOld->pcPathPowerCap) &&
+          (ptagOld->ulPowerCapUW != ptagOld->ulPowerCapOrigUW))
+  {
+    LOG_PRINTF("AMDGPU: Power cap %luW -> %luW (reload)",
+               ptagOld->ulPowerCapUW/AMDGPU_RAW_POWER_TO_WATT_DIVISOR,
+               ptagOld->ulPowerCapOrigUW/AMDGPU_RAW_POWER_TO_WATT_DIVISOR);
+    iFanCtrl_AMDGPU_SetPowerCap_m(ptagFanCtrl,ptagOld->ulPowerCapOrigUW);
+  }
+
+  /* Publish, fanCtrl_Run() picks up the new device with the next tick */
+  ptagFanCtrl->uiUpdateDelayTime=uiUpdateDelayTime;
+  ptagFanCtrl->tagHysteresis=*ptagHysteresis;
+  ptagFanCtrl->ptagAMDGPU=ptagNew;
+  vFanCtrl_AMDGPU_Free_m(ptagOld);
+  DBG_PRINTF("AMDGPU: Reloaded @0x%p, %s device, state %s",
+             ptagNew,
+             (iSameDevice)?"same":"new",
+             (iSameDevice)?"kept":"reset");
+  return(0);
+}
+
+#ifndef FANCTRL_STATIC
+int fanCtrl_AMDGPU_Verify(unsigned int uiUpdateDelayTime,
+                          const TagCfg_Hysteresis *ptagHysteresis,
+                          const TagCfg_AMDGPU *pConfig,
+                          const TagCfg_Sensor *ptagSensors,
+                          unsigned int uiSensorsCount,
+                          const TagCfg_Temperatures *ptagTemps,
+                          unsigned int uiTempsCount,
+                          const TagCfg_Profile *ptagProfiles,
+                          unsigned int uiProfilesCount)
 {
+  unsigned int uiWeights;
   unsigned int uiIndex;
+  const TagCfg_Calibration *ptagCalibration=&pConfig->tagCalibration;
+
+  if(iFanCtrl_VerifyTiming_m(uiUpdateDelayTime,ptagHysteresis))
+    return(2);
 
   /* Verify parameters */
   if((uiTempsCount < 2) ||
-     (uiSensorsCount == 0))
+     (uiSensorsCount == 0) ||
+     (uiProfilesCount > FANCTRL_MAX_PROFILES) ||
+     ((uiProfilesCount) && (!ptagProfiles)))
   {
-    ERR_PUTS("Invalid configuration, at least 2 Temperature Points required / 1 sensor required");
+    ERR_PRINTF("Invalid configuration, at least 2 Temperature Points required / 1 sensor required / max. %u profiles",
+               FANCTRL_MAX_PROFILES);
     return(1);
   }
 
-  /* Verify temperatures are in ascending order */
-  for(uiIndex=1;uiIndex < uiTempsCount;++uiIndex)
-  {
-    if((ptagTemps[uiIndex].iTemp            > ptagTemps[uiIndex-1].iTemp) &&
-       (ptagTemps[uiIndex].ucFanSpeedPercent > ptagTemps[uiIndex-1].ucFanSpeedPercent) &&
-       (ptagTemps[uiIndex].iTemp < CFG_LIMIT_MAX_TEMP+1) &&
-       (ptagTemps[uiIndex].ucFanSpeedPercent < 101))
-      continue;
+  if(iFanCtrl_VerifyCurve_m(ptagTemps,uiTempsCount))
+    return(2);
 
-    ERR_PRINTF("Temperatures must be in ascending order, max. Temp=%d, max. Fanspeed=100, is: Temp=%d, Fanspeed=%u",
+  /* Verify critical temperatures */
+  if((pConfig->usCriticalTemp > CFG_LIMIT_MAX_TEMP) ||
+     (pConfig->usEmergencyTemp > CFG_LIMIT_MAX_TEMP) ||
+     (pConfig->usCriticalTickTime == 0) ||
+     (pConfig->usCriticalTickTime > CFG_LIMIT_MAX_DELAY_TIME) ||
+     (pConfig->usCriticalCooldown > CFG_LIMIT_MAX_CRITICAL_COOLDOWN))
+  {
+    ERR_PRINTF("Invalid critical temperature configuration: Critical=%u, Emergency=%u (max. %u), Tick time=%u (1-%u), Cooldown=%u (max. %u)",
+               pConfig->usCriticalTemp,
+               pConfig->usEmergencyTemp,
                CFG_LIMIT_MAX_TEMP,
-               ptagTemps[uiIndex].iTemp,
-               ptagTemps[uiIndex].ucFanSpeedPercent);
+               pConfig->usCriticalTickTime,
+               CFG_LIMIT_MAX_DELAY_TIME,
+               pConfig->usCriticalCooldown,
+               CFG_LIMIT_MAX_CRITICAL_COOLDOWN);
     return(2);
   }
 
-  if(!(ptagFanCtrl->ptagAMDGPU=
-       malloc(sizeof(TagFanConfigAMDGPU)+ sizeof(TagFanCtrlSensor)*uiSensorsCount + sizeof(TagFanCtrlTempPoint)*uiTempsCount)
-     ))
+  /* Verify control mode */
+  if(((pConfig->ucControlMode != CONTROL_MODE_CURVE) &&
+      (pConfig->ucControlMode != CONTROL_MODE_PID) &&
+      (pConfig->ucControlMode != CONTROL_MODE_MPC)) ||
+     ((pConfig->ucControlMode == CONTROL_MODE_PID) &&
+      ((pConfig->usPIDSetpoint == 0) ||
+       (pConfig->usPIDSetpoint > CFG_LIMIT_MAX_TEMP) ||
+       (pConfig->usPIDKp > CFG_LIMIT_MAX_PID_GAIN) ||
+       (pConfig->usPIDKi > CFG_LIMIT_MAX_PID_GAIN) ||
+       (pConfig->usPIDKd > CFG_LIMIT_MAX_PID_GAIN))))
   {
-    ERR_PUTS("malloc() failed");
-    return(3);
+    ERR_PRINTF("Invalid control mode configuration: Mode=%u, PID: Setpoint=%u (1-%u), Kp=%u, Ki=%u, Kd=%u (max. %u)",
+               pConfig->ucControlMode,
+               pConfig->usPIDSetpoint,
+               CFG_LIMIT_MAX_TEMP,
+               pConfig->usPIDKp,
+               pConfig->usPIDKi,
+               pConfig->usPIDKd,
+               CFG_LIMIT_MAX_PID_GAIN);
+    return(2);
   }
-  ptagFanCtrl->ptagAMDGPU->uiSensorsCount=uiSensorsCount;
-  ptagFanCtrl->ptagAMDGPU->uiPointsCount=uiTempsCount;
-  ptagFanCtrl->ptagAMDGPU->iLastUpdateTemp=0;
-  ptagFanCtrl->ptagAMDGPU->pcPathSetFanCtrlMode=pConfig->caPathSetFanCtrlMode;
-  ptagFanCtrl->ptagAMDGPU->pcPathEnableFan=pConfig->caPathEnableFan;
-  ptagFanCtrl->ptagAMDGPU->pcPathSetPWM=pConfig->caPathSetPWM;
-
-  ptagFanCtrl->ptagAMDGPU->ptagSensors=(TagFanCtrlSensor*)(((unsigned char*)ptagFanCtrl->ptagAMDGPU) + sizeof(TagFanConfigAMDGPU));
-  ptagFanCtrl->ptagAMDGPU->ptagPoints=(TagFanCtrlTempPoint*)(((unsigned char*)ptagFanCtrl->ptagAMDGPU) + sizeof(TagFanConfigAMDGPU) + sizeof(TagFanCtrlSensor)*uiSensorsCount);
-
-  DBG_PRINTF("Allocated space for AMDGPU: @0x%p\n"
-             "Path: set_mode=\"%s\"\n"
-             "Path: enable_fan=\"%s\"\n"
-             "Path: set_pwm=\"%s\"\n"
-             "->ptagSensors(%u)=@0x%p\n"
-             "->ptagPoints(%u)=@0x%p",
-             ptagFanCtrl->ptagAMDGPU,
-             ptagFanCtrl->ptagAMDGPU->pcPathSetFanCtrlMode,
-             ptagFanCtrl->ptagAMDGPU->pcPathEnableFan,
-             ptagFanCtrl->ptagAMDGPU->pcPathSetPWM,
-             uiSensorsCount,
-             ptagFanCtrl->ptagAMDGPU->ptagSensors,
-             uiTempsCount,
-             ptagFanCtrl->ptagAMDGPU->ptagPoints);
-
-  for(uiIndex=0; uiIndex < uiSensorsCount;++uiIndex) /* Initialize Sensors */
+  if((pConfig->ucControlMode == CONTROL_MODE_MPC) &&
+     ((pConfig->usMPCTarget == 0) ||
+      (pConfig->usMPCTarget > CFG_LIMIT_MAX_TEMP) ||
+      (pConfig->usMPCHorizon == 0) ||
+      (pConfig->usMPCHorizon > CFG_LIMIT_MAX_MPC_HORIZON) ||
+      (pConfig->usMPCForgetting < CFG_LIMIT_MIN_MPC_FORGETTING) ||
+      (pConfig->usMPCForgetting > CFG_LIMIT_MAX_MPC_FORGETTING)))
   {
-    DBG_PRINTF("AMDGPU: Sensor[%u]=\"%s\"",
-               uiIndex,
-               ptagSensors[uiIndex].caSensorReadPath);
-    ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex].pcSensorReadPath=ptagSensors[uiIndex].caSensorReadPath;
+    ERR_PRINTF("Invalid MPC configuration: Target=%u (1-%u), Horizon=%u (1-%u), Forgetting=%u (%u-%u)",
+               pConfig->usMPCTarget,
+               CFG_LIMIT_MAX_TEMP,
+               pConfig->usMPCHorizon,
+               CFG_LIMIT_MAX_MPC_HORIZON,
+               pConfig->usMPCForgetting,
+               CFG_LIMIT_MIN_MPC_FORGETTING,
+               CFG_LIMIT_MAX_MPC_FORGETTING);
+    return(2);
   }
 
-  for(uiIndex=0; uiIndex < uiTempsCount;++uiIndex) /* Initialize Temperature points */
+  /* Verify feed-forward */
+  if((pConfig->usFeedForwardPower > CFG_LIMIT_MAX_FEEDFORWARD_GAIN) ||
+     (pConfig->usFeedForwardBusy > CFG_LIMIT_MAX_FEEDFORWARD_GAIN) ||
+     ((pConfig->usFeedForwardPower) && (!pConfig->caPathPowerRead[0])) ||
+     ((pConfig->usFeedForwardBusy) && (!pConfig->caPathBusyRead[0])) ||
+     (pConfig->usFeedForwardDecay == 0) ||
+     (pConfig->usFeedForwardDecay > CFG_LIMIT_MAX_FEEDFORWARD_DECAY))
   {
-    DBG_PRINTF("AMDGPU: Temperature Point[%u]: Temp=%d, fanspeed=%u%%, %u PWM(calculated) ",
-               uiIndex,
-               ptagTemps[uiIndex].iTemp,
-               ptagTemps[uiIndex].ucFanSpeedPercent,
-               (unsigned int)(AMDGPU_FANSPEED_PERCENT_TO_PWM*ptagTemps[uiIndex].ucFanSpeedPercent+0.5));
-    ptagFanCtrl->ptagAMDGPU->ptagPoints[uiIndex].iTemp=ptagTemps[uiIndex].iTemp;
-    ptagFanCtrl->ptagAMDGPU->ptagPoints[uiIndex].uiFanSpeedPWM=(unsigned int)(AMDGPU_FANSPEED_PERCENT_TO_PWM*ptagTemps[uiIndex].ucFanSpeedPercent+0.5);
+    ERR_PRINTF("Invalid feed-forward configuration: Power=%u, Busy=%u (max. %u, requires the sensor path), Decay=%u (1-%u)",
+               pConfig->usFeedForwardPower,
+               pConfig->usFeedForwardBusy,
+               CFG_LIMIT_MAX_FEEDFORWARD_GAIN,
+               pConfig->usFeedForwardDecay,
+               CFG_LIMIT_MAX_FEEDFORWARD_DECAY);
+    return(2);
   }
-  if(ptagFanCtrl->ptagAMDGPU->ptagPoints[0].uiFanSpeedPWM == 0) /* Uses Zero-Fan mode, needs adjustment to work properly */
+
+  /* Verify throttle detection */
+  if((pConfig->usThrottleTemp) &&
+     ((pConfig->usThrottleTemp > CFG_LIMIT_MAX_TEMP) ||
+      (!pConfig->caPathClockRead[0]) ||
+      (!pConfig->caPathBusyRead[0]) ||
+      (pConfig->usThrottleClock == 0) ||
+      (pConfig->usThrottleClock > 100) ||
+      (pConfig->usThrottleBusy > 100) ||
+      (pConfig->usThrottleBiasStep == 0) ||
+      (pConfig->usThrottleBiasStep > CFG_LIMIT_MAX_THROTTLE_BIAS_STEP)))
   {
-    DBG_PRINTF("Using Zero-Fan mode for low Temperature, adjusting point[0].temp to point[1].temp(%d)-1",
-               ptagTemps[1].iTemp);
-    ptagFanCtrl->ptagAMDGPU->ptagPoints[0].iTemp=ptagTemps[1].iTemp-1;
+    ERR_PRINTF("Invalid throttle detection configuration: Temp=%u (max. %u, requires the GPU clock and load path), Clock=%u (1-100), Busy=%u (0-100), Bias step=%u (1-%u)",
+               pConfig->usThrottleTemp,
+               CFG_LIMIT_MAX_TEMP,
+               pConfig->usThrottleClock,
+               pConfig->usThrottleBusy,
+               pConfig->usThrottleBiasStep,
+               CFG_LIMIT_MAX_THROTTLE_BIAS_STEP);
+    return(2);
   }
 
-  return(0);
-}
+  /* Verify power cap, it is compared to the current cap at init */
+  if((pConfig->usPowerCapTemp) &&
+     ((pConfig->usPowerCapTemp > CFG_LIMIT_MAX_TEMP) ||
+      (!pConfig->caPathPowerCap[0]) ||
+      (pConfig->usPowerCapMin == 0) ||
+      (pConfig->usPowerCapStep == 0) ||
+      (pConfig->usPowerCapHysteresis > CFG_LIMIT_MAX_POWER_CAP_HYSTERESIS)))
+  {
+    ERR_PRINTF("Invalid power cap configuration: Temp=%u (max. %u, requires the power cap path), Min=%uW (min. 1), Step=%uW (min. 1), Hysteresis=%u (max. %u)",
+               pConfig->usPowerCapTemp,
+               CFG_LIMIT_MAX_TEMP,
+               pConfig->usPowerCapMin,
+               pConfig->usPowerCapStep,
+               pConfig->usPowerCapHysteresis,
+               CFG_LIMIT_MAX_POWER_CAP_HYSTERESIS);
+    return(2);
+  }
 
-int fanCtrl_Run(TagFanCtrl *ptagFanCtrl)
-{
-  struct timespec tagWaitTime;
-  int iHighestSensorTempVal;
-  unsigned int uiIndex;
-  unsigned int uiCurrPWM;
-  int iCurrFanState;
-  int iSensorReadRetryCount;
-  float fTmp;
+  /* Verify power cap boost, the max. cap is read at init */
+  if((pConfig->usPowerCapBoostTemp) &&
+     ((pConfig->usPowerCapBoostTemp > CFG_LIMIT_MAX_TEMP) ||
+      (!pConfig->caPathPowerCap[0]) ||
+      (pConfig->usPowerCapStep == 0) ||
+      (pConfig->usPowerCapBoostFanSpeed == 0) ||
+      (pConfig->usPowerCapBoostFanSpeed > 100) ||
+      (pConfig->usPowerCapHysteresis > CFG_LIMIT_MAX_POWER_CAP_HYSTERESIS)))
+  {
+    ERR_PRINTF("Invalid power cap boost configuration: Temp=%u (max. %u, requires the power cap path), Step=%uW (min. 1), Fanspeed=%u (1-100), Hysteresis=%u (max. %u)",
+               pConfig->usPowerCapBoostTemp,
+               CFG_LIMIT_MAX_TEMP,
+               pConfig->usPowerCapStep,
+               pConfig->usPowerCapBoostFanSpeed,
+               pConfig->usPowerCapHysteresis,
+               CFG_LIMIT_MAX_POWER_CAP_HYSTERESIS);
+    return(2);
+  }
 
-  if(ptagFanCtrl->ptagAMDGPU)
+  /* Verify profiles */
+  if(pConfig->usProfileFade > CFG_LIMIT_MAX_PROFILE_FADE)
   {
-    if(amdgpu_SetMode(ptagFanCtrl,1))
-    {
-      DBG_PUTS("amdgpu_SetMode() failed");
-      return(RUN_RET_ERR_INIT);
-    }
-    /* Initial enable fan */
-    if(iFanCtrl_EnableFan(eFanCtrlType_AMDGPU,
-                          ptagFanCtrl->ptagAMDGPU->pcPathEnableFan,
-                          1))
+    ERR_PRINTF("Invalid profile cross-fade: %u (max. %u)",
+               pConfig->usProfileFade,
+               CFG_LIMIT_MAX_PROFILE_FADE);
+    return(2);
+  }
+  for(uiIndex=0;uiIndex < uiProfilesCount;++uiIndex)
+  {
+    if((!ptagProfiles[uiIndex].caName[0]) ||
+       (ptagProfiles[uiIndex].uiTempsCount < 2) ||
+       (ptagProfiles[uiIndex].usRuleBusy > 100) ||
+       ((ptagProfiles[uiIndex].usRuleBusy) && (!pConfig->caPathBusyRead[0])) ||
+       ((ptagProfiles[uiIndex].caRulePowerProfile[0]) && (!pConfig->caPathPowerProfile[0])) ||
+       ((ptagProfiles[uiIndex].caRuleHint[0]) && (!pConfig->caPathProfileHint[0])) ||
+       ((!ptagProfiles[uiIndex].usRuleBusy) &&
+        (!ptagProfiles[uiIndex].caRulePowerProfile[0]) &&
+        (!ptagProfiles[uiIndex].caRuleHint[0])))
     {
-      DBG_PUTS("iFanCtrl_EnableFan() failed");
-      return(RUN_RET_ERR_FAN_ENABLE);
+      ERR_PRINTF("Invalid profile[%u] \"%s\": Points=%u (min. 2), Busy=%u (max. 100, requires the GPU load path), "
+                 "Power profile=\"%s\" (requires the power profile path), Hint=\"%s\" (requires the hint file path), at least one rule required",
+                 uiIndex,
+                 ptagProfiles[uiIndex].caName,
+                 ptagProfiles[uiIndex].uiTempsCount,
+                 ptagProfiles[uiIndex].usRuleBusy,
+                 ptagProfiles[uiIndex].caRulePowerProfile,
+                 ptagProfiles[uiIndex].caRuleHint);
+      return(2);
     }
-    iCurrFanState=1;
+    if(iFanCtrl_VerifyCurve_m(ptagProfiles[uiIndex].ptagTemps,
+                              ptagProfiles[uiIndex].uiTempsCount))
+      return(2);
   }
 
-  tagWaitTime.tv_nsec=(ptagFanCtrl->uiUpdateDelayTime%10)?(ptagFanCtrl->uiUpdateDelayTime%10) * 100000000:0;
-  tagWaitTime.tv_sec=ptagFanCtrl->uiUpdateDelayTime/10;
-  DBG_PRINTF("Wait time: %ld secs, %" PRIu64 "nsecs",
-             tagWaitTime.tv_sec,
-             tagWaitTime.tv_nsec);
+  /* Verify load hints */
+  if((pConfig->caPathHintSocket[0]) &&
+     ((!pConfig->caHintDevice[0]) ||
+      (pConfig->usHintGain > CFG_LIMIT_MAX_HINT_GAIN) ||
+      (pConfig->usHintMaxTTL == 0) ||
+      (pConfig->usHintMaxTTL > CFG_LIMIT_MAX_HINT_TTL) ||
+      (pConfig->usHintSocketMode > CFG_LIMIT_MAX_HINT_SOCKET_MODE) ||
+      (strlen(pConfig->caPathHintSocket) >= sizeof(((struct sockaddr_un*)0)->sun_path))))
+  {
+    ERR_PRINTF("Invalid hint configuration: Device=\"%s\" (required), Gain=%u (max. %u), Max. TTL=%u (1-%u), Socket mode=%04o (max. %04o), Socket=\"%s\" (max. %u characters)",
+               pConfig->caHintDevice,
+               pConfig->usHintGain,
+               CFG_LIMIT_MAX_HINT_GAIN,
+               pConfig->usHintMaxTTL,
+               CFG_LIMIT_MAX_HINT_TTL,
+               pConfig->usHintSocketMode,
+               CFG_LIMIT_MAX_HINT_SOCKET_MODE,
+               pConfig->caPathHintSocket,
+               (unsigned int)sizeof(((struct sockaddr_un*)0)->sun_path)-1);
+    return(2);
+  }
 
-  iSensorReadRetryCount=0;
-  while((*ptagFanCtrl->puiQuitRunFlag) == 0)
+  /* Verify sensor filters */
+  for(uiIndex=0;uiIndex < uiSensorsCount;++uiIndex)
   {
-    nanosleep(&tagWaitTime,NULL);
-    DBG_PRINTF("Timestamp=%" PRIu64 ", update temperatures...",time(NULL));
-    /* Check if AMDGPU is used */
-    if(ptagFanCtrl->ptagAMDGPU)
+    if(((ptagSensors[uiIndex].ucFilterType == SENSOR_FILTER_NONE)) ||
+       ((ptagSensors[uiIndex].ucFilterType == SENSOR_FILTER_EMA) &&
+        (ptagSensors[uiIndex].ucFilterParam > 0) &&
+        (ptagSensors[uiIndex].ucFilterParam < 101)) ||
+       ((ptagSensors[uiIndex].ucFilterType == SENSOR_FILTER_MEDIAN) &&
+        (ptagSensors[uiIndex].ucFilterParam > 0) &&
+        (ptagSensors[uiIndex].ucFilterParam <= CTRL_FILTER_MEDIAN_MAX_WINDOW)))
     {
-      iHighestSensorTempVal=INT_MIN;
-      /* Read AMDGPU Sensors */
-      for(uiIndex=0;uiIndex < ptagFanCtrl->ptagAMDGPU->uiSensorsCount;++uiIndex)
-      {
-        switch(iFanCtrl_UpdateSensor_m(eFanCtrlType_AMDGPU,
-                                       &ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex]))
-        {
-          case SENSOR_READ_RET_OK: /* OK */
-            iSensorReadRetryCount=0;
-            break;
-          case SENSOR_READ_RET_TRYAGAIN: /* Temporary failure, try again if < max tries */
-            if(iSensorReadRetryCount++ < SENSOR_READ_MAX_RETRIES)
-            {
-              ERR_PRINTF("Temporary failure reading sensor, retry(%d/%d)...",
-                         iSensorReadRetryCount,
-                         SENSOR_READ_MAX_RETRIES);
-              break;
-            }
-            /* Fall-through */
-          case SENSOR_READ_RET_FAILURE: /* quit with error */
-          default:
-            ERR_PUTS("iGpuFanCtrl_UpdateSensor() failed");
-            return(RUN_RET_ERR_SENSOR_READ);
-        }
-        DBG_PRINTF("Current Sensor[%u]\n"
-                   "\"%s\": Rawvalue=%ld, 1/10°C=%u",
-                   uiIndex,
-                   ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex].pcSensorReadPath,
-                   ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex].lRawValue,
-                   ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex].iTempCelsius);
-
-        if(ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex].iTempCelsius > iHighestSensorTempVal)
-          iHighestSensorTempVal=ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex].iTempCelsius;
-      }
-      if(ptagFanCtrl->ptagAMDGPU->iLastUpdateTemp == iHighestSensorTempVal)
-      {/* No temperature change, continue */
-        DBG_PUTS("No Temperature change");
+      if(ptagSensors[uiIndex].ucOversampling <= CFG_LIMIT_MAX_OVERSAMPLING)
         continue;
-      }
-      uiIndex=(iHighestSensorTempVal > ptagFanCtrl->ptagAMDGPU->iLastUpdateTemp)?iHighestSensorTempVal-ptagFanCtrl->ptagAMDGPU->iLastUpdateTemp:ptagFanCtrl->ptagAMDGPU->iLastUpdateTemp-iHighestSensorTempVal;
+    }
+    ERR_PRINTF("Invalid filter for Sensor[%u]: Type=%u, Param=%u, Oversampling=%u (EMA: 1-100%%, Median: 1-%u samples, max. Oversampling=%u)",
+               uiIndex,
+               ptagSensors[uiIndex].ucFilterType,
+               ptagSensors[uiIndex].ucFilterParam,
+               ptagSensors[uiIndex].ucOversampling,
+               CTRL_FILTER_MEDIAN_MAX_WINDOW,
+               CFG_LIMIT_MAX_OVERSAMPLING);
+    return(2);
+  }
 
-      DBG_PRINTF("iLastUpdateTemp=%d Temperature change=%u, HysteresisTemp=%u, ",
-                 ptagFanCtrl->ptagAMDGPU->iLastUpdateTemp,
+  /* Verify per-sensor curves and weights */
+  uiWeights=0;
+  for(uiIndex=0;uiIndex < uiSensorsCount;++uiIndex)
+  {
+    if((ptagSensors[uiIndex].ucWeight > 100) ||
+       ((ptagSensors[uiIndex].ptagTemps) && (ptagSensors[uiIndex].uiTempsCount < 2)))
+    {
+      ERR_PRINTF("Invalid curve for Sensor[%u]: Weight=%u (max. 100), Points=%u (min. 2)",
                  uiIndex,
-                 (unsigned int)((float)ptagFanCtrl->ucTempHysteresisPercent*ptagFanCtrl->ptagAMDGPU->iLastUpdateTemp/100.0+0.5));
-      if(uiIndex < (unsigned int)((float)ptagFanCtrl->ucTempHysteresisPercent*ptagFanCtrl->ptagAMDGPU->iLastUpdateTemp/100.0+0.5))
-      {/* No Fanspeed update needed */
-        DBG_PUTS("No Fanspeed update required, temperature hysteresis below configured value");
-        continue;
-      }
-      ptagFanCtrl->ptagAMDGPU->iLastUpdateTemp=iHighestSensorTempVal;
+                 ptagSensors[uiIndex].ucWeight,
+                 ptagSensors[uiIndex].uiTempsCount);
+      return(2);
+    }
+    uiWeights+=ptagSensors[uiIndex].ucWeight;
+    if((ptagSensors[uiIndex].ptagTemps) &&
+       (iFanCtrl_VerifyCurve_m(ptagSensors[uiIndex].ptagTemps,
+                               ptagSensors[uiIndex].uiTempsCount)))
+      return(2);
+  }
+  if(((pConfig->ucSensorReducer != SENSOR_REDUCER_MAX) &&
+      (pConfig->ucSensorReducer != SENSOR_REDUCER_MEAN)) ||
+     (uiWeights == 0))
+  {
+    ERR_PRINTF("Invalid sensor reducer configuration: Reducer=%u, at least one sensor with a weight above 0 required",
+               pConfig->ucSensorReducer);
+    return(2);
+  }
+  if((pConfig->ucCurveInterpolation != CURVE_INTERPOLATION_LINEAR) &&
+     (pConfig->ucCurveInterpolation != CURVE_INTERPOLATION_SPLINE))
+  {
+    ERR_PRINTF("Invalid curve interpolation: %u",
+               pConfig->ucCurveInterpolation);
+    return(2);
+  }
 
-      /* Update AMDGPU Fanspeed if needed */
-      for(uiIndex=0;uiIndex < ptagFanCtrl->ptagAMDGPU->uiPointsCount;++uiIndex)
-      {/* Find closest defined temperature point */
-        if(iHighestSensorTempVal > ptagFanCtrl->ptagAMDGPU->ptagPoints[uiIndex].iTemp)
-          continue;
-        break;
-      }
+  /* Verify RPM mode, it needs the target RPM or the tachometer for the inner loop */
+  if(((pConfig->ucFanMode != FAN_MODE_PWM) &&
+      (pConfig->ucFanMode != FAN_MODE_RPM)) ||
+     ((pConfig->ucFanMode == FAN_MODE_RPM) &&
+      ((pConfig->usFanRPMMax == 0) ||
+       (pConfig->usFanRPMMax > CFG_LIMIT_MAX_FAN_RPM) ||
+       (pConfig->usFanRPMGain == 0) ||
+       (pConfig->usFanRPMGain > CFG_LIMIT_MAX_FAN_RPM_GAIN) ||
+       (pConfig->ucFanRPMSubTicks == 0) ||
+       (pConfig->ucFanRPMSubTicks > CFG_LIMIT_MAX_OVERSAMPLING) ||
+       ((!pConfig->caPathFanTarget[0]) &&
+        (!pConfig->caPathFanInput[0])))))
+  {
+    ERR_PRINTF("Invalid RPM mode configuration: Mode=%u, Max.=%u RPM (1-%u), Gain=%u (1-%u), Steps=%u (1-%u), "
+               "requires the target \"%s\" or the input \"%s\"",
+               pConfig->ucFanMode,
+               pConfig->usFanRPMMax,
+               CFG_LIMIT_MAX_FAN_RPM,
+               pConfig->usFanRPMGain,
+               CFG_LIMIT_MAX_FAN_RPM_GAIN,
+               pConfig->ucFanRPMSubTicks,
+               CFG_LIMIT_MAX_OVERSAMPLING,
+               pConfig->caPathFanTarget,
+               pConfig->caPathFanInput);
+    return(2);
+  }
 
-      if(ptagFanCtrl->ptagAMDGPU->ptagPoints[uiIndex].uiFanSpeedPWM)
-      {
-        if((uiIndex == 0) ||
-           (uiIndex == ptagFanCtrl->ptagAMDGPU->uiPointsCount) ||
-           (ptagFanCtrl->ptagAMDGPU->ptagPoints[uiIndex].iTemp==iHighestSensorTempVal))
-        {/* Is bigger than highest or lower than lowest temperature point or exactly on one point */
-          if(uiIndex == ptagFanCtrl->ptagAMDGPU->uiPointsCount)
-            --uiIndex;
-
-          uiCurrPWM=ptagFanCtrl->ptagAMDGPU->ptagPoints[uiIndex].uiFanSpeedPWM*100;
-        }
-        else /* Target is between 2 defined points */
+  /* Verify stall detection, it needs the tachometer */
+  if((pConfig->usStallFanSpeed) &&
+     ((pConfig->usStallFanSpeed > 100) ||
+      (!pConfig->caPathFanInput[0]) ||
+      (pConfig->usStallTime == 0) ||
+      (pConfig->usStallTime > CFG_LIMIT_MAX_STALL_TIME) ||
+      (pConfig->usStallKickTime == 0) ||
+      (pConfig->usStallKickTime > CFG_LIMIT_MAX_STALL_TIME) ||
+      ((pConfig->usStallPowerCap) &&
+       (!pConfig->caPathPowerCap[0]))))
+  {
+    ERR_PRINTF("Invalid stall detection configuration: Fanspeed=%u%% (max. 100), Time=%u, Kick time=%u (1-%u), Power cap=%uW, "
+               "requires the input \"%s\" and the power cap path for the power cap",
+               pConfig->usStallFanSpeed,
+               pConfig->usStallTime,
+               pConfig->usStallKickTime,
+               CFG_LIMIT_MAX_STALL_TIME,
+               pConfig->usStallPowerCap,
+               pConfig->caPathFanInput);
+    return(2);
+  }
+
+  /* Verify the zero-RPM state machine, the stop temperature must be below the start temperature */
+  if((pConfig->usZeroRPMStartTemp) &&
+     ((pConfig->usZeroRPMStopTemp >= pConfig->usZeroRPMStartTemp) ||
+      (pConfig->usZeroRPMMinOnTime > CFG_LIMIT_MAX_ZERO_RPM_TIME) ||
+      (pConfig->usZeroRPMMinOffTime > CFG_LIMIT_MAX_ZERO_RPM_TIME) ||
+      (pConfig->usZeroRPMKickTime > CFG_LIMIT_MAX_ZERO_RPM_KICK_TIME)))
+  {
+    ERR_PRINTF("Invalid zero-RPM configuration: Start temp.=%u, Stop temp.=%u (must be below the start temp.), "
+               "Min. on time=%u, Min. off time=%u (max. %u), Kick time=%u (max. %u)",
+               pConfig->usZeroRPMStartTemp,
+               pConfig->usZeroRPMStopTemp,
+               pConfig->usZeroRPMMinOnTime,
+               pConfig->usZeroRPMMinOffTime,
+               CFG_LIMIT_MAX_ZERO_RPM_TIME,
+               pConfig->usZeroRPMKickTime,
+               CFG_LIMIT_MAX_ZERO_RPM_KICK_TIME);
+    return(2);
+  }
+
+  if((pConfig->caPathState[0]) &&
+     (uiSensorsCount > STATE_FILE_MAX_SENSORS))
+  {
+    ERR_PRINTF("The state file supports max. %u sensors, %u configured",
+               STATE_FILE_MAX_SENSORS,
+               uiSensorsCount);
+    return(2);
+  }
+
+  if((pConfig->usSlewRateUp > CFG_LIMIT_MAX_SLEW_RATE) ||
+     (pConfig->usSlewRateDown > CFG_LIMIT_MAX_SLEW_RATE))
+  {
+    ERR_PRINTF("Invalid slew rate: Up=%u, Down=%u PWM/s (max. %u)",
+               pConfig->usSlewRateUp,
+               pConfig->usSlewRateDown,
+               CFG_LIMIT_MAX_SLEW_RATE);
+    return(2);
+  }
+
+  /* Verify the fan calibration, the points must be ascending by PWM */
+  for(uiIndex=1;uiIndex < ptagCalibration->ucPointsCount;++uiIndex)
+  {
+    if(ptagCalibration->tagaPoints[uiIndex].ucPWM <= ptagCalibration->tagaPoints[uiIndex-1].ucPWM)
+      break;
+  }
+  if((ptagCalibration->ucPointsCount == 1) ||
+     (ptagCalibration->ucPointsCount > FANCTRL_CALIBRATION_MAX_POINTS) ||
+     (uiIndex < ptagCalibration->ucPointsCount) ||
+     ((ptagCalibration->ucPointsCount) &&
+      (!ptagCalibration->tagaPoints[ptagCalibration->ucPointsCount-1].usRPM)))
+  {
+    ERR_PRINTF("Invalid fan calibration: %u points (2-%u), must be ascending by PWM and the fan must spin at the last point",
+               ptagCalibration->ucPointsCount,
+               FANCTRL_CALIBRATION_MAX_POINTS);
+    return(2);
+  }
+
+  return(0);
+}
+#endif /* !FANCTRL_STATIC */
+
+/**
+ * Validates the configuration and builds the runtime block of the device: Sensors, curves and LUTs in one allocation.
+ * On success ptagFanCtrl->ptagAMDGPU is set. Handles (hint socket, state file) are not opened here,
+ * see iFanCtrl_AMDGPU_OpenHandles_m().
+ *
+ * @param ptagPrev _IN_ Running device on a reload, its original power cap is taken over. NULL at init.
+ *
+ * @return 0 on success, nonzero on error, see fanCtrl_AMDGPU_Init().
+ */
+static int iFanCtrl_AMDGPU_Build_m(TagFanCtrl *ptagFanCtrl,
+                                   const TagFanConfigAMDGPU *ptagPrev,
+                                   const TagCfg_AMDGPU *pConfig,
+                                   const TagCfg_Sensor *ptagSensors,
+                                   unsigned int uiSensorsCount,
+                                   const TagCfg_Temperatures *ptagTemps,
+                                   unsigned int uiTempsCount,
+                                   const TagCfg_Profile *ptagProfiles,
+                                   unsigned int uiProfilesCount)
+{
+  TagFanCtrlCurve *ptagCurve;
+  TagFanCtrlTempPoint *ptagPoints;
+  unsigned char *pucLUT;
+  unsigned int uiPointsCount;
+  unsigned int uiLUTSize;
+  unsigned int uiIndex;
+  int iFanTarget;
+  const TagCfg_Calibration *ptagCalibration=&pConfig->tagCalibration;
+  long lPowerCapUW=0;
+  long lPowerCapOrigUW=0;
+  long lPowerCapMaxUW=0;
+  int iPowerCapOrigDefault=0;
+  char caPath[sizeof(pConfig->caPathPowerCap)+sizeof(AMDGPU_POWER_CAP_SUFFIX_DEFAULT)]; /* Longest suffix */
+#ifndef FANCTRL_STATIC
+  int iRc;
+#endif /* !FANCTRL_STATIC */
+
+#ifndef FANCTRL_STATIC
+  if((iRc=fanCtrl_AMDGPU_Verify(ptagFanCtrl->uiUpdateDelayTime,
+                                &ptagFanCtrl->tagHysteresis,
+                                pConfig,
+                                ptagSensors,
+                                uiSensorsCount,
+                                ptagTemps,
+                                uiTempsCount,
+                                ptagProfiles,
+                                uiProfilesCount)))
+    return(iRc);
+#endif /* !FANCTRL_STATIC */
+
+  /* Verify the device, the configuration itself is verified by fanCtrl_AMDGPU_Verify() */
+  if((pConfig->caPathPowerRead[0]) &&
+     (access(pConfig->caPathPowerRead,R_OK) != 0))
+  {
+    ERR_PRINTF("Power sensor \"%s\" not readable: %s",
+               pConfig->caPathPowerRead,
+               strerror(errno));
+    return(2);
+  }
+  if((pConfig->caPathBusyRead[0]) &&
+     (access(pConfig->caPathBusyRead,R_OK) != 0))
+  {
+    ERR_PRINTF("GPU load sensor \"%s\" not readable: %s",
+               pConfig->caPathBusyRead,
+               strerror(errno));
+    return(2);
+  }
+
+  if((pConfig->caPathClockRead[0]) &&
+     (access(pConfig->caPathClockRead,R_OK) != 0))
+  {
+    ERR_PRINTF("GPU clock \"%s\" not readable: %s",
+               pConfig->caPathClockRead,
+               strerror(errno));
+    return(2);
+  }
+
+  /* Power cap: The original value is restored on reset. It's the default of the driver, where available.
+     Otherwise the current cap, which may be left lowered by a crashed instance, the state file corrects this */
+  if(pConfig->caPathPowerCap[0])
+  {
+    if(access(pConfig->caPathPowerCap,R_OK|W_OK) != 0)
+    {
+      ERR_PRINTF("Power cap \"%s\" not read-/writeable: %s",
+                 pConfig->caPathPowerCap,
+                 strerror(errno));
+      return(2);
+    }
+    /* On a reload, the running device may have lowered the cap already */
+    if((ptagPrev) &&
+       (ptagPrev->pcPathPowerCap) &&
+       (strcmp(ptagPrev->pcPathPowerCap,pConfig->caPathPowerCap) == 0))
+    {
+      lPowerCapUW=(long)ptagPrev->ulPowerCapOrigUW;
+      lPowerCapOrigUW=lPowerCapUW;
+      iPowerCapOrigDefault=ptagPrev->iPowerCapOrigDefault;
+    }
+    else
+    {
+      if((iFanCtrl_ReadSysfsLong_m(pConfig->caPathPowerCap,&lPowerCapUW) != SENSOR_READ_RET_OK) ||
+         (lPowerCapUW <= 0))
+      {
+        ERR_PRINTF("Reading power cap \"%s\" failed",
+                   pConfig->caPathPowerCap);
+        return(2);
+      }
+      strcpy(caPath,pConfig->caPathPowerCap);
+      strcat(caPath,AMDGPU_POWER_CAP_SUFFIX_DEFAULT);
+      if((access(caPath,R_OK) == 0) &&
+         (iFanCtrl_ReadSysfsLong_m(caPath,&lPowerCapOrigUW) == SENSOR_READ_RET_OK) &&
+         (lPowerCapOrigUW > 0))
+        iPowerCapOrigDefault=1;
+      else
+        lPowerCapOrigUW=lPowerCapUW;
+    }
+  }
+  if((pConfig->usPowerCapTemp) &&
+     ((unsigned long)pConfig->usPowerCapMin*AMDGPU_RAW_POWER_TO_WATT_DIVISOR > (unsigned long)lPowerCapOrigUW))
+  {
+    ERR_PRINTF("Invalid power cap configuration: Min=%uW is above the original cap %ldW",
+               pConfig->usPowerCapMin,
+               lPowerCapOrigUW/AMDGPU_RAW_POWER_TO_WATT_DIVISOR);
+    return(2);
+  }
+  /* Boost: Max. cap provided by the driver, optionally lowered by the configuration */
+  if(pConfig->usPowerCapBoostTemp)
+  {
+    if(pConfig->caPathPowerCap[0])
+    {
+      strcpy(caPath,pConfig->caPathPowerCap);
+      strcat(caPath,AMDGPU_POWER_CAP_SUFFIX_MAX);
+      if((access(caPath,R_OK) != 0) ||
+         (iFanCtrl_ReadSysfsLong_m(caPath,&lPowerCapMaxUW) != SENSOR_READ_RET_OK))
+        lPowerCapMaxUW=0;
+    }
+    if((pConfig->usPowerCapMax) &&
+       ((lPowerCapMaxUW == 0) ||
+        ((long)pConfig->usPowerCapMax*AMDGPU_RAW_POWER_TO_WATT_DIVISOR < lPowerCapMaxUW)))
+      lPowerCapMaxUW=(long)pConfig->usPowerCapMax*AMDGPU_RAW_POWER_TO_WATT_DIVISOR;
+    if(lPowerCapMaxUW <= lPowerCapOrigUW)
+    {
+      ERR_PRINTF("Invalid power cap boost configuration: Max=%ldW must be above the original cap %ldW",
+                 lPowerCapMaxUW/AMDGPU_RAW_POWER_TO_WATT_DIVISOR,
+                 lPowerCapOrigUW/AMDGPU_RAW_POWER_TO_WATT_DIVISOR);
+      return(2);
+    }
+  }
+
+  if((pConfig->caPathPowerProfile[0]) &&
+     (access(pConfig->caPathPowerProfile,R_OK) != 0))
+  {
+    ERR_PRINTF("Power profile \"%s\" not readable: %s",
+               pConfig->caPathPowerProfile,
+               strerror(errno));
+    return(2);
+  }
+
+  /* RPM mode: The target RPM is written directly if the driver supports it, otherwise the inner loop reads the tachometer */
+  iFanTarget=((pConfig->ucFanMode == FAN_MODE_RPM) &&
+              (pConfig->caPathFanTarget[0]) &&
+              (access(pConfig->caPathFanTarget,W_OK) == 0))?1:0;
+  if((pConfig->ucFanMode == FAN_MODE_RPM) &&
+     (!iFanTarget) &&
+     (access(pConfig->caPathFanInput,R_OK) != 0))
+  {
+    ERR_PRINTF("RPM mode requires a writeable target \"%s\" or a readable input \"%s\"",
+               pConfig->caPathFanTarget,
+               pConfig->caPathFanInput);
+    return(2);
+  }
+  /* Stall detection reads the tachometer */
+  if((pConfig->usStallFanSpeed) &&
+     (access(pConfig->caPathFanInput,R_OK) != 0))
+  {
+    ERR_PRINTF("Stall detection requires a readable input \"%s\": %s",
+               pConfig->caPathFanInput,
+               strerror(errno));
+    return(2);
+  }
+
+  if(!(ptagFanCtrl->ptagAMDGPU=
+       pvFanCtrl_Alloc_m(szFanCtrl_AMDGPU_GetBlockSize_m(ptagSensors,
+                                                         uiSensorsCount,
+                                                         ptagTemps,
+                                                         uiTempsCount,
+                                                         ptagProfiles,
+                                                         uiProfilesCount,
+                                                         &uiPointsCount,
+                                                         &uiLUTSize))
+     ))
+  {
+    ERR_PUTS("Out of memory");
+    return(3);
+  }
+  ptagFanCtrl->ptagAMDGPU->uiSensorsCount=uiSensorsCount;
+  ptagFanCtrl->ptagAMDGPU->uiCurvesCount=1+uiProfilesCount;
+  ctrlHysteresis_Init(&ptagFanCtrl->ptagAMDGPU->tagHysteresis,
+                      ptagFanCtrl->tagHysteresis.usRisingDeadband,
+                      ptagFanCtrl->tagHysteresis.usFallingDeadband,
+                      ptagFanCtrl->tagHysteresis.usMinDwellTime*100UL,
+                      ptagFanCtrl->tagHysteresis.usRisingSlopeBypass);
+  ptagFanCtrl->ptagAMDGPU->iFanState=0;
+  ptagFanCtrl->ptagAMDGPU->uiLastPWM=UINT_MAX;
+  ptagFanCtrl->ptagAMDGPU->uiFanMode=pConfig->ucFanMode;
+  ptagFanCtrl->ptagAMDGPU->pcPathFanTarget=(iFanTarget)?pConfig->caPathFanTarget:NULL;
+  ptagFanCtrl->ptagAMDGPU->pcPathFanInput=(pConfig->caPathFanInput[0])?pConfig->caPathFanInput:NULL;
+  ptagFanCtrl->ptagAMDGPU->uiRPMMax=pConfig->usFanRPMMax;
+  ptagFanCtrl->ptagAMDGPU->uiRPMGain=pConfig->usFanRPMGain;
+  ptagFanCtrl->ptagAMDGPU->uiRPMTarget=0;
+  ptagFanCtrl->ptagAMDGPU->lRPMPWM=0;
+  ptagFanCtrl->ptagAMDGPU->uiRPMPWM=UINT_MAX;
+  ptagFanCtrl->ptagAMDGPU->iRPM=0;
+  ptagFanCtrl->ptagAMDGPU->iRPMError=0;
+  ptagFanCtrl->ptagAMDGPU->ulRPMTargetWrites=0;
+  ptagFanCtrl->ptagAMDGPU->ulRPMSteps=0;
+  ptagFanCtrl->ptagAMDGPU->ulRPMSaturated=0;
+  ptagFanCtrl->ptagAMDGPU->ulRPMReadErrors=0;
+  vFanCtrl_AMDGPU_InitCalibration_m(ptagFanCtrl->ptagAMDGPU,
+                                    (pConfig->ucFanMode == FAN_MODE_PWM)?ptagCalibration:NULL);
+  DBG_PRINTF("AMDGPU: Calibration=%u points%s, min. start=%u pwm, min. sustain=%u pwm, max.=%u RPM",
+             ptagCalibration->ucPointsCount,
+             (ptagFanCtrl->ptagAMDGPU->uiCalibrated)?"":" (not used)",
+             ptagCalibration->ucMinStartPWM,
+             ptagCalibration->ucMinSustainPWM,
+             ptagFanCtrl->ptagAMDGPU->uiCalibratedRPMMax);
+  ptagFanCtrl->ptagAMDGPU->uiCriticalTickTime=pConfig->usCriticalTickTime;
+  ptagFanCtrl->ptagAMDGPU->uiCriticalCooldown=pConfig->usCriticalCooldown;
+  ptagFanCtrl->ptagAMDGPU->iCriticalActive=0;
+  ptagFanCtrl->ptagAMDGPU->iCriticalPWMPending=0;
+  ptagFanCtrl->ptagAMDGPU->ulCriticalSinceMs=0;
+  ptagFanCtrl->ptagAMDGPU->ulCriticalBelowSinceMs=0;
+  ptagFanCtrl->ptagAMDGPU->ulPWMWrites=0;
+  ptagFanCtrl->ptagAMDGPU->ulFanEnableWrites=0;
+  ptagFanCtrl->ptagAMDGPU->ulFanEnableLastMs=0;
+  ptagFanCtrl->ptagAMDGPU->ulFanEnableMinIntervalMs=ULONG_MAX;
+  ptagFanCtrl->ptagAMDGPU->ulCriticalEvents=0;
+  ptagFanCtrl->ptagAMDGPU->ulEmergencyEvents=0;
+  ptagFanCtrl->ptagAMDGPU->ulCriticalLastLatencyMs=0;
+  ptagFanCtrl->ptagAMDGPU->ulCriticalMaxLatencyMs=0;
+  ptagFanCtrl->ptagAMDGPU->ulPowerReadErrors=0;
+  ptagFanCtrl->ptagAMDGPU->pcPathPowerRead=(pConfig->caPathPowerRead[0])?pConfig->caPathPowerRead:NULL;
+  ptagFanCtrl->ptagAMDGPU->iPowerW=0;
+  ptagFanCtrl->ptagAMDGPU->ulBusyReadErrors=0;
+  ptagFanCtrl->ptagAMDGPU->pcPathBusyRead=(pConfig->caPathBusyRead[0])?pConfig->caPathBusyRead:NULL;
+  ptagFanCtrl->ptagAMDGPU->iBusyPercent=0;
+  ctrlFeedForward_Init(&ptagFanCtrl->ptagAMDGPU->tagFeedForwardPower,
+                       pConfig->usFeedForwardPower,
+                       pConfig->usFeedForwardDecay*100UL);
+  ctrlFeedForward_Init(&ptagFanCtrl->ptagAMDGPU->tagFeedForwardBusy,
+                       pConfig->usFeedForwardBusy,
+                       pConfig->usFeedForwardDecay*100UL);
+  ptagFanCtrl->ptagAMDGPU->uiFeedForwardPWM=0;
+  ptagFanCtrl->ptagAMDGPU->uiFeedForwardMaxPWM=0;
+  ptagFanCtrl->ptagAMDGPU->ulFeedForwardLastMs=0;
+  ptagFanCtrl->ptagAMDGPU->pcPathClockRead=(pConfig->caPathClockRead[0])?pConfig->caPathClockRead:NULL;
+  ptagFanCtrl->ptagAMDGPU->uiClockMHz=0;
+  ptagFanCtrl->ptagAMDGPU->uiClockMaxMHz=0;
+  ptagFanCtrl->ptagAMDGPU->iThrottleTemp=pConfig->usThrottleTemp;
+  ptagFanCtrl->ptagAMDGPU->uiThrottleClock=pConfig->usThrottleClock;
+  ptagFanCtrl->ptagAMDGPU->iThrottleBusy=pConfig->usThrottleBusy;
+  ptagFanCtrl->ptagAMDGPU->uiThrottleBiasStep=pConfig->usThrottleBiasStep;
+  ptagFanCtrl->ptagAMDGPU->iThrottled=0;
+  ptagFanCtrl->ptagAMDGPU->uiThrottleBiasPWM=0;
+  ptagFanCtrl->ptagAMDGPU->uiBiasAppliedPWM=0;
+  ptagFanCtrl->ptagAMDGPU->ulClockReadErrors=0;
+  ptagFanCtrl->ptagAMDGPU->ulThrottleEvents=0;
+  ptagFanCtrl->ptagAMDGPU->ulThrottleUpdates=0;
+  ptagFanCtrl->ptagAMDGPU->uiThrottleMaxBiasPWM=0;
+  ptagFanCtrl->ptagAMDGPU->pcPathPowerCap=(pConfig->caPathPowerCap[0])?pConfig->caPathPowerCap:NULL;
+  ptagFanCtrl->ptagAMDGPU->iPowerCapTemp=pConfig->usPowerCapTemp;
+  ptagFanCtrl->ptagAMDGPU->iPowerCapHysteresis=pConfig->usPowerCapHysteresis;
+  ptagFanCtrl->ptagAMDGPU->ulPowerCapOrigUW=(unsigned long)lPowerCapOrigUW;
+  ptagFanCtrl->ptagAMDGPU->iPowerCapOrigDefault=iPowerCapOrigDefault;
+  ptagFanCtrl->ptagAMDGPU->ulPowerCapMinUW=(unsigned long)pConfig->usPowerCapMin*AMDGPU_RAW_POWER_TO_WATT_DIVISOR;
+  ptagFanCtrl->ptagAMDGPU->ulPowerCapStepUW=(unsigned long)pConfig->usPowerCapStep*AMDGPU_RAW_POWER_TO_WATT_DIVISOR;
+  ptagFanCtrl->ptagAMDGPU->ulPowerCapUW=(unsigned long)lPowerCapUW;
+  ptagFanCtrl->ptagAMDGPU->ulPowerCapDecreases=0;
+  ptagFanCtrl->ptagAMDGPU->ulPowerCapIncreases=0;
+  ptagFanCtrl->ptagAMDGPU->ulPowerCapLowestUW=(unsigned long)lPowerCapUW;
+  ptagFanCtrl->ptagAMDGPU->ulPowerCapWriteErrors=0;
+  ptagFanCtrl->ptagAMDGPU->iPowerCapBoostTemp=pConfig->usPowerCapBoostTemp;
+  ptagFanCtrl->ptagAMDGPU->uiPowerCapBoostPWM=AMDGPU_FANSPEED_PERCENT_TO_PWM(pConfig->usPowerCapBoostFanSpeed);
+  ptagFanCtrl->ptagAMDGPU->ulPowerCapMaxUW=(unsigned long)lPowerCapMaxUW;
+  ptagFanCtrl->ptagAMDGPU->ulPowerCapBoostBackoffs=0;
+  ptagFanCtrl->ptagAMDGPU->ulPowerCapHighestUW=(unsigned long)lPowerCapUW;
+  ptagFanCtrl->ptagAMDGPU->uiStallPWM=(pConfig->usStallFanSpeed)?AMDGPU_FANSPEED_PERCENT_TO_PWM(pConfig->usStallFanSpeed):0;
+  ptagFanCtrl->ptagAMDGPU->uiStallTime=pConfig->usStallTime*100U;
+  ptagFanCtrl->ptagAMDGPU->uiStallKickTime=pConfig->usStallKickTime*100U;
+  ptagFanCtrl->ptagAMDGPU->ulStallPowerCapUW=(unsigned long)pConfig->usStallPowerCap*AMDGPU_RAW_POWER_TO_WATT_DIVISOR;
+  ptagFanCtrl->ptagAMDGPU->uiStallState=STALL_STATE_OK;
+  ptagFanCtrl->ptagAMDGPU->ulStallSinceMs=0;
+  ptagFanCtrl->ptagAMDGPU->uiRequestPWM=0;
+  ptagFanCtrl->ptagAMDGPU->ulStallEvents=0;
+  ptagFanCtrl->ptagAMDGPU->ulStallKickRecoveries=0;
+  ptagFanCtrl->ptagAMDGPU->ulFanFailures=0;
+  ptagFanCtrl->ptagAMDGPU->ulStallReadErrors=0;
+  ptagFanCtrl->ptagAMDGPU->tStallLastFault=0;
+  ptagFanCtrl->ptagAMDGPU->iZeroRPMStartTemp=pConfig->usZeroRPMStartTemp;
+  ptagFanCtrl->ptagAMDGPU->iZeroRPMStopTemp=pConfig->usZeroRPMStopTemp;
+  ptagFanCtrl->ptagAMDGPU->uiZeroRPMMinOnTime=pConfig->usZeroRPMMinOnTime*100U;
+  ptagFanCtrl->ptagAMDGPU->uiZeroRPMMinOffTime=pConfig->usZeroRPMMinOffTime*100U;
+  ptagFanCtrl->ptagAMDGPU->uiZeroRPMKickTime=pConfig->usZeroRPMKickTime*100U;
+  ptagFanCtrl->ptagAMDGPU->uiZeroRPMState=ZERO_RPM_STATE_ON; /* The fan is enabled at start */
+  ptagFanCtrl->ptagAMDGPU->ulZeroRPMSinceMs=ulFanCtrl_GetTimeMs_m();
+  ptagFanCtrl->ptagAMDGPU->ulZeroRPMStartReqMs=0;
+  ptagFanCtrl->ptagAMDGPU->ulZeroRPMStarts=0;
+  ptagFanCtrl->ptagAMDGPU->ulZeroRPMStops=0;
+  ptagFanCtrl->ptagAMDGPU->ulZeroRPMKicks=0;
+  ptagFanCtrl->ptagAMDGPU->ulZeroRPMLastLatencyMs=0;
+  ptagFanCtrl->ptagAMDGPU->ulZeroRPMMaxLatencyMs=0;
+  ptagFanCtrl->ptagAMDGPU->uiSlewUp=pConfig->usSlewRateUp;
+  ptagFanCtrl->ptagAMDGPU->uiSlewDown=pConfig->usSlewRateDown;
+  ptagFanCtrl->ptagAMDGPU->iSlewCriticalUnlimited=(pConfig->ucSlewCriticalUnlimited)?1:0;
+  ptagFanCtrl->ptagAMDGPU->lSlewPWM=-1;
+  ptagFanCtrl->ptagAMDGPU->ulSlewLastMs=0;
+  ptagFanCtrl->ptagAMDGPU->uiSlewStepMs=0; /* Sampling steps are known at the end of the initialization */
+  ptagFanCtrl->ptagAMDGPU->ulSlewClips=0;
+  ptagFanCtrl->ptagAMDGPU->uiSlewMaxClipPWM=0;
+  ptagFanCtrl->ptagAMDGPU->uiFadeTicks=(pConfig->usProfileFade)?pConfig->usProfileFade:1;
+  ptagFanCtrl->ptagAMDGPU->uiFadeTick=0;
+  ptagFanCtrl->ptagAMDGPU->uiSensorReducer=pConfig->ucSensorReducer;
+  ptagFanCtrl->ptagAMDGPU->pcPathPowerProfile=(pConfig->caPathPowerProfile[0])?pConfig->caPathPowerProfile:NULL;
+  ptagFanCtrl->ptagAMDGPU->pcPathProfileHint=(pConfig->caPathProfileHint[0])?pConfig->caPathProfileHint:NULL;
+  ptagFanCtrl->ptagAMDGPU->caPowerProfile[0]='\0';
+  ptagFanCtrl->ptagAMDGPU->caProfileHint[0]='\0';
+  ptagFanCtrl->ptagAMDGPU->ulProfileSwitches=0;
+  ptagFanCtrl->ptagAMDGPU->ulProfileReadErrors=0;
+  ptagFanCtrl->ptagAMDGPU->pcPathHintSocket=(pConfig->caPathHintSocket[0])?pConfig->caPathHintSocket:NULL;
+  ptagFanCtrl->ptagAMDGPU->pcHintDevice=pConfig->caHintDevice;
+  ptagFanCtrl->ptagAMDGPU->iHintSocket=-1;
+  ptagFanCtrl->ptagAMDGPU->uiHintSocketMode=pConfig->usHintSocketMode;
+  ptagFanCtrl->ptagAMDGPU->pcHintSocketGroup=(pConfig->caHintSocketGroup[0])?pConfig->caHintSocketGroup:NULL;
+  ptagFanCtrl->ptagAMDGPU->pcPathState=(pConfig->caPathState[0])?pConfig->caPathState:NULL;
+  ptagFanCtrl->ptagAMDGPU->ptagState=NULL;
+  ptagFanCtrl->ptagAMDGPU->uiStateSlot=0;
+  ptagFanCtrl->ptagAMDGPU->ulStateMaxAgeMs=pConfig->usStateMaxAge*1000UL;
+  ptagFanCtrl->ptagAMDGPU->ulStateLastMs=0;
+  ptagFanCtrl->ptagAMDGPU->ulStateWrites=0;
+  ptagFanCtrl->ptagAMDGPU->ulStateRestoredAgeMs=ULONG_MAX;
+  ptagFanCtrl->ptagAMDGPU->uiHintGain=pConfig->usHintGain;
+  ptagFanCtrl->ptagAMDGPU->ulHintMaxTTLMs=pConfig->usHintMaxTTL*1000UL;
+  ptagFanCtrl->ptagAMDGPU->iHintPowerW=0;
+  ptagFanCtrl->ptagAMDGPU->ulHintExpiresMs=0;
+  ptagFanCtrl->ptagAMDGPU->uiHintPWM=0;
+  ptagFanCtrl->ptagAMDGPU->ulHintsReceived=0;
+  ptagFanCtrl->ptagAMDGPU->ulHintsRejected=0;
+  ptagFanCtrl->ptagAMDGPU->ulHintsExpired=0;
+  ptagFanCtrl->ptagAMDGPU->ulHintUpdates=0;
+  ptagFanCtrl->ptagAMDGPU->uiHintMaxPWM=0;
+  ptagFanCtrl->ptagAMDGPU->uiSubTicks=1;
+  ptagFanCtrl->ptagAMDGPU->pcPathSetFanCtrlMode=pConfig->caPathSetFanCtrlMode;
+  ptagFanCtrl->ptagAMDGPU->pcPathEnableFan=pConfig->caPathEnableFan;
+  ptagFanCtrl->ptagAMDGPU->pcPathSetPWM=pConfig->caPathSetPWM;
+
+  ptagFanCtrl->ptagAMDGPU->ptagSensors=(TagFanCtrlSensor*)(((unsigned char*)ptagFanCtrl->ptagAMDGPU) + sizeof(TagFanConfigAMDGPU));
+  ptagFanCtrl->ptagAMDGPU->ptagCurves=(TagFanCtrlCurve*)(((unsigned char*)ptagFanCtrl->ptagAMDGPU->ptagSensors) + sizeof(TagFanCtrlSensor)*uiSensorsCount);
+  ptagPoints=(TagFanCtrlTempPoint*)(ptagFanCtrl->ptagAMDGPU->ptagCurves + 1+uiProfilesCount);
+  pucLUT=(unsigned char*)(ptagPoints + uiPointsCount);
+
+  DBG_PRINTF("Allocated space for AMDGPU: @0x%p\n"
+             "Path: set_mode=\"%s\"\n"
+             "Path: enable_fan=\"%s\"\n"
+             "Path: set_pwm=\"%s\"\n"
+             "->ptagSensors(%u)=@0x%p\n"
+             "->ptagCurves(%u)=@0x%p\n"
+             "->Points(%u)=@0x%p\n"
+             "->LUT(%u)=@0x%p",
+             ptagFanCtrl->ptagAMDGPU,
+             ptagFanCtrl->ptagAMDGPU->pcPathSetFanCtrlMode,
+             ptagFanCtrl->ptagAMDGPU->pcPathEnableFan,
+             ptagFanCtrl->ptagAMDGPU->pcPathSetPWM,
+             uiSensorsCount,
+             ptagFanCtrl->ptagAMDGPU->ptagSensors,
+             1+uiProfilesCount,
+             ptagFanCtrl->ptagAMDGPU->ptagCurves,
+             uiPointsCount,
+             ptagPoints,
+             uiLUTSize,
+             pucLUT);
+
+  for(uiIndex=0; uiIndex < uiSensorsCount;++uiIndex) /* Initialize Sensors */
+  {
+    DBG_PRINTF("AMDGPU: Sensor[%u]=\"%s\", Filter=%u, Param=%u, StepBypass=%u, Oversampling=%u",
+               uiIndex,
+               ptagSensors[uiIndex].caSensorReadPath,
+               ptagSensors[uiIndex].ucFilterType,
+               ptagSensors[uiIndex].ucFilterParam,
+               ptagSensors[uiIndex].usFilterStepBypass,
+               ptagSensors[uiIndex].ucOversampling);
+    ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex].pcSensorReadPath=ptagSensors[uiIndex].caSensorReadPath;
+    ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex].uiOversampling=(ptagSensors[uiIndex].ucOversampling)?ptagSensors[uiIndex].ucOversampling:1;
+    if(ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex].uiOversampling > ptagFanCtrl->ptagAMDGPU->uiSubTicks)
+      ptagFanCtrl->ptagAMDGPU->uiSubTicks=ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex].uiOversampling;
+    ctrlFilter_Init(&ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex].tagFilter,
+                    ptagSensors[uiIndex].ucFilterType,
+                    ptagSensors[uiIndex].ucFilterParam,
+                    ptagSensors[uiIndex].usFilterStepBypass);
+    ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex].ulSampleMs=0;
+
+    /* Critical thresholds: Configured value, or the lower one provided by the driver */
+    ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex].iCriticalTemp=pConfig->usCriticalTemp;
+    ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex].iEmergencyTemp=pConfig->usEmergencyTemp;
+    if(pConfig->ucCriticalFromSensors)
+    {
+      iFanCtrl_ReadCriticalTemp_m(ptagSensors[uiIndex].caSensorReadPath,
+                                  AMDGPU_SENSOR_SUFFIX_CRIT,
+                                  &ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex].iCriticalTemp);
+      iFanCtrl_ReadCriticalTemp_m(ptagSensors[uiIndex].caSensorReadPath,
+                                  AMDGPU_SENSOR_SUFFIX_EMERGENCY,
+                                  &ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex].iEmergencyTemp);
+    }
+    DBG_PRINTF("AMDGPU: Sensor[%u]: Critical=%d, Emergency=%d",
+               uiIndex,
+               ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex].iCriticalTemp,
+               ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex].iEmergencyTemp);
+
+    /* Own curve of the sensor, with its own hysteresis */
+    ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex].uiWeight=ptagSensors[uiIndex].ucWeight;
+    ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex].iCurveTemp=0;
+    ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex].ptagCurve=NULL;
+    ctrlHysteresis_Init(&ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex].tagHysteresis,
+                        ptagFanCtrl->tagHysteresis.usRisingDeadband,
+                        ptagFanCtrl->tagHysteresis.usFallingDeadband,
+                        ptagFanCtrl->tagHysteresis.usMinDwellTime*100UL,
+                        ptagFanCtrl->tagHysteresis.usRisingSlopeBypass);
+    DBG_PRINTF("AMDGPU: Sensor[%u]: Weight=%u%%, own curve=%s",
+               uiIndex,
+               ptagSensors[uiIndex].ucWeight,
+               (ptagSensors[uiIndex].ptagTemps)?"yes":"no");
+    if(!ptagSensors[uiIndex].ptagTemps)
+      continue;
+    if(iFanCtrl_InitCurve_m(ptagFanCtrl,
+                            &ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex].tagCurve,
+                            ptagSensors[uiIndex].caSensorReadPath,
+                            ptagPoints,
+                            pucLUT,
+                            pConfig->ucCurveInterpolation,
+                            ptagSensors[uiIndex].ptagTemps,
+                            ptagSensors[uiIndex].uiTempsCount))
+    {
+      vFanCtrl_Free_m(ptagFanCtrl->ptagAMDGPU);
+      ptagFanCtrl->ptagAMDGPU=NULL;
+      return(2);
+    }
+    ptagPoints+=ptagSensors[uiIndex].uiTempsCount;
+    pucLUT+=ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex].tagCurve.uiLUTSize;
+    ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex].ptagCurve=&ptagFanCtrl->ptagAMDGPU->ptagSensors[uiIndex].tagCurve;
+  }
+
+  /* The inner RPM loop runs every sampling step */
+  if((pConfig->ucFanMode == FAN_MODE_RPM) &&
+     (!iFanTarget) &&
+     (pConfig->ucFanRPMSubTicks > ptagFanCtrl->ptagAMDGPU->uiSubTicks))
+    ptagFanCtrl->ptagAMDGPU->uiSubTicks=pConfig->ucFanRPMSubTicks;
+  DBG_PRINTF("AMDGPU: Fan mode=%u, Max.=%u RPM, %s, Gain=%u, Steps=%u, Target=\"%s\", Input=\"%s\"",
+             pConfig->ucFanMode,
+             pConfig->usFanRPMMax,
+             (iFanTarget)?"RPM target":"inner loop",
+             pConfig->usFanRPMGain,
+             pConfig->ucFanRPMSubTicks,
+             pConfig->caPathFanTarget,
+             pConfig->caPathFanInput);
+
+  /* Initialize curves, the profiles follow the curve of the AMDGPU section */
+  ptagCurve=ptagFanCtrl->ptagAMDGPU->ptagCurves;
+  if(iFanCtrl_InitCurve_m(ptagFanCtrl,
+                          ptagCurve,
+                          AMDGPU_PROFILE_NAME_DEFAULT,
+                          ptagPoints,
+                          pucLUT,
+                          pConfig->ucCurveInterpolation,
+                          ptagTemps,
+                          uiTempsCount))
+  {
+    vFanCtrl_Free_m(ptagFanCtrl->ptagAMDGPU);
+    ptagFanCtrl->ptagAMDGPU=NULL;
+    return(2);
+  }
+  ptagPoints+=uiTempsCount;
+  pucLUT+=ptagCurve->uiLUTSize;
+  for(uiIndex=0; uiIndex < uiProfilesCount;++uiIndex)
+  {
+    ++ptagCurve;
+    if(iFanCtrl_InitCurve_m(ptagFanCtrl,
+                            ptagCurve,
+                            ptagProfiles[uiIndex].caName,
+                            ptagPoints,
+                            pucLUT,
+                            pConfig->ucCurveInterpolation,
+                            ptagProfiles[uiIndex].ptagTemps,
+                            ptagProfiles[uiIndex].uiTempsCount))
+    {
+      vFanCtrl_Free_m(ptagFanCtrl->ptagAMDGPU);
+      ptagFanCtrl->ptagAMDGPU=NULL;
+      return(2);
+    }
+    ptagPoints+=ptagProfiles[uiIndex].uiTempsCount;
+    pucLUT+=ptagCurve->uiLUTSize;
+    ptagCurve->iRuleBusy=ptagProfiles[uiIndex].usRuleBusy;
+    ptagCurve->ulRuleBusyTimeMs=ptagProfiles[uiIndex].usRuleBusyTime*100UL;
+    ptagCurve->pcRulePowerProfile=(ptagProfiles[uiIndex].caRulePowerProfile[0])?ptagProfiles[uiIndex].caRulePowerProfile:NULL;
+    ptagCurve->pcRuleHint=(ptagProfiles[uiIndex].caRuleHint[0])?ptagProfiles[uiIndex].caRuleHint:NULL;
+    DBG_PRINTF("AMDGPU: Profile \"%s\": Rules: Busy=%u%% for %u, Power profile=\"%s\", Hint=\"%s\"",
+               ptagCurve->pcName,
+               ptagProfiles[uiIndex].usRuleBusy,
+               ptagProfiles[uiIndex].usRuleBusyTime,
+               ptagProfiles[uiIndex].caRulePowerProfile,
+               ptagProfiles[uiIndex].caRuleHint);
+  }
+  ptagFanCtrl->ptagAMDGPU->ptagCurve=ptagFanCtrl->ptagAMDGPU->ptagCurves;
+  ptagFanCtrl->ptagAMDGPU->ptagCurveFade=NULL;
+  /* Zero-RPM: A running fan gets at least the first running point of the curve */
+  ptagCurve=ptagFanCtrl->ptagAMDGPU->ptagCurves;
+  ptagFanCtrl->ptagAMDGPU->uiZeroRPMMinPWM=(ptagCurve->ptagPoints[0].uiFanSpeedPWM)?ptagCurve->ptagPoints[0].uiFanSpeedPWM:
+                                                                                    ptagCurve->ptagPoints[1].uiFanSpeedPWM;
+  ptagFanCtrl->ptagAMDGPU->ptagCurveApplied=NULL;
+  DBG_PRINTF("AMDGPU: Sensor reducer=%u, Curve interpolation=%u",
+             pConfig->ucSensorReducer,
+             pConfig->ucCurveInterpolation);
+  DBG_PRINTF("AMDGPU: Profiles: Cross-fade=%u, Power profile=\"%s\", Hint file=\"%s\"",
+             pConfig->usProfileFade,
+             pConfig->caPathPowerProfile,
+             pConfig->caPathProfileHint);
+  DBG_PRINTF("AMDGPU: Load hints: Device=\"%s\", Gain=%u, Max. TTL=%u, Socket=\"%s\", Mode=%04o, Group=\"%s\"",
+             pConfig->caHintDevice,
+             pConfig->usHintGain,
+             pConfig->usHintMaxTTL,
+             pConfig->caPathHintSocket,
+             pConfig->usHintSocketMode,
+             pConfig->caHintSocketGroup);
+
+  DBG_PRINTF("AMDGPU: State file=\"%s\", Max. age=%us",
+             pConfig->caPathState,
+             pConfig->usStateMaxAge);
+  ptagFanCtrl->ptagAMDGPU->uiControlMode=pConfig->ucControlMode;
+  ptagFanCtrl->ptagAMDGPU->ulLastUpdateMs=0;
+  /* PID output is limited to the range of the fan curve */
+  ctrlPID_Init(&ptagFanCtrl->ptagAMDGPU->tagPID,
+               pConfig->usPIDSetpoint,
+               pConfig->usPIDKp,
+               pConfig->usPIDKi,
+               pConfig->usPIDKd,
+               ptagFanCtrl->ptagAMDGPU->ptagCurves[0].ptagPoints[0].uiFanSpeedPWM,
+               ptagFanCtrl->ptagAMDGPU->ptagCurves[0].ptagPoints[uiTempsCount-1].uiFanSpeedPWM);
+  ctrlMPC_Init(&ptagFanCtrl->ptagAMDGPU->tagMPC,
+               pConfig->usMPCTarget,
+               pConfig->usMPCHorizon,
+               pConfig->usMPCForgetting,
+               ptagFanCtrl->ptagAMDGPU->ptagCurves[0].ptagPoints[0].uiFanSpeedPWM,
+               ptagFanCtrl->ptagAMDGPU->ptagCurves[0].ptagPoints[uiTempsCount-1].uiFanSpeedPWM);
+  DBG_PRINTF("AMDGPU: Control mode=%u, PID: Setpoint=%u, Kp=%u, Ki=%u, Kd=%u, MPC: Target=%u, Horizon=%u, Forgetting=%u, Power=\"%s\"",
+             pConfig->ucControlMode,
+             pConfig->usPIDSetpoint,
+             pConfig->usPIDKp,
+             pConfig->usPIDKi,
+             pConfig->usPIDKd,
+             pConfig->usMPCTarget,
+             pConfig->usMPCHorizon,
+             pConfig->usMPCForgetting,
+             pConfig->caPathPowerRead);
+  DBG_PRINTF("AMDGPU: Feed-forward: Power=%u, Busy=%u, Decay=%u, GPU load=\"%s\"",
+             pConfig->usFeedForwardPower,
+             pConfig->usFeedForwardBusy,
+             pConfig->usFeedForwardDecay,
+             pConfig->caPathBusyRead);
+  DBG_PRINTF("AMDGPU: Throttle detection: Temp=%u, Clock=%u%%, Busy=%u%%, Bias step=%u, GPU clock=\"%s\"",
+             pConfig->usThrottleTemp,
+             pConfig->usThrottleClock,
+             pConfig->usThrottleBusy,
+             pConfig->usThrottleBiasStep,
+             pConfig->caPathClockRead);
+  DBG_PRINTF("AMDGPU: Power cap: Temp=%u, Min=%uW, Step=%uW, Hysteresis=%u, Original=%ldW%s, Current=%ldW, Boost: Temp=%u, Fanspeed=%u%%, Max=%ldW, Path=\"%s\"",
+             pConfig->usPowerCapTemp,
+             pConfig->usPowerCapMin,
+             pConfig->usPowerCapStep,
+             pConfig->usPowerCapHysteresis,
+             lPowerCapOrigUW/AMDGPU_RAW_POWER_TO_WATT_DIVISOR,
+             (iPowerCapOrigDefault)?" (driver default)":"",
+             lPowerCapUW/AMDGPU_RAW_POWER_TO_WATT_DIVISOR,
+             pConfig->usPowerCapBoostTemp,
+             pConfig->usPowerCapBoostFanSpeed,
+             lPowerCapMaxUW/AMDGPU_RAW_POWER_TO_WATT_DIVISOR,
+             pConfig->caPathPowerCap);
+  DBG_PRINTF("AMDGPU: Stall detection: Fanspeed=%u%%, Time=%u, Kick time=%u, Power cap=%uW",
+             pConfig->usStallFanSpeed,
+             pConfig->usStallTime,
+             pConfig->usStallKickTime,
+             pConfig->usStallPowerCap);
+  DBG_PRINTF("AMDGPU: Zero-RPM: Start temp.=%u, Stop temp.=%u, Min. on time=%u, Min. off time=%u, Kick time=%u, Min. fanspeed=%u pwm",
+             pConfig->usZeroRPMStartTemp,
+             pConfig->usZeroRPMStopTemp,
+             pConfig->usZeroRPMMinOnTime,
+             pConfig->usZeroRPMMinOffTime,
+             pConfig->usZeroRPMKickTime,
+             ptagFanCtrl->ptagAMDGPU->uiZeroRPMMinPWM);
+  ptagFanCtrl->ptagAMDGPU->uiSlewStepMs=ptagFanCtrl->uiUpdateDelayTime*100/ptagFanCtrl->ptagAMDGPU->uiSubTicks;
+  DBG_PRINTF("AMDGPU: Slew rate: Up=%u, Down=%u PWM/s, unlimited up at critical temp.=%u",
+             pConfig->usSlewRateUp,
+             pConfig->usSlewRateDown,
+             pConfig->ucSlewCriticalUnlimited);
+
+  return(0);
+}
+
+/**
+ * Opens the handles of a built device: Hint socket and state file.
+ * On a reload, handles of the running device with the same path are handed over instead, so
+ * the socket stays bound and the mapping stays in place. Nothing is handed over, if opening fails.
+ *
+ * @param ptagPrev _IN_/_OUT_ Running device on a reload, handed over handles are removed from it. NULL at init.
+ *
+ * @return 0 on success, nonzero on failure.
+ */
+static int iFanCtrl_AMDGPU_OpenHandles_m(TagFanCtrl *ptagFanCtrl,
+                                         TagFanConfigAMDGPU *ptagPrev)
+{
+  TagFanConfigAMDGPU *ptagAMDGPU=ptagFanCtrl->ptagAMDGPU;
+  int iHintShared;
+  int iStateShared;
+
+  iHintShared=((ptagAMDGPU->pcPathHintSocket) &&
+               (ptagPrev) &&
+               (ptagPrev->iHintSocket >= 0) &&
+               (strcmp(ptagPrev->pcPathHintSocket,ptagAMDGPU->pcPathHintSocket) == 0))?1:0;
+  iStateShared=((ptagAMDGPU->pcPathState) &&
+                (ptagPrev) &&
+                (ptagPrev->ptagState) &&
+                (strcmp(ptagPrev->pcPathState,ptagAMDGPU->pcPathState) == 0))?1:0;
+
+  if((ptagAMDGPU->pcPathHintSocket) &&
+     (!iHintShared) &&
+     ((ptagAMDGPU->iHintSocket=iFanCtrl_OpenHintSocket_m(ptagAMDGPU->pcPathHintSocket,
+                                                         ptagAMDGPU->uiHintSocketMode,
+                                                         ptagAMDGPU->pcHintSocketGroup)) < 0))
+    return(1);
+  if((iHintShared) && /* Kept on a reload, mode and group may have changed */
+     (iFanCtrl_SetHintSocketAccess_m(ptagAMDGPU->pcPathHintSocket,
+                                     ptagAMDGPU->uiHintSocketMode,
+                                     ptagAMDGPU->pcHintSocketGroup)))
+    return(1);
+  if((ptagAMDGPU->pcPathState) &&
+     (!iStateShared) &&
+     (iFanCtrl_AMDGPU_OpenState_m(ptagFanCtrl)))
+  {
+    if(ptagAMDGPU->iHintSocket >= 0)
+    {
+      close(ptagAMDGPU->iHintSocket);
+      unlink(ptagAMDGPU->pcPathHintSocket);
+      ptagAMDGPU->iHintSocket=-1;
+    }
+    return(1);
+  }
+
+  if(iHintShared)
+  {
+    ptagAMDGPU->iHintSocket=ptagPrev->iHintSocket;
+    ptagPrev->iHintSocket=-1;
+  }
+  if(iStateShared)
+  {
+    ptagAMDGPU->ptagState=ptagPrev->ptagState;
+    ptagAMDGPU->uiStateSlot=ptagPrev->uiStateSlot;
+    ptagAMDGPU->ulStateLastMs=ptagPrev->ulStateLastMs;
+    memcpy(ptagAMDGPU->caBootId,ptagPrev->caBootId,sizeof(ptagAMDGPU->caBootId));
+    ptagPrev->ptagState=NULL;
+  }
+  return(0);
+}
+
+/**
+ * Closes the handles of a device (the hint socket is removed) and frees it.
+ */
+static void vFanCtrl_AMDGPU_Free_m(TagFanConfigAMDGPU *ptagAMDGPU)
+{
+  if(ptagAMDGPU->iHintSocket >= 0)
+  {
+    close(ptagAMDGPU->iHintSocket);
+    unlink(ptagAMDGPU->pcPathHintSocket);
+  }
+  if(ptagAMDGPU->ptagState)
+    munmap(ptagAMDGPU->ptagState,sizeof(TagFanCtrlStateFile));
+  vFanCtrl_Free_m(ptagAMDGPU);
+}
+
+/**
+ * Checks if two device blocks control the same fan, by the paths of the fan control files.
+ *
+ * @return 1 if it is the same fan, 0 otherwise.
+ */
+static int iFanCtrl_AMDGPU_SameDevice_m(const TagFanConfigAMDGPU *ptagA,
+                                        const TagFanConfigAMDGPU *ptagB)
+{
+  return(((strcmp(ptagA->pcPathSetFanCtrlMode,ptagB->pcPathSetFanCtrlMode) == 0) &&
+          (strcmp(ptagA->pcPathEnableFan,ptagB->pcPathEnableFan) == 0) &&
+          (strcmp(ptagA->pcPathSetPWM,ptagB->pcPathSetPWM) == 0))?1:0);
+}
+
+/**
+ * Takes over the runtime state of the running device on a reload, so the fan continues where it is:
+ * Fan state and applied fanspeed, the state machines (stall, zero-RPM, critical, throttle), the slew limiter,
+ * the active profile and the controller state (filters, hysteresis, PID), as far as the new configuration still has them.
+ * The statistics are continued.
+ */
+static void vFanCtrl_AMDGPU_CarryState_m(TagFanConfigAMDGPU *ptagAMDGPU,
+                                         const TagFanConfigAMDGPU *ptagOld)
+{
+  TagFanCtrlStateRecord tagRecord;
+  unsigned int uiIndex;
+
+  /* The device stays in manual mode, the fan as it is */
+  ptagAMDGPU->iFanState=ptagOld->iFanState;
+  ptagAMDGPU->uiRequestPWM=ptagOld->uiRequestPWM;
+  ptagAMDGPU->ulFanEnableLastMs=ptagOld->ulFanEnableLastMs;
+  ptagAMDGPU->ulLastUpdateMs=ptagOld->ulLastUpdateMs;
+  if(ptagAMDGPU->uiFanMode == ptagOld->uiFanMode)
+  {
+    ptagAMDGPU->uiLastPWM=ptagOld->uiLastPWM;
+    ptagAMDGPU->uiRPMTarget=ptagOld->uiRPMTarget;
+    ptagAMDGPU->lRPMPWM=ptagOld->lRPMPWM;
+    ptagAMDGPU->uiRPMPWM=ptagOld->uiRPMPWM;
+    ptagAMDGPU->iRPM=ptagOld->iRPM;
+    ptagAMDGPU->iRPMError=ptagOld->iRPMError;
+  }
+  if((ptagAMDGPU->uiSlewUp) ||
+     (ptagAMDGPU->uiSlewDown))
+  {
+    ptagAMDGPU->lSlewPWM=ptagOld->lSlewPWM;
+    ptagAMDGPU->ulSlewLastMs=ptagOld->ulSlewLastMs;
+  }
+  if(ptagAMDGPU->uiStallPWM)
+  {
+    ptagAMDGPU->uiStallState=ptagOld->uiStallState;
+    ptagAMDGPU->ulStallSinceMs=ptagOld->ulStallSinceMs;
+  }
+  if(ptagAMDGPU->iZeroRPMStartTemp)
+  {
+    ptagAMDGPU->uiZeroRPMState=ptagOld->uiZeroRPMState;
+    ptagAMDGPU->ulZeroRPMSinceMs=ptagOld->ulZeroRPMSinceMs;
+    ptagAMDGPU->ulZeroRPMStartReqMs=ptagOld->ulZeroRPMStartReqMs;
+  }
+  ptagAMDGPU->iCriticalActive=ptagOld->iCriticalActive;
+  ptagAMDGPU->iCriticalPWMPending=ptagOld->iCriticalPWMPending;
+  ptagAMDGPU->ulCriticalSinceMs=ptagOld->ulCriticalSinceMs;
+  ptagAMDGPU->ulCriticalBelowSinceMs=ptagOld->ulCriticalBelowSinceMs;
+
+  /* Load inputs and the derived terms */
+  ptagAMDGPU->iPowerW=ptagOld->iPowerW;
+  ptagAMDGPU->iBusyPercent=ptagOld->iBusyPercent;
+  ptagAMDGPU->uiClockMHz=ptagOld->uiClockMHz;
+  ptagAMDGPU->uiClockMaxMHz=ptagOld->uiClockMaxMHz;
+  ptagAMDGPU->tagFeedForwardPower.llFiltered=ptagOld->tagFeedForwardPower.llFiltered;
+  ptagAMDGPU->tagFeedForwardPower.iValid=ptagOld->tagFeedForwardPower.iValid;
+  ptagAMDGPU->tagFeedForwardBusy.llFiltered=ptagOld->tagFeedForwardBusy.llFiltered;
+  ptagAMDGPU->tagFeedForwardBusy.iValid=ptagOld->tagFeedForwardBusy.iValid;
+  ptagAMDGPU->uiFeedForwardPWM=ptagOld->uiFeedForwardPWM;
+  ptagAMDGPU->ulFeedForwardLastMs=ptagOld->ulFeedForwardLastMs;
+  if(ptagAMDGPU->iThrottleTemp)
+  {
+    ptagAMDGPU->iThrottled=ptagOld->iThrottled;
+    ptagAMDGPU->uiThrottleBiasPWM=ptagOld->uiThrottleBiasPWM;
+  }
+  ptagAMDGPU->uiBiasAppliedPWM=ptagOld->uiBiasAppliedPWM;
+  if((ptagAMDGPU->iHintSocket >= 0) &&
+     (ptagOld->pcPathHintSocket) &&
+     (strcmp(ptagAMDGPU->pcPathHintSocket,ptagOld->pcPathHintSocket) == 0))
+  {
+    ptagAMDGPU->iHintPowerW=ptagOld->iHintPowerW;
+    ptagAMDGPU->ulHintExpiresMs=ptagOld->ulHintExpiresMs;
+    ptagAMDGPU->uiHintPWM=ptagOld->uiHintPWM;
+  }
+
+  /* Active profile, by name. No cross-fade, the next update applies the new curve */
+  strcpy(ptagAMDGPU->caPowerProfile,ptagOld->caPowerProfile);
+  strcpy(ptagAMDGPU->caProfileHint,ptagOld->caProfileHint);
+  for(uiIndex=0;uiIndex < ptagAMDGPU->uiCurvesCount;++uiIndex)
+  {
+    if(strcmp(ptagAMDGPU->ptagCurves[uiIndex].pcName,ptagOld->ptagCurve->pcName) == 0)
+    {
+      ptagAMDGPU->ptagCurve=&ptagAMDGPU->ptagCurves[uiIndex];
+      break;
+    }
+  }
+
+  /* Controller state, the same way it is restored from the state file. The sensors are matched by index */
+  if((ptagAMDGPU->uiSensorsCount == ptagOld->uiSensorsCount) &&
+     (ptagOld->uiSensorsCount <= STATE_FILE_MAX_SENSORS))
+  {
+    vFanCtrl_AMDGPU_GetStateRecord_m(ptagOld,&tagRecord);
+    vFanCtrl_AMDGPU_ApplyStateRecord_m(ptagAMDGPU,&tagRecord);
+    for(uiIndex=0;uiIndex < ptagAMDGPU->uiSensorsCount;++uiIndex)
+    {
+      ptagAMDGPU->ptagSensors[uiIndex].lRawValue=ptagOld->ptagSensors[uiIndex].lRawValue;
+      ptagAMDGPU->ptagSensors[uiIndex].iTempCelsius=ptagOld->ptagSensors[uiIndex].iTempCelsius;
+      ptagAMDGPU->ptagSensors[uiIndex].ulSampleMs=ptagOld->ptagSensors[uiIndex].ulSampleMs;
+    }
+  }
+
+  /* The statistics are the tail of the block */
+  memcpy(&ptagAMDGPU->ulPWMWrites,
+         &ptagOld->ulPWMWrites,
+         sizeof(TagFanConfigAMDGPU)-offsetof(TagFanConfigAMDGPU,ulPWMWrites));
+}
+
+#ifndef FANCTRL_STATIC
+/**
+ * Verifies the update interval and the hysteresis configuration.
+ *
+ * @return 0 if valid, nonzero otherwise.
+ */
+static int iFanCtrl_VerifyTiming_m(unsigned int uiUpdateDelayTime,
+                                   const TagCfg_Hysteresis *ptagHysteresis)
+{
+  if(uiUpdateDelayTime > CFG_LIMIT_MAX_DELAY_TIME)
+  {
+    ERR_PRINTF("Invalid value: uiUpdateDelayTime too high(=%u), max=%u",
+               uiUpdateDelayTime,
+               CFG_LIMIT_MAX_DELAY_TIME);
+    return(1);
+  }
+  if((ptagHysteresis->usRisingDeadband > CFG_LIMIT_MAX_DEADBAND) ||
+     (ptagHysteresis->usFallingDeadband > CFG_LIMIT_MAX_DEADBAND))
+  {
+    ERR_PRINTF("Invalid value: Hysteresis deadband too high(=%u/%u), max=%u",
+               ptagHysteresis->usRisingDeadband,
+               ptagHysteresis->usFallingDeadband,
+               CFG_LIMIT_MAX_DEADBAND);
+    return(1);
+  }
+  if(ptagHysteresis->usMinDwellTime > CFG_LIMIT_MAX_DWELL_TIME)
+  {
+    ERR_PRINTF("Invalid value: Hysteresis dwell time too high(=%u), max=%u",
+               ptagHysteresis->usMinDwellTime,
+               CFG_LIMIT_MAX_DWELL_TIME);
+    return(1);
+  }
+
+  return(0);
+}
+#endif /* !FANCTRL_STATIC */
+
+/**
+ * Allocates an object, from the storage of the application if set, otherwise from the heap.
+ * The heap is also used, once the storage is exhausted: The storage is sized for the initial configuration,
+ * a reload builds the new device aside. The static build has no heap fallback.
+ *
+ * @return The object, NULL if out of memory.
+ */
+static void *pvFanCtrl_Alloc_m(size_t szSize)
+{
+  void *pvMem;
+
+  szSize=STORAGE_ALIGN(szSize);
+  if((pucStorage_m) &&
+     (szSize <= szStorage_m-szStorageUsed_m))
+  {
+    pvMem=pucStorage_m+szStorageUsed_m;
+    szStorageUsed_m+=szSize;
+    return(pvMem);
+  }
+#ifndef FANCTRL_STATIC
+  /* The size is stored in front of the object, for the statistics */
+  if((pvMem=malloc(STORAGE_ALIGN(sizeof(size_t))+szSize)))
+  {
+    *(size_t*)pvMem=szSize;
+    szHeapUsed_m+=szSize;
+    return((unsigned char*)pvMem+STORAGE_ALIGN(sizeof(size_t)));
+  }
+#endif /* !FANCTRL_STATIC */
+  return(NULL);
+}
+
+/**
+ * Frees an object of pvFanCtrl_Alloc_m(). Objects in the storage of the application are released with the storage.
+ */
+static void vFanCtrl_Free_m(void *pvMem)
+{
+  if((!pvMem) ||
+     ((pucStorage_m) &&
+      ((unsigned char*)pvMem >= pucStorage_m) &&
+      ((unsigned char*)pvMem < pucStorage_m+szStorage_m)))
+    return;
+#ifndef FANCTRL_STATIC
+  pvMem=(unsigned char*)pvMem-STORAGE_ALIGN(sizeof(size_t));
+  szHeapUsed_m-=*(size_t*)pvMem;
+  free(pvMem);
+#endif /* !FANCTRL_STATIC */
+}
+
+/**
+ * Calculates the size of the runtime block of the device, see iFanCtrl_AMDGPU_Build_m(), from a verified configuration.
+ * Also returns the count of the curve points and the LUT entries of all curves.
+ */
+static size_t szFanCtrl_AMDGPU_GetBlockSize_m(const TagCfg_Sensor *ptagSensors,
+                                              unsigned int uiSensorsCount,
+                                              const TagCfg_Temperatures *ptagTemps,
+                                              unsigned int uiTempsCount,
+                                              const TagCfg_Profile *ptagProfiles,
+                                              unsigned int uiProfilesCount,
+                                              unsigned int *puiPointsCount,
+                                              unsigned int *puiLUTSize)
+{
+  unsigned int uiIndex;
+
+  *puiPointsCount=uiTempsCount;
+  *puiLUTSize=(unsigned int)(ptagTemps[uiTempsCount-1].iTemp-ptagTemps[0].iTemp)+1;
+  for(uiIndex=0;uiIndex < uiProfilesCount;++uiIndex)
+  {
+    *puiPointsCount+=ptagProfiles[uiIndex].uiTempsCount;
+    *puiLUTSize+=(unsigned int)(ptagProfiles[uiIndex].ptagTemps[ptagProfiles[uiIndex].uiTempsCount-1].iTemp-ptagProfiles[uiIndex].ptagTemps[0].iTemp)+1;
+  }
+  for(uiIndex=0;uiIndex < uiSensorsCount;++uiIndex)
+  {
+    if(!ptagSensors[uiIndex].ptagTemps)
+      continue;
+    *puiPointsCount+=ptagSensors[uiIndex].uiTempsCount;
+    *puiLUTSize+=(unsigned int)(ptagSensors[uiIndex].ptagTemps[ptagSensors[uiIndex].uiTempsCount-1].iTemp-ptagSensors[uiIndex].ptagTemps[0].iTemp)+1;
+  }
+  return(sizeof(TagFanConfigAMDGPU) + sizeof(TagFanCtrlSensor)*uiSensorsCount +
+         sizeof(TagFanCtrlCurve)*(1+uiProfilesCount) + sizeof(TagFanCtrlTempPoint)*(*puiPointsCount) + *puiLUTSize);
+}
+
+/**
+ * Calculates the wait times of fanCtrl_Run() from the update interval of the device.
+ * Sensors may be sampled multiple times per update interval (oversampling), so the wait is one sampling step only.
+ */
+static void vFanCtrl_GetWaitTimes_m(const TagFanCtrl *ptagFanCtrl,
+                                    struct timespec *ptagWaitTime,
+                                    struct timespec *ptagCriticalWaitTime,
+                                    unsigned int *puiSubTicks)
+{
+  unsigned int uiTmp;
+
+  *puiSubTicks=(ptagFanCtrl->ptagAMDGPU)?ptagFanCtrl->ptagAMDGPU->uiSubTicks:1;
+  uiTmp=ptagFanCtrl->uiUpdateDelayTime*100/(*puiSubTicks); /* In ms */
+  ptagWaitTime->tv_nsec=(uiTmp%1000)*1000000;
+  ptagWaitTime->tv_sec=uiTmp/1000;
+  DBG_PRINTF("Wait time: %ld secs, %" PRIu64 "nsecs, %u sampling steps per update",
+             ptagWaitTime->tv_sec,
+             ptagWaitTime->tv_nsec,
+             *puiSubTicks);
+  /* Short update interval, while a critical temperature is active */
+  uiTmp=(ptagFanCtrl->ptagAMDGPU)?ptagFanCtrl->ptagAMDGPU->uiCriticalTickTime*100:0; /* In ms */
+  ptagCriticalWaitTime->tv_nsec=(uiTmp%1000)*1000000;
+  ptagCriticalWaitTime->tv_sec=uiTmp/1000;
+}
+
+int fanCtrl_Run(TagFanCtrl *ptagFanCtrl)
+{
+  struct timespec tagWaitTime;
+  struct timespec tagCriticalWaitTime;
+  unsigned int uiSubTick;
+  unsigned int uiSubTicks;
+  int iSensorReadRetryCount;
+  int iControlTick;
+  int iFirstTick;
+  int iRc=RUN_RET_OK;
+
+  if((ptagFanCtrl->ptagAMDGPU) &&
+     (((iRc=iFanCtrl_AMDGPU_Start_m(ptagFanCtrl)) != RUN_RET_OK) ||
+      ((iRc=iFanCtrl_AMDGPU_RestoreState_m(ptagFanCtrl)) != RUN_RET_OK)))
+    return(iRc);
+  tzset(); /* Time zone of the statistics, loaded before the steady state */
+
+  vFanCtrl_GetWaitTimes_m(ptagFanCtrl,
+                          &tagWaitTime,
+                          &tagCriticalWaitTime,
+                          &uiSubTicks);
+
+  iSensorReadRetryCount=0;
+  uiSubTick=0;
+  iFirstTick=1;
+  while((*ptagFanCtrl->puiQuitRunFlag) == 0)
+  {
+    /* Check if AMDGPU is used */
+    if(!ptagFanCtrl->ptagAMDGPU)
+    {
+      nanosleep(&tagWaitTime,NULL);
+      continue;
+    }
+    /* Configuration reload between two ticks, the new device is published by fanCtrl_AMDGPU_Reload() at once.
+       The hook may allocate (config file parser, new device), so it is not part of the steady state */
+    if(ptagFanCtrl->pfnReloadHook)
+    {
+      iSteadyState_m=0;
+      if(ptagFanCtrl->pfnReloadHook(ptagFanCtrl) > 0)
+        vFanCtrl_GetWaitTimes_m(ptagFanCtrl,
+                                &tagWaitTime,
+                                &tagCriticalWaitTime,
+                                &uiSubTicks);
+      iSteadyState_m=(!iFirstTick);
+    }
+    if(iFirstTick)
+    {/* First update immediately after the start, without waiting for an interval */
+      iFirstTick=0;
+      iControlTick=1;
+    }
+    else if(ptagFanCtrl->ptagAMDGPU->iCriticalActive)
+    {/* Critical temperature: Every short interval is a full update */
+      nanosleep(&tagCriticalWaitTime,NULL);
+      iControlTick=1;
+    }
+    else
+    {
+      nanosleep(&tagWaitTime,NULL);
+      iControlTick=(++uiSubTick >= uiSubTicks)?1:0;
+    }
+
+    /* Read AMDGPU Sensors, all of them on a full update */
+    if(iFanCtrl_SampleSensors_m(ptagFanCtrl->ptagAMDGPU->ptagSensors,
+                                ptagFanCtrl->ptagAMDGPU->uiSensorsCount,
+                                (iControlTick)?uiSubTicks:uiSubTick,
+                                uiSubTicks,
+                                &iSensorReadRetryCount))
+    {
+      iRc=RUN_RET_ERR_SENSOR_READ;
+      break;
+    }
+
+    /* RPM mode: The inner loop runs every sampling step, reading the tachometer only */
+    if((iRc=iFanCtrl_AMDGPU_UpdateRPM_m(ptagFanCtrl)) != RUN_RET_OK)
+      break;
+    /* Zero-RPM: The kick ends with the next sampling step after its time */
+    if((iRc=iFanCtrl_AMDGPU_UpdateZeroRPM_m(ptagFanCtrl,0,0)) != RUN_RET_OK)
+      break;
+    /* Slew limiter: Ramps towards a clipped fanspeed every sampling step */
+    if((iRc=iFanCtrl_AMDGPU_UpdateSlew_m(ptagFanCtrl)) != RUN_RET_OK)
+      break;
+
+    if((!iControlTick) &&
+       (!iFanCtrl_AMDGPU_CheckCritical_m(ptagFanCtrl->ptagAMDGPU)))
+      continue; /* Oversampling step only, no fanspeed update */
+
+    uiSubTick=0;
+    if(ptagFanCtrl->iStatsRequested)
+    {
+      ptagFanCtrl->iStatsRequested=0;
+      fanCtrl_PrintStats(ptagFanCtrl,stdout);
+    }
+    DBG_PRINTF("Timestamp=%" PRIu64 ", update temperatures...",time(NULL));
+    if((iRc=iFanCtrl_AMDGPU_Update_m(ptagFanCtrl)) != RUN_RET_OK)
+      break;
+    vFanCtrl_AMDGPU_SaveState_m(ptagFanCtrl);
+    /* Everything is set up after the first full update, no heap allocations from here on */
+    iSteadyState_m=1;
+  }
+  iSteadyState_m=0;
+  if(iRc != RUN_RET_OK)
+    return(iRc);
+
+  DBG_PUTS("Stopping loop...");
+  return(RUN_RET_OK);
+}
+
+int fanCtrl_Identify(TagFanCtrl *ptagFanCtrl,
+                     const TagCfg_Identify *ptagCfg,
+                     TagFanCtrl_Identified *ptagResult)
+{
+  TagFanConfigAMDGPU *ptagAMDGPU=ptagFanCtrl->ptagAMDGPU;
+  TagCtrlIdent tagIdent;
+  struct timespec tagWaitTime;
+  unsigned long ulStartMs;
+  unsigned long ulNowMs;
+  unsigned int uiIndex;
+  unsigned int uiPWM;
+  int iSensorReadRetryCount;
+  int iHighestSensorTempVal;
+  int iHighestRawTempVal;
+  int iRc;
+
+  if(!ptagAMDGPU)
+  {
+    ERR_PUTS("Identification needs an AMDGPU device");
+    return(RUN_RET_ERR_INIT);
+  }
+  if((!ptagCfg->usSetpoint) ||
+     (ptagCfg->usSetpoint+ptagCfg->usHysteresis >= ptagCfg->usSafetyTemp) ||
+     (ptagCfg->usSafetyTemp > CFG_LIMIT_MAX_TEMP) ||
+     (ptagCfg->ucFanSpeedLow >= ptagCfg->ucFanSpeedHigh) ||
+     (ptagCfg->ucFanSpeedHigh > 100) ||
+     (!ptagCfg->ucCycles) ||
+     (ptagCfg->ucCycles > FANCTRL_IDENTIFY_MAX_CYCLES) ||
+     (!ptagCfg->usSampleTime) ||
+     (ptagCfg->usSampleTime > CFG_LIMIT_MAX_DELAY_TIME) ||
+     (!ptagCfg->usMaxDuration))
+  {
+    ERR_PRINTF("Invalid identification configuration: Setpoint=%u, Hysteresis=%u, SafetyTemp=%u (max. %u), "
+               "FanSpeedLow=%u, FanSpeedHigh=%u (max. 100), Cycles=%u (1-%u), SampleTime=%u (1-%u), MaxDuration=%u",
+               ptagCfg->usSetpoint,
+               ptagCfg->usHysteresis,
+               ptagCfg->usSafetyTemp,
+               CFG_LIMIT_MAX_TEMP,
+               ptagCfg->ucFanSpeedLow,
+               ptagCfg->ucFanSpeedHigh,
+               ptagCfg->ucCycles,
+               FANCTRL_IDENTIFY_MAX_CYCLES,
+               ptagCfg->usSampleTime,
+               CFG_LIMIT_MAX_DELAY_TIME,
+               ptagCfg->usMaxDuration);
+    return(RUN_RET_ERR_INIT);
+  }
+  if((iRc=iFanCtrl_AMDGPU_Start_m(ptagFanCtrl)) != RUN_RET_OK)
+    return(iRc);
+
+  ctrlIdent_Init(&tagIdent,
+                 ptagCfg->usSetpoint,
+                 ptagCfg->usHysteresis,
+                 AMDGPU_FANSPEED_PERCENT_TO_PWM(ptagCfg->ucFanSpeedLow),
+                 AMDGPU_FANSPEED_PERCENT_TO_PWM(ptagCfg->ucFanSpeedHigh),
+                 ptagCfg->ucCycles);
+  tagWaitTime.tv_nsec=(ptagCfg->usSampleTime%10)*100000000;
+  tagWaitTime.tv_sec=ptagCfg->usSampleTime/10;
+  DBG_PRINTF("Identify: Setpoint=%u, relay %u-%u pwm, safety temp. %u, %u cycles",
+             ptagCfg->usSetpoint,
+             tagIdent.uiPWMLow,
+             tagIdent.uiPWMHigh,
+             ptagCfg->usSafetyTemp,
+             ptagCfg->ucCycles);
+
+  iSensorReadRetryCount=0;
+  iHighestSensorTempVal=INT_MIN;
+  iRc=RUN_RET_OK;
+  ulStartMs=ulFanCtrl_GetTimeMs_m();
+  while(!ctrlIdent_Done(&tagIdent))
+  {
+    if(*ptagFanCtrl->puiQuitRunFlag)
+    {
+      ERR_PUTS("Identification aborted by user");
+      iRc=RUN_RET_ERR_IDENTIFY_ABORTED;
+      break;
+    }
+    if(iFanCtrl_SampleSensors_m(ptagAMDGPU->ptagSensors,
+                                ptagAMDGPU->uiSensorsCount,
+                                1,
+                                1,
+                                &iSensorReadRetryCount))
+    {
+      iRc=RUN_RET_ERR_SENSOR_READ;
+      break;
+    }
+    ulNowMs=ulFanCtrl_GetTimeMs_m();
+
+    iHighestSensorTempVal=INT_MIN;
+    iHighestRawTempVal=INT_MIN;
+    for(uiIndex=0;uiIndex < ptagAMDGPU->uiSensorsCount;++uiIndex)
+    {
+      if(ptagAMDGPU->ptagSensors[uiIndex].iTempFiltered > iHighestSensorTempVal)
+        iHighestSensorTempVal=ptagAMDGPU->ptagSensors[uiIndex].iTempFiltered;
+      if(ptagAMDGPU->ptagSensors[uiIndex].iTempCelsius > iHighestRawTempVal)
+        iHighestRawTempVal=ptagAMDGPU->ptagSensors[uiIndex].iTempCelsius;
+    }
+    /* Safety limit on raw values, the filters must not delay the abort */
+    if((iHighestRawTempVal >= ptagCfg->usSafetyTemp) ||
+       (iFanCtrl_AMDGPU_CheckCritical_m(ptagAMDGPU)))
+    {
+      ERR_PRINTF("Identification aborted: Safety temperature reached (%d)",iHighestRawTempVal);
+      iRc=RUN_RET_ERR_IDENTIFY_ABORTED;
+      break;
+    }
+    if(ulNowMs-ulStartMs > (unsigned long)ptagCfg->usMaxDuration*1000UL)
+    {
+      ERR_PRINTF("Identification aborted: No stable oscillation after %u seconds (%u of %u relay switches)",
+                 ptagCfg->usMaxDuration,
+                 tagIdent.uiSwitches,
+                 tagIdent.uiSwitchesMax);
+      iRc=RUN_RET_ERR_IDENTIFY_ABORTED;
+      break;
+    }
+
+    uiPWM=ctrlIdent_Update(&tagIdent,
+                           iHighestSensorTempVal,
+                           ulNowMs);
+    DBG_PRINTF("Identify: t=%lums, temp. %d -> %u pwm, switches %u/%u",
+               ulNowMs-ulStartMs,
+               iHighestSensorTempVal,
+               uiPWM,
+               tagIdent.uiSwitches,
+               tagIdent.uiSwitchesMax);
+    if((iRc=iFanCtrl_AMDGPU_ApplyPWM_m(ptagFanCtrl,uiPWM)) != RUN_RET_OK)
+      break;
+    nanosleep(&tagWaitTime,NULL);
+  }
+
+  /* Restore the configured curve in any case, max. fanspeed if the temperature is unknown */
+  uiPWM=(iHighestSensorTempVal != INT_MIN)?uiFanCtrl_AMDGPU_CurveGetPWM_m(ptagAMDGPU,
+                                                                          iHighestSensorTempVal):AMDGPU_PWM_VAL_MAX;
+  DBG_PRINTF("Identify: Restoring curve fanspeed %u pwm",uiPWM);
+  if((iFanCtrl_AMDGPU_ApplyPWM_m(ptagFanCtrl,uiPWM) != RUN_RET_OK) &&
+     (iRc == RUN_RET_OK))
+    iRc=RUN_RET_ERR_PWM_WRITE;
+  if(iRc != RUN_RET_OK)
+    return(iRc);
+
+  if(ctrlIdent_Analyze(&tagIdent,
+                       AMDGPU_PWM_VAL_MAX,
+                       ptagResult))
+  {
+    ERR_PUTS("Identification failed: Recorded oscillation can't be used, try a lower hysteresis or a bigger fanspeed range");
+    return(RUN_RET_ERR_IDENTIFY_FAILED);
+  }
+  /* Keep the recommendations within the configuration limits */
+  if(ptagResult->uiUpdateDelayTime > CFG_LIMIT_MAX_DELAY_TIME)
+    ptagResult->uiUpdateDelayTime=CFG_LIMIT_MAX_DELAY_TIME;
+  if(ptagResult->tagHysteresis.usRisingDeadband > CFG_LIMIT_MAX_DEADBAND)
+    ptagResult->tagHysteresis.usRisingDeadband=CFG_LIMIT_MAX_DEADBAND;
+  if(ptagResult->tagHysteresis.usFallingDeadband > CFG_LIMIT_MAX_DEADBAND)
+    ptagResult->tagHysteresis.usFallingDeadband=CFG_LIMIT_MAX_DEADBAND;
+  if(ptagResult->tagHysteresis.usMinDwellTime > CFG_LIMIT_MAX_DWELL_TIME)
+    ptagResult->tagHysteresis.usMinDwellTime=CFG_LIMIT_MAX_DWELL_TIME;
+  if(ptagResult->usPIDKp > CFG_LIMIT_MAX_PID_GAIN)
+    ptagResult->usPIDKp=CFG_LIMIT_MAX_PID_GAIN;
+  if(ptagResult->usPIDKi > CFG_LIMIT_MAX_PID_GAIN)
+    ptagResult->usPIDKi=CFG_LIMIT_MAX_PID_GAIN;
+  if(ptagResult->usPIDKd > CFG_LIMIT_MAX_PID_GAIN)
+    ptagResult->usPIDKd=CFG_LIMIT_MAX_PID_GAIN;
+  for(uiIndex=0;uiIndex < FANCTRL_IDENTIFY_CURVE_POINTS;++uiIndex)
+  {
+    if(ptagResult->tagaCurve[uiIndex].iTemp > CFG_LIMIT_MAX_TEMP)
+      ptagResult->tagaCurve[uiIndex].iTemp=CFG_LIMIT_MAX_TEMP;
+  }
+  DBG_PRINTF("Identify: Gain=%u, time constant=%u, dead time=%u, Ku=%u, Pu=%u, noise=%u",
+             ptagResult->uiGain,
+             ptagResult->uiTimeConstant,
+             ptagResult->uiDeadTime,
+             ptagResult->uiUltimateGain,
+             ptagResult->uiUltimatePeriod,
+             ptagResult->uiNoise);
+  return(RUN_RET_OK);
+}
+
+int fanCtrl_Calibrate(TagFanCtrl *ptagFanCtrl,
+                      const TagCfg_Calibrate *ptagCfg,
+                      TagCfg_Calibration *ptagResult)
+{
+  TagFanConfigAMDGPU *ptagAMDGPU=ptagFanCtrl->ptagAMDGPU;
+  unsigned int uiPointsCount;
+  unsigned int uiIndex;
+  unsigned int uiPWM;
+  int iSensorReadRetryCount;
+  int iHighestSensorTempVal;
+  long lRPM;
+  int iRc;
+
+  if(!ptagAMDGPU)
+  {
+    ERR_PUTS("Calibration needs an AMDGPU device");
+    return(RUN_RET_ERR_INIT);
+  }
+  if(!ptagAMDGPU->pcPathFanInput)
+  {
+    ERR_PUTS("Calibration needs the path of the measured RPM (fan1_input)");
+    return(RUN_RET_ERR_INIT);
+  }
+  /* Points from max. PWM down in steps, plus 0 */
+  uiPointsCount=(ptagCfg->ucStep)?(AMDGPU_PWM_VAL_MAX+ptagCfg->ucStep-1)/ptagCfg->ucStep+1:0;
+  if((!ptagCfg->ucStep) ||
+     (uiPointsCount > FANCTRL_CALIBRATION_MAX_POINTS) ||
+     (!ptagCfg->usSampleTime) ||
+     (ptagCfg->usSampleTime > CFG_LIMIT_MAX_DELAY_TIME) ||
+     (ptagCfg->usSettleTime < ptagCfg->usSampleTime) ||
+     (!ptagCfg->usSafetyTemp) ||
+     (ptagCfg->usSafetyTemp > CFG_LIMIT_MAX_TEMP))
+  {
+    ERR_PRINTF("Invalid calibration configuration: Step=%u (max. %u points), SampleTime=%u (1-%u), SettleTime=%u (min. SampleTime), "
+               "SafetyTemp=%u (1-%u)",
+               ptagCfg->ucStep,
+               FANCTRL_CALIBRATION_MAX_POINTS,
+               ptagCfg->usSampleTime,
+               CFG_LIMIT_MAX_DELAY_TIME,
+               ptagCfg->usSettleTime,
+               ptagCfg->usSafetyTemp,
+               CFG_LIMIT_MAX_TEMP);
+    return(RUN_RET_ERR_INIT);
+  }
+  if((iRc=iFanCtrl_AMDGPU_Start_m(ptagFanCtrl)) != RUN_RET_OK)
+    return(iRc);
+
+  memset(ptagResult,0,sizeof(TagCfg_Calibration));
+  ptagResult->ucPointsCount=(unsigned char)uiPointsCount;
+  iSensorReadRetryCount=0;
+
+  /* Down sweep from max. PWM: PWM-to-RPM table, the lowest spinning PWM is the min. sustaining PWM */
+  uiPWM=AMDGPU_PWM_VAL_MAX;
+  lRPM=0;
+  for(uiIndex=uiPointsCount;uiIndex-- > 0;)
+  {
+    if((iRc=iFanCtrl_AMDGPU_CalibrateStep_m(ptagFanCtrl,
+                                            ptagCfg,
+                                            uiPWM,
+                                            &iSensorReadRetryCount,
+                                            &lRPM)) != RUN_RET_OK)
+      break;
+    ptagResult->tagaPoints[uiIndex].ucPWM=(unsigned char)uiPWM;
+    ptagResult->tagaPoints[uiIndex].usRPM=(lRPM < 0)?0:(lRPM > USHRT_MAX)?USHRT_MAX:(unsigned short)lRPM;
+    if(lRPM > ptagCfg->usSettleTolerance)
+      ptagResult->ucMinSustainPWM=(unsigned char)uiPWM;
+    uiPWM=(uiPWM > ptagCfg->ucStep)?uiPWM-ptagCfg->ucStep:0;
+  }
+  if((iRc == RUN_RET_OK) &&
+     (!ptagResult->tagaPoints[uiPointsCount-1].usRPM))
+  {
+    ERR_PUTS("Calibration failed: The fan doesn't spin at max. PWM, check the path of the measured RPM");
+    iRc=RUN_RET_ERR_CALIBRATE_FAILED;
+  }
+
+  /* Up sweep from standstill, the first PWM which starts the fan is the min. start PWM.
+   * If the fan doesn't stop at 0 PWM, there is nothing to start. RPM within the tolerance counts as standstill. */
+  if((iRc == RUN_RET_OK) &&
+     (lRPM <= ptagCfg->usSettleTolerance))
+  {
+    for(uiPWM=ptagResult->ucMinSustainPWM;;uiPWM+=ptagCfg->ucStep)
+    {
+      if(uiPWM > AMDGPU_PWM_VAL_MAX)
+        uiPWM=AMDGPU_PWM_VAL_MAX;
+      if((iRc=iFanCtrl_AMDGPU_CalibrateStep_m(ptagFanCtrl,
+                                              ptagCfg,
+                                              uiPWM,
+                                              &iSensorReadRetryCount,
+                                              &lRPM)) != RUN_RET_OK)
+        break;
+      if(lRPM > ptagCfg->usSettleTolerance)
+      {
+        ptagResult->ucMinStartPWM=(unsigned char)uiPWM;
+        break;
+      }
+      if(uiPWM == AMDGPU_PWM_VAL_MAX)
+      {
+        ERR_PUTS("Calibration failed: The fan doesn't start from standstill");
+        iRc=RUN_RET_ERR_CALIBRATE_FAILED;
+        break;
+      }
+    }
+  }
+
+  /* Restore the configured curve in any case, max. fanspeed after an abort */
+  iHighestSensorTempVal=INT_MIN;
+  for(uiIndex=0;uiIndex < ptagAMDGPU->uiSensorsCount;++uiIndex)
+  {
+    if(ptagAMDGPU->ptagSensors[uiIndex].iTempFiltered > iHighestSensorTempVal)
+      iHighestSensorTempVal=ptagAMDGPU->ptagSensors[uiIndex].iTempFiltered;
+  }
+  uiPWM=(iRc == RUN_RET_OK)?uiFanCtrl_AMDGPU_CurveGetPWM_m(ptagAMDGPU,
+                                                           iHighestSensorTempVal):AMDGPU_PWM_VAL_MAX;
+  DBG_PRINTF("Calibrate: Restoring curve fanspeed %u pwm",uiPWM);
+  ptagAMDGPU->uiLastPWM=UINT_MAX; /* The sweep wrote the PWM directly */
+  if((iFanCtrl_AMDGPU_ApplyPWM_m(ptagFanCtrl,uiPWM) != RUN_RET_OK) &&
+     (iRc == RUN_RET_OK))
+    iRc=RUN_RET_ERR_PWM_WRITE;
+  if(iRc != RUN_RET_OK)
+    return(iRc);
+
+  DBG_PRINTF("Calibrate: Min. start=%u pwm, min. sustain=%u pwm, max.=%u RPM",
+             ptagResult->ucMinStartPWM,
+             ptagResult->ucMinSustainPWM,
+             ptagResult->tagaPoints[uiPointsCount-1].usRPM);
+  return(RUN_RET_OK);
+}
+
+/**
+ * One step of the calibration sweep: Writes the PWM and waits for the RPM to settle.
+ * The sensors are sampled on every read, to abort at the safety or a critical temperature.
+ *
+ * @return RUN_RET_OK on success, RUN_RET_ Errorcode on failure.
+ */
+static int iFanCtrl_AMDGPU_CalibrateStep_m(TagFanCtrl *ptagFanCtrl,
+                                           const TagCfg_Calibrate *ptagCfg,
+                                           unsigned int uiPWM,
+                                           int *piSensorReadRetryCount,
+                                           long *plRPM)
+{
+  TagFanConfigAMDGPU *ptagAMDGPU=ptagFanCtrl->ptagAMDGPU;
+  struct timespec tagWaitTime;
+  unsigned int uiWaitTime;
+  unsigned int uiIndex;
+  unsigned int uiStableReads;
+  long lRPMLast;
+  int iRc;
+
+  if((iRc=iFanCtrl_AMDGPU_WritePWM_m(ptagFanCtrl,uiPWM)) != RUN_RET_OK)
+    return(iRc);
+  tagWaitTime.tv_nsec=(ptagCfg->usSampleTime%10)*100000000;
+  tagWaitTime.tv_sec=ptagCfg->usSampleTime/10;
+  lRPMLast=LONG_MIN;
+  uiStableReads=0;
+  for(uiWaitTime=ptagCfg->usSampleTime;;uiWaitTime+=ptagCfg->usSampleTime)
+  {
+    nanosleep(&tagWaitTime,NULL);
+    if(*ptagFanCtrl->puiQuitRunFlag)
+    {
+      ERR_PUTS("Calibration aborted by user");
+      return(RUN_RET_ERR_CALIBRATE_ABORTED);
+    }
+    if(iFanCtrl_SampleSensors_m(ptagAMDGPU->ptagSensors,
+                                ptagAMDGPU->uiSensorsCount,
+                                1,
+                                1,
+                                piSensorReadRetryCount))
+      return(RUN_RET_ERR_SENSOR_READ);
+    /* Safety limit on raw values, the filters must not delay the abort */
+    for(uiIndex=0;uiIndex < ptagAMDGPU->uiSensorsCount;++uiIndex)
+    {
+      if(ptagAMDGPU->ptagSensors[uiIndex].iTempCelsius >= ptagCfg->usSafetyTemp)
+        break;
+    }
+    if((uiIndex < ptagAMDGPU->uiSensorsCount) ||
+       (iFanCtrl_AMDGPU_CheckCritical_m(ptagAMDGPU)))
+    {
+      ERR_PRINTF("Calibration aborted: Safety temperature reached at %u pwm",uiPWM);
+      return(RUN_RET_ERR_CALIBRATE_ABORTED);
+    }
+    if(iFanCtrl_ReadSysfsLong_m(ptagAMDGPU->pcPathFanInput,plRPM) != SENSOR_READ_RET_OK)
+    {
+      ERR_PRINTF("Calibration failed: Can't read the RPM from \"%s\"",ptagAMDGPU->pcPathFanInput);
+      return(RUN_RET_ERR_SENSOR_READ);
+    }
+    /* Settled after two consecutive changes within the tolerance, a slowly coasting fan isn't */
+    uiStableReads=((lRPMLast != LONG_MIN) &&
+                   (labs(*plRPM-lRPMLast) <= ptagCfg->usSettleTolerance))?uiStableReads+1:0;
+    if(uiStableReads >= 2)
+      break;
+    if(uiWaitTime+ptagCfg->usSampleTime > ptagCfg->usSettleTime)
+    {
+      LOG_PRINTF("Calibration: RPM not settled at %u pwm after %u/10 seconds, using %ld RPM",
+                 uiPWM,
+                 uiWaitTime,
+                 *plRPM);
+      break;
+    }
+    lRPMLast=*plRPM;
+  }
+  DBG_PRINTF("Calibrate: %u pwm -> %ld RPM after %u/10 seconds",
+             uiPWM,
+             *plRPM,
+             uiWaitTime);
+  return(RUN_RET_OK);
+}
+
+/**
+ * Builds the PWM map from the fan calibration: Each nominal PWM is the same fraction of the max. measured RPM,
+ * the PWM reaching it is interpolated between the calibration points. Nonzero values are mapped to at least
+ * the min. sustaining PWM. Measurement noise is ignored by using the running max. of the RPM.
+ *
+ * @param ptagCalibration
+ *               _IN_ Calibration, NULL or no points to disable the mapping
+ */
+static void vFanCtrl_AMDGPU_InitCalibration_m(TagFanConfigAMDGPU *ptagAMDGPU,
+                                              const TagCfg_Calibration *ptagCalibration)
+{
+  long laRPM[FANCTRL_CALIBRATION_MAX_POINTS];
+  unsigned int uiIndex;
+  unsigned int uiPWM;
+  long lRPM;
+
+  ptagAMDGPU->uiCalibrated=((ptagCalibration) && (ptagCalibration->ucPointsCount))?1:0;
+  ptagAMDGPU->uiMinStartPWM=0;
+  ptagAMDGPU->uiMinSustainPWM=0;
+  ptagAMDGPU->uiCalibratedRPMMax=0;
+  for(uiPWM=0;uiPWM <= AMDGPU_PWM_VAL_MAX;++uiPWM)
+    ptagAMDGPU->ucaPWMMap[uiPWM]=(unsigned char)uiPWM;
+  if(!ptagAMDGPU->uiCalibrated)
+    return;
+
+  ptagAMDGPU->uiMinStartPWM=ptagCalibration->ucMinStartPWM;
+  ptagAMDGPU->uiMinSustainPWM=ptagCalibration->ucMinSustainPWM;
+  lRPM=0;
+  for(uiIndex=0;uiIndex < ptagCalibration->ucPointsCount;++uiIndex)
+  {
+    if(ptagCalibration->tagaPoints[uiIndex].usRPM > lRPM)
+      lRPM=ptagCalibration->tagaPoints[uiIndex].usRPM;
+    laRPM[uiIndex]=lRPM;
+  }
+  ptagAMDGPU->uiCalibratedRPMMax=(unsigned int)lRPM;
+
+  uiIndex=0;
+  for(uiPWM=1;uiPWM <= AMDGPU_PWM_VAL_MAX;++uiPWM)
+  {
+    lRPM=fixp_DivRound((long)uiPWM*(long)ptagAMDGPU->uiCalibratedRPMMax,AMDGPU_PWM_VAL_MAX);
+    while(laRPM[uiIndex] < lRPM) /* The target rises with uiPWM, the last point reaches the max. */
+      ++uiIndex;
+    lRPM=(uiIndex)?fixp_Interpolate(lRPM,
+                                    laRPM[uiIndex-1],
+                                    laRPM[uiIndex],
+                                    ptagCalibration->tagaPoints[uiIndex-1].ucPWM,
+                                    ptagCalibration->tagaPoints[uiIndex].ucPWM):
+                   ptagCalibration->tagaPoints[0].ucPWM;
+    ptagAMDGPU->ucaPWMMap[uiPWM]=(unsigned char)((lRPM < (long)ptagAMDGPU->uiMinSustainPWM)?ptagAMDGPU->uiMinSustainPWM:lRPM);
+  }
+}
+
+/**
+ * Fan stall detection, called once per update:
+ *  - OK: The fan is stalled, if the tachometer reads 0 RPM for the stall time, while the applied fanspeed is at
+ *    or above the stall fanspeed. A stalled fan gets max. PWM (kick).
+ *  - KICK: If the fan spins within the kick time, the requested fanspeed is applied again.
+ *    Otherwise the fan failed: It stays at max. PWM (in case only the tachometer failed) and the power cap is lowered.
+ *  - FAILED: Once the fan spins again, the power cap is restored and the requested fanspeed applied.
+ * Every fault is reported with a timestamp, read failures of the tachometer are counted only.
+ *
+ * @return RUN_RET_OK on success, RUN_RET_ Errorcode on failure.
+ */
+static int iFanCtrl_AMDGPU_CheckStall_m(TagFanCtrl *ptagFanCtrl,
+                                        unsigned long ulNowMs)
+{
+  TagFanConfigAMDGPU *ptagAMDGPU=ptagFanCtrl->ptagAMDGPU;
+  char caTime[32];
+  long lRPM;
+
+  if(!ptagAMDGPU->uiStallPWM)
+    return(RUN_RET_OK);
+  if(iFanCtrl_ReadSysfsLong_m(ptagAMDGPU->pcPathFanInput,&lRPM) != SENSOR_READ_RET_OK)
+  {
+    ++ptagAMDGPU->ulStallReadErrors;
+    return(RUN_RET_OK);
+  }
+
+  switch(ptagAMDGPU->uiStallState)
+  {
+    case STALL_STATE_OK:
+      if((lRPM > 0) ||
+         (!ptagAMDGPU->iFanState) ||
+         (ptagAMDGPU->uiLastPWM == UINT_MAX) ||
+         (ptagAMDGPU->uiLastPWM < ptagAMDGPU->uiStallPWM))
+      {
+        ptagAMDGPU->ulStallSinceMs=0;
+        return(RUN_RET_OK);
+      }
+      if(!ptagAMDGPU->ulStallSinceMs)
+      {
+        ptagAMDGPU->ulStallSinceMs=ulNowMs;
+        return(RUN_RET_OK);
+      }
+      if(ulNowMs-ptagAMDGPU->ulStallSinceMs < ptagAMDGPU->uiStallTime)
+        return(RUN_RET_OK);
+      ++ptagAMDGPU->ulStallEvents;
+      ptagAMDGPU->tStallLastFault=time(NULL);
+      ERR_PRINTF("AMDGPU: %s: Fan stalled, 0 RPM at %u pwm for %lums, spin-up kick",
+                 pcFanCtrl_FormatTime_m(ptagAMDGPU->tStallLastFault,caTime,sizeof(caTime)),
+                 ptagAMDGPU->uiLastPWM,
+                 ulNowMs-ptagAMDGPU->ulStallSinceMs);
+      ptagAMDGPU->uiStallState=STALL_STATE_KICK;
+      ptagAMDGPU->ulStallSinceMs=ulNowMs;
+      return(iFanCtrl_AMDGPU_ApplyPWM_m(ptagFanCtrl,ptagAMDGPU->uiRequestPWM));
+
+    case STALL_STATE_KICK:
+      if(lRPM > 0)
+      {
+        ++ptagAMDGPU->ulStallKickRecoveries;
+        LOG_PRINTF("AMDGPU: %s: Fan spins again after the kick (%ld RPM)",
+                   pcFanCtrl_FormatTime_m(time(NULL),caTime,sizeof(caTime)),
+                   lRPM);
+        break;
+      }
+      if(ulNowMs-ptagAMDGPU->ulStallSinceMs < ptagAMDGPU->uiStallKickTime)
+        return(RUN_RET_OK);
+      ++ptagAMDGPU->ulFanFailures;
+      ptagAMDGPU->tStallLastFault=time(NULL);
+      ERR_PRINTF("AMDGPU: %s: Fan failed, no RPM after the spin-up kick, staying at max. PWM",
+                 pcFanCtrl_FormatTime_m(ptagAMDGPU->tStallLastFault,caTime,sizeof(caTime)));
+      ptagAMDGPU->uiStallState=STALL_STATE_FAILED;
+      if((ptagAMDGPU->ulStallPowerCapUW) &&
+         (ptagAMDGPU->ulPowerCapUW > ptagAMDGPU->ulStallPowerCapUW))
+      {
+        LOG_PRINTF("AMDGPU: Power cap %luW -> %luW (fan failure)",
+                   ptagAMDGPU->ulPowerCapUW/AMDGPU_RAW_POWER_TO_WATT_DIVISOR,
+                   ptagAMDGPU->ulStallPowerCapUW/AMDGPU_RAW_POWER_TO_WATT_DIVISOR);
+        if(!iFanCtrl_AMDGPU_SetPowerCap_m(ptagFanCtrl,ptagAMDGPU->ulStallPowerCapUW))
+          ++ptagAMDGPU->ulPowerCapDecreases;
+        if(ptagAMDGPU->ulPowerCapUW < ptagAMDGPU->ulPowerCapLowestUW)
+          ptagAMDGPU->ulPowerCapLowestUW=ptagAMDGPU->ulPowerCapUW;
+      }
+      return(RUN_RET_OK);
+
+    default: /* STALL_STATE_FAILED */
+      if(lRPM <= 0)
+        return(RUN_RET_OK);
+      LOG_PRINTF("AMDGPU: %s: Failed fan spins again (%ld RPM)",
+                 pcFanCtrl_FormatTime_m(time(NULL),caTime,sizeof(caTime)),
+                 lRPM);
+      if((ptagAMDGPU->ulStallPowerCapUW) &&
+         (ptagAMDGPU->ulPowerCapUW < ptagAMDGPU->ulPowerCapOrigUW))
+      {
+        LOG_PRINTF("AMDGPU: Power cap %luW -> %luW (fan recovered)",
+                   ptagAMDGPU->ulPowerCapUW/AMDGPU_RAW_POWER_TO_WATT_DIVISOR,
+                   ptagAMDGPU->ulPowerCapOrigUW/AMDGPU_RAW_POWER_TO_WATT_DIVISOR);
+        if(!iFanCtrl_AMDGPU_SetPowerCap_m(ptagFanCtrl,ptagAMDGPU->ulPowerCapOrigUW))
+          ++ptagAMDGPU->ulPowerCapIncreases;
+      }
+      break;
+  }
+  ptagAMDGPU->uiStallState=STALL_STATE_OK;
+  ptagAMDGPU->ulStallSinceMs=0;
+  return(iFanCtrl_AMDGPU_ApplyPWM_m(ptagFanCtrl,ptagAMDGPU->uiRequestPWM));
+}
+
+/**
+ * Formats a timestamp as local time for fault reports, "-" if not set.
+ *
+ * @return pcBuffer
+ */
+static const char *pcFanCtrl_FormatTime_m(time_t tTime,
+                                          char *pcBuffer,
+                                          size_t sizeBuffer)
+{
+  struct tm tagTime;
+
+  if((!tTime) ||
+     (!localtime_r(&tTime,&tagTime)) ||
+     (!strftime(pcBuffer,sizeBuffer,"%Y-%m-%d %H:%M:%S",&tagTime)))
+    snprintf(pcBuffer,sizeBuffer,"-");
+  return(pcBuffer);
+}
+
+/**
+ * Zero-RPM state machine, called every sampling step and with the temperature on every update:
+ *  - OFF: The fan starts, once the temperature reached the start temperature and the min. off time elapsed.
+ *  - KICK: After a start, the fan runs at full duty for the kick time, ending with the next sampling step.
+ *  - ON: The fan stops, once the temperature is at or below the stop temperature and the min. on time elapsed.
+ * The min. on/off times bound the fan enable writes, the restart latency (start temperature reached to fan enabled)
+ * is bound by the min. off time plus one update interval.
+ *
+ * @return RUN_RET_OK on success, RUN_RET_ Errorcode on failure.
+ */
+static int iFanCtrl_AMDGPU_UpdateZeroRPM_m(TagFanCtrl *ptagFanCtrl,
+                                           int iTemp,
+                                           int iControlTick)
+{
+  TagFanConfigAMDGPU *ptagAMDGPU=ptagFanCtrl->ptagAMDGPU;
+  unsigned long ulNowMs;
+
+  if(!ptagAMDGPU->iZeroRPMStartTemp)
+    return(RUN_RET_OK);
+  ulNowMs=ulFanCtrl_GetTimeMs_m();
+  switch(ptagAMDGPU->uiZeroRPMState)
+  {
+    case ZERO_RPM_STATE_KICK:
+      if(ulNowMs-ptagAMDGPU->ulZeroRPMSinceMs < ptagAMDGPU->uiZeroRPMKickTime)
+        return(RUN_RET_OK);
+      DBG_PRINTF("AMDGPU: Zero-RPM: Kick done after %lums",
+                 ulNowMs-ptagAMDGPU->ulZeroRPMSinceMs);
+      ptagAMDGPU->uiZeroRPMState=ZERO_RPM_STATE_ON;
+      break;
+
+    case ZERO_RPM_STATE_OFF:
+      if(!iControlTick)
+        return(RUN_RET_OK);
+      if(iTemp < ptagAMDGPU->iZeroRPMStartTemp)
+      {
+        ptagAMDGPU->ulZeroRPMStartReqMs=0;
+        return(RUN_RET_OK);
+      }
+      if(!ptagAMDGPU->ulZeroRPMStartReqMs)
+        ptagAMDGPU->ulZeroRPMStartReqMs=ulNowMs;
+      if(ulNowMs-ptagAMDGPU->ulZeroRPMSinceMs < ptagAMDGPU->uiZeroRPMMinOffTime)
+        return(RUN_RET_OK);
+      vFanCtrl_AMDGPU_StartZeroRPM_m(ptagAMDGPU,ulNowMs);
+      DBG_PRINTF("AMDGPU: Zero-RPM: Start at temp. %d, %lums after the start temp. was reached",
+                 iTemp,
+                 ptagAMDGPU->ulZeroRPMLastLatencyMs);
+      break;
+
+    default: /* ZERO_RPM_STATE_ON */
+      if((!iControlTick) ||
+         (iTemp > ptagAMDGPU->iZeroRPMStopTemp) ||
+         (ulNowMs-ptagAMDGPU->ulZeroRPMSinceMs < ptagAMDGPU->uiZeroRPMMinOnTime) ||
+         (ptagAMDGPU->uiStallState != STALL_STATE_OK)) /* A stalled fan stays at max. speed */
+        return(RUN_RET_OK);
+      DBG_PRINTF("AMDGPU: Zero-RPM: Stop at temp. %d after %lums",
+                 iTemp,
+                 ulNowMs-ptagAMDGPU->ulZeroRPMSinceMs);
+      ptagAMDGPU->uiZeroRPMState=ZERO_RPM_STATE_OFF;
+      ptagAMDGPU->ulZeroRPMSinceMs=ulNowMs;
+      ptagAMDGPU->ulZeroRPMStartReqMs=0;
+      ++ptagAMDGPU->ulZeroRPMStops;
+      break;
+  }
+  return(iFanCtrl_AMDGPU_ApplyPWM_m(ptagFanCtrl,ptagAMDGPU->uiRequestPWM));
+}
+
+/**
+ * Limits the change of the fanspeed to the slew rates, in PWM/s of the time since the last call.
+ * While a critical temperature is active, the fanspeed may rise unlimited, if configured.
+ * A stopped fan starts at the requested fanspeed, the spin-up is up to the zero-RPM kick.
+ *
+ * @return Limited fanspeed.
+ */
+static unsigned int uiFanCtrl_AMDGPU_SlewLimit_m(TagFanConfigAMDGPU *ptagAMDGPU,
+                                                 unsigned int uiPWM)
+{
+  unsigned long ulNowMs;
+  unsigned long ulElapsedMs;
+  long lTarget;
+  long lMax;
+  long lMin;
+  long lClip;
+
+  if((!ptagAMDGPU->uiSlewUp) &&
+     (!ptagAMDGPU->uiSlewDown))
+    return(uiPWM);
+  ulNowMs=ulFanCtrl_GetTimeMs_m();
+  lTarget=FIXP_FROM_INT(uiPWM);
+  if((!uiPWM) ||
+     (!ptagAMDGPU->iFanState) ||
+     (ptagAMDGPU->lSlewPWM < 0))
+  {/* Fan stops or starts */
+    ptagAMDGPU->lSlewPWM=(uiPWM)?lTarget:-1;
+    ptagAMDGPU->ulSlewLastMs=ulNowMs;
+    return(uiPWM);
+  }
+  /* Allowed range since the last call, at most one sampling step while settled. 0 rates are unlimited */
+  ulElapsedMs=ulNowMs-ptagAMDGPU->ulSlewLastMs;
+  if(ulElapsedMs > ptagAMDGPU->uiSlewStepMs)
+    ulElapsedMs=ptagAMDGPU->uiSlewStepMs;
+  ptagAMDGPU->ulSlewLastMs=ulNowMs;
+  lMax=((ptagAMDGPU->uiSlewUp) &&
+        ((!ptagAMDGPU->iSlewCriticalUnlimited) ||
+         (!ptagAMDGPU->iCriticalActive)))?
+       ptagAMDGPU->lSlewPWM+(long)((unsigned long long)ptagAMDGPU->uiSlewUp*FIXP_ONE*ulElapsedMs/1000):LONG_MAX;
+  lMin=(ptagAMDGPU->uiSlewDown)?
+       ptagAMDGPU->lSlewPWM-(long)((unsigned long long)ptagAMDGPU->uiSlewDown*FIXP_ONE*ulElapsedMs/1000):LONG_MIN;
+  if((lTarget > lMax) ||
+     (lTarget < lMin))
+  {
+    lClip=(lTarget > lMax)?lMax:lMin;
+    ++ptagAMDGPU->ulSlewClips;
+    if((unsigned int)fixp_ToInt(labs(lTarget-lClip)) > ptagAMDGPU->uiSlewMaxClipPWM)
+      ptagAMDGPU->uiSlewMaxClipPWM=(unsigned int)fixp_ToInt(labs(lTarget-lClip));
+    lTarget=lClip;
+  }
+  ptagAMDGPU->lSlewPWM=lTarget;
+  return((unsigned int)fixp_ToInt(lTarget));
+}
+
+/**
+ * Applies the requested fanspeed again, while the slew limiter is still ramping towards it.
+ *
+ * @return RUN_RET_OK on success, RUN_RET_ Errorcode on failure.
+ */
+static int iFanCtrl_AMDGPU_UpdateSlew_m(TagFanCtrl *ptagFanCtrl)
+{
+  TagFanConfigAMDGPU *ptagAMDGPU=ptagFanCtrl->ptagAMDGPU;
+
+  if((ptagAMDGPU->lSlewPWM < 0) ||
+     (ptagAMDGPU->lSlewPWM == FIXP_FROM_INT(ptagAMDGPU->uiRequestPWM)))
+    return(RUN_RET_OK);
+  return(iFanCtrl_AMDGPU_ApplyPWM_m(ptagFanCtrl,ptagAMDGPU->uiRequestPWM));
+}
+
+/**
+ * Opens the state file, creates it if needed and maps it.
+ * A file of another size or version is reinitialized, it's restored from nothing then.
+ *
+ * @return 0 on success, nonzero on failure.
+ */
+static int iFanCtrl_AMDGPU_OpenState_m(TagFanCtrl *ptagFanCtrl)
+{
+  TagFanConfigAMDGPU *ptagAMDGPU=ptagFanCtrl->ptagAMDGPU;
+  TagFanCtrlStateFile *ptagFile;
+  struct stat tagStat;
+  int iSlot;
+  int iFd;
+
+  if((iFd=open(ptagAMDGPU->pcPathState,O_RDWR | O_CREAT | O_CLOEXEC,0644)) < 0)
+  {
+    ERR_PRINTF("Opening state file \"%s\" failed (%d): %s",
+               ptagAMDGPU->pcPathState,
+               errno,
+               strerror(errno));
+    return(1);
+  }
+  if((fstat(iFd,&tagStat) != 0) ||
+     ((tagStat.st_size != (off_t)sizeof(TagFanCtrlStateFile)) &&
+      (ftruncate(iFd,sizeof(TagFanCtrlStateFile)) != 0)) ||
+     ((ptagFile=mmap(NULL,sizeof(TagFanCtrlStateFile),PROT_READ | PROT_WRITE,MAP_SHARED,iFd,0)) == MAP_FAILED))
+  {
+    ERR_PRINTF("Mapping state file \"%s\" failed (%d): %s",
+               ptagAMDGPU->pcPathState,
+               errno,
+               strerror(errno));
+    close(iFd);
+    return(1);
+  }
+  close(iFd);
+  if((ptagFile->uiMagic != STATE_FILE_MAGIC) ||
+     (ptagFile->uiVersion != STATE_FILE_VERSION) ||
+     (ptagFile->uiSize != sizeof(TagFanCtrlStateFile)))
+  {
+    DBG_PRINTF("State file \"%s\" is empty or of another version, initializing",
+               ptagAMDGPU->pcPathState);
+    memset(ptagFile,0,sizeof(TagFanCtrlStateFile));
+    ptagFile->uiMagic=STATE_FILE_MAGIC;
+    ptagFile->uiVersion=STATE_FILE_VERSION;
+    ptagFile->uiSize=sizeof(TagFanCtrlStateFile);
+  }
+  ptagAMDGPU->ptagState=ptagFile;
+  vFanCtrl_ReadBootId_m(ptagAMDGPU->caBootId,sizeof(ptagAMDGPU->caBootId));
+  iSlot=iFanCtrl_StateCurrentSlot_m(ptagFile,ptagAMDGPU->uiSensorsCount);
+  ptagAMDGPU->uiStateSlot=(iSlot >= 0)?(unsigned int)iSlot:1; /* The first write goes to the other slot */
+  return(0);
+}
+
+/**
+ * Reads the boot ID of the running system, which changes with every boot. Empty, if it isn't available.
+ */
+static void vFanCtrl_ReadBootId_m(char *pcBootId,
+                                  size_t szSize)
+{
+  long lLen;
+
+  memset(pcBootId,0,szSize);
+  if((lLen=lFanCtrl_ReadFile_m(STATE_FILE_PATH_BOOT_ID,pcBootId,szSize)) <= 0)
+  {
+    memset(pcBootId,0,szSize);
+    return;
+  }
+  while((lLen > 0) &&
+        (isspace((unsigned char)pcBootId[lLen-1])))
+    pcBootId[--lLen]='\0';
+}
+
+/**
+ * Finds the current slot of the state file: Valid checksum, same number of sensors, highest generation.
+ *
+ * @return Index of the slot, -1 if there is none.
+ */
+static int iFanCtrl_StateCurrentSlot_m(const TagFanCtrlStateFile *ptagFile,
+                                       unsigned int uiSensorsCount)
+{
+  unsigned int uiIndex;
+  int iSlot=-1;
+
+  for(uiIndex=0;uiIndex < 2;++uiIndex)
+  {
+    if((ptagFile->tagaSlots[uiIndex].uiGeneration) &&
+       (ptagFile->tagaSlots[uiIndex].uiSensorsCount == uiSensorsCount) &&
+       (ptagFile->tagaSlots[uiIndex].uiChecksum == uiFanCtrl_StateChecksum_m(&ptagFile->tagaSlots[uiIndex])) &&
+       ((iSlot < 0) ||
+        (ptagFile->tagaSlots[uiIndex].uiGeneration > ptagFile->tagaSlots[iSlot].uiGeneration)))
+      iSlot=(int)uiIndex;
+  }
+  return(iSlot);
+}
+
+/**
+ * FNV-1a checksum of a state record, the checksum field itself is skipped.
+ */
+static unsigned int uiFanCtrl_StateChecksum_m(const TagFanCtrlStateRecord *ptagRecord)
+{
+  const unsigned char *pucData=(const unsigned char*)ptagRecord;
+  unsigned int uiHash=2166136261U;
+  size_t sizeIndex;
+
+  for(sizeIndex=0;sizeIndex < sizeof(TagFanCtrlStateRecord);++sizeIndex)
+  {
+    if((sizeIndex >= offsetof(TagFanCtrlStateRecord,uiChecksum)) &&
+       (sizeIndex < offsetof(TagFanCtrlStateRecord,uiChecksum)+sizeof(ptagRecord->uiChecksum)))
+      continue;
+    uiHash^=pucData[sizeIndex];
+    uiHash*=16777619U;
+  }
+  return(uiHash);
+}
+
+/**
+ * Restores the controller state of the last run, if it isn't older than the max. age:
+ * Sensor filters, hysteresis references and the PID integrator. The last fanspeed is applied immediately,
+ * so the fan doesn't stay at whatever the device held until the first update.
+ *
+ * @return RUN_RET_OK on success, RUN_RET_ Errorcode on failure.
+ */
+static int iFanCtrl_AMDGPU_RestoreState_m(TagFanCtrl *ptagFanCtrl)
+{
+  TagFanConfigAMDGPU *ptagAMDGPU=ptagFanCtrl->ptagAMDGPU;
+  const TagFanCtrlStateRecord *ptagRecord;
+  unsigned long ulNowMs;
+  int iSlot;
+
+  if((!ptagAMDGPU->ptagState) ||
+     ((iSlot=iFanCtrl_StateCurrentSlot_m(ptagAMDGPU->ptagState,ptagAMDGPU->uiSensorsCount)) < 0))
+    return(RUN_RET_OK);
+  ptagRecord=&ptagAMDGPU->ptagState->tagaSlots[iSlot];
+  ulNowMs=ulFanCtrl_GetTimeMs_m();
+  /* From before a reboot, the driver reset the power cap as well. The clock check covers an unknown boot ID */
+  if((ptagRecord->ullSavedMs > ulNowMs) ||
+     (memcmp(ptagRecord->caBootId,ptagAMDGPU->caBootId,sizeof(ptagRecord->caBootId)) != 0))
+  {
+    DBG_PUTS("State file: Saved state is from before a reboot, not restored");
+    return(RUN_RET_OK);
+  }
+  vFanCtrl_AMDGPU_RestorePowerCap_m(ptagFanCtrl,ptagRecord);
+  if(ulNowMs-ptagRecord->ullSavedMs > ptagAMDGPU->ulStateMaxAgeMs)
+  {
+    DBG_PRINTF("State file: Saved state is too old (%llums), not restored",
+               (unsigned long long)ulNowMs-ptagRecord->ullSavedMs);
+    return(RUN_RET_OK);
+  }
+  ptagAMDGPU->ulStateRestoredAgeMs=ulNowMs-(unsigned long)ptagRecord->ullSavedMs;
+
+  vFanCtrl_AMDGPU_ApplyStateRecord_m(ptagAMDGPU,ptagRecord);
+  if(ptagRecord->iPIDValid) /* The first update integrates one interval, not the downtime */
+    ptagAMDGPU->ulLastUpdateMs=ulNowMs-ptagFanCtrl->uiUpdateDelayTime*100UL;
+  DBG_PRINTF("State file: Restored state of %lums ago, fanspeed %u pwm, hysteresis temp. %d, PID integral %lld (Q8)",
+             ptagAMDGPU->ulStateRestoredAgeMs,
+             ptagRecord->uiRequestPWM,
+             ptagRecord->iHysteresisTemp,
+             ptagRecord->llPIDIntegral);
+  ptagAMDGPU->uiStateSlot=(unsigned int)iSlot;
+  return(iFanCtrl_AMDGPU_ApplyPWM_m(ptagFanCtrl,ptagRecord->uiRequestPWM));
+}
+
+/**
+ * Takes the original power cap from the state record, if the driver doesn't provide its default.
+ * Otherwise a cap lowered or boosted by a crashed instance would become the new original and never be restored.
+ * The age of the record doesn't matter, the cap stays until a reboot.
+ */
+static void vFanCtrl_AMDGPU_RestorePowerCap_m(TagFanCtrl *ptagFanCtrl,
+                                              const TagFanCtrlStateRecord *ptagRecord)
+{
+  TagFanConfigAMDGPU *ptagAMDGPU=ptagFanCtrl->ptagAMDGPU;
+
+  if((!ptagAMDGPU->pcPathPowerCap) ||
+     (ptagAMDGPU->iPowerCapOrigDefault) ||
+     (!ptagRecord->ullPowerCapOrigUW) ||
+     (ptagRecord->ullPowerCapOrigUW == ptagAMDGPU->ulPowerCapOrigUW))
+    return;
+  if(((ptagAMDGPU->iPowerCapTemp) &&
+      (ptagRecord->ullPowerCapOrigUW < ptagAMDGPU->ulPowerCapMinUW)) ||
+     ((ptagAMDGPU->iPowerCapBoostTemp) &&
+      (ptagRecord->ullPowerCapOrigUW >= ptagAMDGPU->ulPowerCapMaxUW)))
+  {
+    DBG_PRINTF("State file: Original power cap %lluW doesn't match the configuration, not restored",
+               ptagRecord->ullPowerCapOrigUW/AMDGPU_RAW_POWER_TO_WATT_DIVISOR);
+    return;
+  }
+  DBG_PRINTF("State file: Original power cap %lluW restored, current cap %luW",
+             ptagRecord->ullPowerCapOrigUW/AMDGPU_RAW_POWER_TO_WATT_DIVISOR,
+             ptagAMDGPU->ulPowerCapUW/AMDGPU_RAW_POWER_TO_WATT_DIVISOR);
+  ptagAMDGPU->ulPowerCapOrigUW=(unsigned long)ptagRecord->ullPowerCapOrigUW;
+}
+
+/**
+ * Writes the controller state to the inactive slot of the state file, if it changed
+ * or the last write is older than STATE_FILE_HEARTBEAT_MS. The file is mapped, so this is a memory copy.
+ */
+static void vFanCtrl_AMDGPU_SaveState_m(TagFanCtrl *ptagFanCtrl)
+{
+  TagFanConfigAMDGPU *ptagAMDGPU=ptagFanCtrl->ptagAMDGPU;
+  TagFanCtrlStateRecord tagRecord;
+  TagFanCtrlStateRecord *ptagCurr;
+  unsigned long ulNowMs;
+
+  if(!ptagAMDGPU->ptagState)
+    return;
+  vFanCtrl_AMDGPU_GetStateRecord_m(ptagAMDGPU,&tagRecord);
+
+  ulNowMs=ulFanCtrl_GetTimeMs_m();
+  ptagCurr=&ptagAMDGPU->ptagState->tagaSlots[ptagAMDGPU->uiStateSlot];
+  if((ptagAMDGPU->ulStateLastMs) &&
+     (ulNowMs-ptagAMDGPU->ulStateLastMs < STATE_FILE_HEARTBEAT_MS) &&
+     (memcmp(&tagRecord.uiSensorsCount,
+             &ptagCurr->uiSensorsCount,
+             sizeof(tagRecord)-offsetof(TagFanCtrlStateRecord,uiSensorsCount)) == 0))
+    return;
+  tagRecord.ullSavedMs=ulNowMs;
+  tagRecord.uiGeneration=ptagCurr->uiGeneration+1;
+  if(!tagRecord.uiGeneration) /* 0 marks an empty slot */
+    tagRecord.uiGeneration=1;
+  tagRecord.uiChecksum=uiFanCtrl_StateChecksum_m(&tagRecord);
+  ptagAMDGPU->uiStateSlot^=1;
+  memcpy(&ptagAMDGPU->ptagState->tagaSlots[ptagAMDGPU->uiStateSlot],&tagRecord,sizeof(tagRecord));
+  ptagAMDGPU->ulStateLastMs=ulNowMs;
+  ++ptagAMDGPU->ulStateWrites;
+}
+
+/**
+ * Fills a state record from the controller state of the device, without generation, checksum and timestamp.
+ * The device must have max. STATE_FILE_MAX_SENSORS sensors.
+ */
+static void vFanCtrl_AMDGPU_GetStateRecord_m(const TagFanConfigAMDGPU *ptagAMDGPU,
+                                             TagFanCtrlStateRecord *ptagRecord)
+{
+  unsigned int uiIndex;
+
+  memset(ptagRecord,0,sizeof(TagFanCtrlStateRecord));
+  ptagRecord->uiSensorsCount=ptagAMDGPU->uiSensorsCount;
+  ptagRecord->uiRequestPWM=ptagAMDGPU->uiRequestPWM;
+  ptagRecord->iHysteresisTemp=ptagAMDGPU->tagHysteresis.iLastUpdateTemp;
+  ptagRecord->iPIDValid=ptagAMDGPU->tagPID.iValid;
+  ptagRecord->iPIDPrevTemp=ptagAMDGPU->tagPID.iPrevTemp;
+  ptagRecord->ullHysteresisMs=ptagAMDGPU->tagHysteresis.ulLastUpdateMs;
+  ptagRecord->llPIDIntegral=ptagAMDGPU->tagPID.llIntegral;
+  if(ptagAMDGPU->pcPathPowerCap)
+    ptagRecord->ullPowerCapOrigUW=ptagAMDGPU->ulPowerCapOrigUW;
+  memcpy(ptagRecord->caBootId,ptagAMDGPU->caBootId,sizeof(ptagRecord->caBootId));
+  for(uiIndex=0;uiIndex < ptagAMDGPU->uiSensorsCount;++uiIndex)
+  {
+    ptagRecord->iaTempFiltered[uiIndex]=ptagAMDGPU->ptagSensors[uiIndex].iTempFiltered;
+    ptagRecord->iaCurveTemp[uiIndex]=ptagAMDGPU->ptagSensors[uiIndex].iCurveTemp;
+  }
+}
+
+/**
+ * Applies a state record to the controller state of the device: The sensor filters are seeded with the filtered values,
+ * the hysteresis references are forced and the PID integrator is set. The record must match the number of sensors.
+ */
+static void vFanCtrl_AMDGPU_ApplyStateRecord_m(TagFanConfigAMDGPU *ptagAMDGPU,
+                                               const TagFanCtrlStateRecord *ptagRecord)
+{
+  unsigned int uiIndex;
+
+  for(uiIndex=0;uiIndex < ptagAMDGPU->uiSensorsCount;++uiIndex)
+  {
+    ptagAMDGPU->ptagSensors[uiIndex].iTempFiltered=ctrlFilter_Update(&ptagAMDGPU->ptagSensors[uiIndex].tagFilter,
+                                                                      ptagRecord->iaTempFiltered[uiIndex]);
+    ptagAMDGPU->ptagSensors[uiIndex].iCurveTemp=ptagRecord->iaCurveTemp[uiIndex];
+    if(ptagAMDGPU->ptagSensors[uiIndex].ptagCurve)
+      ctrlHysteresis_Force(&ptagAMDGPU->ptagSensors[uiIndex].tagHysteresis,
+                           ptagRecord->iaCurveTemp[uiIndex],
+                           (unsigned long)ptagRecord->ullHysteresisMs);
+  }
+  ctrlHysteresis_Force(&ptagAMDGPU->tagHysteresis,
+                       ptagRecord->iHysteresisTemp,
+                       (unsigned long)ptagRecord->ullHysteresisMs);
+  if(ptagRecord->iPIDValid)
+  {
+    ptagAMDGPU->tagPID.llIntegral=ptagRecord->llPIDIntegral;
+    ptagAMDGPU->tagPID.iPrevTemp=ptagRecord->iPIDPrevTemp;
+    ptagAMDGPU->tagPID.iValid=1;
+  }
+}
+
+/**
+ * Starts the fan from zero-RPM, with a kick if configured and the fanspeed is not max. anyway.
+ * Records the restart latency, from reaching the start temperature (or now) to the start.
+ */
+static void vFanCtrl_AMDGPU_StartZeroRPM_m(TagFanConfigAMDGPU *ptagAMDGPU,
+                                           unsigned long ulNowMs)
+{
+  ptagAMDGPU->ulZeroRPMLastLatencyMs=(ptagAMDGPU->ulZeroRPMStartReqMs)?ulNowMs-ptagAMDGPU->ulZeroRPMStartReqMs:0;
+  if(ptagAMDGPU->ulZeroRPMLastLatencyMs > ptagAMDGPU->ulZeroRPMMaxLatencyMs)
+    ptagAMDGPU->ulZeroRPMMaxLatencyMs=ptagAMDGPU->ulZeroRPMLastLatencyMs;
+  ptagAMDGPU->ulZeroRPMStartReqMs=0;
+  ptagAMDGPU->ulZeroRPMSinceMs=ulNowMs;
+  ++ptagAMDGPU->ulZeroRPMStarts;
+  if((ptagAMDGPU->uiZeroRPMKickTime) &&
+     (ptagAMDGPU->uiRequestPWM != AMDGPU_PWM_VAL_MAX))
+  {
+    ptagAMDGPU->uiZeroRPMState=ZERO_RPM_STATE_KICK;
+    ++ptagAMDGPU->ulZeroRPMKicks;
+  }
+  else
+    ptagAMDGPU->uiZeroRPMState=ZERO_RPM_STATE_ON;
+}
+
+/**
+ * Switches the AMDGPU device to manual mode and enables the fan.
+ *
+ * @return RUN_RET_OK on success, RUN_RET_ Errorcode on failure.
+ */
+static int iFanCtrl_AMDGPU_Start_m(TagFanCtrl *ptagFanCtrl)
+{
+  if(amdgpu_SetMode(ptagFanCtrl,1))
+  {
+    DBG_PUTS("amdgpu_SetMode() failed");
+    return(RUN_RET_ERR_INIT);
+  }
+  /* Initial enable fan */
+  if(iFanCtrl_EnableFan(eFanCtrlType_AMDGPU,
+                        ptagFanCtrl->ptagAMDGPU->pcPathEnableFan,
+                        1))
+  {
+    DBG_PUTS("iFanCtrl_EnableFan() failed");
+    return(RUN_RET_ERR_FAN_ENABLE);
+  }
+  ptagFanCtrl->ptagAMDGPU->iFanState=1;
+  return(RUN_RET_OK);
+}
+
+/**
+ * Checks if any sensor of the device is at or above its critical or emergency temperature.
+ * Raw values are used, so the filters don't delay the reaction.
+ *
+ * @return 0 if no threshold is reached, SENSOR_CRIT_ enum otherwise.
+ */
+static int iFanCtrl_AMDGPU_CheckCritical_m(const TagFanConfigAMDGPU *ptagAMDGPU)
+{
+  unsigned int uiIndex;
+  int iRc=0;
+
+  for(uiIndex=0;uiIndex < ptagAMDGPU->uiSensorsCount;++uiIndex)
+  {
+    if((ptagAMDGPU->ptagSensors[uiIndex].iEmergencyTemp) &&
+       (ptagAMDGPU->ptagSensors[uiIndex].iTempCelsius >= ptagAMDGPU->ptagSensors[uiIndex].iEmergencyTemp))
+      return(SENSOR_CRIT_EMERGENCY);
+    if((ptagAMDGPU->ptagSensors[uiIndex].iCriticalTemp) &&
+       (ptagAMDGPU->ptagSensors[uiIndex].iTempCelsius >= ptagAMDGPU->ptagSensors[uiIndex].iCriticalTemp))
+      iRc=SENSOR_CRIT_CRITICAL;
+  }
+  return(iRc);
+}
+
+/**
+ * Reads the configured load inputs (power draw, GPU load, GPU clock) of the device.
+ * On failure, the last value is kept, these are optional inputs only.
+ */
+static void vFanCtrl_AMDGPU_ReadLoad_m(TagFanConfigAMDGPU *ptagAMDGPU)
+{
+  long lValue;
+
+  if(ptagAMDGPU->pcPathPowerRead)
+  {
+    if(iFanCtrl_ReadSysfsLong_m(ptagAMDGPU->pcPathPowerRead,&lValue) != SENSOR_READ_RET_OK)
+      ++ptagAMDGPU->ulPowerReadErrors;
+    else
+      ptagAMDGPU->iPowerW=(int)fixp_DivRound(lValue,AMDGPU_RAW_POWER_TO_WATT_DIVISOR);
+  }
+  if(ptagAMDGPU->pcPathBusyRead)
+  {
+    if(iFanCtrl_ReadSysfsLong_m(ptagAMDGPU->pcPathBusyRead,&lValue) != SENSOR_READ_RET_OK)
+      ++ptagAMDGPU->ulBusyReadErrors;
+    else
+      ptagAMDGPU->iBusyPercent=(int)lValue;
+  }
+  if(ptagAMDGPU->pcPathClockRead)
+  {
+    if(iFanCtrl_ReadDPMClock_m(ptagAMDGPU->pcPathClockRead,
+                               &ptagAMDGPU->uiClockMHz,
+                               &ptagAMDGPU->uiClockMaxMHz) != SENSOR_READ_RET_OK)
+      ++ptagAMDGPU->ulClockReadErrors;
+  }
+}
+
+/**
+ * Throttle detection: The GPU is treated as thermally throttled, if it is under load near the temperature limit,
+ * but its clock dropped below the expected level. While throttled, the fanspeed bias is raised every update,
+ * once the temperature is below the limit again, it is lowered in smaller steps.
+ */
+static void vFanCtrl_AMDGPU_CheckThrottle_m(TagFanCtrl *ptagFanCtrl,
+                                           int iTemp)
+{
+  TagFanConfigAMDGPU *ptagAMDGPU=ptagFanCtrl->ptagAMDGPU;
+  unsigned int uiStep;
+  int iThrottled;
+
+  if(!ptagAMDGPU->iThrottleTemp)
+    return;
+
+  iThrottled=((iTemp >= ptagAMDGPU->iThrottleTemp) &&
+              (ptagAMDGPU->iBusyPercent >= ptagAMDGPU->iThrottleBusy) &&
+              (ptagAMDGPU->uiClockMHz*100UL < (unsigned long)ptagAMDGPU->uiClockMaxMHz*ptagAMDGPU->uiThrottleClock))?1:0;
+  if(iThrottled)
+  {
+    if(!ptagAMDGPU->iThrottled)
+    {
+      ++ptagAMDGPU->ulThrottleEvents;
+      DBG_PRINTF("AMDGPU: Throttling detected: temp. %d, clock %u of %u MHz, load %d%%",
+                 iTemp,
+                 ptagAMDGPU->uiClockMHz,
+                 ptagAMDGPU->uiClockMaxMHz,
+                 ptagAMDGPU->iBusyPercent);
+    }
+    ++ptagAMDGPU->ulThrottleUpdates;
+    ptagAMDGPU->uiThrottleBiasPWM+=ptagAMDGPU->uiThrottleBiasStep;
+    if(ptagAMDGPU->uiThrottleBiasPWM > AMDGPU_PWM_VAL_MAX)
+      ptagAMDGPU->uiThrottleBiasPWM=AMDGPU_PWM_VAL_MAX;
+    if(ptagAMDGPU->uiThrottleBiasPWM > ptagAMDGPU->uiThrottleMaxBiasPWM)
+      ptagAMDGPU->uiThrottleMaxBiasPWM=ptagAMDGPU->uiThrottleBiasPWM;
+  }
+  else if(iTemp < ptagAMDGPU->iThrottleTemp)
+  {
+    uiStep=(ptagAMDGPU->uiThrottleBiasStep < THROTTLE_BIAS_RELEASE_DIVISOR)?1:ptagAMDGPU->uiThrottleBiasStep/THROTTLE_BIAS_RELEASE_DIVISOR;
+    ptagAMDGPU->uiThrottleBiasPWM-=(ptagAMDGPU->uiThrottleBiasPWM > uiStep)?uiStep:ptagAMDGPU->uiThrottleBiasPWM;
+  }
+  ptagAMDGPU->iThrottled=iThrottled;
+}
+
+/**
+ * Power cap actuator:
+ *  - If the fanspeed is already at the max. fanspeed of the curve and the temperature is still above the
+ *    power cap temperature, the power cap is lowered by one step per update, down to the configured minimum.
+ *    Once the temperature is below the power cap temperature minus hysteresis, it is raised again in the same steps.
+ *  - Boost (optional): While the temperature is below the boost temperature minus hysteresis and the fanspeed
+ *    is below the boost fanspeed, the power cap is raised by one step per update above the original value, up to the max. cap.
+ *    If one of the limits is reached, the boost is backed off by POWER_CAP_BOOST_BACKOFF_STEPS steps per update.
+ * Uses the fanspeed of the previous update, write failures are counted only, the fan control keeps running.
+ * Every change is logged, so the throughput can be attributed.
+ */
+static void vFanCtrl_AMDGPU_UpdatePowerCap_m(TagFanCtrl *ptagFanCtrl,
+                                            int iTemp)
+{
+  TagFanConfigAMDGPU *ptagAMDGPU=ptagFanCtrl->ptagAMDGPU;
+  unsigned long ulPowerCapUW=ptagAMDGPU->ulPowerCapUW;
+  unsigned long ulUpperUW;
+  unsigned long ulStepUW;
+  unsigned int uiPWM;
+  const char *pcReason;
+
+  if(((!ptagAMDGPU->iPowerCapTemp) &&
+      (!ptagAMDGPU->iPowerCapBoostTemp)) ||
+     (ptagAMDGPU->uiStallState == STALL_STATE_FAILED) || /* Held at the fan failure cap */
+     ((ptagAMDGPU->iFanState) &&
+      (ptagAMDGPU->uiLastPWM == UINT_MAX))) /* Applied fanspeed unknown, e.g. before the first update */
+    return;
+
+  uiPWM=(ptagAMDGPU->iFanState)?ptagAMDGPU->uiLastPWM:0;
+  if((ptagAMDGPU->iPowerCapTemp) &&
+     (iTemp > ptagAMDGPU->iPowerCapTemp) &&
+     (uiPWM >= ptagAMDGPU->ptagCurve->ptagPoints[ptagAMDGPU->ptagCurve->uiPointsCount-1].uiFanSpeedPWM))
+  {/* Fanspeed saturated */
+    if(ulPowerCapUW <= ptagAMDGPU->ulPowerCapMinUW)
+      return;
+    ulPowerCapUW=(ulPowerCapUW-ptagAMDGPU->ulPowerCapMinUW > ptagAMDGPU->ulPowerCapStepUW)?ulPowerCapUW-ptagAMDGPU->ulPowerCapStepUW:ptagAMDGPU->ulPowerCapMinUW;
+    ++ptagAMDGPU->ulPowerCapDecreases;
+    pcReason="fanspeed saturated";
+  }
+  else if((ptagAMDGPU->iPowerCapBoostTemp) &&
+          (ulPowerCapUW > ptagAMDGPU->ulPowerCapOrigUW) &&
+          ((iTemp >= ptagAMDGPU->iPowerCapBoostTemp) ||
+           (uiPWM >= ptagAMDGPU->uiPowerCapBoostPWM)))
+  {/* Boost limit reached, back off fast */
+    ulStepUW=ptagAMDGPU->ulPowerCapStepUW*POWER_CAP_BOOST_BACKOFF_STEPS;
+    ulPowerCapUW=(ulPowerCapUW-ptagAMDGPU->ulPowerCapOrigUW > ulStepUW)?ulPowerCapUW-ulStepUW:ptagAMDGPU->ulPowerCapOrigUW;
+    ++ptagAMDGPU->ulPowerCapBoostBackoffs;
+    pcReason="boost back-off";
+  }
+  else
+  {
+    /* Below the original cap: Restore. Above: Boost, if enabled and there is headroom */
+    if(ulPowerCapUW < ptagAMDGPU->ulPowerCapOrigUW)
+    {
+      if((ptagAMDGPU->iPowerCapTemp) &&
+         (iTemp > ptagAMDGPU->iPowerCapTemp-ptagAMDGPU->iPowerCapHysteresis))
+        return;
+      ulUpperUW=ptagAMDGPU->ulPowerCapOrigUW;
+      pcReason="restore";
+    }
+    else if((ptagAMDGPU->iPowerCapBoostTemp) &&
+            (iTemp <= ptagAMDGPU->iPowerCapBoostTemp-ptagAMDGPU->iPowerCapHysteresis) &&
+            (uiPWM < ptagAMDGPU->uiPowerCapBoostPWM))
+    {
+      ulUpperUW=ptagAMDGPU->ulPowerCapMaxUW;
+      pcReason="boost";
+    }
+    else
+      return;
+    if(ulPowerCapUW >= ulUpperUW)
+      return;
+    ulPowerCapUW=(ulUpperUW-ulPowerCapUW > ptagAMDGPU->ulPowerCapStepUW)?ulPowerCapUW+ptagAMDGPU->ulPowerCapStepUW:ulUpperUW;
+    ++ptagAMDGPU->ulPowerCapIncreases;
+  }
+
+  LOG_PRINTF("AMDGPU: Power cap %luW -> %luW (%s), temp. %d, fanspeed %u pwm",
+             ptagAMDGPU->ulPowerCapUW/AMDGPU_RAW_POWER_TO_WATT_DIVISOR,
+             ulPowerCapUW/AMDGPU_RAW_POWER_TO_WATT_DIVISOR,
+             pcReason,
+             iTemp,
+             uiPWM);
+  iFanCtrl_AMDGPU_SetPowerCap_m(ptagFanCtrl,ulPowerCapUW);
+  if(ptagAMDGPU->ulPowerCapUW < ptagAMDGPU->ulPowerCapLowestUW)
+    ptagAMDGPU->ulPowerCapLowestUW=ptagAMDGPU->ulPowerCapUW;
+  if(ptagAMDGPU->ulPowerCapUW > ptagAMDGPU->ulPowerCapHighestUW)
+    ptagAMDGPU->ulPowerCapHighestUW=ptagAMDGPU->ulPowerCapUW;
+}
+
+/**
+ * Writes the power cap of the AMDGPU device.
+ *
+ * @return 0 on success, nonzero on failure.
+ */
+static int iFanCtrl_AMDGPU_SetPowerCap_m(TagFanCtrl *ptagFanCtrl,
+                                         unsigned long ulPowerCapUW)
+{
+  if(iFanCtrl_WriteSysfsULong_m(ptagFanCtrl->ptagAMDGPU->pcPathPowerCap,
+                                ulPowerCapUW))
+  {
+    ++ptagFanCtrl->ptagAMDGPU->ulPowerCapWriteErrors;
+    return(1);
+  }
+  ptagFanCtrl->ptagAMDGPU->ulPowerCapUW=ulPowerCapUW;
+  return(0);
+}
+
+/**
+ * Adds a bias (feed-forward, throttle bias) to a fanspeed, limited to the max. fanspeed of the active curve.
+ */
+static unsigned int uiFanCtrl_AMDGPU_AddBias_m(const TagFanConfigAMDGPU *ptagAMDGPU,
+                                               unsigned int uiPWM,
+                                               unsigned int uiBias)
+{
+  unsigned int uiPWMMax=ptagAMDGPU->ptagCurve->ptagPoints[ptagAMDGPU->ptagCurve->uiPointsCount-1].uiFanSpeedPWM;
+
+  if(uiPWM >= uiPWMMax)
+    return(uiPWM);
+  if(uiBias >= uiPWMMax-uiPWM)
+    return(uiPWMMax);
+  return(uiPWM+uiBias);
+}
+
+/**
+ * Selects the curve profile by its rules and advances a running cross-fade, called once per update.
+ * All curves are precomputed at init, a switch only replaces the pointer to the active curve.
+ * Rules of a profile are AND-ed, the first matching profile wins, if none matches the default curve is used.
+ * The GPU load rule changes its state only after the load stayed above/below the threshold for the configured time.
+ * Read failures are counted only, the last values are kept.
+ */
+static void vFanCtrl_AMDGPU_SelectProfile_m(TagFanConfigAMDGPU *ptagAMDGPU,
+                                            unsigned long ulNowMs)
+{
+  TagFanCtrlCurve *ptagCurve;
+  const TagFanCtrlCurve *ptagSelected;
+  unsigned int uiIndex;
+  int iAbove;
+
+  if((ptagAMDGPU->ptagCurveFade) &&
+     (++ptagAMDGPU->uiFadeTick >= ptagAMDGPU->uiFadeTicks))
+    ptagAMDGPU->ptagCurveFade=NULL;
+  if(ptagAMDGPU->uiCurvesCount < 2)
+    return;
+
+  if((ptagAMDGPU->pcPathPowerProfile) &&
+     (iFanCtrl_ReadPowerProfile_m(ptagAMDGPU->pcPathPowerProfile,
+                                  ptagAMDGPU->caPowerProfile,
+                                  sizeof(ptagAMDGPU->caPowerProfile))))
+    ++ptagAMDGPU->ulProfileReadErrors;
+  if((ptagAMDGPU->pcPathProfileHint) &&
+     (iFanCtrl_ReadHint_m(ptagAMDGPU->pcPathProfileHint,
+                          ptagAMDGPU->caProfileHint,
+                          sizeof(ptagAMDGPU->caProfileHint))))
+    ++ptagAMDGPU->ulProfileReadErrors;
+
+  ptagSelected=ptagAMDGPU->ptagCurves;
+  for(uiIndex=1;uiIndex < ptagAMDGPU->uiCurvesCount;++uiIndex)
+  {
+    ptagCurve=&ptagAMDGPU->ptagCurves[uiIndex];
+    if(ptagCurve->iRuleBusy)
+    {/* Sustained GPU load, evaluated for every profile to keep the timers running */
+      iAbove=(ptagAMDGPU->iBusyPercent >= ptagCurve->iRuleBusy)?1:0;
+      if(iAbove == ptagCurve->iBusyMatch)
+        ptagCurve->ulBusyChangeMs=0;
+      else
+      {
+        if(!ptagCurve->ulBusyChangeMs)
+          ptagCurve->ulBusyChangeMs=ulNowMs;
+        if(ulNowMs-ptagCurve->ulBusyChangeMs >= ptagCurve->ulRuleBusyTimeMs)
         {
-          /* Calculate delta between 2 defined points (P-lower and P-Higher), Dlp */
-          uiCurrPWM=(ptagFanCtrl->ptagAMDGPU->ptagPoints[uiIndex].iTemp-ptagFanCtrl->ptagAMDGPU->ptagPoints[uiIndex-1].iTemp);
-          /* Calculate delta between current temperature point and lower defined point. Then divide by Delta Dlp. */
-          fTmp=(float)uiCurrPWM / (iHighestSensorTempVal-ptagFanCtrl->ptagAMDGPU->ptagPoints[uiIndex-1].iTemp);
-          /* Calculate percentage of fan speed (multilied by factor 100) */
-          fTmp=((float)(ptagFanCtrl->ptagAMDGPU->ptagPoints[uiIndex].uiFanSpeedPWM-ptagFanCtrl->ptagAMDGPU->ptagPoints[uiIndex-1].uiFanSpeedPWM))/fTmp;
-          uiCurrPWM=(ptagFanCtrl->ptagAMDGPU->ptagPoints[uiIndex-1].uiFanSpeedPWM*100)+(unsigned int)(fTmp*100+0.5);
+          ptagCurve->iBusyMatch=iAbove;
+          ptagCurve->ulBusyChangeMs=0;
         }
       }
+    }
+    if((ptagSelected != ptagAMDGPU->ptagCurves) ||
+       ((ptagCurve->iRuleBusy) && (!ptagCurve->iBusyMatch)) ||
+       ((ptagCurve->pcRulePowerProfile) && (strcmp(ptagCurve->pcRulePowerProfile,ptagAMDGPU->caPowerProfile) != 0)) ||
+       ((ptagCurve->pcRuleHint) && (strcmp(ptagCurve->pcRuleHint,ptagAMDGPU->caProfileHint) != 0)))
+      continue;
+    ptagSelected=ptagCurve;
+  }
+  if(ptagSelected == ptagAMDGPU->ptagCurve)
+    return;
+
+  LOG_PRINTF("AMDGPU: Profile \"%s\" -> \"%s\", GPU load %d%%, power profile \"%s\", hint \"%s\"",
+             ptagAMDGPU->ptagCurve->pcName,
+             ptagSelected->pcName,
+             ptagAMDGPU->iBusyPercent,
+             ptagAMDGPU->caPowerProfile,
+             ptagAMDGPU->caProfileHint);
+  ++ptagAMDGPU->ulProfileSwitches;
+  /* A running cross-fade is restarted from the previous target curve */
+  if(ptagAMDGPU->uiFadeTicks > 1)
+  {
+    ptagAMDGPU->ptagCurveFade=ptagAMDGPU->ptagCurve;
+    ptagAMDGPU->uiFadeTick=1;
+  }
+  ptagAMDGPU->ptagCurve=ptagSelected;
+}
+
+/**
+ * Creates the non-blocking hint socket. A stale socket of a previous run is removed.
+ * With a configured mode, the socket is created accessible by the owner only, until the mode and group are set.
+ *
+ * @return Socket descriptor on success, -1 on failure.
+ */
+static int iFanCtrl_OpenHintSocket_m(const char *pcPath,
+                                     unsigned int uiMode,
+                                     const char *pcGroup)
+{
+  struct sockaddr_un tagAddr;
+  struct stat tagStat;
+  mode_t tagUmask=0;
+  int iSocket;
+  int iRc;
+
+  if((lstat(pcPath,&tagStat) == 0) &&
+     (S_ISSOCK(tagStat.st_mode)))
+    unlink(pcPath);
+  if((iSocket=socket(AF_UNIX,SOCK_DGRAM|SOCK_NONBLOCK|SOCK_CLOEXEC,0)) < 0)
+  {
+    ERR_PRINTF("socket() failed (%d): %s",
+               errno,
+               strerror(errno));
+    return(-1);
+  }
+  memset(&tagAddr,0,sizeof(tagAddr));
+  tagAddr.sun_family=AF_UNIX;
+  strncpy(tagAddr.sun_path,pcPath,sizeof(tagAddr.sun_path)-1);
+  if(uiMode)
+    tagUmask=umask(S_IRWXG | S_IRWXO | S_IXUSR);
+  iRc=bind(iSocket,(const struct sockaddr*)&tagAddr,sizeof(tagAddr));
+  if(uiMode)
+    umask(tagUmask);
+  if(iRc != 0)
+  {
+    ERR_PRINTF("bind(\"%s\") failed (%d): %s",
+               pcPath,
+               errno,
+               strerror(errno));
+    close(iSocket);
+    return(-1);
+  }
+  if(iFanCtrl_SetHintSocketAccess_m(pcPath,uiMode,pcGroup))
+  {
+    close(iSocket);
+    unlink(pcPath);
+    return(-1);
+  }
+  return(iSocket);
+}
+
+/**
+ * Sets the access mode and group of the hint socket, the group is a name or a numeric ID.
+ *
+ * @param uiMode   _IN_ Access mode, 0 to keep it
+ * @param pcGroup  _IN_ Group, NULL to keep it
+ *
+ * @return 0 on success, nonzero on failure.
+ */
+static int iFanCtrl_SetHintSocketAccess_m(const char *pcPath,
+                                          unsigned int uiMode,
+                                          const char *pcGroup)
+{
+  const struct group *ptagGroup;
+  unsigned long ulGid;
+  char *pcEnd;
+
+  if(pcGroup)
+  {
+    if((ptagGroup=getgrnam(pcGroup)))
+      ulGid=ptagGroup->gr_gid;
+    else if((!isdigit((unsigned char)pcGroup[0])) ||
+            ((ulGid=strtoul(pcGroup,&pcEnd,10)),*pcEnd != '\0'))
+    {
+      ERR_PRINTF("Hint socket: Unknown group \"%s\"",pcGroup);
+      return(1);
+    }
+    if(chown(pcPath,(uid_t)-1,(gid_t)ulGid) != 0)
+    {
+      ERR_PRINTF("chown(\"%s\") failed (%d): %s",
+                 pcPath,
+                 errno,
+                 strerror(errno));
+      return(1);
+    }
+  }
+  if((uiMode) &&
+     (chmod(pcPath,(mode_t)uiMode) != 0))
+  {
+    ERR_PRINTF("chmod(\"%s\") failed (%d): %s",
+               pcPath,
+               errno,
+               strerror(errno));
+    return(1);
+  }
+  return(0);
+}
+
+/**
+ * Reads the pending load hints without blocking and updates the hint fanspeed, called once per update.
+ * At most HINT_MAX_MESSAGES_PER_UPDATE messages are read, the latest valid hint replaces an active one.
+ * The hint fanspeed is the expected power above the current power draw, scaled by the hint gain.
+ */
+static void vFanCtrl_AMDGPU_ReadHints_m(TagFanCtrl *ptagFanCtrl,
+                                       unsigned long ulNowMs)
+{
+  TagFanConfigAMDGPU *ptagAMDGPU=ptagFanCtrl->ptagAMDGPU;
+  char caMsg[128];
+  char caDevice[32];
+  ssize_t sszLen;
+  unsigned int uiIndex;
+  unsigned long ulDurationS;
+  long lDurationS;
+  long lPowerW;
+  long lHintPWM;
+
+  if(ptagAMDGPU->iHintSocket < 0)
+    return;
+
+  for(uiIndex=0;uiIndex < HINT_MAX_MESSAGES_PER_UPDATE;++uiIndex)
+  {
+    if((sszLen=recv(ptagAMDGPU->iHintSocket,caMsg,sizeof(caMsg)-1,MSG_DONTWAIT)) < 0)
+      break; /* No more messages (EAGAIN), or error */
+    caMsg[sszLen]='\0';
+    ++ptagAMDGPU->ulHintsReceived;
+    /* Format: "<device> <expected power in W> <duration in seconds>" */
+    /* Signed duration: %lu would accept "-5" as a huge value */
+    if((sscanf(caMsg,"%31s %ld %ld",caDevice,&lPowerW,&lDurationS) != 3) ||
+       (strcmp(caDevice,ptagAMDGPU->pcHintDevice) != 0) ||
+       (lPowerW < 0) ||
+       (lPowerW > INT_MAX) ||
+       (lDurationS < 0))
+    {
+      ++ptagAMDGPU->ulHintsRejected;
+      DBG_PRINTF("AMDGPU: Hint rejected: \"%s\"",caMsg);
+      continue;
+    }
+    ulDurationS=(unsigned long)lDurationS;
+    if(ulDurationS > ptagAMDGPU->ulHintMaxTTLMs/1000UL)
+      ulDurationS=ptagAMDGPU->ulHintMaxTTLMs/1000UL;
+    ptagAMDGPU->iHintPowerW=(ulDurationS)?(int)lPowerW:0;
+    ptagAMDGPU->ulHintExpiresMs=ulNowMs+ulDurationS*1000UL;
+    LOG_PRINTF("AMDGPU: Load hint %ldW for %lus",
+               lPowerW,
+               ulDurationS);
+  }
+
+  if((ptagAMDGPU->iHintPowerW) &&
+     ((long)(ulNowMs-ptagAMDGPU->ulHintExpiresMs) >= 0))
+  {
+    LOG_PRINTF("AMDGPU: Load hint %dW expired",ptagAMDGPU->iHintPowerW);
+    ++ptagAMDGPU->ulHintsExpired;
+    ptagAMDGPU->iHintPowerW=0;
+  }
+
+  ptagAMDGPU->uiHintPWM=0;
+  if(ptagAMDGPU->iHintPowerW > ptagAMDGPU->iPowerW)
+  {
+    lHintPWM=fixp_DivRound((long)(ptagAMDGPU->iHintPowerW-ptagAMDGPU->iPowerW)*(long)ptagAMDGPU->uiHintGain,100);
+    ptagAMDGPU->uiHintPWM=(lHintPWM > AMDGPU_PWM_VAL_MAX)?AMDGPU_PWM_VAL_MAX:(unsigned int)lHintPWM;
+  }
+  if(ptagAMDGPU->uiHintPWM)
+    ++ptagAMDGPU->ulHintUpdates;
+  if(ptagAMDGPU->uiHintPWM > ptagAMDGPU->uiHintMaxPWM)
+    ptagAMDGPU->uiHintMaxPWM=ptagAMDGPU->uiHintPWM;
+}
+
+/**
+ * Performs a full update for the AMDGPU device: Evaluates the sensor values and updates the fanspeed if needed.
+ *
+ * @return RUN_RET_OK on success, RUN_RET_ Errorcode on failure.
+ */
+static int iFanCtrl_AMDGPU_Update_m(TagFanCtrl *ptagFanCtrl)
+{
+  TagFanConfigAMDGPU *ptagAMDGPU=ptagFanCtrl->ptagAMDGPU;
+  int iHighestSensorTempVal;
+  int iHighestRawTempVal;
+  unsigned int uiIndex;
+  unsigned int uiCurrPWM;
+  unsigned long ulNowMs;
+  int iFeedForward;
+  int iCritical;
+  int iAccepted;
+  int iChanged;
+  int iRc;
+
+  iHighestSensorTempVal=INT_MIN;
+  iHighestRawTempVal=INT_MIN;
+  for(uiIndex=0;uiIndex < ptagAMDGPU->uiSensorsCount;++uiIndex)
+  {
+    DBG_PRINTF("Current Sensor[%u]\n"
+               "\"%s\": Rawvalue=%ld, 1/10°C raw=%d, filtered=%d",
+               uiIndex,
+               ptagAMDGPU->ptagSensors[uiIndex].pcSensorReadPath,
+               ptagAMDGPU->ptagSensors[uiIndex].lRawValue,
+               ptagAMDGPU->ptagSensors[uiIndex].iTempCelsius,
+               ptagAMDGPU->ptagSensors[uiIndex].iTempFiltered);
+
+    if(ptagAMDGPU->ptagSensors[uiIndex].iTempFiltered > iHighestSensorTempVal)
+      iHighestSensorTempVal=ptagAMDGPU->ptagSensors[uiIndex].iTempFiltered;
+    if(ptagAMDGPU->ptagSensors[uiIndex].iTempCelsius > iHighestRawTempVal)
+      iHighestRawTempVal=ptagAMDGPU->ptagSensors[uiIndex].iTempCelsius;
+  }
+
+  vFanCtrl_AMDGPU_ReadLoad_m(ptagAMDGPU);
+  ulNowMs=ulFanCtrl_GetTimeMs_m();
+  if((iRc=iFanCtrl_AMDGPU_CheckStall_m(ptagFanCtrl,ulNowMs)) != RUN_RET_OK)
+    return(iRc);
+  if((iRc=iFanCtrl_AMDGPU_UpdateZeroRPM_m(ptagFanCtrl,iHighestSensorTempVal,1)) != RUN_RET_OK)
+    return(iRc);
+  vFanCtrl_AMDGPU_SelectProfile_m(ptagAMDGPU,ulNowMs);
+  vFanCtrl_AMDGPU_ReadHints_m(ptagFanCtrl,ulNowMs);
+
+  /* Feed-forward: Only raises the fanspeed ahead of the temperature, decreasing is left to the temperature */
+  iFeedForward=0;
+  if(ptagAMDGPU->pcPathPowerRead)
+    iFeedForward+=ctrlFeedForward_Update(&ptagAMDGPU->tagFeedForwardPower,
+                                         ptagAMDGPU->iPowerW,
+                                         ulNowMs-ptagAMDGPU->ulFeedForwardLastMs);
+  if(ptagAMDGPU->pcPathBusyRead)
+    iFeedForward+=ctrlFeedForward_Update(&ptagAMDGPU->tagFeedForwardBusy,
+                                         ptagAMDGPU->iBusyPercent,
+                                         ulNowMs-ptagAMDGPU->ulFeedForwardLastMs);
+  ptagAMDGPU->ulFeedForwardLastMs=ulNowMs;
+  ptagAMDGPU->uiFeedForwardPWM=(iFeedForward > 0)?(unsigned int)iFeedForward:0;
+  if(ptagAMDGPU->uiFeedForwardPWM > ptagAMDGPU->uiFeedForwardMaxPWM)
+    ptagAMDGPU->uiFeedForwardMaxPWM=ptagAMDGPU->uiFeedForwardPWM;
+
+  vFanCtrl_AMDGPU_CheckThrottle_m(ptagFanCtrl,iHighestSensorTempVal);
+  vFanCtrl_AMDGPU_UpdatePowerCap_m(ptagFanCtrl,iHighestSensorTempVal);
+
+  /* Critical temperature fast path: Max. fanspeed, bypassing hysteresis */
+  if((iCritical=iFanCtrl_AMDGPU_CheckCritical_m(ptagAMDGPU)))
+  {
+    ptagAMDGPU->ulCriticalBelowSinceMs=0;
+    if(!ptagAMDGPU->iCriticalActive)
+    {
+      ptagAMDGPU->iCriticalActive=1;
+      ptagAMDGPU->iCriticalPWMPending=1;
+      /* Crossing time is the time the first sensor above threshold was sampled */
+      ptagAMDGPU->ulCriticalSinceMs=ulNowMs;
+      for(uiIndex=0;uiIndex < ptagAMDGPU->uiSensorsCount;++uiIndex)
+      {
+        if((((ptagAMDGPU->ptagSensors[uiIndex].iCriticalTemp) &&
+             (ptagAMDGPU->ptagSensors[uiIndex].iTempCelsius >= ptagAMDGPU->ptagSensors[uiIndex].iCriticalTemp)) ||
+            ((ptagAMDGPU->ptagSensors[uiIndex].iEmergencyTemp) &&
+             (ptagAMDGPU->ptagSensors[uiIndex].iTempCelsius >= ptagAMDGPU->ptagSensors[uiIndex].iEmergencyTemp))) &&
+           (ptagAMDGPU->ptagSensors[uiIndex].ulSampleMs < ptagAMDGPU->ulCriticalSinceMs))
+          ptagAMDGPU->ulCriticalSinceMs=ptagAMDGPU->ptagSensors[uiIndex].ulSampleMs;
+      }
+      if(iCritical == SENSOR_CRIT_EMERGENCY)
+      {
+        ++ptagAMDGPU->ulEmergencyEvents;
+        ERR_PRINTF("AMDGPU: Emergency temperature reached (%d), max. fanspeed",iHighestRawTempVal);
+      }
       else
-        uiCurrPWM=0;
+      {
+        ++ptagAMDGPU->ulCriticalEvents;
+        DBG_PRINTF("AMDGPU: Critical temperature reached (%d), max. fanspeed",iHighestRawTempVal);
+      }
+    }
+    /* Keep hysteresis reference at the peak, so the fanspeed can drop again once it cooled down */
+    ctrlHysteresis_Force(&ptagAMDGPU->tagHysteresis,
+                         iHighestRawTempVal,
+                         ulNowMs);
+    for(uiIndex=0;uiIndex < ptagAMDGPU->uiSensorsCount;++uiIndex)
+    {
+      ctrlHysteresis_Force(&ptagAMDGPU->ptagSensors[uiIndex].tagHysteresis,
+                           ptagAMDGPU->ptagSensors[uiIndex].iTempCelsius,
+                           ulNowMs);
+      ptagAMDGPU->ptagSensors[uiIndex].iCurveTemp=ptagAMDGPU->ptagSensors[uiIndex].iTempCelsius;
+    }
+    /* Bumpless transfer back to PID, once cooled down */
+    ctrlPID_Track(&ptagAMDGPU->tagPID,
+                  iHighestSensorTempVal,
+                  AMDGPU_PWM_VAL_MAX);
+    /* Tick interval differs, don't fit the model with these samples */
+    ctrlMPC_Invalidate(&ptagAMDGPU->tagMPC);
+    ptagAMDGPU->ulLastUpdateMs=ulNowMs;
+    if((iRc=iFanCtrl_AMDGPU_ApplyPWM_m(ptagFanCtrl,AMDGPU_PWM_VAL_MAX)) != RUN_RET_OK)
+      return(iRc);
+    if(ptagAMDGPU->iCriticalPWMPending)
+    {
+      ptagAMDGPU->iCriticalPWMPending=0;
+      ptagAMDGPU->ulCriticalLastLatencyMs=ulFanCtrl_GetTimeMs_m()-ptagAMDGPU->ulCriticalSinceMs;
+      if(ptagAMDGPU->ulCriticalLastLatencyMs > ptagAMDGPU->ulCriticalMaxLatencyMs)
+        ptagAMDGPU->ulCriticalMaxLatencyMs=ptagAMDGPU->ulCriticalLastLatencyMs;
+      DBG_PRINTF("AMDGPU: Max. fanspeed applied %lums after critical temperature was sampled",
+                 ptagAMDGPU->ulCriticalLastLatencyMs);
+    }
+    return(RUN_RET_OK);
+  }
+  if(ptagAMDGPU->iCriticalActive)
+  {/* Below threshold again, keep short interval until cooldown time elapsed */
+    if(!ptagAMDGPU->ulCriticalBelowSinceMs)
+      ptagAMDGPU->ulCriticalBelowSinceMs=ulNowMs;
+    else if(ulNowMs-ptagAMDGPU->ulCriticalBelowSinceMs >= ptagAMDGPU->uiCriticalCooldown*100UL)
+    {
+      DBG_PUTS("AMDGPU: Critical temperature cooled down, back to normal update interval");
+      ptagAMDGPU->iCriticalActive=0;
+    }
+  }
+
+  if(ptagAMDGPU->uiControlMode == CONTROL_MODE_MPC)
+  {
+    if((ptagAMDGPU->iFanState) &&
+       (ptagAMDGPU->uiLastPWM == UINT_MAX)) /* Applied PWM unknown */
+      ctrlMPC_Invalidate(&ptagAMDGPU->tagMPC);
+    ctrlMPC_Observe(&ptagAMDGPU->tagMPC,
+                    iHighestSensorTempVal,
+                    (ptagAMDGPU->iFanState)?ptagAMDGPU->uiLastPWM:0,
+                    ptagAMDGPU->iPowerW);
+    uiCurrPWM=uiFanCtrl_AMDGPU_AddBias_m(ptagAMDGPU,
+                                         ctrlMPC_Solve(&ptagAMDGPU->tagMPC,
+                                                       iHighestSensorTempVal,
+                                                       (ptagAMDGPU->iHintPowerW > ptagAMDGPU->iPowerW)?ptagAMDGPU->iHintPowerW:ptagAMDGPU->iPowerW,
+                                                       uiFanCtrl_AMDGPU_CurveGetPWM_m(ptagAMDGPU,
+                                                                                      iHighestSensorTempVal)),
+                                         ptagAMDGPU->uiThrottleBiasPWM);
+    DBG_PRINTF("MPC: temp. %d, power %dW, target %d: prediction error %d, a=%lld b=%lld c=%lld d=%lld (Q16), throttle bias %u -> %u pwm (~%u.%u percent)",
+               iHighestSensorTempVal,
+               ptagAMDGPU->iPowerW,
+               ptagAMDGPU->tagMPC.iTarget,
+               ptagAMDGPU->tagMPC.iLastError,
+               ptagAMDGPU->tagMPC.llaTheta[0],
+               ptagAMDGPU->tagMPC.llaTheta[1],
+               ptagAMDGPU->tagMPC.llaTheta[2],
+               ptagAMDGPU->tagMPC.llaTheta[3],
+               ptagAMDGPU->uiThrottleBiasPWM,
+               uiCurrPWM,
+               AMDGPU_FANSPEED_PWM_TO_PERMILLE(uiCurrPWM)/10,
+               AMDGPU_FANSPEED_PWM_TO_PERMILLE(uiCurrPWM)%10);
+    return(iFanCtrl_AMDGPU_ApplyPWM_m(ptagFanCtrl,uiCurrPWM));
+  }
+
+  if(ptagAMDGPU->uiControlMode == CONTROL_MODE_PID)
+  {
+    if(!ptagAMDGPU->tagPID.iValid)
+    {/* Bumpless start from the curve */
+      ctrlPID_Track(&ptagAMDGPU->tagPID,
+                    iHighestSensorTempVal,
+                    uiFanCtrl_AMDGPU_CurveGetPWM_m(ptagAMDGPU,
+                                                   iHighestSensorTempVal));
+      ptagAMDGPU->ulLastUpdateMs=ulNowMs;
+    }
+    uiCurrPWM=uiFanCtrl_AMDGPU_AddBias_m(ptagAMDGPU,
+                                         ctrlPID_Update(&ptagAMDGPU->tagPID,
+                                                        iHighestSensorTempVal,
+                                                        ulNowMs-ptagAMDGPU->ulLastUpdateMs),
+                                         ptagAMDGPU->uiFeedForwardPWM+ptagAMDGPU->uiThrottleBiasPWM+ptagAMDGPU->uiHintPWM);
+    ptagAMDGPU->ulLastUpdateMs=ulNowMs;
+    DBG_PRINTF("PID: temp. %d, setpoint %d: P=%lld, I=%lld, D=%lld (Q8), feed-forward %u, throttle bias %u, hint %u -> %u pwm (~%u.%u percent)",
+               iHighestSensorTempVal,
+               ptagAMDGPU->tagPID.iSetpoint,
+               ptagAMDGPU->tagPID.llLastP,
+               ptagAMDGPU->tagPID.llIntegral,
+               ptagAMDGPU->tagPID.llLastD,
+               ptagAMDGPU->uiFeedForwardPWM,
+               ptagAMDGPU->uiThrottleBiasPWM,
+               ptagAMDGPU->uiHintPWM,
+               uiCurrPWM,
+               AMDGPU_FANSPEED_PWM_TO_PERMILLE(uiCurrPWM)/10,
+               AMDGPU_FANSPEED_PWM_TO_PERMILLE(uiCurrPWM)%10);
+    return(iFanCtrl_AMDGPU_ApplyPWM_m(ptagFanCtrl,uiCurrPWM));
+  }
+
+  /* Sensors on the active curve follow the hysteresis of the highest temperature, sensors with an own curve their own one */
+  iAccepted=ctrlHysteresis_Check(&ptagAMDGPU->tagHysteresis,
+                                 iHighestSensorTempVal,
+                                 ulNowMs);
+  iChanged=iAccepted;
+  for(uiIndex=0;uiIndex < ptagAMDGPU->uiSensorsCount;++uiIndex)
+  {
+    if((ptagAMDGPU->ptagSensors[uiIndex].ptagCurve)?
+       (!ctrlHysteresis_Check(&ptagAMDGPU->ptagSensors[uiIndex].tagHysteresis,
+                              ptagAMDGPU->ptagSensors[uiIndex].iTempFiltered,
+                              ulNowMs)):
+       (!iAccepted))
+      continue;
+    iChanged=1;
+    ptagAMDGPU->ptagSensors[uiIndex].iCurveTemp=ptagAMDGPU->ptagSensors[uiIndex].iTempFiltered;
+  }
+  if((!iChanged) &&
+     (ptagAMDGPU->uiFeedForwardPWM+ptagAMDGPU->uiThrottleBiasPWM+ptagAMDGPU->uiHintPWM == ptagAMDGPU->uiBiasAppliedPWM) &&
+     (ptagAMDGPU->ptagCurve == ptagAMDGPU->ptagCurveApplied))
+  {/* No Fanspeed update needed */
+    DBG_PRINTF("No Fanspeed update required, temperature change from %d within hysteresis",
+               ptagAMDGPU->tagHysteresis.iLastUpdateTemp);
+    return(RUN_RET_OK);
+  }
+
+  /* Update AMDGPU Fanspeed if needed, the hysteresis reference is the current temperature if the change was accepted */
+  ptagAMDGPU->uiBiasAppliedPWM=ptagAMDGPU->uiFeedForwardPWM+ptagAMDGPU->uiThrottleBiasPWM+ptagAMDGPU->uiHintPWM;
+  ptagAMDGPU->ptagCurveApplied=(ptagAMDGPU->ptagCurveFade)?NULL:ptagAMDGPU->ptagCurve;
+  uiCurrPWM=uiFanCtrl_AMDGPU_AddBias_m(ptagAMDGPU,
+                                       uiFanCtrl_AMDGPU_SensorsGetPWM_m(ptagFanCtrl),
+                                       ptagAMDGPU->uiBiasAppliedPWM);
+
+  DBG_PRINTF("Calculated fanspeed %u pwm (~%u.%u percent) for temp. %d, feed-forward %u, throttle bias %u, hint %u, profile \"%s\" (cross-fade %u/%u)",
+             uiCurrPWM,
+             AMDGPU_FANSPEED_PWM_TO_PERMILLE(uiCurrPWM)/10,
+             AMDGPU_FANSPEED_PWM_TO_PERMILLE(uiCurrPWM)%10,
+             ptagAMDGPU->tagHysteresis.iLastUpdateTemp,
+             ptagAMDGPU->uiFeedForwardPWM,
+             ptagAMDGPU->uiThrottleBiasPWM,
+             ptagAMDGPU->uiHintPWM,
+             ptagAMDGPU->ptagCurve->pcName,
+             (ptagAMDGPU->ptagCurveFade)?ptagAMDGPU->uiFadeTick:ptagAMDGPU->uiFadeTicks,
+             ptagAMDGPU->uiFadeTicks);
+
+  return(iFanCtrl_AMDGPU_ApplyPWM_m(ptagFanCtrl,uiCurrPWM));
+}
+
+/**
+ * Writes the PWM value to the AMDGPU device, enables/disables the fan if needed.
+ * The PWM is only written if it changed since the last write.
+ *
+ * @return RUN_RET_OK on success, RUN_RET_ Errorcode on failure.
+ */
+static int iFanCtrl_AMDGPU_ApplyPWM_m(TagFanCtrl *ptagFanCtrl,
+                                      unsigned int uiPWM)
+{
+  TagFanConfigAMDGPU *ptagAMDGPU=ptagFanCtrl->ptagAMDGPU;
+  unsigned long ulNowMs;
+  int iRc;
+
+  /* Slew limiter on the control output, the overrides below are not limited */
+  ptagAMDGPU->uiRequestPWM=uiPWM;
+  uiPWM=uiFanCtrl_AMDGPU_SlewLimit_m(ptagAMDGPU,uiPWM);
+  /* Stalled or failed fan: Max. speed, regardless of the request */
+  if(ptagAMDGPU->uiStallState != STALL_STATE_OK)
+    uiPWM=AMDGPU_PWM_VAL_MAX;
+  /* Zero-RPM: The state machine decides if the fan runs, max. fanspeed (critical temperature) starts it immediately */
+  if(ptagAMDGPU->iZeroRPMStartTemp)
+  {
+    if((ptagAMDGPU->uiZeroRPMState == ZERO_RPM_STATE_OFF) &&
+       (uiPWM == AMDGPU_PWM_VAL_MAX))
+      vFanCtrl_AMDGPU_StartZeroRPM_m(ptagAMDGPU,ulFanCtrl_GetTimeMs_m());
+    if(ptagAMDGPU->uiZeroRPMState == ZERO_RPM_STATE_OFF)
+      uiPWM=0;
+    else if(ptagAMDGPU->uiZeroRPMState == ZERO_RPM_STATE_KICK)
+      uiPWM=AMDGPU_PWM_VAL_MAX;
+    else if(uiPWM < ptagAMDGPU->uiZeroRPMMinPWM)
+      uiPWM=ptagAMDGPU->uiZeroRPMMinPWM;
+  }
+  if(((uiPWM) && (ptagAMDGPU->iFanState == 0)) ||     /* Fan needs to be enabled */
+     ((uiPWM == 0) && (ptagAMDGPU->iFanState == 1)))  /* Fan needs to be disabled */
+  {
+    ptagAMDGPU->iFanState=(uiPWM)?1:0;
+    DBG_PRINTF("Fanstate changed: %s",
+               (ptagAMDGPU->iFanState)?"ENABLE":"DISABLE");
+
+    if(iFanCtrl_EnableFan(eFanCtrlType_AMDGPU,
+                          ptagAMDGPU->pcPathEnableFan,
+                          ptagAMDGPU->iFanState))
+    {
+      DBG_PUTS("iFanCtrl_EnableFan() failed");
+      return(RUN_RET_ERR_FAN_ENABLE);
+    }
+    ++ptagAMDGPU->ulFanEnableWrites;
+    ulNowMs=ulFanCtrl_GetTimeMs_m();
+    if((ptagAMDGPU->ulFanEnableLastMs) &&
+       (ulNowMs-ptagAMDGPU->ulFanEnableLastMs < ptagAMDGPU->ulFanEnableMinIntervalMs))
+      ptagAMDGPU->ulFanEnableMinIntervalMs=ulNowMs-ptagAMDGPU->ulFanEnableLastMs;
+    ptagAMDGPU->ulFanEnableLastMs=ulNowMs;
+    ptagAMDGPU->uiLastPWM=UINT_MAX; /* Force PWM write after enable */
+    ptagAMDGPU->uiRPMTarget=0;      /* Inner loop restarts at the nominal PWM */
+    ptagAMDGPU->uiRPMPWM=UINT_MAX;
+  }
+
+  if((uiPWM) &&
+     (uiPWM != ptagAMDGPU->uiLastPWM))
+  {
+    if((iRc=(ptagAMDGPU->uiFanMode == FAN_MODE_RPM)?iFanCtrl_AMDGPU_SetRPMTarget_m(ptagFanCtrl,uiPWM):
+            (ptagAMDGPU->uiCalibrated)?iFanCtrl_AMDGPU_WritePWM_m(ptagFanCtrl,ptagAMDGPU->ucaPWMMap[uiPWM]):
+                                       iFanCtrl_AMDGPU_WritePWM_m(ptagFanCtrl,uiPWM)) != RUN_RET_OK)
+      return(iRc);
+    ptagAMDGPU->uiLastPWM=uiPWM;
+  }
+  return(RUN_RET_OK);
+}
+
+/**
+ * Writes the PWM value to the AMDGPU device.
+ *
+ * @return RUN_RET_OK on success, RUN_RET_ERR_PWM_WRITE on failure.
+ */
+static int iFanCtrl_AMDGPU_WritePWM_m(TagFanCtrl *ptagFanCtrl,
+                                      unsigned int uiPWM)
+{
+  if(iFanCtrl_SetFanSpeed(eFanCtrlType_AMDGPU,
+                          ptagFanCtrl->ptagAMDGPU->pcPathSetPWM,
+                          uiPWM))
+  {
+    DBG_PUTS("iFanCtrl_SetFanSpeed() failed");
+    return(RUN_RET_ERR_PWM_WRITE);
+  }
+  ++ptagFanCtrl->ptagAMDGPU->ulPWMWrites;
+  return(RUN_RET_OK);
+}
+
+/**
+ * RPM mode: Sets the target RPM, scaled from the PWM range to the max. RPM.
+ * If the driver supports it, the target is written to fan1_target. Otherwise the inner loop output
+ * jumps by the nominal PWM change (or starts at the nominal PWM), the inner loop corrects the rest.
+ *
+ * @return RUN_RET_OK on success, RUN_RET_ Errorcode on failure.
+ */
+static int iFanCtrl_AMDGPU_SetRPMTarget_m(TagFanCtrl *ptagFanCtrl,
+                                          unsigned int uiPWM)
+{
+  TagFanConfigAMDGPU *ptagAMDGPU=ptagFanCtrl->ptagAMDGPU;
+  unsigned int uiTarget;
+
+  uiTarget=(unsigned int)fixp_DivRound((long)uiPWM*(long)ptagAMDGPU->uiRPMMax,AMDGPU_PWM_VAL_MAX);
+  if(uiTarget == 0) /* 0 means fan disabled */
+    uiTarget=1;
+  if(ptagAMDGPU->pcPathFanTarget)
+  {
+    if(iFanCtrl_WriteSysfsULong_m(ptagAMDGPU->pcPathFanTarget,uiTarget))
+    {
+      DBG_PUTS("Writing the target RPM failed");
+      return(RUN_RET_ERR_PWM_WRITE);
+    }
+    ++ptagAMDGPU->ulRPMTargetWrites;
+    ptagAMDGPU->uiRPMTarget=uiTarget;
+    return(RUN_RET_OK);
+  }
+
+  if(!ptagAMDGPU->uiRPMTarget)
+    ptagAMDGPU->lRPMPWM=FIXP_FROM_INT(uiPWM);
+  else
+    ptagAMDGPU->lRPMPWM+=fixp_DivRound(((long)uiTarget-(long)ptagAMDGPU->uiRPMTarget)*FIXP_ONE*AMDGPU_PWM_VAL_MAX,
+                                       (long)ptagAMDGPU->uiRPMMax);
+  if(ptagAMDGPU->lRPMPWM < FIXP_FROM_INT(1))
+    ptagAMDGPU->lRPMPWM=FIXP_FROM_INT(1);
+  else if(ptagAMDGPU->lRPMPWM > FIXP_FROM_INT(AMDGPU_PWM_VAL_MAX))
+    ptagAMDGPU->lRPMPWM=FIXP_FROM_INT(AMDGPU_PWM_VAL_MAX);
+  ptagAMDGPU->uiRPMTarget=uiTarget;
+  uiPWM=(unsigned int)fixp_ToInt(ptagAMDGPU->lRPMPWM);
+  DBG_PRINTF("RPM: target %u RPM -> %u pwm",
+             uiTarget,
+             uiPWM);
+  if(uiPWM == ptagAMDGPU->uiRPMPWM)
+    return(RUN_RET_OK);
+  ptagAMDGPU->uiRPMPWM=uiPWM;
+  return(iFanCtrl_AMDGPU_WritePWM_m(ptagFanCtrl,uiPWM));
+}
+
+/**
+ * RPM mode without fan1_target: One step of the inner loop, called every sampling step.
+ * Integer integral control of the PWM on the RPM difference, only the tachometer is read.
+ * Read failures are counted only, the PWM is kept.
+ *
+ * @return RUN_RET_OK on success, RUN_RET_ Errorcode on failure.
+ */
+static int iFanCtrl_AMDGPU_UpdateRPM_m(TagFanCtrl *ptagFanCtrl)
+{
+  TagFanConfigAMDGPU *ptagAMDGPU=ptagFanCtrl->ptagAMDGPU;
+  long lRPM;
+  long lError;
+  unsigned int uiPWM;
+
+  if((ptagAMDGPU->uiFanMode != FAN_MODE_RPM) ||
+     (ptagAMDGPU->pcPathFanTarget) ||
+     (!ptagAMDGPU->uiRPMTarget))
+    return(RUN_RET_OK);
+  if(iFanCtrl_ReadSysfsLong_m(ptagAMDGPU->pcPathFanInput,&lRPM) != SENSOR_READ_RET_OK)
+  {
+    ++ptagAMDGPU->ulRPMReadErrors;
+    return(RUN_RET_OK);
+  }
+  ++ptagAMDGPU->ulRPMSteps;
+  /* Limit the error, a bogus reading must not wind up the output */
+  lError=(long)ptagAMDGPU->uiRPMTarget-lRPM;
+  if(lError > (long)ptagAMDGPU->uiRPMMax)
+    lError=(long)ptagAMDGPU->uiRPMMax;
+  else if(lError < -(long)ptagAMDGPU->uiRPMMax)
+    lError=-(long)ptagAMDGPU->uiRPMMax;
+  ptagAMDGPU->iRPM=(int)(ptagAMDGPU->uiRPMTarget-lError);
+  ptagAMDGPU->iRPMError=(int)lError;
+
+  ptagAMDGPU->lRPMPWM+=fixp_DivRound(lError*FIXP_ONE*(long)ptagAMDGPU->uiRPMGain,1000);
+  if(ptagAMDGPU->lRPMPWM < FIXP_FROM_INT(1))
+  {
+    ptagAMDGPU->lRPMPWM=FIXP_FROM_INT(1);
+    ++ptagAMDGPU->ulRPMSaturated;
+  }
+  else if(ptagAMDGPU->lRPMPWM > FIXP_FROM_INT(AMDGPU_PWM_VAL_MAX))
+  {
+    ptagAMDGPU->lRPMPWM=FIXP_FROM_INT(AMDGPU_PWM_VAL_MAX);
+    ++ptagAMDGPU->ulRPMSaturated;
+  }
+  uiPWM=(unsigned int)fixp_ToInt(ptagAMDGPU->lRPMPWM);
+  DBG_PRINTF("RPM: target %u, measured %ld, error %ld -> %u pwm",
+             ptagAMDGPU->uiRPMTarget,
+             lRPM,
+             lError,
+             uiPWM);
+  if(uiPWM == ptagAMDGPU->uiRPMPWM)
+    return(RUN_RET_OK);
+  ptagAMDGPU->uiRPMPWM=uiPWM;
+  return(iFanCtrl_AMDGPU_WritePWM_m(ptagFanCtrl,uiPWM));
+}
 
-      DBG_PRINTF("Calculated fanspeed (c->pwm fac=%f) %u pwm (~%f percent) for temp. %d",
-                 AMDGPU_FANSPEED_PERCENT_TO_PWM,
-                 (uiCurrPWM+50)/100,
-                 (uiCurrPWM+50)/100/AMDGPU_FANSPEED_PERCENT_TO_PWM,
-                 iHighestSensorTempVal);
-      uiCurrPWM=(uiCurrPWM+50)/100;
+void fanCtrl_RequestStats(TagFanCtrl *ptagFanCtrl)
+{
+  ptagFanCtrl->iStatsRequested=1;
+}
 
-      if(((uiCurrPWM) && (iCurrFanState == 0)) ||     /* Fan needs to be enabled */
-         ((uiCurrPWM == 0) && (iCurrFanState == 1)))  /* Fan needs to be disabled */
-      {
-        iCurrFanState=(uiCurrPWM)?1:0;
-        DBG_PRINTF("Fanstate changed: %s",
-                   (iCurrFanState)?"ENABLE":"DISABLE");
+void fanCtrl_PrintStats(const TagFanCtrl *ptagFanCtrl,
+                        FILE *fp)
+{
+  const TagFanConfigAMDGPU *ptagAMDGPU;
+  TagCtrlMPCModel tagModel;
+  char caTime[32];
 
-        if(iFanCtrl_EnableFan(eFanCtrlType_AMDGPU,
-                              ptagFanCtrl->ptagAMDGPU->pcPathEnableFan,
-                              iCurrFanState))
-        {
-          DBG_PUTS("iFanCtrl_EnableFan() failed");
-          return(RUN_RET_ERR_FAN_ENABLE);
-        }
-      }
+  if(!(ptagAMDGPU=ptagFanCtrl->ptagAMDGPU))
+    return;
+  ctrlMPC_GetModel(&ptagAMDGPU->tagMPC,
+                   ptagFanCtrl->uiUpdateDelayTime*100UL,
+                   &tagModel);
+  fprintf(fp,
+          "fanctrl stats: AMDGPU:\n"
+          "  PWM writes=%lu, fan enable writes=%lu\n"
+          "  Hysteresis: accepted=%lu, suppressed (deadband)=%lu, suppressed (dwell)=%lu, slope bypass=%lu, max. dwell delay=%lums\n"
+          "  Critical: events=%lu, emergency events=%lu, time to max. fanspeed: last=%lums, max=%lums\n"
+          "  PID: saturated updates=%lu\n"
+          "  MPC: samples=%lu, time constant=%ldms, gain=%ld/1000 °C per PWM, %ld/1000 °C per W, bias=%lld (Q16),\n"
+          "       prediction error (1/10 °C): last=%d, mean abs.=%d, max. abs.=%d, fallbacks to curve=%lu, model resets=%lu\n"
+          "  Power: last=%dW, read errors=%lu\n"
+          "  GPU load: last=%d%%, read errors=%lu\n"
+          "  Feed-forward: last=%u pwm, max=%u pwm\n"
+          "  Throttling: events=%lu, throttled updates=%lu, bias last=%u pwm, max=%u pwm, clock=%u/%u MHz, clock read errors=%lu\n"
+          "  Power cap: current=%luW, original=%luW, lowest=%luW, highest=%luW, decreases=%lu, increases=%lu, boost back-offs=%lu, write errors=%lu\n"
+          "  Profiles: active=\"%s\", switches=%lu, read errors=%lu\n"
+          "  Load hints: received=%lu, rejected=%lu, expired=%lu, hint-driven updates=%lu, max=%u pwm, active=%dW\n"
+          "  RPM mode: target=%u RPM, last=%d RPM, error=%d RPM, inner loop=%u pwm, steps=%lu, saturated=%lu, target writes=%lu, read errors=%lu\n"
+          "  Calibration: %s, min. start=%u pwm, min. sustain=%u pwm, max.=%u RPM, last written=%u pwm\n"
+          "  Fan stall: state=%s, stalls=%lu, recovered by kick=%lu, failures=%lu, read errors=%lu, last fault=%s\n"
+          "  Zero-RPM: state=%s, starts=%lu, stops=%lu, kicks=%lu, restart latency last=%lums, max=%lums, shortest enable/disable interval=%lums\n"
+          "  Slew limiter: up=%u PWM/s, down=%u PWM/s, clipped=%lu, max. clipped=%u pwm\n"
+          "  State file: %s, writes=%lu, restored=%s, age=%lums\n"
+          "  Memory: storage=%lu/%lu bytes, heap=%lu bytes\n",
+          ptagAMDGPU->ulPWMWrites,
+          ptagAMDGPU->ulFanEnableWrites,
+          ptagAMDGPU->tagHysteresis.ulAccepted,
+          ptagAMDGPU->tagHysteresis.ulSuppressedDeadband,
+          ptagAMDGPU->tagHysteresis.ulSuppressedDwell,
+          ptagAMDGPU->tagHysteresis.ulSlopeBypass,
+          ptagAMDGPU->tagHysteresis.ulMaxDwellDelayMs,
+          ptagAMDGPU->ulCriticalEvents,
+          ptagAMDGPU->ulEmergencyEvents,
+          ptagAMDGPU->ulCriticalLastLatencyMs,
+          ptagAMDGPU->ulCriticalMaxLatencyMs,
+          ptagAMDGPU->tagPID.ulSaturated,
+          ptagAMDGPU->tagMPC.ulSamples,
+          tagModel.lTimeConstantMs,
+          tagModel.lGainPWM,
+          tagModel.lGainPower,
+          ptagAMDGPU->tagMPC.llaTheta[3],
+          ptagAMDGPU->tagMPC.iLastError,
+          tagModel.iMeanError,
+          ptagAMDGPU->tagMPC.iMaxError,
+          ptagAMDGPU->tagMPC.ulFallbacks,
+          ptagAMDGPU->tagMPC.ulResets,
+          ptagAMDGPU->iPowerW,
+          ptagAMDGPU->ulPowerReadErrors,
+          ptagAMDGPU->iBusyPercent,
+          ptagAMDGPU->ulBusyReadErrors,
+          ptagAMDGPU->uiFeedForwardPWM,
+          ptagAMDGPU->uiFeedForwardMaxPWM,
+          ptagAMDGPU->ulThrottleEvents,
+          ptagAMDGPU->ulThrottleUpdates,
+          ptagAMDGPU->uiThrottleBiasPWM,
+          ptagAMDGPU->uiThrottleMaxBiasPWM,
+          ptagAMDGPU->uiClockMHz,
+          ptagAMDGPU->uiClockMaxMHz,
+          ptagAMDGPU->ulClockReadErrors,
+          ptagAMDGPU->ulPowerCapUW/AMDGPU_RAW_POWER_TO_WATT_DIVISOR,
+          ptagAMDGPU->ulPowerCapOrigUW/AMDGPU_RAW_POWER_TO_WATT_DIVISOR,
+          ptagAMDGPU->ulPowerCapLowestUW/AMDGPU_RAW_POWER_TO_WATT_DIVISOR,
+          ptagAMDGPU->ulPowerCapHighestUW/AMDGPU_RAW_POWER_TO_WATT_DIVISOR,
+          ptagAMDGPU->ulPowerCapDecreases,
+          ptagAMDGPU->ulPowerCapIncreases,
+          ptagAMDGPU->ulPowerCapBoostBackoffs,
+          ptagAMDGPU->ulPowerCapWriteErrors,
+          ptagAMDGPU->ptagCurve->pcName,
+          ptagAMDGPU->ulProfileSwitches,
+          ptagAMDGPU->ulProfileReadErrors,
+          ptagAMDGPU->ulHintsReceived,
+          ptagAMDGPU->ulHintsRejected,
+          ptagAMDGPU->ulHintsExpired,
+          ptagAMDGPU->ulHintUpdates,
+          ptagAMDGPU->uiHintMaxPWM,
+          ptagAMDGPU->iHintPowerW,
+          ptagAMDGPU->uiRPMTarget,
+          ptagAMDGPU->iRPM,
+          ptagAMDGPU->iRPMError,
+          (ptagAMDGPU->uiRPMPWM != UINT_MAX)?ptagAMDGPU->uiRPMPWM:0,
+          ptagAMDGPU->ulRPMSteps,
+          ptagAMDGPU->ulRPMSaturated,
+          ptagAMDGPU->ulRPMTargetWrites,
+          ptagAMDGPU->ulRPMReadErrors,
+          (ptagAMDGPU->uiCalibrated)?"active":"off",
+          ptagAMDGPU->uiMinStartPWM,
+          ptagAMDGPU->uiMinSustainPWM,
+          ptagAMDGPU->uiCalibratedRPMMax,
+          (ptagAMDGPU->uiLastPWM != UINT_MAX)?ptagAMDGPU->ucaPWMMap[ptagAMDGPU->uiLastPWM]:0,
+          (ptagAMDGPU->uiStallState == STALL_STATE_FAILED)?"failed":(ptagAMDGPU->uiStallState == STALL_STATE_KICK)?"kick":"ok",
+          ptagAMDGPU->ulStallEvents,
+          ptagAMDGPU->ulStallKickRecoveries,
+          ptagAMDGPU->ulFanFailures,
+          ptagAMDGPU->ulStallReadErrors,
+          pcFanCtrl_FormatTime_m(ptagAMDGPU->tStallLastFault,caTime,sizeof(caTime)),
+          (!ptagAMDGPU->iZeroRPMStartTemp)?"disabled":(ptagAMDGPU->uiZeroRPMState == ZERO_RPM_STATE_OFF)?"off":
+          (ptagAMDGPU->uiZeroRPMState == ZERO_RPM_STATE_KICK)?"kick":"on",
+          ptagAMDGPU->ulZeroRPMStarts,
+          ptagAMDGPU->ulZeroRPMStops,
+          ptagAMDGPU->ulZeroRPMKicks,
+          ptagAMDGPU->ulZeroRPMLastLatencyMs,
+          ptagAMDGPU->ulZeroRPMMaxLatencyMs,
+          (ptagAMDGPU->ulFanEnableMinIntervalMs != ULONG_MAX)?ptagAMDGPU->ulFanEnableMinIntervalMs:0,
+          ptagAMDGPU->uiSlewUp,
+          ptagAMDGPU->uiSlewDown,
+          ptagAMDGPU->ulSlewClips,
+          ptagAMDGPU->uiSlewMaxClipPWM,
+          (ptagAMDGPU->ptagState)?"active":"off",
+          ptagAMDGPU->ulStateWrites,
+          (ptagAMDGPU->ulStateRestoredAgeMs != ULONG_MAX)?"yes":"no",
+          (ptagAMDGPU->ulStateRestoredAgeMs != ULONG_MAX)?ptagAMDGPU->ulStateRestoredAgeMs:0,
+          (unsigned long)szStorageUsed_m,
+          (unsigned long)szStorage_m,
+          (unsigned long)szHeapUsed_m);
+  fflush(fp);
+}
 
-      if(uiCurrPWM)
-      {
-        if(iFanCtrl_SetFanSpeed(eFanCtrlType_AMDGPU,
-                                ptagFanCtrl->ptagAMDGPU->pcPathSetPWM,
-                                uiCurrPWM))
+/**
+ * Returns a monotonic timestamp, in ms.
+ */
+static unsigned long ulFanCtrl_GetTimeMs_m(void)
+{
+  struct timespec tagNow;
+
+  clock_gettime(CLOCK_MONOTONIC,&tagNow);
+  return((unsigned long)tagNow.tv_sec*1000UL + (unsigned long)(tagNow.tv_nsec/1000000L));
+}
+
+/**
+ * Reads all sensors which are due in the current sampling step and feeds them into their filter.
+ * On the last step (uiSubTick == uiSubTicks), all sensors are read.
+ * A sensor with oversampling N is read N times per update interval, evenly distributed over the steps.
+ *
+ * @return 0 on success, nonzero if reading failed permanently.
+ */
+static int iFanCtrl_SampleSensors_m(TagFanCtrlSensor *ptagSensors,
+                                    unsigned int uiSensorsCount,
+                                    unsigned int uiSubTick,
+                                    unsigned int uiSubTicks,
+                                    int *piRetryCount)
+{
+  unsigned int uiIndex;
+
+  for(uiIndex=0;uiIndex < uiSensorsCount;++uiIndex)
+  {
+    if((uiSubTick*ptagSensors[uiIndex].uiOversampling)/uiSubTicks ==
+       ((uiSubTick-1)*ptagSensors[uiIndex].uiOversampling)/uiSubTicks)
+      continue; /* Not due in this step */
+
+    switch(iFanCtrl_UpdateSensor_m(eFanCtrlType_AMDGPU,
+                                   &ptagSensors[uiIndex]))
+    {
+      case SENSOR_READ_RET_OK: /* OK */
+        *piRetryCount=0;
+        ptagSensors[uiIndex].ulSampleMs=ulFanCtrl_GetTimeMs_m();
+        ptagSensors[uiIndex].iTempFiltered=ctrlFilter_Update(&ptagSensors[uiIndex].tagFilter,
+                                                             ptagSensors[uiIndex].iTempCelsius);
+        break;
+      case SENSOR_READ_RET_TRYAGAIN: /* Temporary failure, try again if < max tries */
+        if((*piRetryCount)++ < SENSOR_READ_MAX_RETRIES)
         {
-          DBG_PUTS("iFanCtrl_SetFanSpeed() failed");
-          return(RUN_RET_ERR_PWM_WRITE);
+          ERR_PRINTF("Temporary failure reading sensor, retry(%d/%d)...",
+                     *piRetryCount,
+                     SENSOR_READ_MAX_RETRIES);
+          break;
         }
-      }
+        /* Fall-through */
+      case SENSOR_READ_RET_FAILURE: /* quit with error */
+      default:
+        ERR_PUTS("iGpuFanCtrl_UpdateSensor() failed");
+        return(1);
     }
   }
+  return(0);
+}
 
-  DBG_PUTS("Stopping loop...");
-  return(RUN_RET_OK);
+/**
+ * Reads a file at once into pcBuffer, zero terminated. A file larger than the buffer is truncated.
+ * Plain file descriptor, so no stdio buffer is allocated per read.
+ *
+ * @return Count of bytes read, -1 on error (errno is set).
+ */
+static long lFanCtrl_ReadFile_m(const char *pcPath,
+                                char *pcBuffer,
+                                size_t szBufSize)
+{
+  ssize_t sszRead;
+  size_t szUsed=0;
+  int iFd;
+  int iErrno;
+
+  if((iFd=open(pcPath,O_RDONLY | O_CLOEXEC)) < 0)
+    return(-1);
+  while(szUsed < szBufSize-1)
+  {
+    if((sszRead=read(iFd,pcBuffer+szUsed,szBufSize-1-szUsed)) < 0)
+    {
+      if(errno == EINTR)
+        continue;
+      iErrno=errno;
+      close(iFd);
+      errno=iErrno;
+      return(-1);
+    }
+    if(sszRead == 0) /* EOF */
+      break;
+    szUsed+=(size_t)sszRead;
+  }
+  close(iFd);
+  pcBuffer[szUsed]='\0';
+  return((long)szUsed);
 }
 
-static int iFanCtrl_UpdateSensor_m(EFanCtrlType eSensorType,
-                                   TagFanCtrlSensor *ptagSensor)
+/**
+ * Writes a string to a file with a single write() (sysfs takes the value of the first write), truncating it like fopen(.., "w").
+ *
+ * @return 0 on success, nonzero on error (errno is set).
+ */
+static int iFanCtrl_WriteFile_m(const char *pcPath,
+                                const char *pcData)
 {
-  FILE *fp;
-  char caBuf[16];
+  size_t szLen=strlen(pcData);
+  ssize_t sszWritten;
+  int iFd;
+  int iErrno;
+
+  if((iFd=open(pcPath,O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,0666)) < 0)
+    return(1);
+  do
+  {
+    sszWritten=write(iFd,pcData,szLen);
+  }while((sszWritten < 0) &&
+         (errno == EINTR));
+  iErrno=(sszWritten < 0)?errno:EIO;
+  if(close(iFd) != 0)
+    return(1);
+  if((size_t)sszWritten != szLen)
+  {
+    errno=iErrno;
+    return(1);
+  }
+  return(0);
+}
+
+/**
+ * Reads a single integer value from a sysfs file.
+ *
+ * @return SENSOR_READ_RET_ enum.
+ */
+static int iFanCtrl_ReadSysfsLong_m(const char *pcPath,
+                                    long *plValue)
+{
+  char caBuf[24];
+  char *pcTmp;
+
+  if(lFanCtrl_ReadFile_m(pcPath,caBuf,sizeof(caBuf)) < 0)
+  {
+    ERR_PRINTF("Reading \"%s\" failed (%d): %s",
+               pcPath,
+               errno,
+               strerror(errno));
+    return((errno == EIO) ? SENSOR_READ_RET_TRYAGAIN : SENSOR_READ_RET_FAILURE);
+  }
+
+  errno=0;
+  *plValue=strtol(caBuf,&pcTmp,10);
+  if((pcTmp == caBuf) ||
+     (errno == ERANGE) ||
+     ((*pcTmp != '\n') && (*pcTmp != '\0')))
+  {/* Conversion failed*/
+    ERR_PRINTF("Conversion string-> long failed for \"%s\"",pcPath);
+    return(SENSOR_READ_RET_FAILURE);
+  }
+  return(SENSOR_READ_RET_OK);
+}
+
+/**
+ * Reads the current clock from a DPM level table (pp_dpm_sclk), e.g.:
+ *   0: 500Mhz
+ *   1: 2100Mhz *
+ *   2: 2500Mhz
+ * The current level is marked with '*'.
+ *
+ * @param pcPath     _IN_ Path of the DPM table
+ * @param puiClockMHz
+ *                   _OUT_ Clock of the current level, in MHz
+ * @param puiClockMaxMHz
+ *                   _OUT_ Clock of the highest level, in MHz
+ *
+ * @return SENSOR_READ_RET_ enum.
+ */
+static int iFanCtrl_ReadDPMClock_m(const char *pcPath,
+                                   unsigned int *puiClockMHz,
+                                   unsigned int *puiClockMaxMHz)
+{
+  char caBuf[SYSFS_TABLE_MAX_SIZE];
+  char *pcLine;
+  char *pcNext;
   char *pcTmp;
+  unsigned long ulClock;
+  unsigned int uiCurrent=0;
+  unsigned int uiMax=0;
+  int iFound=0;
 
-  if(!(fp=fopen(ptagSensor->pcSensorReadPath,"r")))
+  if(lFanCtrl_ReadFile_m(pcPath,caBuf,sizeof(caBuf)) < 0)
   {
-    ERR_PRINTF("fopen(\"%s\",\"w\") failed (%d): %s",
-               ptagSensor->pcSensorReadPath,
+    ERR_PRINTF("Reading \"%s\" failed (%d): %s",
+               pcPath,
                errno,
                strerror(errno));
     return(SENSOR_READ_RET_FAILURE);
   }
-  if(fgets(caBuf,sizeof(caBuf),fp) == NULL)
+  for(pcLine=caBuf;*pcLine;pcLine=pcNext)
+  {
+    if((pcNext=strchr(pcLine,'\n')))
+      *pcNext++='\0';
+    else
+      pcNext=pcLine+strlen(pcLine);
+    /* Format: "<level>: <clock>Mhz[ *]" */
+    if(!(pcTmp=strchr(pcLine,':')))
+      continue;
+    ulClock=strtoul(pcTmp+1,&pcTmp,10);
+    if(ulClock > UINT_MAX)
+      continue;
+    if(ulClock > uiMax)
+      uiMax=(unsigned int)ulClock;
+    if(strchr(pcTmp,'*'))
+    {
+      uiCurrent=(unsigned int)ulClock;
+      iFound=1;
+    }
+  }
+  if((!iFound) ||
+     (uiMax == 0))
+  {
+    ERR_PRINTF("No current clock level found in \"%s\"",pcPath);
+    return(SENSOR_READ_RET_FAILURE);
+  }
+  *puiClockMHz=uiCurrent;
+  *puiClockMaxMHz=uiMax;
+  return(SENSOR_READ_RET_OK);
+}
+
+/**
+ * Reads the name of the active power profile from pp_power_profile_mode.
+ * The active profile is the line marked with '*', format: "<index> <NAME>[ ]*[:]".
+ *
+ * @return 0 on success, nonzero on failure.
+ */
+static int iFanCtrl_ReadPowerProfile_m(const char *pcPath,
+                                       char *pcBuffer,
+                                       size_t szBufSize)
+{
+  char caBuf[SYSFS_TABLE_MAX_SIZE];
+  char *pcLine;
+  char *pcNext;
+  char *pcName;
+  size_t szLen;
+  int iFound=0;
+
+  if(lFanCtrl_ReadFile_m(pcPath,caBuf,sizeof(caBuf)) < 0)
   {
-    ERR_PRINTF("fgets(caBuf,%" PRIu64 ",fp) failed (%d): %s",
-               sizeof(caBuf),
+    ERR_PRINTF("Reading \"%s\" failed (%d): %s",
+               pcPath,
                errno,
                strerror(errno));
-    fclose(fp);
-    return((errno == EIO) ? SENSOR_READ_RET_TRYAGAIN : SENSOR_READ_RET_FAILURE);
+    return(1);
+  }
+  for(pcLine=caBuf;(!iFound) && (*pcLine);pcLine=pcNext)
+  {
+    if((pcNext=strchr(pcLine,'\n')))
+      *pcNext++='\0';
+    else
+      pcNext=pcLine+strlen(pcLine);
+    if(!strchr(pcLine,'*'))
+      continue;
+    pcName=pcLine+strspn(pcLine," \t");
+    pcName+=strspn(pcName,"0123456789"); /* Skip index */
+    pcName+=strspn(pcName," \t");
+    szLen=strcspn(pcName," \t*:");
+    if((szLen == 0) ||
+       (szLen >= szBufSize))
+      continue;
+    memcpy(pcBuffer,pcName,szLen);
+    pcBuffer[szLen]='\0';
+    iFound=1;
+  }
+  if(!iFound)
+  {
+    ERR_PRINTF("No active power profile found in \"%s\"",pcPath);
+    return(1);
+  }
+  return(0);
+}
+
+/**
+ * Reads the first line of the hint file, without trailing whitespace.
+ * A missing file is an empty hint.
+ *
+ * @return 0 on success, nonzero on failure.
+ */
+static int iFanCtrl_ReadHint_m(const char *pcPath,
+                               char *pcBuffer,
+                               size_t szBufSize)
+{
+  size_t szLen;
+
+  if(lFanCtrl_ReadFile_m(pcPath,pcBuffer,szBufSize) < 0)
+  {
+    pcBuffer[0]='\0';
+    if(errno == ENOENT)
+      return(0);
+    ERR_PRINTF("Reading \"%s\" failed (%d): %s",
+               pcPath,
+               errno,
+               strerror(errno));
+    return(1);
   }
-  fclose(fp);
+  pcBuffer[strcspn(pcBuffer,"\n")]='\0'; /* First line only */
+  szLen=strlen(pcBuffer);
+  while((szLen) &&
+        (isspace((unsigned char)pcBuffer[szLen-1])))
+    pcBuffer[--szLen]='\0';
+  return(0);
+}
+
+/**
+ * Writes a single unsigned integer value to a sysfs file.
+ *
+ * @return 0 on success, nonzero on failure.
+ */
+static int iFanCtrl_WriteSysfsULong_m(const char *pcPath,
+                                      unsigned long ulValue)
+{
+  char caBuf[24];
+
+  snprintf(caBuf,sizeof(caBuf),"%lu\n",ulValue);
+  if(iFanCtrl_WriteFile_m(pcPath,caBuf))
+  {
+    ERR_PRINTF("Writing %lu to \"%s\" failed (%d): %s",
+               ulValue,
+               pcPath,
+               errno,
+               strerror(errno));
+    return(1);
+  }
+  return(0);
+}
+
+/**
+ * Reads the critical/emergency temperature, provided by the driver next to the sensor (e.g. temp2_input -> temp2_crit).
+ * *piTemp is only lowered, so a configured lower threshold is kept. If the file doesn't exist, *piTemp is untouched.
+ *
+ * @return 0 if the value was read, nonzero otherwise.
+ */
+static int iFanCtrl_ReadCriticalTemp_m(const char *pcSensorReadPath,
+                                       const char *pcSuffix,
+                                       int *piTemp)
+{
+  char caPath[sizeof(((TagCfg_Sensor*)0)->caSensorReadPath)+16];
+  size_t szLen;
+  long lValue;
+  int iTemp;
+
+  szLen=strlen(pcSensorReadPath);
+  if((szLen < sizeof(AMDGPU_SENSOR_SUFFIX_INPUT)-1) ||
+     (strcmp(pcSensorReadPath+szLen-(sizeof(AMDGPU_SENSOR_SUFFIX_INPUT)-1),AMDGPU_SENSOR_SUFFIX_INPUT) != 0))
+    return(1);
+  szLen-=sizeof(AMDGPU_SENSOR_SUFFIX_INPUT)-1;
+  memcpy(caPath,pcSensorReadPath,szLen);
+  strcpy(caPath+szLen,pcSuffix);
+
+  if(access(caPath,R_OK) != 0) /* Not provided for this sensor */
+    return(1);
+  if(iFanCtrl_ReadSysfsLong_m(caPath,&lValue) != SENSOR_READ_RET_OK)
+    return(1);
+  iTemp=(int)fixp_DivRound(lValue,AMDGPU_RAW_TO_TENTH_CELSUIS_DIVISOR);
+  if((iTemp > 0) &&
+     ((*piTemp == 0) || (iTemp < *piTemp)))
+    *piTemp=iTemp;
+  return(0);
+}
+
+static int iFanCtrl_UpdateSensor_m(EFanCtrlType eSensorType,
+                                   TagFanCtrlSensor *ptagSensor)
+{
+  int iRc;
+
+  if((iRc=iFanCtrl_ReadSysfsLong_m(ptagSensor->pcSensorReadPath,
+                                   &ptagSensor->lRawValue)) != SENSOR_READ_RET_OK)
+    return(iRc);
 
   switch(eSensorType)
   {
     case eFanCtrlType_AMDGPU:
-      ptagSensor->lRawValue=strtol(caBuf,&pcTmp,10);
-      if((ptagSensor->lRawValue == 0) ||
-         ((ptagSensor->lRawValue == LONG_MAX) && (errno==ERANGE)) ||
-         ((ptagSensor->lRawValue == LONG_MIN) && (errno==ERANGE)) ||
-         (*pcTmp != '\n'))
+      if(ptagSensor->lRawValue == 0)
       {/* Conversion failed*/
         ERR_PUTS("Conversion string-> long failed");
         return(SENSOR_READ_RET_FAILURE);
       }
-      /* Calculate Temperature in Celsius */
-      ptagSensor->iTempCelsius=(int)(ptagSensor->lRawValue/AMDGPU_RAW_TO_TENTH_CELSUIS_DIVISOR);
+      /* Calculate Temperature in 1/10 Celsius, rounded to nearest */
+      ptagSensor->iTempCelsius=(int)fixp_DivRound(ptagSensor->lRawValue,AMDGPU_RAW_TO_TENTH_CELSUIS_DIVISOR);
       break;
     default:
       ERR_PRINTF("Unknown Sensortype (%d)",eSensorType);
@@ -476,83 +4761,319 @@ static int iFanCtrl_UpdateSensor_m(EFanCtrlType eSensorType,
   return(SENSOR_READ_RET_OK);
 }
 
-static int iFanCtrl_EnableFan(EFanCtrlType eSensorType,
-                              const char *pcEnableFanPath,
-                              int iEnable)
+/**
+ * Evaluates the fan curve at the given temperature, using integer math only.
+ * Below the lowest point, the lowest point's PWM is used, above the highest point the highest point's PWM.
+ * Between two points, PWM is linear interpolated and rounded to nearest.
+ */
+static unsigned int uiFanCtrl_CurveGetPWM_m(const TagFanCtrlTempPoint *ptagPoints,
+                                            unsigned int uiPointsCount,
+                                            int iTemp)
 {
-  FILE *fp;
-  int iRc=0;
+  unsigned int uiIndex;
+
+  for(uiIndex=0;uiIndex < uiPointsCount;++uiIndex)
+  {/* Find closest defined temperature point */
+    if(iTemp > ptagPoints[uiIndex].iTemp)
+      continue;
+    break;
+  }
+  if(uiIndex == uiPointsCount) /* Is bigger than highest temperature point */
+    return(ptagPoints[uiPointsCount-1].uiFanSpeedPWM);
+  if((uiIndex == 0) ||                      /* Is lower than lowest temperature point */
+     (ptagPoints[uiIndex].iTemp == iTemp))  /* Exactly on one point */
+    return(ptagPoints[uiIndex].uiFanSpeedPWM);
+
+  /* Target is between 2 defined points */
+  return((unsigned int)fixp_Interpolate(iTemp,
+                                        ptagPoints[uiIndex-1].iTemp,
+                                        ptagPoints[uiIndex].iTemp,
+                                        ptagPoints[uiIndex-1].uiFanSpeedPWM,
+                                        ptagPoints[uiIndex].uiFanSpeedPWM));
+}
+
+/**
+ * Evaluates the fan curve at the given temperature through its lookup table, constant time.
+ */
+static unsigned int uiFanCtrl_CurveLookup_m(const TagFanCtrlCurve *ptagCurve,
+                                            int iTemp)
+{
+  if(iTemp <= ptagCurve->iLUTTemp)
+    return(ptagCurve->pucLUT[0]);
+  if(iTemp-ptagCurve->iLUTTemp >= (int)ptagCurve->uiLUTSize)
+    return(ptagCurve->pucLUT[ptagCurve->uiLUTSize-1]);
+  return(ptagCurve->pucLUT[iTemp-ptagCurve->iLUTTemp]);
+}
+
+#ifndef FANCTRL_STATIC
+/**
+ * Verifies the temperature points are in ascending order and within limits.
+ *
+ * @return 0 if valid, nonzero otherwise.
+ */
+static int iFanCtrl_VerifyCurve_m(const TagCfg_Temperatures *ptagTemps,
+                                  unsigned int uiTempsCount)
+{
+  unsigned int uiIndex;
 
-  if(!(fp=fopen(pcEnableFanPath,"w")))
+  for(uiIndex=1;uiIndex < uiTempsCount;++uiIndex)
   {
-    ERR_PRINTF("fopen(\"%s\",\"w\") failed (%d): %s",
-               pcEnableFanPath,
-               errno,
-               strerror(errno));
-    if(errno == EACCES)
-      ERR_PUTS("Application should run as root.");
+    if((ptagTemps[uiIndex].iTemp            > ptagTemps[uiIndex-1].iTemp) &&
+       (ptagTemps[uiIndex].ucFanSpeedPercent > ptagTemps[uiIndex-1].ucFanSpeedPercent) &&
+       (ptagTemps[uiIndex].iTemp < CFG_LIMIT_MAX_TEMP+1) &&
+       (ptagTemps[uiIndex].ucFanSpeedPercent < 101))
+      continue;
+
+    ERR_PRINTF("Temperatures must be in ascending order, max. Temp=%d, max. Fanspeed=100, is: Temp=%d, Fanspeed=%u",
+               CFG_LIMIT_MAX_TEMP,
+               ptagTemps[uiIndex].iTemp,
+               ptagTemps[uiIndex].ucFanSpeedPercent);
     return(1);
   }
+  return(0);
+}
+#endif /* !FANCTRL_STATIC */
+
+/**
+ * Slope of the monotone cubic spline at a point, in Q8 PWM per 1/10 °C (Fritsch-Carlson).
+ * Inner points use the mean of the adjacent secant slopes, limited to 3 times each of them (0 at a flat segment),
+ * which keeps every segment monotone. Secant slopes are truncated, so rounding never exceeds the limit.
+ */
+static long lFanCtrl_SplineSlope_m(const TagFanCtrlTempPoint *ptagPoints,
+                                   unsigned int uiPointsCount,
+                                   unsigned int uiIndex)
+{
+  long lPrev=0;
+  long lNext=0;
+  long lSlope;
+
+  if(uiIndex > 0)
+    lPrev=FIXP_FROM_INT((long)ptagPoints[uiIndex].uiFanSpeedPWM-(long)ptagPoints[uiIndex-1].uiFanSpeedPWM)/
+          (ptagPoints[uiIndex].iTemp-ptagPoints[uiIndex-1].iTemp);
+  if(uiIndex+1 < uiPointsCount)
+    lNext=FIXP_FROM_INT((long)ptagPoints[uiIndex+1].uiFanSpeedPWM-(long)ptagPoints[uiIndex].uiFanSpeedPWM)/
+          (ptagPoints[uiIndex+1].iTemp-ptagPoints[uiIndex].iTemp);
+  if(uiIndex == 0)
+    return(lNext);
+  if(uiIndex+1 == uiPointsCount)
+    return(lPrev);
+  if((lPrev <= 0) || (lNext <= 0))
+    return(0);
+  lSlope=(lPrev+lNext)/2;
+  if(lSlope > 3*lPrev)
+    lSlope=3*lPrev;
+  if(lSlope > 3*lNext)
+    lSlope=3*lNext;
+  return(lSlope);
+}
+
+/**
+ * Initializes a curve, the PWM values of the points and the lookup table are precomputed.
+ * pucLUT must provide space for (highest - lowest temperature + 1) entries, the used size is stored in uiLUTSize.
+ * With CURVE_INTERPOLATION_SPLINE, the step of the Zero-Fan mode stays linear, the spline starts at the first running point.
+ * The table is verified to be monotone and within the PWM range.
+ *
+ * @return 0 on success, nonzero if the table is invalid.
+ */
+static int iFanCtrl_InitCurve_m(const TagFanCtrl *ptagFanCtrl,
+                                TagFanCtrlCurve *ptagCurve,
+                                const char *pcName,
+                                TagFanCtrlTempPoint *ptagPoints,
+                                unsigned char *pucLUT,
+                                unsigned int uiInterpolation,
+                                const TagCfg_Temperatures *ptagTemps,
+                                unsigned int uiTempsCount)
+{
+  unsigned int uiIndex;
+  unsigned int uiFirst;
+  unsigned int uiSegment;
+  int iTemp;
+  long lPWM;
+
+  ptagCurve->pcName=pcName;
+  ptagCurve->uiPointsCount=uiTempsCount;
+  ptagCurve->ptagPoints=ptagPoints;
+  ptagCurve->iRuleBusy=0;
+  ptagCurve->ulRuleBusyTimeMs=0;
+  ptagCurve->pcRulePowerProfile=NULL;
+  ptagCurve->pcRuleHint=NULL;
+  ptagCurve->iBusyMatch=0;
+  ptagCurve->ulBusyChangeMs=0;
+  for(uiIndex=0; uiIndex < uiTempsCount;++uiIndex) /* Initialize Temperature points */
+  {
+    DBG_PRINTF("AMDGPU: Curve \"%s\": Temperature Point[%u]: Temp=%d, fanspeed=%u%%, %u PWM(calculated) ",
+               pcName,
+               uiIndex,
+               ptagTemps[uiIndex].iTemp,
+               ptagTemps[uiIndex].ucFanSpeedPercent,
+               AMDGPU_FANSPEED_PERCENT_TO_PWM(ptagTemps[uiIndex].ucFanSpeedPercent));
+    ptagPoints[uiIndex].iTemp=ptagTemps[uiIndex].iTemp;
+    ptagPoints[uiIndex].uiFanSpeedPWM=AMDGPU_FANSPEED_PERCENT_TO_PWM(ptagTemps[uiIndex].ucFanSpeedPercent);
+  }
+  if(ptagPoints[0].uiFanSpeedPWM == 0) /* Uses Zero-Fan mode, needs adjustment to work properly */
+  {
+    DBG_PRINTF("Using Zero-Fan mode for low Temperature, adjusting point[0].temp to point[1].temp(%d)-1",
+               ptagTemps[1].iTemp);
+    ptagPoints[0].iTemp=ptagTemps[1].iTemp-1;
+  }
+  ptagCurve->iLUTTemp=ptagPoints[0].iTemp;
+  ptagCurve->uiLUTSize=(unsigned int)(ptagPoints[uiTempsCount-1].iTemp-ptagPoints[0].iTemp)+1;
+  ptagCurve->pucLUT=pucLUT;
+  uiFirst=(ptagPoints[0].uiFanSpeedPWM == 0)?1:0;
+  uiSegment=uiFirst;
+  for(uiIndex=0;uiIndex < ptagCurve->uiLUTSize;++uiIndex)
+  {
+    iTemp=ptagCurve->iLUTTemp+(int)uiIndex;
+    if((uiInterpolation != CURVE_INTERPOLATION_SPLINE) ||
+       (iTemp <= ptagPoints[uiFirst].iTemp))
+      lPWM=uiFanCtrl_CurveGetPWM_m(ptagPoints,
+                                   uiTempsCount,
+                                   iTemp);
+    else
+    {
+      while(iTemp > ptagPoints[uiSegment+1].iTemp)
+        ++uiSegment;
+      lPWM=fixp_Hermite(iTemp,
+                        ptagPoints[uiSegment].iTemp,
+                        ptagPoints[uiSegment+1].iTemp,
+                        ptagPoints[uiSegment].uiFanSpeedPWM,
+                        ptagPoints[uiSegment+1].uiFanSpeedPWM,
+                        lFanCtrl_SplineSlope_m(ptagPoints+uiFirst,uiTempsCount-uiFirst,uiSegment-uiFirst),
+                        lFanCtrl_SplineSlope_m(ptagPoints+uiFirst,uiTempsCount-uiFirst,uiSegment+1-uiFirst));
+    }
+    if((lPWM < 0) ||
+       (lPWM > AMDGPU_PWM_VAL_MAX) ||
+       ((uiIndex) && (lPWM < pucLUT[uiIndex-1])))
+    {
+      ERR_PRINTF("Curve \"%s\" is not monotone or out of range at temp. %d: %ld PWM",
+                 pcName,
+                 iTemp,
+                 lPWM);
+      return(1);
+    }
+    pucLUT[uiIndex]=(unsigned char)lPWM;
+  }
+  return(0);
+}
+
+/**
+ * Evaluates the active curve of the AMDGPU device.
+ * While a cross-fade is running, the result is blended linear from the previous to the active curve.
+ */
+static unsigned int uiFanCtrl_AMDGPU_CurveGetPWM_m(const TagFanConfigAMDGPU *ptagAMDGPU,
+                                                   int iTemp)
+{
+  unsigned int uiPWM;
+  unsigned int uiPWMFade;
+
+  uiPWM=uiFanCtrl_CurveLookup_m(ptagAMDGPU->ptagCurve,
+                                iTemp);
+  if(!ptagAMDGPU->ptagCurveFade)
+    return(uiPWM);
+  uiPWMFade=uiFanCtrl_CurveLookup_m(ptagAMDGPU->ptagCurveFade,
+                                    iTemp);
+  return((unsigned int)fixp_Interpolate(ptagAMDGPU->uiFadeTick,
+                                        0,
+                                        ptagAMDGPU->uiFadeTicks,
+                                        uiPWMFade,
+                                        uiPWM));
+}
+
+/**
+ * Evaluates the curves of all sensors at their temperature of the last accepted change and reduces them to the device fanspeed.
+ * SENSOR_REDUCER_MAX: Max. of the fanspeeds, each scaled by the sensor weight.
+ * SENSOR_REDUCER_MEAN: Mean of the fanspeeds, weighted by the sensor weights.
+ * Sensors without an own curve use the active curve, including a running cross-fade.
+ */
+static unsigned int uiFanCtrl_AMDGPU_SensorsGetPWM_m(const TagFanCtrl *ptagFanCtrl)
+{
+  const TagFanConfigAMDGPU *ptagAMDGPU=ptagFanCtrl->ptagAMDGPU;
+  const TagFanCtrlSensor *ptagSensor;
+  unsigned int uiIndex;
+  unsigned int uiPWM;
+  unsigned int uiMaxPWM=0;
+  unsigned long ulSum=0;
+  unsigned long ulWeights=0;
+
+  for(uiIndex=0;uiIndex < ptagAMDGPU->uiSensorsCount;++uiIndex)
+  {
+    ptagSensor=&ptagAMDGPU->ptagSensors[uiIndex];
+    if(!ptagSensor->uiWeight)
+      continue;
+    uiPWM=(ptagSensor->ptagCurve)?uiFanCtrl_CurveLookup_m(ptagSensor->ptagCurve,
+                                                          ptagSensor->iCurveTemp):
+                                  uiFanCtrl_AMDGPU_CurveGetPWM_m(ptagAMDGPU,
+                                                                 ptagSensor->iCurveTemp);
+    DBG_PRINTF("Sensor[%u]: temp. %d, weight %u%%, %s curve -> %u pwm",
+               uiIndex,
+               ptagSensor->iCurveTemp,
+               ptagSensor->uiWeight,
+               (ptagSensor->ptagCurve)?"own":"active",
+               uiPWM);
+    ulSum+=(unsigned long)uiPWM*ptagSensor->uiWeight;
+    ulWeights+=ptagSensor->uiWeight;
+    uiPWM=(unsigned int)fixp_DivRound((long)uiPWM*(long)ptagSensor->uiWeight,100);
+    if(uiPWM > uiMaxPWM)
+      uiMaxPWM=uiPWM;
+  }
+  if(ptagAMDGPU->uiSensorReducer == SENSOR_REDUCER_MEAN)
+    return((unsigned int)fixp_DivRound((long)ulSum,(long)ulWeights));
+  return(uiMaxPWM);
+}
+
+static int iFanCtrl_EnableFan(EFanCtrlType eSensorType,
+                              const char *pcEnableFanPath,
+                              int iEnable)
+{
   switch(eSensorType)
   {
     case eFanCtrlType_AMDGPU:
-      if(fputs((iEnable)?AMDGPU_FAN_ENABLE:AMDGPU_FAN_DISABLE,
-               fp) == EOF)
+      if(iFanCtrl_WriteFile_m(pcEnableFanPath,
+                              (iEnable)?AMDGPU_FAN_ENABLE:AMDGPU_FAN_DISABLE))
       {
-        ERR_PRINTF("fputs(\"%s\",fp) failed (%d): %s",
-                   (iEnable)?AMDGPU_FAN_ENABLE:AMDGPU_FAN_DISABLE,
+        ERR_PRINTF("Writing \"%s\" failed (%d): %s",
+                   pcEnableFanPath,
                    errno,
                    strerror(errno));
-        iRc=1;
+        if(errno == EACCES)
+          ERR_PUTS("Application should run as root.");
+        return(1);
       }
       break;
     default:
       ERR_PRINTF("Unknown Sensortype (%d)",eSensorType);
-      iRc=2;
-      break;
+      return(2);
   }
-  fclose(fp);
-  return(iRc);
+  return(0);
 }
 
 static int iFanCtrl_SetFanSpeed(EFanCtrlType eSensorType,
                                 const char *pcSetFanSpeedPath,
                                 unsigned int uiPWM)
 {
-  FILE *fp;
-  int iRc=0;
+  char caBuf[16];
 
-  if(!(fp=fopen(pcSetFanSpeedPath,"w")))
-  {
-    ERR_PRINTF("fopen(\"%s\",\"w\") failed (%d): %s",
-               pcSetFanSpeedPath,
-               errno,
-               strerror(errno));
-    if(errno == EACCES)
-      ERR_PUTS("Application should run as root.");
-    return(1);
-  }
   switch(eSensorType)
   {
     case eFanCtrlType_AMDGPU:
-      if(fprintf(fp,
-                 "%u\n",
-                 uiPWM) < 1)
+      snprintf(caBuf,sizeof(caBuf),"%u\n",uiPWM);
+      if(iFanCtrl_WriteFile_m(pcSetFanSpeedPath,caBuf))
       {
-        ERR_PRINTF("fprintf(fp,\"%%u\",%u) failed (%d): %s",
+        ERR_PRINTF("Writing %u to \"%s\" failed (%d): %s",
                    uiPWM,
+                   pcSetFanSpeedPath,
                    errno,
                    strerror(errno));
-        iRc=1;
+        if(errno == EACCES)
+          ERR_PUTS("Application should run as root.");
+        return(1);
       }
       break;
     default:
       ERR_PRINTF("Unknown Sensortype (%d)",eSensorType);
-      iRc=2;
-      break;
+      return(2);
   }
-  fclose(fp);
-  return(iRc);
+  return(0);
 }
 
 /**
@@ -561,12 +5082,10 @@ static int iFanCtrl_SetFanSpeed(EFanCtrlType eSensorType,
 static int amdgpu_SetMode(TagFanCtrl *ptagFanCtrl,
                           int iModeManual)
 {
-  FILE * fp;
-  int iRc=0;
-
-  if(!(fp=fopen(ptagFanCtrl->ptagAMDGPU->pcPathSetFanCtrlMode,"w")))
+  if(iFanCtrl_WriteFile_m(ptagFanCtrl->ptagAMDGPU->pcPathSetFanCtrlMode,
+                          (iModeManual)?AMDGPU_SET_CTRL_MODE_MANUAL:AMDGPU_SET_CTRL_MODE_AUTO))
   {
-    ERR_PRINTF("fopen(\"%s\",\"w\") failed (%d): %s",
+    ERR_PRINTF("Writing \"%s\" failed (%d): %s",
                ptagFanCtrl->ptagAMDGPU->pcPathSetFanCtrlMode,
                errno,
                strerror(errno));
@@ -574,16 +5093,6 @@ static int amdgpu_SetMode(TagFanCtrl *ptagFanCtrl,
       ERR_PUTS("Application should run as root.");
     return(1);
   }
-  if(fputs((iModeManual)?AMDGPU_SET_CTRL_MODE_MANUAL:AMDGPU_SET_CTRL_MODE_AUTO,
-           fp) == EOF)
-  {
-    ERR_PRINTF("fputs(%s,fp) failed (%d): %s",
-               (iModeManual)?AMDGPU_SET_CTRL_MODE_MANUAL:AMDGPU_SET_CTRL_MODE_AUTO,
-               errno,
-               strerror(errno));
-    iRc=2;
-  }
-  fclose(fp);
-  return(iRc);
+  return(0);
 }
 
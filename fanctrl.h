@@ -1,6 +1,9 @@
 #ifndef FANCTRL_H_INCLUDED
   #define FANCTRL_H_INCLUDED
 
+#include <stdio.h> /* For FILE */
+#include <stddef.h> /* For size_t */
+
 #define FANCTRL_VERSION_MAJOR  0
 #define FANCTRL_VERSION_MINOR  2
 #define FANCTRL_VERSION_PATCH  0
@@ -14,11 +17,80 @@ enum
   RUN_RET_ERR_SENSOR_READ,
   RUN_RET_ERR_FAN_ENABLE,
   RUN_RET_ERR_PWM_WRITE,
+  RUN_RET_ERR_IDENTIFY_ABORTED,
+  RUN_RET_ERR_IDENTIFY_FAILED,
+  RUN_RET_ERR_CALIBRATE_ABORTED,
+  RUN_RET_ERR_CALIBRATE_FAILED,
 
   /* Flags for creation */
   CREATE_FLAG_DEBUG      =0x1,
+
+  /* Sensor filter types */
+  SENSOR_FILTER_NONE=0,
+  SENSOR_FILTER_EMA,
+  SENSOR_FILTER_MEDIAN,
+
+  /* Reducers of the per-sensor fanspeeds */
+  SENSOR_REDUCER_MAX=0,
+  SENSOR_REDUCER_MEAN,
+
+  /* Interpolation between the temperature points */
+  CURVE_INTERPOLATION_LINEAR=0,
+  CURVE_INTERPOLATION_SPLINE,
+
+  /* Fan output modes */
+  FAN_MODE_PWM=0,
+  FAN_MODE_RPM,
+
+  /* Control modes */
+  CONTROL_MODE_CURVE=0,
+  CONTROL_MODE_PID,
+  CONTROL_MODE_MPC,
+
+  /* Identification limits */
+  FANCTRL_IDENTIFY_MAX_CYCLES=10,
+  FANCTRL_IDENTIFY_CURVE_POINTS=3,
+
+  /* Curve profiles */
+  FANCTRL_MAX_PROFILES=8,
+
+  /* Fan calibration limits */
+  FANCTRL_CALIBRATION_MAX_POINTS=32,
 };
 
+/**
+ * One point of the fan calibration: Settled RPM at a PWM value.
+ */
+typedef struct
+{
+  unsigned char ucPWM;
+  unsigned short usRPM;
+}TagCfg_CalibrationPoint;
+
+/**
+ * Fan calibration, measured by fanCtrl_Calibrate().
+ * If present, fanspeeds are remapped in PWM mode, so a fanspeed in percent is the same percentage of the max. RPM on every fan.
+ */
+typedef struct
+{
+  /**
+   * Lowest PWM, which starts the fan from standstill.
+   */
+  unsigned char ucMinStartPWM;
+  /**
+   * Lowest PWM, which keeps a running fan spinning. Nonzero fanspeeds are not mapped below it.
+   */
+  unsigned char ucMinSustainPWM;
+  /**
+   * Number of measured points, 0 if the fan is not calibrated.
+   */
+  unsigned char ucPointsCount;
+  /**
+   * Measured points, ascending by PWM.
+   */
+  TagCfg_CalibrationPoint tagaPoints[FANCTRL_CALIBRATION_MAX_POINTS];
+}TagCfg_Calibration;
+
 /**
  * Configuration for AMDGPU.
  * Make sure that all memory stays valid during runtime, paths are only stored as reference!
@@ -28,8 +100,256 @@ typedef struct
   char caPathSetFanCtrlMode[260];
   char caPathEnableFan[260];
   char caPathSetPWM[260];
+  /**
+   * Critical/Emergency temperature, in 1/10 °C. When reached by any sensor, the fan runs at max. speed immediately. 0 to disable.
+   */
+  unsigned short usCriticalTemp;
+  unsigned short usEmergencyTemp;
+  /**
+   * If nonzero, the thresholds are also read from temp*_crit/temp*_emergency next to each sensor, the lower value is used.
+   */
+  unsigned char ucCriticalFromSensors;
+  /**
+   * Update interval while a critical temperature is active, in 1/10 seconds.
+   */
+  unsigned short usCriticalTickTime;
+  /**
+   * Time the temperature must stay below the threshold, before the normal update interval is used again, in 1/10 seconds.
+   */
+  unsigned short usCriticalCooldown;
+  /**
+   * Control law, see CONTROL_MODE_ enums above.
+   */
+  unsigned char ucControlMode;
+  /**
+   * CONTROL_MODE_PID: Target temperature, in 1/10 °C.
+   */
+  unsigned short usPIDSetpoint;
+  /**
+   * CONTROL_MODE_PID: Gains, in 1/100 PWM per 1/10 °C error (Kp), per 1/10 °C error and second (Ki),
+   * per 1/10 °C per second temperature change (Kd).
+   * Output is clamped to the min./max. fanspeed of the temperature points.
+   */
+  unsigned short usPIDKp;
+  unsigned short usPIDKi;
+  unsigned short usPIDKd;
+  /**
+   * Optional: Path to read the power draw (power1_average, in µW). Empty if not used.
+   */
+  char caPathPowerRead[260];
+  /**
+   * CONTROL_MODE_MPC: Max. temperature, in 1/10 °C, which must not be exceeded over the prediction horizon.
+   */
+  unsigned short usMPCTarget;
+  /**
+   * CONTROL_MODE_MPC: Prediction horizon, in update intervals.
+   */
+  unsigned short usMPCHorizon;
+  /**
+   * CONTROL_MODE_MPC: Forgetting factor of the online model fit, in 1/1000. Lower values adapt faster, but are noisier.
+   */
+  unsigned short usMPCForgetting;
+  /**
+   * Optional: Path to read the GPU load (gpu_busy_percent, in Percent). Empty if not used.
+   */
+  char caPathBusyRead[260];
+  /**
+   * Feed-forward: Fanspeed added on a step of the power draw/GPU load, in 1/100 PWM per W (Power)
+   * and per Percent (Busy). 0 to disable. The added fanspeed decays with usFeedForwardDecay.
+   * Not used in CONTROL_MODE_MPC, the model uses the power draw directly.
+   */
+  unsigned short usFeedForwardPower;
+  unsigned short usFeedForwardBusy;
+  /**
+   * Feed-forward: Decay time constant, in 1/10 seconds. Should be about the thermal time constant of the GPU.
+   */
+  unsigned short usFeedForwardDecay;
+  /**
+   * Optional: Path to read the current GPU clock (pp_dpm_sclk). Empty if not used.
+   */
+  char caPathClockRead[260];
+  /**
+   * Throttle detection: Temperature, in 1/10 °C, at or above which a clock drop is treated as thermal throttling. 0 to disable.
+   * Requires caPathClockRead and caPathBusyRead.
+   */
+  unsigned short usThrottleTemp;
+  /**
+   * Throttle detection: The GPU throttles, if the current clock is below usThrottleClock Percent of the highest clock level,
+   * while the GPU load is at or above usThrottleBusy Percent.
+   */
+  unsigned short usThrottleClock;
+  unsigned short usThrottleBusy;
+  /**
+   * Throttle detection: Fanspeed added per update interval while throttling, in PWM.
+   * Removed again in steps of 1/4, once the temperature is below usThrottleTemp.
+   */
+  unsigned short usThrottleBiasStep;
+  /**
+   * Optional: Path to the power cap of the GPU (power1_cap, in µW). Empty if not used.
+   * The power cap is lowered as second actuator, if the fanspeed is saturated.
+   */
+  char caPathPowerCap[260];
+  /**
+   * Power cap: Temperature, in 1/10 °C, above which the power cap is lowered, while the fanspeed is at the max. fanspeed of the curve.
+   * 0 to disable.
+   */
+  unsigned short usPowerCapTemp;
+  /**
+   * Power cap: Lower bound, in W.
+   */
+  unsigned short usPowerCapMin;
+  /**
+   * Power cap: Change per update interval, in W.
+   */
+  unsigned short usPowerCapStep;
+  /**
+   * Power cap: The power cap is raised again (up to the original value), once the temperature is
+   * usPowerCapHysteresis (in 1/10 °C) below usPowerCapTemp.
+   */
+  unsigned short usPowerCapHysteresis;
+  /**
+   * Power cap boost: Temperature limit, in 1/10 °C. While the temperature is usPowerCapHysteresis below this limit
+   * and the fanspeed is below usPowerCapBoostFanSpeed Percent, the power cap is raised above its original value,
+   * by usPowerCapStep per update interval. If one of the limits is reached, it is lowered fast. 0 to disable.
+   */
+  unsigned short usPowerCapBoostTemp;
+  unsigned short usPowerCapBoostFanSpeed;
+  /**
+   * Power cap boost: Max. power cap, in W. 0 to use the max. cap of the driver (power1_cap_max).
+   */
+  unsigned short usPowerCapMax;
+  /**
+   * Optional: Path to read the power profile of the driver (pp_power_profile_mode), for profile rules. Empty if not used.
+   */
+  char caPathPowerProfile[260];
+  /**
+   * Optional: Path of a hint file, its first line is matched by profile rules. Empty if not used.
+   * A missing file is treated as empty hint.
+   */
+  char caPathProfileHint[260];
+  /**
+   * Profile switch: Number of update intervals to cross-fade from the old to the new curve. 0 or 1 to switch immediately.
+   */
+  unsigned short usProfileFade;
+  /**
+   * Optional: Path of a unix datagram socket, created by fanctrl, which accepts load hints of a job scheduler. Empty if not used.
+   * Message format: "<device> <expected power in W> <duration in seconds>", duration 0 cancels the hint, a negative one is rejected.
+   */
+  char caPathHintSocket[108];
+  /**
+   * Hint: Device name, hints for other devices are ignored.
+   */
+  char caHintDevice[32];
+  /**
+   * Hint: Fanspeed added while a hint is active, in 1/100 PWM per W the expected power is above the current power draw.
+   * CONTROL_MODE_MPC uses the expected power directly.
+   */
+  unsigned short usHintGain;
+  /**
+   * Hint: Max. duration of a hint, in seconds. Longer durations are limited to this value.
+   */
+  unsigned short usHintMaxTTL;
+  /**
+   * Hint: Access mode of the socket, e.g. 0660. 0 to keep the default, given by the umask of fanctrl.
+   */
+  unsigned short usHintSocketMode;
+  /**
+   * Hint: Group of the socket, name or numeric ID. Empty to keep the group of fanctrl.
+   */
+  char caHintSocketGroup[32];
+  /**
+   * Reducer of the per-sensor fanspeeds in CONTROL_MODE_CURVE, see SENSOR_REDUCER_ enums above.
+   * SENSOR_REDUCER_MAX: Max. of the fanspeeds, each scaled by the sensor weight.
+   * SENSOR_REDUCER_MEAN: Mean of the fanspeeds, weighted by the sensor weights.
+   */
+  unsigned char ucSensorReducer;
+  /**
+   * Interpolation between the temperature points of all curves, see CURVE_INTERPOLATION_ enums above.
+   * CURVE_INTERPOLATION_SPLINE: Monotone cubic (Fritsch-Carlson), smooth at the points, never overshoots between them.
+   */
+  unsigned char ucCurveInterpolation;
+  /**
+   * Fan output, see FAN_MODE_ enums above.
+   * FAN_MODE_PWM: The fanspeed is written as PWM.
+   * FAN_MODE_RPM: The fanspeed is a target RPM, in percent of usFanRPMMax. It is written to caPathFanTarget if supported
+   *               by the driver, otherwise an inner loop adjusts the PWM until caPathFanInput matches.
+   */
+  unsigned char ucFanMode;
+  /**
+   * RPM mode: Path of the target RPM (fan1_target). Empty or not writeable to use the inner loop.
+   */
+  char caPathFanTarget[260];
+  /**
+   * RPM mode: Path of the measured RPM (fan1_input), required for the inner loop.
+   */
+  char caPathFanInput[260];
+  /**
+   * RPM mode: RPM at 100% fanspeed.
+   */
+  unsigned short usFanRPMMax;
+  /**
+   * RPM mode, inner loop: PWM change per step, in 1/1000 PWM per RPM difference to the target.
+   */
+  unsigned short usFanRPMGain;
+  /**
+   * RPM mode, inner loop: Steps per update interval, the inner loop reads the tachometer only.
+   */
+  unsigned char ucFanRPMSubTicks;
+  /**
+   * Stall detection: The fan is stalled, if caPathFanInput reads 0 RPM for usStallTime (1/10 seconds),
+   * while the fanspeed is at least usStallFanSpeed (in percent, 0 to disable).
+   * A stalled fan gets max. PWM for usStallKickTime (1/10 seconds). If it doesn't spin up, it is treated as failed:
+   * It stays at max. PWM and the power cap is lowered to usStallPowerCap (in W, 0 to keep it).
+   */
+  unsigned short usStallFanSpeed;
+  unsigned short usStallTime;
+  unsigned short usStallKickTime;
+  unsigned short usStallPowerCap;
+  /**
+   * Zero-RPM state machine, replaces the on/off decision of a zero fanspeed in the curve:
+   * The fan starts at usZeroRPMStartTemp and stops at or below usZeroRPMStopTemp (in 1/10 °C, start 0 to disable),
+   * each state is kept for at least usZeroRPMMinOnTime/usZeroRPMMinOffTime (1/10 seconds).
+   * After a start, the fan runs at full duty for usZeroRPMKickTime (1/10 seconds, 0 to disable).
+   */
+  unsigned short usZeroRPMStartTemp;
+  unsigned short usZeroRPMStopTemp;
+  unsigned short usZeroRPMMinOnTime;
+  unsigned short usZeroRPMMinOffTime;
+  unsigned short usZeroRPMKickTime;
+  /**
+   * Slew limiter: Max. change of the fanspeed, in PWM/s up and down (0 for unlimited).
+   * If ucSlewCriticalUnlimited is nonzero, the fanspeed rises unlimited while a critical temperature is active.
+   */
+  unsigned short usSlewRateUp;
+  unsigned short usSlewRateDown;
+  unsigned char ucSlewCriticalUnlimited;
+  /**
+   * Optional: Path of the state file (e.g. below /run), empty to disable.
+   * The controller state is restored at start, if it isn't older than usStateMaxAge (seconds).
+   */
+  char caPathState[260];
+  unsigned short usStateMaxAge;
+  /**
+   * Optional fan calibration, see TagCfg_Calibration.
+   */
+  TagCfg_Calibration tagCalibration;
 }TagCfg_AMDGPU;
 
+/**
+ * Configuration for Temperature Points.
+ */
+typedef struct
+{
+  /**
+   * Temperature, in 1/10 °C
+   */
+  int iTemp;
+  /**
+   * Desired Fanspeed at temperature, in Percent.
+   */
+  unsigned char ucFanSpeedPercent;
+}TagCfg_Temperatures;
+
 /**
  * Configuration for Sensors.
  * Make sure that all memory stays valid during runtime, paths are only stored as reference!
@@ -37,25 +357,224 @@ typedef struct
 typedef struct
 {
   char caSensorReadPath[260];
+  /**
+   * Filter applied to the raw sensor values, see SENSOR_FILTER_ enums above.
+   */
+  unsigned char ucFilterType;
+  /**
+   * SENSOR_FILTER_EMA: Weight of a new sample, in Percent (1-100).
+   * SENSOR_FILTER_MEDIAN: Window size, in samples (1-9).
+   */
+  unsigned char ucFilterParam;
+  /**
+   * SENSOR_FILTER_EMA only: Rising step in 1/10 °C, above which the filter is bypassed to react on real load changes immediately.
+   * 0 to disable.
+   */
+  unsigned short usFilterStepBypass;
+  /**
+   * Number of samples taken per update interval (oversampling), 0 or 1 to sample once.
+   */
+  unsigned char ucOversampling;
+  /**
+   * Weight of the sensor's fanspeed, in Percent (0-100), see TagCfg_AMDGPU.ucSensorReducer. 0 to ignore the sensor in CONTROL_MODE_CURVE.
+   */
+  unsigned char ucWeight;
+  /**
+   * Own curve of the sensor, NULL to use the curve of the AMDGPU section (or the active profile).
+   */
+  const TagCfg_Temperatures *ptagTemps;
+  unsigned int uiTempsCount;
 }TagCfg_Sensor;
 
 /**
- * Configuration for Temperature Points.
+ * Configuration for a named curve profile.
+ * A profile is active if all of its configured rules match, the first matching profile wins.
+ * If no profile matches, the temperature points of the AMDGPU section are used.
+ * Make sure that all memory stays valid during runtime, names/rules and points are only stored as reference!
  */
 typedef struct
 {
+  char caName[32];
+  const TagCfg_Temperatures *ptagTemps;
+  unsigned int uiTempsCount;
   /**
-   * Temperature, in 1/10 °C
+   * Rule: GPU load, in Percent, which must be reached (or fallen below again) for usRuleBusyTime (1/10 seconds)
+   * before the rule changes its state. 0 to disable. Requires caPathBusyRead.
    */
-  int iTemp;
+  unsigned short usRuleBusy;
+  unsigned short usRuleBusyTime;
   /**
-   * Desired Fanspeed at temperature, in Percent.
+   * Rule: Name of the active power profile (e.g. "COMPUTE"). Empty to disable. Requires caPathPowerProfile.
    */
-  unsigned char ucFanSpeedPercent;
-}TagCfg_Temperatures;
+  char caRulePowerProfile[32];
+  /**
+   * Rule: Content of the hint file. Empty to disable. Requires caPathProfileHint.
+   */
+  char caRuleHint[64];
+}TagCfg_Profile;
+
+/**
+ * Configuration for the Hysteresis engine, which decides when a temperature change updates the fanspeed.
+ */
+typedef struct
+{
+  /**
+   * Min. temperature rise since the last update, in 1/10 °C. 0 to update on any rise.
+   */
+  unsigned short usRisingDeadband;
+  /**
+   * Min. temperature fall since the last update, in 1/10 °C. 0 to update on any fall.
+   */
+  unsigned short usFallingDeadband;
+  /**
+   * Min. time between two fanspeed updates, in 1/10 seconds. 0 to disable.
+   */
+  unsigned short usMinDwellTime;
+  /**
+   * Rising slope in 1/10 °C per second, at or above which the fanspeed is updated immediately,
+   * regardless of deadband and dwell time. 0 to disable.
+   */
+  unsigned short usRisingSlopeBypass;
+}TagCfg_Hysteresis;
+
+/**
+ * Configuration for the identification run (relay experiment), see fanCtrl_Identify().
+ */
+typedef struct
+{
+  /**
+   * Temperature to oscillate around, in 1/10 °C. The GPU must be loaded enough to reach it at the low fanspeed.
+   */
+  unsigned short usSetpoint;
+  /**
+   * Relay hysteresis, in 1/10 °C.
+   */
+  unsigned short usHysteresis;
+  /**
+   * Low/High fanspeed of the relay, in Percent.
+   */
+  unsigned char ucFanSpeedLow;
+  unsigned char ucFanSpeedHigh;
+  /**
+   * Number of oscillations to record (1-FANCTRL_IDENTIFY_MAX_CYCLES).
+   */
+  unsigned char ucCycles;
+  /**
+   * Sampling interval, in 1/10 seconds.
+   */
+  unsigned short usSampleTime;
+  /**
+   * The run is aborted, if any sensor reaches this temperature, in 1/10 °C.
+   */
+  unsigned short usSafetyTemp;
+  /**
+   * The run is aborted, if not finished after this time, in seconds.
+   */
+  unsigned short usMaxDuration;
+}TagCfg_Identify;
+
+/**
+ * Result of the identification run.
+ * Units are the same as in the configuration, so the values can be written back as they are.
+ */
+typedef struct
+{
+  /**
+   * First order plus dead time model:
+   * Gain in 1/1000 °C per PWM step, time constant and dead time in 1/10 seconds.
+   */
+  unsigned int uiGain;
+  unsigned int uiTimeConstant;
+  unsigned int uiDeadTime;
+  /**
+   * Ultimate gain in 1/100 PWM per 1/10 °C and ultimate period in 1/10 seconds.
+   */
+  unsigned int uiUltimateGain;
+  unsigned int uiUltimatePeriod;
+  /**
+   * Peak-to-peak sensor noise, in 1/10 °C.
+   */
+  unsigned int uiNoise;
+  /**
+   * Recommended curve slope, in 1/100 PWM per 1/10 °C, and the according curve.
+   */
+  unsigned int uiCurveSlope;
+  TagCfg_Temperatures tagaCurve[FANCTRL_IDENTIFY_CURVE_POINTS];
+  /**
+   * Recommended update interval (longest safe tick), in 1/10 seconds and hysteresis.
+   */
+  unsigned int uiUpdateDelayTime;
+  TagCfg_Hysteresis tagHysteresis;
+  /**
+   * Recommended PID settings, see TagCfg_AMDGPU.
+   */
+  unsigned short usPIDSetpoint;
+  unsigned short usPIDKp;
+  unsigned short usPIDKi;
+  unsigned short usPIDKd;
+}TagFanCtrl_Identified;
+
+/**
+ * Configuration for the fan calibration sweep, see fanCtrl_Calibrate().
+ */
+typedef struct
+{
+  /**
+   * PWM step of the sweep, the number of points is limited to FANCTRL_CALIBRATION_MAX_POINTS.
+   */
+  unsigned char ucStep;
+  /**
+   * Interval between two tachometer reads, in 1/10 seconds.
+   */
+  unsigned short usSampleTime;
+  /**
+   * The RPM is settled, once three consecutive reads differ by this value or less. A fan below it counts as stopped.
+   */
+  unsigned short usSettleTolerance;
+  /**
+   * Max. time to wait for the RPM to settle on each step, in 1/10 seconds. The last read is used on timeout.
+   */
+  unsigned short usSettleTime;
+  /**
+   * The run is aborted, if any sensor reaches this temperature, in 1/10 °C.
+   */
+  unsigned short usSafetyTemp;
+}TagCfg_Calibrate;
 
 typedef struct TagFanCtrl_t TagFanCtrl;
 
+/**
+ * Reload hook, called by fanCtrl_Run() between two ticks, see fanCtrl_SetReloadHook().
+ * The hook decides if a reload is due (e.g. a flag set by a signal handler) and calls fanCtrl_AMDGPU_Reload().
+ *
+ * @return 1 if the configuration was reloaded, 0 if not, negative if the reload failed (the running configuration is kept).
+ */
+typedef int (*FanCtrlReloadHook)(TagFanCtrl *ptagFanCtrl);
+
+/**
+ * Places the FanCtrl-Object and its devices in storage of the application (one arena, sized at init), instead of the heap.
+ * Must be called before fanCtrl_Create(), the storage must stay valid until fanCtrl_Destroy().
+ * Once the storage is exhausted (e.g. by the new device of a reload), the heap is used.
+ * Required by the static build (FANCTRL_STATIC), which has no heap fallback.
+ *
+ * @param pvStorage _IN_ Storage, aligned for any type. NULL to use the heap.
+ * @param szStorage _IN_ Size of the storage, see fanCtrl_AMDGPU_StorageSize().
+ */
+void fanCtrl_SetStorage(void *pvStorage,
+                        size_t szStorage);
+
+/**
+ * Calculates the storage size for a FanCtrl-Object with an AMDGPU device, see fanCtrl_SetStorage().
+ * The configuration must be verified, see fanCtrl_AMDGPU_Verify().
+ *
+ * @return Size in bytes.
+ */
+size_t fanCtrl_AMDGPU_StorageSize(const TagCfg_Sensor *ptagSensors,
+                                  unsigned int uiSensorsCount,
+                                  const TagCfg_Temperatures *ptagTemps,
+                                  unsigned int uiTempsCount,
+                                  const TagCfg_Profile *ptagProfiles,
+                                  unsigned int uiProfilesCount);
 
 /**
  * Creates new Object for Fancontrol.
@@ -63,8 +582,8 @@ typedef struct TagFanCtrl_t TagFanCtrl;
  *
  * @param uiUpdateDelayTime
  *                _IN_ Delay Time between updating the Sensorvalues/Fanspeeds, in 1/10 seconds.
- * @param ucTempHysteresisPercent
- *                _IN_ Temperature Hysteresis, before the speed is updated, in Percent.
+ * @param ptagHysteresis
+ *                _IN_ Hysteresis configuration, before the speed is updated.
  * @param puiQuitRunFlag
  *                _IN_ Flag to indicate the Run Function to quit.
  *                Value should be 0 before Run is called, otherwise it will instantly quit.
@@ -73,12 +592,12 @@ typedef struct TagFanCtrl_t TagFanCtrl;
  * @return New Fanctrl Object on success, NULL on error.
  */
 TagFanCtrl *fanCtrl_Create(unsigned int uiUpdateDelayTime,
-                           unsigned char ucTempHysteresisPercent,
+                           const TagCfg_Hysteresis *ptagHysteresis,
                            unsigned int *puiQuitRunFlag,
                            unsigned int uiFlags);
 
 /**
- * Cleans up the allocated memory of the Fanctrl-Object.
+ * Cleans up the allocated memory of the Fanctrl-Object, the hint socket is closed and removed.
  * After this, the FanCtrl-Object cannot be used anymore.
  * Make sure to reset Fancontrol to automode, by calling fanCtrl_ResetDevices() before this.
  *
@@ -87,6 +606,33 @@ TagFanCtrl *fanCtrl_Create(unsigned int uiUpdateDelayTime,
  */
 void fanCtrl_Destroy(TagFanCtrl *ptagFanCtrl);
 
+#ifndef FANCTRL_STATIC
+/**
+ * Verifies the configuration of the AMDGPU Subsystem, without accessing the device.
+ * fanCtrl_AMDGPU_Init() and fanCtrl_AMDGPU_Reload() call this first, afterwards they verify the device only
+ * (readable sensors, power cap, ...). The static build (FANCTRL_STATIC) doesn't contain it,
+ * its configuration is verified when it is exported.
+ *
+ * @param uiUpdateDelayTime
+ *                  _IN_ Update interval, see fanCtrl_Create()
+ * @param ptagHysteresis
+ *                  _IN_ Hysteresis configuration, see fanCtrl_Create()
+ *
+ * Further parameters, see fanCtrl_AMDGPU_Init().
+ *
+ * @return 0 if valid, nonzero otherwise (the error is printed).
+ */
+int fanCtrl_AMDGPU_Verify(unsigned int uiUpdateDelayTime,
+                          const TagCfg_Hysteresis *ptagHysteresis,
+                          const TagCfg_AMDGPU *pConfig,
+                          const TagCfg_Sensor *ptagSensors,
+                          unsigned int uiSensorsCount,
+                          const TagCfg_Temperatures *ptagTemps,
+                          unsigned int uiTempsCount,
+                          const TagCfg_Profile *ptagProfiles,
+                          unsigned int uiProfilesCount);
+#endif /* !FANCTRL_STATIC */
+
 /**
  * Initializes the AMDGPU Subsystem for Fancontol of a GPU using the AMDGPU-Driver.
  *
@@ -100,6 +646,10 @@ void fanCtrl_Destroy(TagFanCtrl *ptagFanCtrl);
  * @param ptagTemps _IN_ Temperature Points, containing Temperature + according fanspeed.
  * @param uiTempsCount
  *                  _IN_ Number of Temperature Points
+ * @param ptagProfiles
+ *                  _IN_ Curve profiles, NULL if not used.
+ * @param uiProfilesCount
+ *                  _IN_ Number of profiles (max. FANCTRL_MAX_PROFILES)
  *
  * @return 0 on success, nonzero on error.
  */
@@ -108,11 +658,56 @@ int fanCtrl_AMDGPU_Init(TagFanCtrl *ptagFanCtrl,
                         const TagCfg_Sensor *ptagSensors,
                         unsigned int uiSensorsCount,
                         const TagCfg_Temperatures *ptagTemps,
-                        unsigned int uiTempsCount);
+                        unsigned int uiTempsCount,
+                        const TagCfg_Profile *ptagProfiles,
+                        unsigned int uiProfilesCount);
+
+/**
+ * Reloads the configuration of the running AMDGPU device, to be called from the reload hook only.
+ * The new configuration is validated and the new device (sensors, curves, LUTs) is built aside, the running one
+ * is replaced by a single pointer swap afterwards. If the fan control paths are unchanged, the device stays in manual mode:
+ * Open handles with an unchanged path (hint socket, state file) are handed over, as well as the controller state and the statistics.
+ * Otherwise the new fan is switched to manual mode and the old one is reset to automode.
+ * On failure, the running configuration is kept unchanged.
+ * The configuration must stay valid, until the next reload or fanCtrl_Destroy().
+ *
+ * @param ptagFanCtrl
+ *                  _IN_ The FanCtrl-Object, initialized by fanCtrl_AMDGPU_Init()
+ * @param uiUpdateDelayTime
+ *                  _IN_ Delay Time between updating the Sensorvalues/Fanspeeds, in 1/10 seconds.
+ * @param ptagHysteresis
+ *                  _IN_ Hysteresis configuration, before the speed is updated.
+ * @param pConfig ... uiProfilesCount
+ *                  _IN_ See fanCtrl_AMDGPU_Init()
+ *
+ * @return 0 on success, nonzero on error.
+ */
+int fanCtrl_AMDGPU_Reload(TagFanCtrl *ptagFanCtrl,
+                          unsigned int uiUpdateDelayTime,
+                          const TagCfg_Hysteresis *ptagHysteresis,
+                          const TagCfg_AMDGPU *pConfig,
+                          const TagCfg_Sensor *ptagSensors,
+                          unsigned int uiSensorsCount,
+                          const TagCfg_Temperatures *ptagTemps,
+                          unsigned int uiTempsCount,
+                          const TagCfg_Profile *ptagProfiles,
+                          unsigned int uiProfilesCount);
+
+/**
+ * Sets the reload hook, called by fanCtrl_Run() between two ticks.
+ *
+ * @param ptagFanCtrl
+ *               _IN_ The FanCtrl-Object
+ * @param pfnReloadHook
+ *               _IN_ The hook, NULL to disable
+ */
+void fanCtrl_SetReloadHook(TagFanCtrl *ptagFanCtrl,
+                           FanCtrlReloadHook pfnReloadHook);
 
 
 /**
  * Resets the configured devices to automatic Fanctrl.
+ * A lowered power cap is restored to its original value.
  *
  * @param ptagFanCtrl
  *               _IN_ The FanCtrl-Object
@@ -123,6 +718,7 @@ int fanCtrl_ResetDevices(TagFanCtrl *ptagFanCtrl);
 
 /**
  * Starts the Fancontrol. This will block the current thread, until the exit Flag is set to quit.
+ * After the first full update, the loop runs in its steady state without heap allocations, see fanCtrl_IsSteadyState().
  *
  * @param ptagFanCtrl
  *               _IN_ The FanCtrl-Object
@@ -131,5 +727,73 @@ int fanCtrl_ResetDevices(TagFanCtrl *ptagFanCtrl);
  */
 int fanCtrl_Run(TagFanCtrl *ptagFanCtrl);
 
+/**
+ * Returns, if fanCtrl_Run() is in its steady state: After the first full update, except while the reload hook runs.
+ * No heap allocations are expected then, the Debug build aborts on any (see fanctrl_alloccheck.c).
+ *
+ * @return Nonzero in the steady state.
+ */
+int fanCtrl_IsSteadyState(void);
+
+/**
+ * Runs the identification (relay experiment) for the AMDGPU device, instead of fanCtrl_Run().
+ * The fanspeed is switched between two values to make the temperature oscillate around the setpoint,
+ * the recorded oscillations are used to fit a thermal model and to derive recommended settings.
+ * If the safety temperature (or a critical temperature) is reached, or the quit flag is set, the run is aborted.
+ * In any case, the fanspeed of the configured curve is restored before returning.
+ *
+ * @param ptagFanCtrl
+ *               _IN_ The FanCtrl-Object
+ * @param ptagCfg
+ *               _IN_ Configuration of the experiment
+ * @param ptagResult
+ *               _OUT_ Identified model and recommended settings, only valid on RUN_RET_OK
+ *
+ * @return RUN_RET_OK on success, Errorcode on failure.
+ */
+int fanCtrl_Identify(TagFanCtrl *ptagFanCtrl,
+                     const TagCfg_Identify *ptagCfg,
+                     TagFanCtrl_Identified *ptagResult);
+
+/**
+ * Runs the fan calibration for the AMDGPU device, instead of fanCtrl_Run().
+ * The PWM is swept down from max. speed to 0 in steps, waiting for the tachometer to settle on each step,
+ * which gives the PWM-to-RPM table and the min. sustaining PWM. Afterwards the PWM is raised from standstill,
+ * until the fan starts, which gives the min. start PWM.
+ * If the safety temperature (or a critical temperature) is reached, or the quit flag is set, the run is aborted.
+ * In any case, the fanspeed of the configured curve is restored before returning.
+ *
+ * @param ptagFanCtrl
+ *               _IN_ The FanCtrl-Object
+ * @param ptagCfg
+ *               _IN_ Configuration of the sweep
+ * @param ptagResult
+ *               _OUT_ Measured calibration, only valid on RUN_RET_OK
+ *
+ * @return RUN_RET_OK on success, Errorcode on failure.
+ */
+int fanCtrl_Calibrate(TagFanCtrl *ptagFanCtrl,
+                      const TagCfg_Calibrate *ptagCfg,
+                      TagCfg_Calibration *ptagResult);
+
+/**
+ * Requests to print the runtime statistics from within fanCtrl_Run().
+ * This only sets a flag, so it's safe to call from a signal handler.
+ *
+ * @param ptagFanCtrl
+ *               _IN_ The FanCtrl-Object
+ */
+void fanCtrl_RequestStats(TagFanCtrl *ptagFanCtrl);
+
+/**
+ * Prints the runtime statistics (e.g. count of fanspeed updates/suppressed changes).
+ *
+ * @param ptagFanCtrl
+ *               _IN_ The FanCtrl-Object
+ * @param fp     _IN_ Stream where to print to (e.g. stdout)
+ */
+void fanCtrl_PrintStats(const TagFanCtrl *ptagFanCtrl,
+                        FILE *fp);
+
 #endif /* FANCTRL_H_INCLUDED */
 
@@ -0,0 +1,59 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "fanctrl.h"
+
+/**
+ * Debug build only: Interposes the heap functions of the C library, to verify the steady state of fanCtrl_Run()
+ * is free of heap allocations (see fanCtrl_IsSteadyState()). Any malloc/calloc/realloc/free then aborts,
+ * so the backtrace of the core dump (or gdb) shows the caller. Allocations of libc itself are caught as well.
+ * Requires glibc, which exports the __libc_ entry points of its allocator.
+ */
+
+#define ALLOCCHECK_MSG(func) "fanctrl_alloccheck Error: " func "() in the steady state of fanCtrl_Run(), aborting\n"
+
+extern void *__libc_malloc(size_t szSize);
+extern void *__libc_calloc(size_t szCount,size_t szSize);
+extern void *__libc_realloc(void *pvMem,size_t szSize);
+extern void __libc_free(void *pvMem);
+
+/**
+ * Aborts, if called in the steady state. The message is written without stdio, which could allocate itself.
+ */
+static void vAllocCheck_m(const char *pcMsg,
+                          size_t szMsgLen)
+{
+  if(!fanCtrl_IsSteadyState())
+    return;
+  if(write(STDERR_FILENO,pcMsg,szMsgLen) < 0)
+  {/* Nothing left to report to */
+  }
+  abort();
+}
+
+void *malloc(size_t szSize)
+{
+  vAllocCheck_m(ALLOCCHECK_MSG("malloc"),sizeof(ALLOCCHECK_MSG("malloc"))-1);
+  return(__libc_malloc(szSize));
+}
+
+void *calloc(size_t szCount,
+             size_t szSize)
+{
+  vAllocCheck_m(ALLOCCHECK_MSG("calloc"),sizeof(ALLOCCHECK_MSG("calloc"))-1);
+  return(__libc_calloc(szCount,szSize));
+}
+
+void *realloc(void *pvMem,
+              size_t szSize)
+{
+  vAllocCheck_m(ALLOCCHECK_MSG("realloc"),sizeof(ALLOCCHECK_MSG("realloc"))-1);
+  return(__libc_realloc(pvMem,szSize));
+}
+
+void free(void *pvMem)
+{
+  if(pvMem)
+    vAllocCheck_m(ALLOCCHECK_MSG("free"),sizeof(ALLOCCHECK_MSG("free"))-1);
+  __libc_free(pvMem);
+}
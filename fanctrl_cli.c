@@ -1,19 +1,157 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <signal.h>
+#include <string.h>
+#include <errno.h>
+#include <ctype.h> /* For isdigit() */
+#include <limits.h> /* For PATH_MAX */
+#include <stddef.h> /* For offsetof */
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "fanctrl.h"
 #include "inifile.h"
 
 #define CFGFILE_SECTION_NAME_FANCTRL                 "FanCtrlGlobal"
 #define CFGFILE_SECTION_NAME_AMDGPU                  "AMDGPU"
+#define CFGFILE_SECTION_NAME_IDENTIFY                "Identify"
+#define CFGFILE_SECTION_NAME_IDENTIFIED              "Identified"
+#define CFGFILE_SECTION_NAME_PROFILE                 "Profile" /* Followed by the number, e.g. [Profile1] */
+#define CFGFILE_SECTION_NAME_SENSOR_CURVE            "SensorCurve" /* Followed by the sensor number, e.g. [SensorCurve1] */
+#define CFGFILE_SECTION_NAME_CALIBRATE               "Calibrate"
+#define CFGFILE_SECTION_NAME_CALIBRATION             "Calibration"
 
 #define CFGFILE_KEY_NAME_FANCTRL_UPDATETIME          "UpdateDelayTime"
-#define CFGFILE_KEY_NAME_FANCTRL_CHANGE_HYSTERESIS   "TempChangeHysteresis"
+#define CFGFILE_KEY_NAME_FANCTRL_CHANGE_HYSTERESIS   "TempChangeHysteresis" /* Deprecated, replaced by the keys below */
+#define CFGFILE_KEY_NAME_FANCTRL_HYST_RISING         "TempHysteresisRising"
+#define CFGFILE_KEY_NAME_FANCTRL_HYST_FALLING        "TempHysteresisFalling"
+#define CFGFILE_KEY_NAME_FANCTRL_HYST_MIN_DWELL      "MinDwellTime"
+#define CFGFILE_KEY_NAME_FANCTRL_HYST_SLOPE_BYPASS   "RisingSlopeBypass"
 
 #define CFGFILE_KEY_NAME_AMDGPU_PATH_SET_CTRL_MODE   "PathSetFanCtrlMode"
 #define CFGFILE_KEY_NAME_AMDGPU_PATH_ENABLE_FAN      "PathEnableFan"
 #define CFGFILE_KEY_NAME_AMDGPU_PATH_SET_PWM         "PathSetPWM"
+#define CFGFILE_KEY_NAME_AMDGPU_CRITICAL_TEMP        "CriticalTemp"
+#define CFGFILE_KEY_NAME_AMDGPU_EMERGENCY_TEMP       "EmergencyTemp"
+#define CFGFILE_KEY_NAME_AMDGPU_CRITICAL_FROM_SENSOR "CriticalFromSensors"
+#define CFGFILE_KEY_NAME_AMDGPU_CRITICAL_TICK_TIME   "CriticalUpdateDelayTime"
+#define CFGFILE_KEY_NAME_AMDGPU_CRITICAL_COOLDOWN    "CriticalCooldownTime"
+#define CFGFILE_KEY_NAME_AMDGPU_CONTROL_MODE         "ControlMode"
+#define CFGFILE_KEY_NAME_AMDGPU_PID_SETPOINT         "PIDSetpoint"
+#define CFGFILE_KEY_NAME_AMDGPU_PID_KP               "PIDKp"
+#define CFGFILE_KEY_NAME_AMDGPU_PID_KI               "PIDKi"
+#define CFGFILE_KEY_NAME_AMDGPU_PID_KD               "PIDKd"
+#define CFGFILE_KEY_NAME_AMDGPU_PATH_POWER_READ      "PathPowerRead"
+#define CFGFILE_KEY_NAME_AMDGPU_MPC_TARGET           "MPCTarget"
+#define CFGFILE_KEY_NAME_AMDGPU_MPC_HORIZON          "MPCHorizon"
+#define CFGFILE_KEY_NAME_AMDGPU_MPC_FORGETTING       "MPCForgetting"
+#define CFGFILE_KEY_NAME_AMDGPU_PATH_BUSY_READ       "PathBusyRead"
+#define CFGFILE_KEY_NAME_AMDGPU_FEEDFORWARD_POWER    "FeedForwardPower"
+#define CFGFILE_KEY_NAME_AMDGPU_FEEDFORWARD_BUSY     "FeedForwardBusy"
+#define CFGFILE_KEY_NAME_AMDGPU_FEEDFORWARD_DECAY    "FeedForwardDecay"
+#define CFGFILE_KEY_NAME_AMDGPU_PATH_CLOCK_READ      "PathClockRead"
+#define CFGFILE_KEY_NAME_AMDGPU_THROTTLE_TEMP        "ThrottleTemp"
+#define CFGFILE_KEY_NAME_AMDGPU_THROTTLE_CLOCK       "ThrottleClock"
+#define CFGFILE_KEY_NAME_AMDGPU_THROTTLE_BUSY        "ThrottleBusy"
+#define CFGFILE_KEY_NAME_AMDGPU_THROTTLE_BIAS_STEP   "ThrottleBiasStep"
+#define CFGFILE_KEY_NAME_AMDGPU_PATH_POWER_CAP       "PathPowerCap"
+#define CFGFILE_KEY_NAME_AMDGPU_POWER_CAP_TEMP       "PowerCapTemp"
+#define CFGFILE_KEY_NAME_AMDGPU_POWER_CAP_MIN        "PowerCapMin"
+#define CFGFILE_KEY_NAME_AMDGPU_POWER_CAP_STEP       "PowerCapStep"
+#define CFGFILE_KEY_NAME_AMDGPU_POWER_CAP_HYSTERESIS "PowerCapHysteresis"
+#define CFGFILE_KEY_NAME_AMDGPU_POWER_CAP_BOOST_TEMP "PowerCapBoostTemp"
+#define CFGFILE_KEY_NAME_AMDGPU_POWER_CAP_BOOST_FAN  "PowerCapBoostFanSpeed"
+#define CFGFILE_KEY_NAME_AMDGPU_POWER_CAP_MAX        "PowerCapMax"
+#define CFGFILE_KEY_NAME_AMDGPU_PATH_POWER_PROFILE   "PathPowerProfile"
+#define CFGFILE_KEY_NAME_AMDGPU_PATH_PROFILE_HINT    "PathProfileHint"
+#define CFGFILE_KEY_NAME_AMDGPU_PROFILE_FADE         "ProfileFade"
+#define CFGFILE_KEY_NAME_AMDGPU_PATH_HINT_SOCKET     "PathHintSocket"
+#define CFGFILE_KEY_NAME_AMDGPU_HINT_DEVICE          "HintDevice"
+#define CFGFILE_KEY_NAME_AMDGPU_HINT_GAIN            "HintGain"
+#define CFGFILE_KEY_NAME_AMDGPU_HINT_MAX_TTL         "HintMaxTTL"
+#define CFGFILE_KEY_NAME_AMDGPU_HINT_SOCKET_MODE     "HintSocketMode" /* Octal, e.g. 0660 */
+#define CFGFILE_KEY_NAME_AMDGPU_HINT_SOCKET_GROUP    "HintSocketGroup"
+#define CFGFILE_KEY_NAME_AMDGPU_SENSOR_REDUCER       "SensorReducer"
+#define CFGFILE_KEY_NAME_AMDGPU_CURVE_INTERPOLATION  "CurveInterpolation"
+#define CFGFILE_KEY_NAME_AMDGPU_FAN_MODE             "FanMode"
+#define CFGFILE_KEY_NAME_AMDGPU_PATH_FAN_TARGET      "PathFanTarget"
+#define CFGFILE_KEY_NAME_AMDGPU_PATH_FAN_INPUT       "PathFanInput"
+#define CFGFILE_KEY_NAME_AMDGPU_FAN_RPM_MAX          "FanRPMMax"
+#define CFGFILE_KEY_NAME_AMDGPU_FAN_RPM_GAIN         "FanRPMGain"
+#define CFGFILE_KEY_NAME_AMDGPU_FAN_RPM_STEPS        "FanRPMSteps"
+#define CFGFILE_KEY_NAME_AMDGPU_STALL_FAN_SPEED      "StallFanSpeed"
+#define CFGFILE_KEY_NAME_AMDGPU_STALL_TIME           "StallTime"
+#define CFGFILE_KEY_NAME_AMDGPU_STALL_KICK_TIME      "StallKickTime"
+#define CFGFILE_KEY_NAME_AMDGPU_STALL_POWER_CAP      "StallPowerCap"
+#define CFGFILE_KEY_NAME_AMDGPU_ZERO_RPM_START_TEMP  "ZeroRPMStartTemp"
+#define CFGFILE_KEY_NAME_AMDGPU_ZERO_RPM_STOP_TEMP   "ZeroRPMStopTemp"
+#define CFGFILE_KEY_NAME_AMDGPU_ZERO_RPM_MIN_ON      "ZeroRPMMinOnTime"
+#define CFGFILE_KEY_NAME_AMDGPU_ZERO_RPM_MIN_OFF     "ZeroRPMMinOffTime"
+#define CFGFILE_KEY_NAME_AMDGPU_ZERO_RPM_KICK_TIME   "ZeroRPMKickTime"
+#define CFGFILE_KEY_NAME_AMDGPU_SLEW_RATE_UP         "SlewRateUp"
+#define CFGFILE_KEY_NAME_AMDGPU_SLEW_RATE_DOWN       "SlewRateDown"
+#define CFGFILE_KEY_NAME_AMDGPU_SLEW_CRIT_UNLIMITED  "SlewCriticalUnlimited"
+#define CFGFILE_KEY_NAME_AMDGPU_PATH_STATE           "PathState"
+#define CFGFILE_KEY_NAME_AMDGPU_STATE_MAX_AGE        "StateMaxAge"
+
+#define CFGFILE_VALUE_HINT_DEVICE_DEFAULT            "card0"
+
+#define CFGFILE_KEY_NAME_PROFILE_NAME                "Name"
+#define CFGFILE_KEY_NAME_PROFILE_RULE_BUSY           "RuleBusy"
+#define CFGFILE_KEY_NAME_PROFILE_RULE_BUSY_TIME      "RuleBusyTime"
+#define CFGFILE_KEY_NAME_PROFILE_RULE_POWER_PROFILE  "RulePowerProfile"
+#define CFGFILE_KEY_NAME_PROFILE_RULE_HINT           "RuleHint"
+
+#define CFGFILE_KEY_NAME_IDENTIFY_SETPOINT           "Setpoint"
+#define CFGFILE_KEY_NAME_IDENTIFY_HYSTERESIS         "Hysteresis"
+#define CFGFILE_KEY_NAME_IDENTIFY_FANSPEED_LOW       "FanSpeedLow"
+#define CFGFILE_KEY_NAME_IDENTIFY_FANSPEED_HIGH      "FanSpeedHigh"
+#define CFGFILE_KEY_NAME_IDENTIFY_CYCLES             "Cycles"
+#define CFGFILE_KEY_NAME_IDENTIFY_SAMPLE_TIME        "SampleTime"
+#define CFGFILE_KEY_NAME_IDENTIFY_SAFETY_TEMP        "SafetyTemp"
+#define CFGFILE_KEY_NAME_IDENTIFY_MAX_DURATION       "MaxDuration"
+
+#define CFGFILE_KEY_NAME_IDENTIFIED_GAIN             "ThermalGain"
+#define CFGFILE_KEY_NAME_IDENTIFIED_TIME_CONSTANT    "TimeConstant"
+#define CFGFILE_KEY_NAME_IDENTIFIED_DEAD_TIME        "DeadTime"
+#define CFGFILE_KEY_NAME_IDENTIFIED_ULTIMATE_GAIN    "UltimateGain"
+#define CFGFILE_KEY_NAME_IDENTIFIED_ULTIMATE_PERIOD  "UltimatePeriod"
+#define CFGFILE_KEY_NAME_IDENTIFIED_NOISE            "SensorNoise"
+#define CFGFILE_KEY_NAME_IDENTIFIED_CURVE_SLOPE      "CurveSlope"
+
+#define CFGFILE_KEY_NAME_CALIBRATE_STEP              "Step"
+#define CFGFILE_KEY_NAME_CALIBRATE_SAMPLE_TIME       "SampleTime"
+#define CFGFILE_KEY_NAME_CALIBRATE_SETTLE_TOLERANCE  "SettleTolerance"
+#define CFGFILE_KEY_NAME_CALIBRATE_SETTLE_TIME       "SettleTime"
+#define CFGFILE_KEY_NAME_CALIBRATE_SAFETY_TEMP       "SafetyTemp"
+
+#define CFGFILE_KEY_NAME_CALIBRATION_MIN_START       "MinStartPWM"
+#define CFGFILE_KEY_NAME_CALIBRATION_MIN_SUSTAIN     "MinSustainPWM"
+#define CFGFILE_KEY_NAME_CALIBRATION_POINT           "Point" /* Followed by the number, e.g. Point1 */
+
+#define CFGFILE_BACKUP_SUFFIX                        ".bak" /* Followed by the number, if it exists already, e.g. .bak.1 */
+#define CFGFILE_BACKUP_MAX                           100
+#define CFGFILE_CACHE_SUFFIX                         ".cache"
+
+#define CFGFILE_VALUE_FILTER_NONE                    "none"
+#define CFGFILE_VALUE_FILTER_EMA                     "ema"
+#define CFGFILE_VALUE_FILTER_MEDIAN                  "median"
+
+#define CFGFILE_VALUE_CONTROL_MODE_CURVE             "curve"
+#define CFGFILE_VALUE_CONTROL_MODE_PID               "pid"
+#define CFGFILE_VALUE_CONTROL_MODE_MPC               "mpc"
+
+#define CFGFILE_VALUE_SENSOR_REDUCER_MAX             "max"
+#define CFGFILE_VALUE_SENSOR_REDUCER_MEAN            "mean"
+
+#define CFGFILE_VALUE_CURVE_INTERPOLATION_LINEAR     "linear"
+#define CFGFILE_VALUE_CURVE_INTERPOLATION_SPLINE     "spline"
+
+#define CFGFILE_VALUE_FAN_MODE_PWM                   "pwm"
+#define CFGFILE_VALUE_FAN_MODE_RPM                   "rpm"
 
 #define STRINGIFY(x) STRINGIFY_DETAIL(x)
 #define STRINGIFY_DETAIL(x) #x
@@ -23,16 +161,67 @@
 
 enum
 {
+  CFG_DEFAULT_CRITICAL_TICK_TIME=5,   /* 0.5 seconds */
+  CFG_DEFAULT_CRITICAL_COOLDOWN=100,  /* 10 seconds */
+  CFG_DEFAULT_MPC_HORIZON=10,
+  CFG_DEFAULT_MPC_FORGETTING=990,
+  CFG_DEFAULT_FEEDFORWARD_DECAY=200,  /* 20 seconds */
+  CFG_DEFAULT_THROTTLE_CLOCK=90,      /* Percent of the highest clock level */
+  CFG_DEFAULT_THROTTLE_BUSY=80,       /* Percent GPU load */
+  CFG_DEFAULT_THROTTLE_BIAS_STEP=10,  /* PWM per update interval */
+  CFG_DEFAULT_POWER_CAP_STEP=10,      /* W per update interval */
+  CFG_DEFAULT_POWER_CAP_HYSTERESIS=30,/* 3°C */
+  CFG_DEFAULT_POWER_CAP_BOOST_FAN=80, /* Percent */
+  CFG_DEFAULT_PROFILE_FADE=5,         /* Update intervals */
+  CFG_DEFAULT_PROFILE_BUSY_TIME=100,  /* 10 seconds */
+  CFG_DEFAULT_HINT_GAIN=50,           /* 1/100 PWM per W */
+  CFG_DEFAULT_HINT_MAX_TTL=300,       /* 5 minutes */
+  CFG_DEFAULT_SENSOR_WEIGHT=100,      /* Percent */
+  CFG_DEFAULT_FAN_RPM_GAIN=10,        /* 1/1000 PWM per RPM error and step */
+  CFG_DEFAULT_FAN_RPM_STEPS=4,        /* Inner loop steps per update interval */
+  CFG_DEFAULT_STALL_TIME=50,          /* 5 seconds */
+  CFG_DEFAULT_STALL_KICK_TIME=30,     /* 3 seconds */
+  CFG_DEFAULT_ZERO_RPM_MIN_ON=600,    /* 60 seconds */
+  CFG_DEFAULT_ZERO_RPM_MIN_OFF=300,   /* 30 seconds */
+  CFG_DEFAULT_ZERO_RPM_KICK_TIME=20,  /* 2 seconds */
+  CFG_DEFAULT_STATE_MAX_AGE=300,      /* 5 minutes */
+
+  CFG_DEFAULT_IDENTIFY_HYSTERESIS=10,   /* 1°C */
+  CFG_DEFAULT_IDENTIFY_CYCLES=4,
+  CFG_DEFAULT_IDENTIFY_SAMPLE_TIME=5,   /* 0.5 seconds */
+  CFG_DEFAULT_IDENTIFY_MAX_DURATION=1800, /* 30 minutes */
+
+  CFG_DEFAULT_CALIBRATE_STEP=16,          /* PWM */
+  CFG_DEFAULT_CALIBRATE_SAMPLE_TIME=10,   /* 1 second */
+  CFG_DEFAULT_CALIBRATE_SETTLE_TOLERANCE=30, /* RPM */
+  CFG_DEFAULT_CALIBRATE_SETTLE_TIME=150,  /* 15 seconds */
+
+  CFG_CACHE_MAGIC=0x43434346,             /* "FCCC" */
+  CFG_CACHE_VERSION=2,
+
   MAX_SENSORS_COUNT=10,
   MAX_TEMPERATURES_COUNT=32,
 
   CLI_OPTION_FLAG_PRINT_HELP=0x1,
   CLI_OPTION_FLAG_PRINT_VERSION=0x2,
   CLI_OPTION_FLAG_DEBUG=0x4,
+  CLI_OPTION_FLAG_IDENTIFY=0x8,
+  CLI_OPTION_FLAG_CALIBRATE=0x10,
+  CLI_OPTION_FLAG_EXPORT_STATIC=0x20,
 
   CLI_CMD_INDEX_HELP=0,
   CLI_CMD_INDEX_VERSION,
-  CLI_CMD_INDEX_DEBUG
+  CLI_CMD_INDEX_DEBUG,
+  CLI_CMD_INDEX_IDENTIFY,
+  CLI_CMD_INDEX_CALIBRATE,
+  CLI_CMD_INDEX_EXPORT_STATIC,
+
+  /* Types of the fields exported to the header of the static build */
+  STATIC_FIELD_UNSIGNED=0,  /* unsigned char/short/int */
+  STATIC_FIELD_INT,
+  STATIC_FIELD_STRING,
+  STATIC_FIELD_TEMPS,       /* Curve pointer, refers to the points exported before */
+  STATIC_FIELD_STRUCT,      /* Struct or array of structs, see ptagSub */
 };
 
 typedef struct
@@ -41,10 +230,80 @@ typedef struct
   const char *pcAlias;
 }TagCLICommands;
 
+/**
+ * Complete configuration read from the config file.
+ * The device references it (paths, profile names), so it must stay valid while the device uses it.
+ */
+typedef struct
+{
+  TagCfg_AMDGPU tagConfig;
+  TagCfg_Sensor tagaSensors[MAX_SENSORS_COUNT];
+  TagCfg_Temperatures tagaSensorTemps[MAX_SENSORS_COUNT][MAX_TEMPERATURES_COUNT];
+  TagCfg_Temperatures tagaTemps[MAX_TEMPERATURES_COUNT];
+  TagCfg_Profile tagaProfiles[FANCTRL_MAX_PROFILES];
+  TagCfg_Temperatures tagaProfileTemps[FANCTRL_MAX_PROFILES][MAX_TEMPERATURES_COUNT];
+  unsigned int uiSensorsCount;
+  unsigned int uiTemperaturesCount;
+  unsigned int uiProfilesCount;
+  unsigned int uiUpdateTime;
+  TagCfg_Hysteresis tagHysteresis;
+}TagCfgSet;
+
+/**
+ * Identifies the content of the config file, the cache is valid only for the same content.
+ */
+typedef struct
+{
+  long long llMtimeSec;
+  long long llMtimeNsec;
+  long long llSize;
+  unsigned int uiHash;        /* FNV-1a over the file */
+  unsigned int uiReserved;
+}TagCfgSource;
+
+/**
+ * Binary cache of the parsed configuration, stored next to the config file (<config file>.cache) and mapped on start.
+ * It is written after the configuration was accepted by fanCtrl_AMDGPU_Init()/fanCtrl_AMDGPU_Reload().
+ * The curve pointers of the set are meaningless in the file, they are set after mapping.
+ */
+typedef struct
+{
+  unsigned int uiMagic;
+  unsigned int uiVersion;
+  unsigned int uiSize;
+  unsigned int uiChecksum;    /* FNV-1a over tagSet */
+  TagCfgSource tagSource;
+  TagCfgSet tagSet;
+}TagCfgCache;
+
+/**
+ * Field of a configuration struct, exported to the header of the static build (--export-static).
+ * Every nonzero byte of an exported struct must be covered by a field, so a new config field can't get lost.
+ */
+typedef struct TagStaticField_t
+{
+  const char *pcName;
+  unsigned int uiOffset;
+  unsigned int uiSize;
+  unsigned int uiType;                      /* STATIC_FIELD_ */
+  const struct TagStaticField_t *ptagSub;   /* STATIC_FIELD_STRUCT: Fields of the struct */
+  unsigned int uiSubCount;
+  unsigned int uiElements;                  /* STATIC_FIELD_STRUCT: Array size, 1 for a single struct */
+}TagStaticField;
+
+#define STATIC_FIELD(type,name,fieldtype)  {#name,offsetof(type,name),sizeof(((type*)0)->name),fieldtype,NULL,0,1}
+#define STATIC_FIELD_SUB(type,name,sub)    {#name,offsetof(type,name),sizeof(((type*)0)->name),STATIC_FIELD_STRUCT, \
+                                            sub,sizeof(sub)/sizeof(sub[0]),1}
+#define STATIC_FIELD_ARRAY(type,name,sub)  {#name,offsetof(type,name),sizeof(((type*)0)->name),STATIC_FIELD_STRUCT, \
+                                            sub,sizeof(sub)/sizeof(sub[0]),sizeof(((type*)0)->name)/sizeof(((type*)0)->name[0])}
+
 static const TagCLICommands tagaCLICommands_m[]={
   {"--help",    "-h"},
   {"--version", "-v"},
   {"--debug",   "-d"},
+  {"--identify","-i"},
+  {"--calibrate","-c"},
+  {"--export-static","-s"},
 };
 
 int iCleanupFanControl(int iRc);
@@ -55,16 +314,234 @@ static void vCLIPrintWrongArgs(const char *pcArg);
 
 static int iParseCLI_m(int argc,
                        char *argv[],
-                       unsigned int *puiOptions);
+                       unsigned int *puiOptions,
+                       const char **ppcExportPath);
+
+static int iFanCtrl_ParseSensorFilter_m(const char *pcValue,
+                                        TagCfg_Sensor *ptagSensor);
+
+static int iFanCtrl_ReadOptionalUShort_m(Inifile tagFile,
+                                         const char *pcKey,
+                                         unsigned short *pusValue);
+
+static int iFanCtrl_ReadOptionalString_m(Inifile tagFile,
+                                         const char *pcKey,
+                                         char *pcBuffer,
+                                         unsigned int uiBufSize);
 
 static int iFanCtrl_ReadCfgFile(const char *pcFilePath,
                                 unsigned int *puiUpdateDelayTime,
-                                unsigned char *pucChangeHysteresis,
+                                TagCfg_Hysteresis *ptagHysteresis,
                                 TagCfg_AMDGPU *ptagAMDGPU,
                                 TagCfg_Sensor tagaSensors[MAX_SENSORS_COUNT],
+                                TagCfg_Temperatures tagaSensorTemps[MAX_SENSORS_COUNT][MAX_TEMPERATURES_COUNT],
                                 TagCfg_Temperatures tagaTemps[MAX_TEMPERATURES_COUNT],
+                                TagCfg_Profile tagaProfiles[FANCTRL_MAX_PROFILES],
+                                TagCfg_Temperatures tagaProfileTemps[FANCTRL_MAX_PROFILES][MAX_TEMPERATURES_COUNT],
                                 unsigned int *puiSensorsCount,
-                                unsigned int *puiTempsCount);
+                                unsigned int *puiTempsCount,
+                                unsigned int *puiProfilesCount);
+
+static int iFanCtrl_ReadCfgSet_m(const char *pcFilePath,
+                                 TagCfgSet *ptagSet);
+
+static int iFanCtrl_CfgSetEqual_m(const TagCfgSet *ptagA,
+                                  const TagCfgSet *ptagB);
+
+static unsigned int uiFanCtrl_Hash_m(const void *pData,
+                                     size_t sizeData,
+                                     unsigned int uiHash);
+
+static int iFanCtrl_GetCfgSource_m(const char *pcFilePath,
+                                   TagCfgSource *ptagSource);
+
+static TagCfgSet *ptagFanCtrl_MapCfgCache_m(const char *pcFilePath,
+                                           const TagCfgSource *ptagSource);
+
+static void vFanCtrl_WriteCfgCache_m(const char *pcFilePath,
+                                     const TagCfgSource *ptagSource,
+                                     const TagCfgSet *ptagSet);
+
+static void vFanCtrl_WatchCfgFile_m(const char *pcFilePath);
+
+static int iFanCtrl_CfgFileChanged_m(void);
+
+static int iFanCtrl_ReloadHook_m(TagFanCtrl *ptagFanCtrl);
+
+static int iFanCtrl_ReadTempPoints_m(Inifile tagFile,
+                                     const char *pcSection,
+                                     TagCfg_Temperatures tagaTemps[MAX_TEMPERATURES_COUNT],
+                                     unsigned int *puiTempsCount);
+
+static int iFanCtrl_ReadProfiles_m(Inifile tagFile,
+                                   TagCfg_Profile tagaProfiles[FANCTRL_MAX_PROFILES],
+                                   TagCfg_Temperatures tagaProfileTemps[FANCTRL_MAX_PROFILES][MAX_TEMPERATURES_COUNT],
+                                   unsigned int *puiProfilesCount);
+
+static int iFanCtrl_ReadSensorCurves_m(Inifile tagFile,
+                                       TagCfg_Sensor tagaSensors[MAX_SENSORS_COUNT],
+                                       TagCfg_Temperatures tagaSensorTemps[MAX_SENSORS_COUNT][MAX_TEMPERATURES_COUNT],
+                                       unsigned int uiSensorsCount);
+
+static int iFanCtrl_ReadIdentifyCfg_m(const char *pcFilePath,
+                                      const TagCfg_AMDGPU *ptagAMDGPU,
+                                      const TagCfg_Temperatures *ptagTemps,
+                                      unsigned int uiTempsCount,
+                                      TagCfg_Identify *ptagIdentify);
+
+static int iFanCtrl_WriteIdentified_m(const char *pcFilePath,
+                                      const TagFanCtrl_Identified *ptagResult);
+
+static int iFanCtrl_ReadCalibration_m(Inifile tagFile,
+                                      TagCfg_Calibration *ptagCalibration);
+
+static int iFanCtrl_ReadCalibrateCfg_m(const char *pcFilePath,
+                                       const TagCfg_AMDGPU *ptagAMDGPU,
+                                       const TagCfg_Temperatures *ptagTemps,
+                                       unsigned int uiTempsCount,
+                                       TagCfg_Calibrate *ptagCalibrate);
+
+static int iFanCtrl_WriteCalibration_m(const char *pcFilePath,
+                                       const TagCfg_Calibration *ptagResult);
+
+static int iFanCtrl_BackupFile_m(const char *pcFilePath,
+                                 char *pcBackupPath,
+                                 size_t szBackupPathSize);
+
+static int iFanCtrl_CopyFile_m(const char *pcSrcPath,
+                               const char *pcDstPath);
+
+static int iFanCtrl_ExportStatic_m(const char *pcFilePath,
+                                   const char *pcHeaderPath);
+
+static int iFanCtrl_WriteStaticCfg_m(FILE *fp,
+                                     const char *pcFilePath,
+                                     const TagCfgSet *ptagSet);
+
+static int iFanCtrl_WriteStaticStruct_m(FILE *fp,
+                                        const unsigned char *pucStruct,
+                                        unsigned int uiSize,
+                                        const TagStaticField *ptagFields,
+                                        unsigned int uiFieldsCount,
+                                        const char *pcTemps,
+                                        const char *pcIndent);
+
+static void vFanCtrl_WriteStaticString_m(FILE *fp,
+                                         const char *pcString);
+
+static const TagStaticField tagaStaticFields_Temperatures_m[]={
+  STATIC_FIELD(TagCfg_Temperatures,iTemp,STATIC_FIELD_INT),
+  STATIC_FIELD(TagCfg_Temperatures,ucFanSpeedPercent,STATIC_FIELD_UNSIGNED),
+};
+
+static const TagStaticField tagaStaticFields_Hysteresis_m[]={
+  STATIC_FIELD(TagCfg_Hysteresis,usRisingDeadband,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_Hysteresis,usFallingDeadband,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_Hysteresis,usMinDwellTime,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_Hysteresis,usRisingSlopeBypass,STATIC_FIELD_UNSIGNED),
+};
+
+static const TagStaticField tagaStaticFields_Sensor_m[]={
+  STATIC_FIELD(TagCfg_Sensor,caSensorReadPath,STATIC_FIELD_STRING),
+  STATIC_FIELD(TagCfg_Sensor,ucFilterType,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_Sensor,ucFilterParam,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_Sensor,usFilterStepBypass,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_Sensor,ucOversampling,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_Sensor,ucWeight,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_Sensor,ptagTemps,STATIC_FIELD_TEMPS),
+  STATIC_FIELD(TagCfg_Sensor,uiTempsCount,STATIC_FIELD_UNSIGNED),
+};
+
+static const TagStaticField tagaStaticFields_Profile_m[]={
+  STATIC_FIELD(TagCfg_Profile,caName,STATIC_FIELD_STRING),
+  STATIC_FIELD(TagCfg_Profile,ptagTemps,STATIC_FIELD_TEMPS),
+  STATIC_FIELD(TagCfg_Profile,uiTempsCount,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_Profile,usRuleBusy,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_Profile,usRuleBusyTime,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_Profile,caRulePowerProfile,STATIC_FIELD_STRING),
+  STATIC_FIELD(TagCfg_Profile,caRuleHint,STATIC_FIELD_STRING),
+};
+
+static const TagStaticField tagaStaticFields_CalibrationPoint_m[]={
+  STATIC_FIELD(TagCfg_CalibrationPoint,ucPWM,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_CalibrationPoint,usRPM,STATIC_FIELD_UNSIGNED),
+};
+
+static const TagStaticField tagaStaticFields_Calibration_m[]={
+  STATIC_FIELD(TagCfg_Calibration,ucMinStartPWM,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_Calibration,ucMinSustainPWM,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_Calibration,ucPointsCount,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD_ARRAY(TagCfg_Calibration,tagaPoints,tagaStaticFields_CalibrationPoint_m),
+};
+
+static const TagStaticField tagaStaticFields_AMDGPU_m[]={
+  STATIC_FIELD(TagCfg_AMDGPU,caPathSetFanCtrlMode,STATIC_FIELD_STRING),
+  STATIC_FIELD(TagCfg_AMDGPU,caPathEnableFan,STATIC_FIELD_STRING),
+  STATIC_FIELD(TagCfg_AMDGPU,caPathSetPWM,STATIC_FIELD_STRING),
+  STATIC_FIELD(TagCfg_AMDGPU,usCriticalTemp,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usEmergencyTemp,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,ucCriticalFromSensors,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usCriticalTickTime,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usCriticalCooldown,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,ucControlMode,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usPIDSetpoint,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usPIDKp,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usPIDKi,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usPIDKd,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,caPathPowerRead,STATIC_FIELD_STRING),
+  STATIC_FIELD(TagCfg_AMDGPU,usMPCTarget,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usMPCHorizon,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usMPCForgetting,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,caPathBusyRead,STATIC_FIELD_STRING),
+  STATIC_FIELD(TagCfg_AMDGPU,usFeedForwardPower,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usFeedForwardBusy,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usFeedForwardDecay,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,caPathClockRead,STATIC_FIELD_STRING),
+  STATIC_FIELD(TagCfg_AMDGPU,usThrottleTemp,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usThrottleClock,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usThrottleBusy,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usThrottleBiasStep,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,caPathPowerCap,STATIC_FIELD_STRING),
+  STATIC_FIELD(TagCfg_AMDGPU,usPowerCapTemp,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usPowerCapMin,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usPowerCapStep,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usPowerCapHysteresis,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usPowerCapBoostTemp,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usPowerCapBoostFanSpeed,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usPowerCapMax,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,caPathPowerProfile,STATIC_FIELD_STRING),
+  STATIC_FIELD(TagCfg_AMDGPU,caPathProfileHint,STATIC_FIELD_STRING),
+  STATIC_FIELD(TagCfg_AMDGPU,usProfileFade,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,caPathHintSocket,STATIC_FIELD_STRING),
+  STATIC_FIELD(TagCfg_AMDGPU,caHintDevice,STATIC_FIELD_STRING),
+  STATIC_FIELD(TagCfg_AMDGPU,usHintGain,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usHintMaxTTL,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usHintSocketMode,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,caHintSocketGroup,STATIC_FIELD_STRING),
+  STATIC_FIELD(TagCfg_AMDGPU,ucSensorReducer,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,ucCurveInterpolation,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,ucFanMode,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,caPathFanTarget,STATIC_FIELD_STRING),
+  STATIC_FIELD(TagCfg_AMDGPU,caPathFanInput,STATIC_FIELD_STRING),
+  STATIC_FIELD(TagCfg_AMDGPU,usFanRPMMax,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usFanRPMGain,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,ucFanRPMSubTicks,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usStallFanSpeed,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usStallTime,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usStallKickTime,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usStallPowerCap,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usZeroRPMStartTemp,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usZeroRPMStopTemp,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usZeroRPMMinOnTime,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usZeroRPMMinOffTime,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usZeroRPMKickTime,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usSlewRateUp,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,usSlewRateDown,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,ucSlewCriticalUnlimited,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD(TagCfg_AMDGPU,caPathState,STATIC_FIELD_STRING),
+  STATIC_FIELD(TagCfg_AMDGPU,usStateMaxAge,STATIC_FIELD_UNSIGNED),
+  STATIC_FIELD_SUB(TagCfg_AMDGPU,tagCalibration,tagaStaticFields_Calibration_m),
+};
 
 static const char *pcaCFGKeys_AMDGPU_Sensors_m[]={"PathSensorRead1",
                                                   "PathSensorRead2",
@@ -77,6 +554,39 @@ static const char *pcaCFGKeys_AMDGPU_Sensors_m[]={"PathSensorRead1",
                                                   "PathSensorRead9",
                                                   "PathSensorRead10"};
 
+static const char *pcaCFGKeys_AMDGPU_SensorFilters_m[]={"SensorFilter1",
+                                                        "SensorFilter2",
+                                                        "SensorFilter3",
+                                                        "SensorFilter4",
+                                                        "SensorFilter5",
+                                                        "SensorFilter6",
+                                                        "SensorFilter7",
+                                                        "SensorFilter8",
+                                                        "SensorFilter9",
+                                                        "SensorFilter10"};
+
+static const char *pcaCFGKeys_AMDGPU_SensorOversampling_m[]={"SensorOversampling1",
+                                                             "SensorOversampling2",
+                                                             "SensorOversampling3",
+                                                             "SensorOversampling4",
+                                                             "SensorOversampling5",
+                                                             "SensorOversampling6",
+                                                             "SensorOversampling7",
+                                                             "SensorOversampling8",
+                                                             "SensorOversampling9",
+                                                             "SensorOversampling10"};
+
+static const char *pcaCFGKeys_AMDGPU_SensorWeights_m[]={"SensorWeight1",
+                                                        "SensorWeight2",
+                                                        "SensorWeight3",
+                                                        "SensorWeight4",
+                                                        "SensorWeight5",
+                                                        "SensorWeight6",
+                                                        "SensorWeight7",
+                                                        "SensorWeight8",
+                                                        "SensorWeight9",
+                                                        "SensorWeight10"};
+
 static const char *pcaCFGKeys_AMDGPU_Temps_m[]={"FanSpeed1",
                                                 "FanSpeed2",
                                                 "FanSpeed3",
@@ -113,22 +623,47 @@ static const char *pcaCFGKeys_AMDGPU_Temps_m[]={"FanSpeed1",
 unsigned int uiExitFanCtrlFlag_m;
 static TagFanCtrl *ptagFanCtrl_m;
 
+/* Live reload: The running configuration and a spare one, which the new configuration is read into.
+ * At start, the running one may be the mapped cache instead */
+static TagCfgSet tagaCfgSets_m[2];
+static TagCfgSet *ptagaCfgSets_m[2]={&tagaCfgSets_m[0],&tagaCfgSets_m[1]};
+static unsigned int uiCfgSetActive_m;
+static TagCfgSource tagCfgSource_m;    /* Of the running configuration */
+static TagCfgCache *ptagCfgCache_m;    /* NULL if not mapped */
+static const char *pcCfgFilePath_m;
+static const char *pcCfgFileName_m;
+static int iCfgFileWatch_m=-1;         /* inotify, -1 if not used */
+static volatile sig_atomic_t iReloadRequested_m;
+
+/* Runtime memory: The library objects in one arena, sized at init (see fanCtrl_SetStorage()), and the stdout buffer */
+static void *pvArena_m;
+static char caStdoutBuffer_m[BUFSIZ];
+
 int main(int argc, char *argv[])
 {
 
-  TagCfg_AMDGPU tagConfig;
-  TagCfg_Sensor tagaSensors[MAX_SENSORS_COUNT];
-  TagCfg_Temperatures tagaTemps[MAX_TEMPERATURES_COUNT];
-  unsigned int uiSensorsCount;
-  unsigned int uiTemperaturesCount;
-  unsigned int uiUpdateTime;
-  unsigned char ucChangeHysteresis;
+  TagCfgSet *ptagCfg;
+  int iCfgParsed=0;
+  TagCfg_Identify tagIdentify;
+  TagFanCtrl_Identified tagIdentified;
+  TagCfg_Calibrate tagCalibrate;
+  TagCfg_Calibration tagCalibrated;
   unsigned int uiCLIOptions;
   unsigned int uiCreateFlags=0;
+  const char *pcExportPath;
+  size_t szArena;
+  int iRc;
+
+  /* Otherwise stdio allocates the buffer with the first output, which may be the statistics in the steady state */
+  setvbuf(stdout,
+          caStdoutBuffer_m,
+          (isatty(STDOUT_FILENO))?_IOLBF:_IOFBF,
+          sizeof(caStdoutBuffer_m));
 
   if(iParseCLI_m(argc,
                  argv,
-                 &uiCLIOptions))
+                 &uiCLIOptions,
+                 &pcExportPath))
   {
     vCLIPrintWrongArgs((argc > 1)?argv[1]:NULL);
     return(EXIT_FAILURE);
@@ -149,27 +684,81 @@ int main(int argc, char *argv[])
   }
   if(uiCLIOptions & CLI_OPTION_FLAG_DEBUG)
     uiCreateFlags|=CREATE_FLAG_DEBUG;
+  if(uiCLIOptions & CLI_OPTION_FLAG_EXPORT_STATIC)
+    return((iFanCtrl_ExportStatic_m(argv[1],pcExportPath))?EXIT_FAILURE:EXIT_SUCCESS);
 
-  if(iFanCtrl_ReadCfgFile(argv[1],
-                          &uiUpdateTime,
-                          &ucChangeHysteresis,
-                          &tagConfig,
-                          tagaSensors,
-                          tagaTemps,
-                          &uiSensorsCount,
-                          &uiTemperaturesCount))
+  /* The config file is parsed only if it changed since the cache was written */
+  uiCfgSetActive_m=0;
+  if(iFanCtrl_GetCfgSource_m(argv[1],&tagCfgSource_m))
+    return(EXIT_FAILURE);
+  if(!(ptagCfg=ptagFanCtrl_MapCfgCache_m(argv[1],&tagCfgSource_m)))
   {
-    ERR_PUTS("iFanCtrl_ReadCfgFile() failed");
+    ptagCfg=&tagaCfgSets_m[0];
+    if(iFanCtrl_ReadCfgSet_m(argv[1],ptagCfg))
+    {
+      ERR_PUTS("iFanCtrl_ReadCfgFile() failed");
+      return(EXIT_FAILURE);
+    }
+    iCfgParsed=1;
+  }
+  ptagaCfgSets_m[0]=ptagCfg;
+  if((uiCLIOptions & CLI_OPTION_FLAG_IDENTIFY) &&
+     (iFanCtrl_ReadIdentifyCfg_m(argv[1],
+                                 &ptagCfg->tagConfig,
+                                 ptagCfg->tagaTemps,
+                                 ptagCfg->uiTemperaturesCount,
+                                 &tagIdentify)))
+  {
+    ERR_PUTS("iFanCtrl_ReadIdentifyCfg_m() failed");
+    return(EXIT_FAILURE);
+  }
+  if((uiCLIOptions & CLI_OPTION_FLAG_CALIBRATE) &&
+     (iFanCtrl_ReadCalibrateCfg_m(argv[1],
+                                  &ptagCfg->tagConfig,
+                                  ptagCfg->tagaTemps,
+                                  ptagCfg->uiTemperaturesCount,
+                                  &tagCalibrate)))
+  {
+    ERR_PUTS("iFanCtrl_ReadCalibrateCfg_m() failed");
+    return(EXIT_FAILURE);
+  }
+
+  /* The arena is sized for the verified configuration, Init verifies it again along with the device */
+  if(fanCtrl_AMDGPU_Verify(ptagCfg->uiUpdateTime,
+                           &ptagCfg->tagHysteresis,
+                           &ptagCfg->tagConfig,
+                           ptagCfg->tagaSensors,
+                           ptagCfg->uiSensorsCount,
+                           ptagCfg->tagaTemps,
+                           ptagCfg->uiTemperaturesCount,
+                           ptagCfg->tagaProfiles,
+                           ptagCfg->uiProfilesCount))
+  {
+    ERR_PUTS("fanCtrl_AMDGPU_Verify() failed");
+    return(EXIT_FAILURE);
+  }
+  szArena=fanCtrl_AMDGPU_StorageSize(ptagCfg->tagaSensors,
+                                     ptagCfg->uiSensorsCount,
+                                     ptagCfg->tagaTemps,
+                                     ptagCfg->uiTemperaturesCount,
+                                     ptagCfg->tagaProfiles,
+                                     ptagCfg->uiProfilesCount);
+  if(!(pvArena_m=malloc(szArena)))
+  {
+    ERR_PUTS("Out of memory");
     return(EXIT_FAILURE);
   }
+  fanCtrl_SetStorage(pvArena_m,szArena);
 
   uiExitFanCtrlFlag_m=0;
 
   signal(SIGINT,vSignalHandler);   /* On CTRL+C */
   signal(SIGTERM,vSignalHandler);  /* On exit using kill (SIGTERM) command */
+  signal(SIGUSR1,vSignalHandler);  /* Print statistics */
+  signal(SIGHUP,vSignalHandler);   /* Reload the config file */
 
-  if(!(ptagFanCtrl_m=fanCtrl_Create(uiUpdateTime,
-                                    ucChangeHysteresis,
+  if(!(ptagFanCtrl_m=fanCtrl_Create(ptagCfg->uiUpdateTime,
+                                    &ptagCfg->tagHysteresis,
                                     &uiExitFanCtrlFlag_m,
                                     uiCreateFlags)))
   {
@@ -178,16 +767,52 @@ int main(int argc, char *argv[])
   }
 
   if(fanCtrl_AMDGPU_Init(ptagFanCtrl_m,
-                         &tagConfig,
-                         tagaSensors,
-                         uiSensorsCount,
-                         tagaTemps,
-                         uiTemperaturesCount))
+                         &ptagCfg->tagConfig,
+                         ptagCfg->tagaSensors,
+                         ptagCfg->uiSensorsCount,
+                         ptagCfg->tagaTemps,
+                         ptagCfg->uiTemperaturesCount,
+                         ptagCfg->tagaProfiles,
+                         ptagCfg->uiProfilesCount))
   {
     ERR_PUTS("fanCtrl_AMDGPU_Init() failed");
     fanCtrl_Destroy(ptagFanCtrl_m);
     return(EXIT_FAILURE);
   }
+  if(iCfgParsed)
+    vFanCtrl_WriteCfgCache_m(argv[1],&tagCfgSource_m,ptagCfg);
+
+  if(uiCLIOptions & CLI_OPTION_FLAG_IDENTIFY)
+  {
+    if(((iRc=fanCtrl_Identify(ptagFanCtrl_m,
+                              &tagIdentify,
+                              &tagIdentified)) == RUN_RET_OK) &&
+       (iFanCtrl_WriteIdentified_m(argv[1],
+                                   &tagIdentified)))
+    {
+      ERR_PUTS("iFanCtrl_WriteIdentified_m() failed");
+      iRc=RUN_RET_ERR_IDENTIFY_FAILED;
+    }
+    return(iCleanupFanControl(iRc));
+  }
+  if(uiCLIOptions & CLI_OPTION_FLAG_CALIBRATE)
+  {
+    if(((iRc=fanCtrl_Calibrate(ptagFanCtrl_m,
+                               &tagCalibrate,
+                               &tagCalibrated)) == RUN_RET_OK) &&
+       (iFanCtrl_WriteCalibration_m(argv[1],
+                                    &tagCalibrated)))
+    {
+      ERR_PUTS("iFanCtrl_WriteCalibration_m() failed");
+      iRc=RUN_RET_ERR_CALIBRATE_FAILED;
+    }
+    return(iCleanupFanControl(iRc));
+  }
+
+  /* Live reload on SIGHUP or when the config file is written */
+  pcCfgFilePath_m=argv[1];
+  vFanCtrl_WatchCfgFile_m(argv[1]);
+  fanCtrl_SetReloadHook(ptagFanCtrl_m,iFanCtrl_ReloadHook_m);
 
   return(iCleanupFanControl(fanCtrl_Run(ptagFanCtrl_m)));
 }
@@ -200,6 +825,13 @@ void vSignalHandler(int iSignum)
     case SIGTERM:
       uiExitFanCtrlFlag_m=1; /* Quits run function loop */
       break;
+    case SIGUSR1:
+      if(ptagFanCtrl_m)
+        fanCtrl_RequestStats(ptagFanCtrl_m);
+      break;
+    case SIGHUP:
+      iReloadRequested_m=1; /* Handled by the reload hook, between two ticks */
+      break;
     default:
       ERR_PRINTF("Unknown signal: %d",iSignum);
       break;
@@ -214,6 +846,7 @@ int iCleanupFanControl(int iRc)
       break;
     case RUN_RET_OK:
     default:
+      fanCtrl_PrintStats(ptagFanCtrl_m,stdout);
       if(fanCtrl_ResetDevices(ptagFanCtrl_m))
       {
         iRc=1;
@@ -221,19 +854,421 @@ int iCleanupFanControl(int iRc)
       }
   }
   fanCtrl_Destroy(ptagFanCtrl_m);
+  free(pvArena_m);
+  if(iCfgFileWatch_m >= 0)
+    close(iCfgFileWatch_m);
+  if(ptagCfgCache_m)
+    munmap(ptagCfgCache_m,sizeof(TagCfgCache));
   return((iRc)?EXIT_FAILURE:EXIT_SUCCESS);
 }
 
+/**
+ * Reads the config file into a configuration set, which is cleared before.
+ * So unused entries are zero and two sets of the same file compare equal.
+ *
+ * @return 0 on success, nonzero on failure.
+ */
+static int iFanCtrl_ReadCfgSet_m(const char *pcFilePath,
+                                 TagCfgSet *ptagSet)
+{
+  memset(ptagSet,0,sizeof(TagCfgSet));
+  return(iFanCtrl_ReadCfgFile(pcFilePath,
+                              &ptagSet->uiUpdateTime,
+                              &ptagSet->tagHysteresis,
+                              &ptagSet->tagConfig,
+                              ptagSet->tagaSensors,
+                              ptagSet->tagaSensorTemps,
+                              ptagSet->tagaTemps,
+                              ptagSet->tagaProfiles,
+                              ptagSet->tagaProfileTemps,
+                              &ptagSet->uiSensorsCount,
+                              &ptagSet->uiTemperaturesCount,
+                              &ptagSet->uiProfilesCount));
+}
+
+/**
+ * Compares two configuration sets. The curve pointers of sensors and profiles point into their own set,
+ * so only whether a curve is set is compared, the points are compared with the arrays.
+ *
+ * @return 1 if equal, 0 otherwise.
+ */
+static int iFanCtrl_CfgSetEqual_m(const TagCfgSet *ptagA,
+                                  const TagCfgSet *ptagB)
+{
+  TagCfg_Sensor tagSensorA;
+  TagCfg_Sensor tagSensorB;
+  TagCfg_Profile tagProfileA;
+  TagCfg_Profile tagProfileB;
+  unsigned int uiIndex;
+
+  if((memcmp(&ptagA->tagConfig,&ptagB->tagConfig,sizeof(ptagA->tagConfig)) != 0) ||
+     (memcmp(ptagA->tagaSensorTemps,ptagB->tagaSensorTemps,sizeof(ptagA->tagaSensorTemps)) != 0) ||
+     (memcmp(ptagA->tagaTemps,ptagB->tagaTemps,sizeof(ptagA->tagaTemps)) != 0) ||
+     (memcmp(ptagA->tagaProfileTemps,ptagB->tagaProfileTemps,sizeof(ptagA->tagaProfileTemps)) != 0) ||
+     (memcmp(&ptagA->tagHysteresis,&ptagB->tagHysteresis,sizeof(ptagA->tagHysteresis)) != 0) ||
+     (ptagA->uiSensorsCount != ptagB->uiSensorsCount) ||
+     (ptagA->uiTemperaturesCount != ptagB->uiTemperaturesCount) ||
+     (ptagA->uiProfilesCount != ptagB->uiProfilesCount) ||
+     (ptagA->uiUpdateTime != ptagB->uiUpdateTime))
+    return(0);
+  for(uiIndex=0;uiIndex < MAX_SENSORS_COUNT;++uiIndex)
+  {
+    memcpy(&tagSensorA,&ptagA->tagaSensors[uiIndex],sizeof(tagSensorA));
+    memcpy(&tagSensorB,&ptagB->tagaSensors[uiIndex],sizeof(tagSensorB));
+    tagSensorA.ptagTemps=(tagSensorA.ptagTemps)?ptagB->tagaSensorTemps[uiIndex]:NULL;
+    if(memcmp(&tagSensorA,&tagSensorB,sizeof(tagSensorA)) != 0)
+      return(0);
+  }
+  for(uiIndex=0;uiIndex < FANCTRL_MAX_PROFILES;++uiIndex)
+  {
+    memcpy(&tagProfileA,&ptagA->tagaProfiles[uiIndex],sizeof(tagProfileA));
+    memcpy(&tagProfileB,&ptagB->tagaProfiles[uiIndex],sizeof(tagProfileB));
+    tagProfileA.ptagTemps=(tagProfileA.ptagTemps)?ptagB->tagaProfileTemps[uiIndex]:NULL;
+    if(memcmp(&tagProfileA,&tagProfileB,sizeof(tagProfileA)) != 0)
+      return(0);
+  }
+  return(1);
+}
+
+/**
+ * FNV-1a hash, continued from uiHash (2166136261U to start).
+ */
+static unsigned int uiFanCtrl_Hash_m(const void *pData,
+                                     size_t sizeData,
+                                     unsigned int uiHash)
+{
+  const unsigned char *pucData=(const unsigned char*)pData;
+  size_t sizeIndex;
+
+  for(sizeIndex=0;sizeIndex < sizeData;++sizeIndex)
+  {
+    uiHash^=pucData[sizeIndex];
+    uiHash*=16777619U;
+  }
+  return(uiHash);
+}
+
+/**
+ * Gets the modification time, size and hash of the config file.
+ *
+ * @return 0 on success, nonzero on failure.
+ */
+static int iFanCtrl_GetCfgSource_m(const char *pcFilePath,
+                                   TagCfgSource *ptagSource)
+{
+  struct stat tagStat;
+  char caBuffer[4096];
+  ssize_t sizeRead;
+  int iFd;
+
+  memset(ptagSource,0,sizeof(TagCfgSource));
+  if((iFd=open(pcFilePath,O_RDONLY | O_CLOEXEC)) < 0)
+  {
+    ERR_PRINTF("Opening config file \"%s\" failed (%d): %s",
+               pcFilePath,
+               errno,
+               strerror(errno));
+    return(1);
+  }
+  if(fstat(iFd,&tagStat) != 0)
+  {
+    ERR_PRINTF("Reading config file \"%s\" failed (%d): %s",
+               pcFilePath,
+               errno,
+               strerror(errno));
+    close(iFd);
+    return(1);
+  }
+  ptagSource->llMtimeSec=tagStat.st_mtim.tv_sec;
+  ptagSource->llMtimeNsec=tagStat.st_mtim.tv_nsec;
+  ptagSource->llSize=tagStat.st_size;
+  ptagSource->uiHash=2166136261U;
+  while((sizeRead=read(iFd,caBuffer,sizeof(caBuffer))) > 0)
+    ptagSource->uiHash=uiFanCtrl_Hash_m(caBuffer,(size_t)sizeRead,ptagSource->uiHash);
+  close(iFd);
+  if(sizeRead < 0)
+  {
+    ERR_PRINTF("Reading config file \"%s\" failed (%d): %s",
+               pcFilePath,
+               errno,
+               strerror(errno));
+    return(1);
+  }
+  return(0);
+}
+
+/**
+ * Maps the cache of the config file, if it is valid for the current content of the config file.
+ * The mapping is private, so the curve pointers are set in memory only and the set may be reused on a reload.
+ *
+ * @return The cached configuration, NULL if there is no valid cache.
+ */
+static TagCfgSet *ptagFanCtrl_MapCfgCache_m(const char *pcFilePath,
+                                           const TagCfgSource *ptagSource)
+{
+  char caPath[PATH_MAX];
+  TagCfgCache *ptagCache;
+  TagCfgSet *ptagSet;
+  struct stat tagStat;
+  unsigned int uiIndex;
+  int iFd;
+
+  if((snprintf(caPath,sizeof(caPath),"%s" CFGFILE_CACHE_SUFFIX,pcFilePath) >= (int)sizeof(caPath)) ||
+     ((iFd=open(caPath,O_RDONLY | O_CLOEXEC)) < 0))
+    return(NULL);
+  if((fstat(iFd,&tagStat) != 0) ||
+     (tagStat.st_size != (off_t)sizeof(TagCfgCache)) ||
+     ((ptagCache=mmap(NULL,sizeof(TagCfgCache),PROT_READ | PROT_WRITE,MAP_PRIVATE,iFd,0)) == MAP_FAILED))
+  {
+    close(iFd);
+    return(NULL);
+  }
+  close(iFd);
+  if((ptagCache->uiMagic != CFG_CACHE_MAGIC) ||
+     (ptagCache->uiVersion != CFG_CACHE_VERSION) ||
+     (ptagCache->uiSize != sizeof(TagCfgCache)) ||
+     (memcmp(&ptagCache->tagSource,ptagSource,sizeof(TagCfgSource)) != 0) ||
+     (ptagCache->uiChecksum != uiFanCtrl_Hash_m(&ptagCache->tagSet,sizeof(TagCfgSet),2166136261U)))
+  {
+    munmap(ptagCache,sizeof(TagCfgCache));
+    return(NULL);
+  }
+
+  ptagSet=&ptagCache->tagSet;
+  for(uiIndex=0;uiIndex < MAX_SENSORS_COUNT;++uiIndex)
+  {
+    if(ptagSet->tagaSensors[uiIndex].ptagTemps)
+      ptagSet->tagaSensors[uiIndex].ptagTemps=ptagSet->tagaSensorTemps[uiIndex];
+  }
+  for(uiIndex=0;uiIndex < FANCTRL_MAX_PROFILES;++uiIndex)
+  {
+    if(ptagSet->tagaProfiles[uiIndex].ptagTemps)
+      ptagSet->tagaProfiles[uiIndex].ptagTemps=ptagSet->tagaProfileTemps[uiIndex];
+  }
+  ptagCfgCache_m=ptagCache;
+  return(ptagSet);
+}
+
+/**
+ * Writes the cache of the config file. A temporary file is renamed, so a started instance never maps a partial cache.
+ * Failing to write the cache is not an error, the config file is parsed on each start then.
+ */
+static void vFanCtrl_WriteCfgCache_m(const char *pcFilePath,
+                                     const TagCfgSource *ptagSource,
+                                     const TagCfgSet *ptagSet)
+{
+  char caPath[PATH_MAX];
+  char caPathTmp[PATH_MAX];
+  TagCfgCache *ptagCache;
+  FILE *fp;
+  int iRc;
+
+  if((snprintf(caPath,sizeof(caPath),"%s" CFGFILE_CACHE_SUFFIX,pcFilePath) >= (int)sizeof(caPath)) ||
+     (snprintf(caPathTmp,sizeof(caPathTmp),"%s" CFGFILE_CACHE_SUFFIX ".tmp",pcFilePath) >= (int)sizeof(caPathTmp)))
+    return;
+  if(!(ptagCache=calloc(1,sizeof(TagCfgCache))))
+  {
+    ERR_PUTS("calloc() failed");
+    return;
+  }
+  ptagCache->uiMagic=CFG_CACHE_MAGIC;
+  ptagCache->uiVersion=CFG_CACHE_VERSION;
+  ptagCache->uiSize=sizeof(TagCfgCache);
+  memcpy(&ptagCache->tagSource,ptagSource,sizeof(TagCfgSource));
+  memcpy(&ptagCache->tagSet,ptagSet,sizeof(TagCfgSet));
+  ptagCache->uiChecksum=uiFanCtrl_Hash_m(&ptagCache->tagSet,sizeof(TagCfgSet),2166136261U);
+
+  iRc=((!(fp=fopen(caPathTmp,"wb"))) ||
+       (fwrite(ptagCache,sizeof(TagCfgCache),1,fp) != 1))?1:0;
+  if(fp)
+    iRc|=fclose(fp);
+  if((iRc) ||
+     (rename(caPathTmp,caPath) != 0))
+  {
+    ERR_PRINTF("Writing config cache \"%s\" failed (%d): %s, the config file is parsed on each start",
+               caPath,
+               errno,
+               strerror(errno));
+    unlink(caPathTmp);
+  }
+  else
+  {
+    printf("fanctrl: Config cache \"%s\" written\n",caPath);
+    fflush(stdout);
+  }
+  free(ptagCache);
+}
+
+/**
+ * Watches the directory of the config file with inotify, editors often replace the file instead of writing it.
+ * On failure, the config file is reloaded on SIGHUP only.
+ */
+static void vFanCtrl_WatchCfgFile_m(const char *pcFilePath)
+{
+  char caDir[PATH_MAX];
+  const char *pcName;
+
+  if((pcName=strrchr(pcFilePath,'/')))
+  {
+    if((size_t)(pcName-pcFilePath) >= sizeof(caDir))
+    {
+      ERR_PRINTF("Path of \"%s\" too long, reload on SIGHUP only",pcFilePath);
+      return;
+    }
+    memcpy(caDir,pcFilePath,(size_t)(pcName-pcFilePath));
+    caDir[pcName-pcFilePath]='\0';
+    if(!caDir[0])
+      strcpy(caDir,"/");
+    ++pcName;
+  }
+  else
+  {
+    strcpy(caDir,".");
+    pcName=pcFilePath;
+  }
+  pcCfgFileName_m=pcName;
+  if(((iCfgFileWatch_m=inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0) ||
+     (inotify_add_watch(iCfgFileWatch_m,caDir,IN_CLOSE_WRITE | IN_MOVED_TO) < 0))
+  {
+    ERR_PRINTF("Watching \"%s\" failed (%d): %s, reload on SIGHUP only",
+               caDir,
+               errno,
+               strerror(errno));
+    if(iCfgFileWatch_m >= 0)
+      close(iCfgFileWatch_m);
+    iCfgFileWatch_m=-1;
+  }
+}
+
+/**
+ * Reads all pending inotify events.
+ *
+ * @return 1 if the config file was written or replaced, 0 otherwise.
+ */
+static int iFanCtrl_CfgFileChanged_m(void)
+{
+  union
+  {
+    struct inotify_event tagEvent; /* Alignment */
+    char caBuf[4096];
+  }uBuf;
+  const struct inotify_event *ptagEvent;
+  ssize_t sizeRead;
+  size_t sizeOffset;
+  int iChanged=0;
+
+  if(iCfgFileWatch_m < 0)
+    return(0);
+  while((sizeRead=read(iCfgFileWatch_m,&uBuf,sizeof(uBuf))) > 0)
+  {
+    for(sizeOffset=0;sizeOffset < (size_t)sizeRead;sizeOffset+=sizeof(struct inotify_event)+ptagEvent->len)
+    {
+      ptagEvent=(const struct inotify_event*)(uBuf.caBuf+sizeOffset);
+      if((ptagEvent->len) &&
+         (strcmp(ptagEvent->name,pcCfgFileName_m) == 0))
+        iChanged=1;
+    }
+  }
+  return(iChanged);
+}
+
+/**
+ * Reload hook of fanCtrl_Run(): On SIGHUP or a changed config file, the file is read into the spare configuration set.
+ * An unchanged configuration is ignored, so the device keeps running untouched, otherwise the device is reloaded
+ * and the spare set becomes the running one. On any failure, the running configuration is kept.
+ *
+ * @return 1 if reloaded, 0 if not, -1 on failure.
+ */
+static int iFanCtrl_ReloadHook_m(TagFanCtrl *ptagFanCtrl)
+{
+  TagCfgSource tagSource;
+  TagCfgSet *ptagSet;
+  int iReload;
+
+  iReload=iFanCtrl_CfgFileChanged_m();
+  if(iReloadRequested_m)
+  {
+    iReloadRequested_m=0;
+    iReload=1;
+  }
+  if(!iReload)
+    return(0);
+
+  /* Same file (time, size and content), nothing to parse */
+  if(iFanCtrl_GetCfgSource_m(pcCfgFilePath_m,&tagSource))
+    return(-1);
+  if(memcmp(&tagSource,&tagCfgSource_m,sizeof(TagCfgSource)) == 0)
+  {
+    printf("fanctrl: Reload: Configuration of \"%s\" unchanged\n",
+           pcCfgFilePath_m);
+    fflush(stdout);
+    return(0);
+  }
+
+  ptagSet=ptagaCfgSets_m[uiCfgSetActive_m^1];
+  if(iFanCtrl_ReadCfgSet_m(pcCfgFilePath_m,ptagSet))
+  {
+    ERR_PUTS("Reload: iFanCtrl_ReadCfgFile() failed, keeping the running configuration");
+    return(-1);
+  }
+  if(iFanCtrl_CfgSetEqual_m(ptagSet,ptagaCfgSets_m[uiCfgSetActive_m]))
+  {
+    tagCfgSource_m=tagSource;
+    printf("fanctrl: Reload: Configuration of \"%s\" unchanged\n",
+           pcCfgFilePath_m);
+    fflush(stdout);
+    return(0);
+  }
+  if(fanCtrl_AMDGPU_Reload(ptagFanCtrl,
+                           ptagSet->uiUpdateTime,
+                           &ptagSet->tagHysteresis,
+                           &ptagSet->tagConfig,
+                           ptagSet->tagaSensors,
+                           ptagSet->uiSensorsCount,
+                           ptagSet->tagaTemps,
+                           ptagSet->uiTemperaturesCount,
+                           ptagSet->tagaProfiles,
+                           ptagSet->uiProfilesCount))
+  {
+    ERR_PUTS("Reload: fanCtrl_AMDGPU_Reload() failed, keeping the running configuration");
+    return(-1);
+  }
+  uiCfgSetActive_m^=1;
+  tagCfgSource_m=tagSource;
+  vFanCtrl_WriteCfgCache_m(pcCfgFilePath_m,&tagSource,ptagSet);
+  printf("fanctrl: Reload: Configuration of \"%s\" applied\n",
+         pcCfgFilePath_m);
+  fflush(stdout);
+  return(1);
+}
+
 static void vCLIPrintHelp(void)
 {
   printf("Usage: fanctrl [options]\n"
          "Available Options:\n"
          "  <Path to config file>: Path to configuration file\n"
          "    %s, %s: Print debug informations during runtime, this is recommended while testing your configuration\n"
+         "    %s, %s: Identify the thermal behaviour (relay experiment, see section [" CFGFILE_SECTION_NAME_IDENTIFY "] in the config file)\n"
+         "              and write the recommended settings to section [" CFGFILE_SECTION_NAME_IDENTIFIED "] of the config file.\n"
+         "              The GPU must be under constant load during the run.\n"
+         "              The config file is rewritten (comments are lost), a backup is stored as <config file>" CFGFILE_BACKUP_SUFFIX "\n"
+         "              (" CFGFILE_BACKUP_SUFFIX ".1, " CFGFILE_BACKUP_SUFFIX ".2, ... if it exists, a backup is never overwritten)\n"
+         "    %s, %s: Calibrate the fan (PWM sweep, see section [" CFGFILE_SECTION_NAME_CALIBRATE "] in the config file)\n"
+         "              and write the measured PWM-to-RPM table to section [" CFGFILE_SECTION_NAME_CALIBRATION "] of the config file,\n"
+         "              which remaps the fanspeeds from then on. Requires PathFanInput.\n"
+         "              The config file is rewritten (comments are lost), a backup is stored as <config file>" CFGFILE_BACKUP_SUFFIX "\n"
+         "              (" CFGFILE_BACKUP_SUFFIX ".1, " CFGFILE_BACKUP_SUFFIX ".2, ... if it exists, a backup is never overwritten)\n"
+         "    %s, %s <header>: Verify the configuration and export it to a C header, for the static build (make fanctrl-static)\n"
          "  %s, %s: Prints this help\n"
          "  %s, %s: Prints version of the application\n",
          tagaCLICommands_m[CLI_CMD_INDEX_DEBUG].pcCmd,
          tagaCLICommands_m[CLI_CMD_INDEX_DEBUG].pcAlias,
+         tagaCLICommands_m[CLI_CMD_INDEX_IDENTIFY].pcCmd,
+         tagaCLICommands_m[CLI_CMD_INDEX_IDENTIFY].pcAlias,
+         tagaCLICommands_m[CLI_CMD_INDEX_CALIBRATE].pcCmd,
+         tagaCLICommands_m[CLI_CMD_INDEX_CALIBRATE].pcAlias,
+         tagaCLICommands_m[CLI_CMD_INDEX_EXPORT_STATIC].pcCmd,
+         tagaCLICommands_m[CLI_CMD_INDEX_EXPORT_STATIC].pcAlias,
          tagaCLICommands_m[CLI_CMD_INDEX_HELP].pcCmd,
          tagaCLICommands_m[CLI_CMD_INDEX_HELP].pcAlias,
          tagaCLICommands_m[CLI_CMD_INDEX_VERSION].pcCmd,
@@ -256,9 +1291,13 @@ static void vCLIPrintWrongArgs(const char *pcArg)
 
 static int iParseCLI_m(int argc,
                        char *argv[],
-                       unsigned int *puiOptions)
+                       unsigned int *puiOptions,
+                       const char **ppcExportPath)
 {
+  int iIndex;
+
   *puiOptions=0;
+  *ppcExportPath=NULL;
   if(argc < 2)
     return(1);
 
@@ -279,29 +1318,46 @@ static int iParseCLI_m(int argc,
   {
     return(1);
   }
-  if(argc == 2) /* No more args than config file path, OK */
-    return(0);
-
-  if(argc == 3) /* Check for debug switch */
+  for(iIndex=2;iIndex < argc;++iIndex) /* Optional switches after the config file path */
   {
-    if((strcmp(argv[2],tagaCLICommands_m[CLI_CMD_INDEX_DEBUG].pcCmd)   == 0) ||
-       (strcmp(argv[2],tagaCLICommands_m[CLI_CMD_INDEX_DEBUG].pcAlias) == 0))
+    if((strcmp(argv[iIndex],tagaCLICommands_m[CLI_CMD_INDEX_DEBUG].pcCmd)   == 0) ||
+       (strcmp(argv[iIndex],tagaCLICommands_m[CLI_CMD_INDEX_DEBUG].pcAlias) == 0))
+      *puiOptions|=CLI_OPTION_FLAG_DEBUG; /* Okay, enable debug outputs */
+    else if((strcmp(argv[iIndex],tagaCLICommands_m[CLI_CMD_INDEX_IDENTIFY].pcCmd)   == 0) ||
+            (strcmp(argv[iIndex],tagaCLICommands_m[CLI_CMD_INDEX_IDENTIFY].pcAlias) == 0))
+      *puiOptions|=CLI_OPTION_FLAG_IDENTIFY;
+    else if((strcmp(argv[iIndex],tagaCLICommands_m[CLI_CMD_INDEX_CALIBRATE].pcCmd)   == 0) ||
+            (strcmp(argv[iIndex],tagaCLICommands_m[CLI_CMD_INDEX_CALIBRATE].pcAlias) == 0))
+      *puiOptions|=CLI_OPTION_FLAG_CALIBRATE;
+    else if(((strcmp(argv[iIndex],tagaCLICommands_m[CLI_CMD_INDEX_EXPORT_STATIC].pcCmd)   == 0) ||
+             (strcmp(argv[iIndex],tagaCLICommands_m[CLI_CMD_INDEX_EXPORT_STATIC].pcAlias) == 0)) &&
+            (iIndex+1 < argc))
     {
-      *puiOptions|=CLI_OPTION_FLAG_DEBUG;
-      return(0); /* Okay, enable debug outputs */
+      *puiOptions|=CLI_OPTION_FLAG_EXPORT_STATIC;
+      *ppcExportPath=argv[++iIndex]; /* Followed by the path of the header */
     }
+    else
+      return(1);
   }
-  return(1);
+  if(((*puiOptions & CLI_OPTION_FLAG_IDENTIFY) != 0) +
+     ((*puiOptions & CLI_OPTION_FLAG_CALIBRATE) != 0) +
+     ((*puiOptions & CLI_OPTION_FLAG_EXPORT_STATIC) != 0) > 1) /* Only one experiment/export per run */
+    return(1);
+  return(0);
 }
 
 static int iFanCtrl_ReadCfgFile(const char *pcFilePath,
                                 unsigned int *puiUpdateDelayTime,
-                                unsigned char *pucChangeHysteresis,
+                                TagCfg_Hysteresis *ptagHysteresis,
                                 TagCfg_AMDGPU *ptagAMDGPU,
                                 TagCfg_Sensor tagaSensors[MAX_SENSORS_COUNT],
+                                TagCfg_Temperatures tagaSensorTemps[MAX_SENSORS_COUNT][MAX_TEMPERATURES_COUNT],
                                 TagCfg_Temperatures tagaTemps[MAX_TEMPERATURES_COUNT],
+                                TagCfg_Profile tagaProfiles[FANCTRL_MAX_PROFILES],
+                                TagCfg_Temperatures tagaProfileTemps[FANCTRL_MAX_PROFILES][MAX_TEMPERATURES_COUNT],
                                 unsigned int *puiSensorsCount,
-                                unsigned int *puiTempsCount)
+                                unsigned int *puiTempsCount,
+                                unsigned int *puiProfilesCount)
 {
   /* Local macros for error handling */
 #define ERR_INI_FAILURE(txt) ERR_PRINTF( \
@@ -320,11 +1376,12 @@ static int iFanCtrl_ReadCfgFile(const char *pcFilePath,
   Inifile tagFile;
   TagData tagCfgData;
   char caTmp[20];
-  char *pcTmp;
   unsigned int uiIndex;
   const char *pcCurrSection;
   const char *pcCurrKey;
-  long lTmp;
+  unsigned short usTmp;
+  unsigned long ulTmp;
+  char *pcEnd;
   int iRc;
 
   if((iRc=IniFile_New(&tagFile,
@@ -368,20 +1425,33 @@ static int iFanCtrl_ReadCfgFile(const char *pcFilePath,
   }
   *puiUpdateDelayTime=DATA_GET_UINT(tagCfgData);
 
-  pcCurrKey=CFGFILE_KEY_NAME_FANCTRL_CHANGE_HYSTERESIS;
-  if((iRc=IniFile_Iterator_FindKey(tagFile,
-                                   pcCurrKey)) != INI_ERR_NONE)
+  if(IniFile_Iterator_FindKey(tagFile,
+                              CFGFILE_KEY_NAME_FANCTRL_CHANGE_HYSTERESIS) == INI_ERR_NONE)
   {
-    ERR_INI_KEY_FIND();
+    ERR_PUTS("Key \"" CFGFILE_KEY_NAME_FANCTRL_CHANGE_HYSTERESIS "\" is not supported anymore and ignored, use \""
+             CFGFILE_KEY_NAME_FANCTRL_HYST_RISING "\"/\"" CFGFILE_KEY_NAME_FANCTRL_HYST_FALLING "\" instead");
   }
 
-  dataType_Set_Uint(&tagCfgData,0,eRepr_Int_Default);
-  if((iRc=IniFile_Iterator_KeyGetValue(tagFile,
-                                       &tagCfgData)) != INI_ERR_NONE)
+  /* Optional: Hysteresis */
+  ptagHysteresis->usRisingDeadband=0;
+  ptagHysteresis->usFallingDeadband=0;
+  ptagHysteresis->usMinDwellTime=0;
+  ptagHysteresis->usRisingSlopeBypass=0;
+  if(((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_FANCTRL_HYST_RISING),
+                                         &ptagHysteresis->usRisingDeadband)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_FANCTRL_HYST_FALLING),
+                                         &ptagHysteresis->usFallingDeadband)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_FANCTRL_HYST_MIN_DWELL),
+                                         &ptagHysteresis->usMinDwellTime)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_FANCTRL_HYST_SLOPE_BYPASS),
+                                         &ptagHysteresis->usRisingSlopeBypass)) != INI_ERR_NONE))
   {
     ERR_INI_GET_KEY_VALUE();
   }
-  *pucChangeHysteresis=(unsigned char)DATA_GET_UINT(tagCfgData);
 
   pcCurrSection=CFGFILE_SECTION_NAME_AMDGPU;
   if((iRc=IniFile_Iterator_FindSection(tagFile,
@@ -447,21 +1517,45 @@ static int iFanCtrl_ReadCfgFile(const char *pcFilePath,
     ERR_INI_GET_KEY_VALUE();
   }
 
-  /* Read All Sensor Paths */
-  for(uiIndex=0;uiIndex < MAX_SENSORS_COUNT;++uiIndex)
+  /* Optional: Critical temperatures */
+  ptagAMDGPU->usCriticalTemp=0;
+  ptagAMDGPU->usEmergencyTemp=0;
+  ptagAMDGPU->usCriticalTickTime=CFG_DEFAULT_CRITICAL_TICK_TIME;
+  ptagAMDGPU->usCriticalCooldown=CFG_DEFAULT_CRITICAL_COOLDOWN;
+  usTmp=0;
+  if(((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_CRITICAL_TEMP),
+                                         &ptagAMDGPU->usCriticalTemp)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_EMERGENCY_TEMP),
+                                         &ptagAMDGPU->usEmergencyTemp)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_CRITICAL_FROM_SENSOR),
+                                         &usTmp)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_CRITICAL_TICK_TIME),
+                                         &ptagAMDGPU->usCriticalTickTime)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_CRITICAL_COOLDOWN),
+                                         &ptagAMDGPU->usCriticalCooldown)) != INI_ERR_NONE))
   {
-    pcCurrKey=pcaCFGKeys_AMDGPU_Sensors_m[uiIndex];
-    if((iRc=IniFile_Iterator_FindKey(tagFile,
-                                     pcCurrKey)) != INI_ERR_NONE)
-    {
-      if(iRc == INI_ERR_FIND_SECTION) /* No more Sensors */
-        break;
-      ERR_INI_KEY_FIND();
-    }
+    ERR_INI_GET_KEY_VALUE();
+  }
+  ptagAMDGPU->ucCriticalFromSensors=(usTmp)?1:0;
 
+  /* Optional: Control mode */
+  ptagAMDGPU->ucControlMode=CONTROL_MODE_CURVE;
+  ptagAMDGPU->usPIDSetpoint=0;
+  ptagAMDGPU->usPIDKp=0;
+  ptagAMDGPU->usPIDKi=0;
+  ptagAMDGPU->usPIDKd=0;
+  pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_CONTROL_MODE;
+  if((iRc=IniFile_Iterator_FindKey(tagFile,
+                                   pcCurrKey)) == INI_ERR_NONE)
+  {
     dataType_Set_String(&tagCfgData,
-                        tagaSensors[uiIndex].caSensorReadPath,
-                        sizeof(tagaSensors[uiIndex].caSensorReadPath),
+                        caTmp,
+                        sizeof(caTmp),
                         NULL,
                         0,
                         eRepr_String_Default);
@@ -470,39 +1564,561 @@ static int iFanCtrl_ReadCfgFile(const char *pcFilePath,
     {
       ERR_INI_GET_KEY_VALUE();
     }
-  }
-  if(uiIndex == 0) /* Check if sensors where found */
-  {
-    ERR_PUTS("No Sensor paths found in config file");
+    if(strcmp(caTmp,CFGFILE_VALUE_CONTROL_MODE_PID) == 0)
+      ptagAMDGPU->ucControlMode=CONTROL_MODE_PID;
+    else if(strcmp(caTmp,CFGFILE_VALUE_CONTROL_MODE_MPC) == 0)
+      ptagAMDGPU->ucControlMode=CONTROL_MODE_MPC;
+    else if(strcmp(caTmp,CFGFILE_VALUE_CONTROL_MODE_CURVE) != 0)
+    {
+      ERR_PRINTF("Invalid value \"%s\" for \"%s\", use \"" CFGFILE_VALUE_CONTROL_MODE_CURVE "\", \"" CFGFILE_VALUE_CONTROL_MODE_PID "\" or \"" CFGFILE_VALUE_CONTROL_MODE_MPC "\"",
+                 caTmp,
+                 pcCurrKey);
+      IniFile_Dispose(tagFile);
+      return(1);
+    }
+  }
+  else if(iRc != INI_ERR_FIND_SECTION)
+  {
+    ERR_INI_KEY_FIND();
+  }
+  if(((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_PID_SETPOINT),
+                                         &ptagAMDGPU->usPIDSetpoint)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_PID_KP),
+                                         &ptagAMDGPU->usPIDKp)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_PID_KI),
+                                         &ptagAMDGPU->usPIDKi)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_PID_KD),
+                                         &ptagAMDGPU->usPIDKd)) != INI_ERR_NONE))
+  {
+    ERR_INI_GET_KEY_VALUE();
+  }
+  ptagAMDGPU->usMPCTarget=0;
+  ptagAMDGPU->usMPCHorizon=CFG_DEFAULT_MPC_HORIZON;
+  ptagAMDGPU->usMPCForgetting=CFG_DEFAULT_MPC_FORGETTING;
+  if(((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_MPC_TARGET),
+                                         &ptagAMDGPU->usMPCTarget)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_MPC_HORIZON),
+                                         &ptagAMDGPU->usMPCHorizon)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_MPC_FORGETTING),
+                                         &ptagAMDGPU->usMPCForgetting)) != INI_ERR_NONE))
+  {
+    ERR_INI_GET_KEY_VALUE();
+  }
+
+  /* Optional: Power and GPU load sensors, feed-forward */
+  ptagAMDGPU->caPathPowerRead[0]='\0';
+  ptagAMDGPU->caPathBusyRead[0]='\0';
+  ptagAMDGPU->usFeedForwardPower=0;
+  ptagAMDGPU->usFeedForwardBusy=0;
+  ptagAMDGPU->usFeedForwardDecay=CFG_DEFAULT_FEEDFORWARD_DECAY;
+  if(((iRc=iFanCtrl_ReadOptionalString_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_PATH_POWER_READ),
+                                         ptagAMDGPU->caPathPowerRead,
+                                         sizeof(ptagAMDGPU->caPathPowerRead))) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalString_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_PATH_BUSY_READ),
+                                         ptagAMDGPU->caPathBusyRead,
+                                         sizeof(ptagAMDGPU->caPathBusyRead))) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_FEEDFORWARD_POWER),
+                                         &ptagAMDGPU->usFeedForwardPower)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_FEEDFORWARD_BUSY),
+                                         &ptagAMDGPU->usFeedForwardBusy)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_FEEDFORWARD_DECAY),
+                                         &ptagAMDGPU->usFeedForwardDecay)) != INI_ERR_NONE))
+  {
+    ERR_INI_GET_KEY_VALUE();
+  }
+
+  /* Optional: GPU clock, throttle detection */
+  ptagAMDGPU->caPathClockRead[0]='\0';
+  ptagAMDGPU->usThrottleTemp=0;
+  ptagAMDGPU->usThrottleClock=CFG_DEFAULT_THROTTLE_CLOCK;
+  ptagAMDGPU->usThrottleBusy=CFG_DEFAULT_THROTTLE_BUSY;
+  ptagAMDGPU->usThrottleBiasStep=CFG_DEFAULT_THROTTLE_BIAS_STEP;
+  if(((iRc=iFanCtrl_ReadOptionalString_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_PATH_CLOCK_READ),
+                                         ptagAMDGPU->caPathClockRead,
+                                         sizeof(ptagAMDGPU->caPathClockRead))) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_THROTTLE_TEMP),
+                                         &ptagAMDGPU->usThrottleTemp)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_THROTTLE_CLOCK),
+                                         &ptagAMDGPU->usThrottleClock)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_THROTTLE_BUSY),
+                                         &ptagAMDGPU->usThrottleBusy)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_THROTTLE_BIAS_STEP),
+                                         &ptagAMDGPU->usThrottleBiasStep)) != INI_ERR_NONE))
+  {
+    ERR_INI_GET_KEY_VALUE();
+  }
+
+  /* Optional: Power cap actuator */
+  ptagAMDGPU->caPathPowerCap[0]='\0';
+  ptagAMDGPU->usPowerCapTemp=0;
+  ptagAMDGPU->usPowerCapMin=0;
+  ptagAMDGPU->usPowerCapStep=CFG_DEFAULT_POWER_CAP_STEP;
+  ptagAMDGPU->usPowerCapHysteresis=CFG_DEFAULT_POWER_CAP_HYSTERESIS;
+  ptagAMDGPU->usPowerCapBoostTemp=0;
+  ptagAMDGPU->usPowerCapBoostFanSpeed=CFG_DEFAULT_POWER_CAP_BOOST_FAN;
+  ptagAMDGPU->usPowerCapMax=0;
+  if(((iRc=iFanCtrl_ReadOptionalString_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_PATH_POWER_CAP),
+                                         ptagAMDGPU->caPathPowerCap,
+                                         sizeof(ptagAMDGPU->caPathPowerCap))) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_POWER_CAP_TEMP),
+                                         &ptagAMDGPU->usPowerCapTemp)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_POWER_CAP_MIN),
+                                         &ptagAMDGPU->usPowerCapMin)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_POWER_CAP_STEP),
+                                         &ptagAMDGPU->usPowerCapStep)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_POWER_CAP_HYSTERESIS),
+                                         &ptagAMDGPU->usPowerCapHysteresis)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_POWER_CAP_BOOST_TEMP),
+                                         &ptagAMDGPU->usPowerCapBoostTemp)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_POWER_CAP_BOOST_FAN),
+                                         &ptagAMDGPU->usPowerCapBoostFanSpeed)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_POWER_CAP_MAX),
+                                         &ptagAMDGPU->usPowerCapMax)) != INI_ERR_NONE))
+  {
+    ERR_INI_GET_KEY_VALUE();
+  }
+
+  /* Optional: Profile rule inputs */
+  ptagAMDGPU->caPathPowerProfile[0]='\0';
+  ptagAMDGPU->caPathProfileHint[0]='\0';
+  ptagAMDGPU->usProfileFade=CFG_DEFAULT_PROFILE_FADE;
+  if(((iRc=iFanCtrl_ReadOptionalString_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_PATH_POWER_PROFILE),
+                                         ptagAMDGPU->caPathPowerProfile,
+                                         sizeof(ptagAMDGPU->caPathPowerProfile))) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalString_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_PATH_PROFILE_HINT),
+                                         ptagAMDGPU->caPathProfileHint,
+                                         sizeof(ptagAMDGPU->caPathProfileHint))) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_PROFILE_FADE),
+                                         &ptagAMDGPU->usProfileFade)) != INI_ERR_NONE))
+  {
+    ERR_INI_GET_KEY_VALUE();
+  }
+
+  /* Optional: Load hints of a job scheduler */
+  ptagAMDGPU->caPathHintSocket[0]='\0';
+  strcpy(ptagAMDGPU->caHintDevice,CFGFILE_VALUE_HINT_DEVICE_DEFAULT);
+  ptagAMDGPU->usHintGain=CFG_DEFAULT_HINT_GAIN;
+  ptagAMDGPU->usHintMaxTTL=CFG_DEFAULT_HINT_MAX_TTL;
+  ptagAMDGPU->usHintSocketMode=0;
+  ptagAMDGPU->caHintSocketGroup[0]='\0';
+  caTmp[0]='\0';
+  if(((iRc=iFanCtrl_ReadOptionalString_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_PATH_HINT_SOCKET),
+                                         ptagAMDGPU->caPathHintSocket,
+                                         sizeof(ptagAMDGPU->caPathHintSocket))) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalString_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_HINT_DEVICE),
+                                         ptagAMDGPU->caHintDevice,
+                                         sizeof(ptagAMDGPU->caHintDevice))) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_HINT_GAIN),
+                                         &ptagAMDGPU->usHintGain)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_HINT_MAX_TTL),
+                                         &ptagAMDGPU->usHintMaxTTL)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalString_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_HINT_SOCKET_GROUP),
+                                         ptagAMDGPU->caHintSocketGroup,
+                                         sizeof(ptagAMDGPU->caHintSocketGroup))) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalString_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_HINT_SOCKET_MODE),
+                                         caTmp,
+                                         sizeof(caTmp))) != INI_ERR_NONE))
+  {
+    ERR_INI_GET_KEY_VALUE();
+  }
+  if(caTmp[0])
+  {
+    ulTmp=strtoul(caTmp,&pcEnd,8);
+    if((!isdigit((unsigned char)caTmp[0])) ||
+       (*pcEnd != '\0') ||
+       (ulTmp > USHRT_MAX))
+    {
+      ERR_PRINTF("Invalid value \"%s\" for \"%s\", use an octal mode, e.g. 0660",
+                 caTmp,
+                 pcCurrKey);
+      IniFile_Dispose(tagFile);
+      return(1);
+    }
+    ptagAMDGPU->usHintSocketMode=(unsigned short)ulTmp;
+  }
 
+  /* Optional: Reducer of the per-sensor fanspeeds */
+  ptagAMDGPU->ucSensorReducer=SENSOR_REDUCER_MAX;
+  caTmp[0]='\0';
+  if((iRc=iFanCtrl_ReadOptionalString_m(tagFile,
+                                        (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_SENSOR_REDUCER),
+                                        caTmp,
+                                        sizeof(caTmp))) != INI_ERR_NONE)
+  {
+    ERR_INI_GET_KEY_VALUE();
+  }
+  if(strcmp(caTmp,CFGFILE_VALUE_SENSOR_REDUCER_MEAN) == 0)
+    ptagAMDGPU->ucSensorReducer=SENSOR_REDUCER_MEAN;
+  else if((caTmp[0]) &&
+          (strcmp(caTmp,CFGFILE_VALUE_SENSOR_REDUCER_MAX) != 0))
+  {
+    ERR_PRINTF("Invalid value \"%s\" for \"%s\", use \"" CFGFILE_VALUE_SENSOR_REDUCER_MAX "\" or \"" CFGFILE_VALUE_SENSOR_REDUCER_MEAN "\"",
+               caTmp,
+               pcCurrKey);
     IniFile_Dispose(tagFile);
     return(1);
   }
-  *puiSensorsCount=uiIndex;
 
-  dataType_Set_String(&tagCfgData,
-                      caTmp,
-                      sizeof(caTmp),
-                      NULL,
-                      0,
-                      eRepr_String_Default);
-  /* Read All Temperature Points */
-  for(uiIndex=0;uiIndex < MAX_TEMPERATURES_COUNT;++uiIndex)
+  /* Optional: Interpolation between the temperature points */
+  ptagAMDGPU->ucCurveInterpolation=CURVE_INTERPOLATION_LINEAR;
+  caTmp[0]='\0';
+  if((iRc=iFanCtrl_ReadOptionalString_m(tagFile,
+                                        (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_CURVE_INTERPOLATION),
+                                        caTmp,
+                                        sizeof(caTmp))) != INI_ERR_NONE)
+  {
+    ERR_INI_GET_KEY_VALUE();
+  }
+  if(strcmp(caTmp,CFGFILE_VALUE_CURVE_INTERPOLATION_SPLINE) == 0)
+    ptagAMDGPU->ucCurveInterpolation=CURVE_INTERPOLATION_SPLINE;
+  else if((caTmp[0]) &&
+          (strcmp(caTmp,CFGFILE_VALUE_CURVE_INTERPOLATION_LINEAR) != 0))
+  {
+    ERR_PRINTF("Invalid value \"%s\" for \"%s\", use \"" CFGFILE_VALUE_CURVE_INTERPOLATION_LINEAR "\" or \"" CFGFILE_VALUE_CURVE_INTERPOLATION_SPLINE "\"",
+               caTmp,
+               pcCurrKey);
+    IniFile_Dispose(tagFile);
+    return(1);
+  }
+
+  /* Optional: RPM mode, the fanspeed is a target RPM */
+  ptagAMDGPU->ucFanMode=FAN_MODE_PWM;
+  ptagAMDGPU->caPathFanTarget[0]='\0';
+  ptagAMDGPU->caPathFanInput[0]='\0';
+  ptagAMDGPU->usFanRPMMax=0;
+  ptagAMDGPU->usFanRPMGain=CFG_DEFAULT_FAN_RPM_GAIN;
+  usTmp=CFG_DEFAULT_FAN_RPM_STEPS;
+  caTmp[0]='\0';
+  if(((iRc=iFanCtrl_ReadOptionalString_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_FAN_MODE),
+                                         caTmp,
+                                         sizeof(caTmp))) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalString_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_PATH_FAN_TARGET),
+                                         ptagAMDGPU->caPathFanTarget,
+                                         sizeof(ptagAMDGPU->caPathFanTarget))) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalString_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_PATH_FAN_INPUT),
+                                         ptagAMDGPU->caPathFanInput,
+                                         sizeof(ptagAMDGPU->caPathFanInput))) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_FAN_RPM_MAX),
+                                         &ptagAMDGPU->usFanRPMMax)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_FAN_RPM_GAIN),
+                                         &ptagAMDGPU->usFanRPMGain)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_FAN_RPM_STEPS),
+                                         &usTmp)) != INI_ERR_NONE))
+  {
+    ERR_INI_GET_KEY_VALUE();
+  }
+  ptagAMDGPU->ucFanRPMSubTicks=(usTmp > UCHAR_MAX)?UCHAR_MAX:(unsigned char)usTmp;
+  if(strcmp(caTmp,CFGFILE_VALUE_FAN_MODE_RPM) == 0)
+    ptagAMDGPU->ucFanMode=FAN_MODE_RPM;
+  else if((caTmp[0]) &&
+          (strcmp(caTmp,CFGFILE_VALUE_FAN_MODE_PWM) != 0))
+  {
+    ERR_PRINTF("Invalid value \"%s\" for \"%s\", use \"" CFGFILE_VALUE_FAN_MODE_PWM "\" or \"" CFGFILE_VALUE_FAN_MODE_RPM "\"",
+               caTmp,
+               CFGFILE_KEY_NAME_AMDGPU_FAN_MODE);
+    IniFile_Dispose(tagFile);
+    return(1);
+  }
+
+  /* Optional: Fan stall detection, requires PathFanInput */
+  ptagAMDGPU->usStallFanSpeed=0;
+  ptagAMDGPU->usStallTime=CFG_DEFAULT_STALL_TIME;
+  ptagAMDGPU->usStallKickTime=CFG_DEFAULT_STALL_KICK_TIME;
+  ptagAMDGPU->usStallPowerCap=0;
+  if(((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_STALL_FAN_SPEED),
+                                         &ptagAMDGPU->usStallFanSpeed)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_STALL_TIME),
+                                         &ptagAMDGPU->usStallTime)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_STALL_KICK_TIME),
+                                         &ptagAMDGPU->usStallKickTime)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_STALL_POWER_CAP),
+                                         &ptagAMDGPU->usStallPowerCap)) != INI_ERR_NONE))
+  {
+    ERR_INI_GET_KEY_VALUE();
+  }
+
+  /* Optional: Zero-RPM state machine */
+  ptagAMDGPU->usZeroRPMStartTemp=0;
+  ptagAMDGPU->usZeroRPMStopTemp=0;
+  ptagAMDGPU->usZeroRPMMinOnTime=CFG_DEFAULT_ZERO_RPM_MIN_ON;
+  ptagAMDGPU->usZeroRPMMinOffTime=CFG_DEFAULT_ZERO_RPM_MIN_OFF;
+  ptagAMDGPU->usZeroRPMKickTime=CFG_DEFAULT_ZERO_RPM_KICK_TIME;
+  if(((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_ZERO_RPM_START_TEMP),
+                                         &ptagAMDGPU->usZeroRPMStartTemp)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_ZERO_RPM_STOP_TEMP),
+                                         &ptagAMDGPU->usZeroRPMStopTemp)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_ZERO_RPM_MIN_ON),
+                                         &ptagAMDGPU->usZeroRPMMinOnTime)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_ZERO_RPM_MIN_OFF),
+                                         &ptagAMDGPU->usZeroRPMMinOffTime)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_ZERO_RPM_KICK_TIME),
+                                         &ptagAMDGPU->usZeroRPMKickTime)) != INI_ERR_NONE))
+  {
+    ERR_INI_GET_KEY_VALUE();
+  }
+
+  /* Optional: PWM slew limiter */
+  ptagAMDGPU->usSlewRateUp=0;
+  ptagAMDGPU->usSlewRateDown=0;
+  usTmp=1;
+  if(((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_SLEW_RATE_UP),
+                                         &ptagAMDGPU->usSlewRateUp)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_SLEW_RATE_DOWN),
+                                         &ptagAMDGPU->usSlewRateDown)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_SLEW_CRIT_UNLIMITED),
+                                         &usTmp)) != INI_ERR_NONE))
+  {
+    ERR_INI_GET_KEY_VALUE();
+  }
+  ptagAMDGPU->ucSlewCriticalUnlimited=(usTmp)?1:0;
+
+  /* Optional: Persistent state */
+  ptagAMDGPU->caPathState[0]='\0';
+  ptagAMDGPU->usStateMaxAge=CFG_DEFAULT_STATE_MAX_AGE;
+  if(((iRc=iFanCtrl_ReadOptionalString_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_PATH_STATE),
+                                         ptagAMDGPU->caPathState,
+                                         sizeof(ptagAMDGPU->caPathState))) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_AMDGPU_STATE_MAX_AGE),
+                                         &ptagAMDGPU->usStateMaxAge)) != INI_ERR_NONE))
+  {
+    ERR_INI_GET_KEY_VALUE();
+  }
+
+  /* Read All Sensor Paths */
+  for(uiIndex=0;uiIndex < MAX_SENSORS_COUNT;++uiIndex)
   {
-    pcCurrKey=pcaCFGKeys_AMDGPU_Temps_m[uiIndex];
+    pcCurrKey=pcaCFGKeys_AMDGPU_Sensors_m[uiIndex];
     if((iRc=IniFile_Iterator_FindKey(tagFile,
                                      pcCurrKey)) != INI_ERR_NONE)
     {
-      if(iRc == INI_ERR_FIND_SECTION) /* No more Temperatures */
+      if(iRc == INI_ERR_FIND_SECTION) /* No more Sensors */
         break;
       ERR_INI_KEY_FIND();
     }
 
+    dataType_Set_String(&tagCfgData,
+                        tagaSensors[uiIndex].caSensorReadPath,
+                        sizeof(tagaSensors[uiIndex].caSensorReadPath),
+                        NULL,
+                        0,
+                        eRepr_String_Default);
     if((iRc=IniFile_Iterator_KeyGetValue(tagFile,
                                          &tagCfgData)) != INI_ERR_NONE)
     {
       ERR_INI_GET_KEY_VALUE();
     }
+
+    /* Optional: Sensor filter */
+    tagaSensors[uiIndex].ucFilterType=SENSOR_FILTER_NONE;
+    tagaSensors[uiIndex].ucFilterParam=0;
+    tagaSensors[uiIndex].usFilterStepBypass=0;
+    tagaSensors[uiIndex].ucOversampling=0;
+    pcCurrKey=pcaCFGKeys_AMDGPU_SensorFilters_m[uiIndex];
+    if((iRc=IniFile_Iterator_FindKey(tagFile,
+                                     pcCurrKey)) == INI_ERR_NONE)
+    {
+      dataType_Set_String(&tagCfgData,
+                          caTmp,
+                          sizeof(caTmp),
+                          NULL,
+                          0,
+                          eRepr_String_Default);
+      if((iRc=IniFile_Iterator_KeyGetValue(tagFile,
+                                           &tagCfgData)) != INI_ERR_NONE)
+      {
+        ERR_INI_GET_KEY_VALUE();
+      }
+      if(iFanCtrl_ParseSensorFilter_m(caTmp,
+                                      &tagaSensors[uiIndex]))
+      {
+        ERR_PRINTF("conversion failed (%s) for value \"%s\", Correct format: %s=<none|ema|median>,<ema: weight in %%, median: window size>[,<ema: bypass step in 1/10 °C>]",
+                   pcCurrKey,
+                   caTmp,
+                   pcCurrKey);
+        IniFile_Dispose(tagFile);
+        return(1);
+      }
+    }
+    else if(iRc != INI_ERR_FIND_SECTION)
+    {
+      ERR_INI_KEY_FIND();
+    }
+
+    /* Optional: Sensor oversampling */
+    pcCurrKey=pcaCFGKeys_AMDGPU_SensorOversampling_m[uiIndex];
+    if((iRc=IniFile_Iterator_FindKey(tagFile,
+                                     pcCurrKey)) == INI_ERR_NONE)
+    {
+      dataType_Set_Uint(&tagCfgData,0,eRepr_Int_Default);
+      if((iRc=IniFile_Iterator_KeyGetValue(tagFile,
+                                           &tagCfgData)) != INI_ERR_NONE)
+      {
+        ERR_INI_GET_KEY_VALUE();
+      }
+      tagaSensors[uiIndex].ucOversampling=(DATA_GET_UINT(tagCfgData) > UCHAR_MAX)?UCHAR_MAX:(unsigned char)DATA_GET_UINT(tagCfgData);
+    }
+    else if(iRc != INI_ERR_FIND_SECTION)
+    {
+      ERR_INI_KEY_FIND();
+    }
+
+    /* Optional: Sensor weight, the own curve is read from its section later */
+    tagaSensors[uiIndex].ptagTemps=NULL;
+    tagaSensors[uiIndex].uiTempsCount=0;
+    usTmp=CFG_DEFAULT_SENSOR_WEIGHT;
+    if((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                          (pcCurrKey=pcaCFGKeys_AMDGPU_SensorWeights_m[uiIndex]),
+                                          &usTmp)) != INI_ERR_NONE)
+    {
+      ERR_INI_GET_KEY_VALUE();
+    }
+    tagaSensors[uiIndex].ucWeight=(usTmp > UCHAR_MAX)?UCHAR_MAX:(unsigned char)usTmp;
+  }
+  if(uiIndex == 0) /* Check if sensors where found */
+  {
+    ERR_PUTS("No Sensor paths found in config file");
+
+    IniFile_Dispose(tagFile);
+    return(1);
+  }
+  *puiSensorsCount=uiIndex;
+
+  /* Read All Temperature Points */
+  if(iFanCtrl_ReadTempPoints_m(tagFile,
+                               pcCurrSection,
+                               tagaTemps,
+                               puiTempsCount))
+  {
+    IniFile_Dispose(tagFile);
+    return(1);
+  }
+
+  /* Optional: Per-sensor curves, each in its own section */
+  if(iFanCtrl_ReadSensorCurves_m(tagFile,
+                                 tagaSensors,
+                                 tagaSensorTemps,
+                                 *puiSensorsCount))
+  {
+    IniFile_Dispose(tagFile);
+    return(1);
+  }
+
+  /* Optional: Curve profiles, each in its own section */
+  if(iFanCtrl_ReadProfiles_m(tagFile,
+                             tagaProfiles,
+                             tagaProfileTemps,
+                             puiProfilesCount))
+  {
+    IniFile_Dispose(tagFile);
+    return(1);
+  }
+
+  /* Optional: Fan calibration, written by --calibrate */
+  if(iFanCtrl_ReadCalibration_m(tagFile,
+                                &ptagAMDGPU->tagCalibration))
+  {
+    IniFile_Dispose(tagFile);
+    return(1);
+  }
+
+  IniFile_Dispose(tagFile);
+  return(0);
+}
+
+/**
+ * Reads the temperature points (FanSpeedX keys) of the current section.
+ *
+ * @return 0 on success, nonzero on failure.
+ */
+static int iFanCtrl_ReadTempPoints_m(Inifile tagFile,
+                                     const char *pcSection,
+                                     TagCfg_Temperatures tagaTemps[MAX_TEMPERATURES_COUNT],
+                                     unsigned int *puiTempsCount)
+{
+  TagData tagCfgData;
+  char caTmp[20];
+  char *pcTmp;
+  unsigned int uiIndex;
+  long lTmp;
+  int iRc;
+
+  dataType_Set_String(&tagCfgData,
+                      caTmp,
+                      sizeof(caTmp),
+                      NULL,
+                      0,
+                      eRepr_String_Default);
+  for(uiIndex=0;uiIndex < MAX_TEMPERATURES_COUNT;++uiIndex)
+  {
+    if(((iRc=IniFile_Iterator_FindKey(tagFile,
+                                      pcaCFGKeys_AMDGPU_Temps_m[uiIndex])) != INI_ERR_NONE) &&
+       (iRc == INI_ERR_FIND_SECTION)) /* No more Temperatures */
+      break;
+    if((iRc != INI_ERR_NONE) ||
+       ((iRc=IniFile_Iterator_KeyGetValue(tagFile,
+                                          &tagCfgData)) != INI_ERR_NONE))
+    {
+      ERR_PRINTF("Key \"%s\" in Section \"%s\": Failed getting Value from Key: Failure (%d): %s",
+                 pcaCFGKeys_AMDGPU_Temps_m[uiIndex],
+                 pcSection,
+                 iRc,
+                 IniFile_GetErrorText(iRc));
+      return(1);
+    }
     lTmp=strtol(caTmp,&pcTmp,10);
     if((*pcTmp != ',') ||
        (lTmp < 0) ||
@@ -510,7 +2126,6 @@ static int iFanCtrl_ReadCfgFile(const char *pcFilePath,
     {
       ERR_PRINTF("conversion failed (Fanspeed) for value \"%s\", Correct format: FanSpeedX=<speed in %%>,<temperature in 1/10 °C>",
                 caTmp);
-      IniFile_Dispose(tagFile);
       return(1);
     }
     tagaTemps[uiIndex].ucFanSpeedPercent=(unsigned char)lTmp;
@@ -523,20 +2138,1124 @@ static int iFanCtrl_ReadCfgFile(const char *pcFilePath,
     {
       ERR_PRINTF("conversion failed (Temperature) for value \"%s\", Correct format: FanSpeedX=<speed in %%>,<temperature in 1/10 °C>",
                 caTmp);
-      IniFile_Dispose(tagFile);
       return(1);
     }
     tagaTemps[uiIndex].iTemp=(int)lTmp;
   }
   if(uiIndex < 2) /* Check if enough temperature points where found */
   {
-    ERR_PUTS("Too less Temperature Points found in config file, minimum=2");
-
-    IniFile_Dispose(tagFile);
+    ERR_PRINTF("Too less Temperature Points found in section \"%s\", minimum=2",pcSection);
     return(1);
   }
   *puiTempsCount=uiIndex;
+  return(0);
+}
 
-  IniFile_Dispose(tagFile);
+/**
+ * Reads the curve profiles from the sections [Profile1], [Profile2], ...
+ * Reading stops at the first missing section.
+ *
+ * @return 0 on success, nonzero on failure.
+ */
+static int iFanCtrl_ReadProfiles_m(Inifile tagFile,
+                                   TagCfg_Profile tagaProfiles[FANCTRL_MAX_PROFILES],
+                                   TagCfg_Temperatures tagaProfileTemps[FANCTRL_MAX_PROFILES][MAX_TEMPERATURES_COUNT],
+                                   unsigned int *puiProfilesCount)
+{
+  char caSection[sizeof(CFGFILE_SECTION_NAME_PROFILE)+10];
+  const char *pcCurrKey;
+  unsigned int uiIndex;
+  int iRc;
+
+  for(uiIndex=0;uiIndex < FANCTRL_MAX_PROFILES;++uiIndex)
+  {
+    snprintf(caSection,sizeof(caSection),CFGFILE_SECTION_NAME_PROFILE "%u",uiIndex+1);
+    if(IniFile_Iterator_FindSection(tagFile,
+                                    caSection) != INI_ERR_NONE)
+      break;
+
+    tagaProfiles[uiIndex].caName[0]='\0';
+    tagaProfiles[uiIndex].usRuleBusy=0;
+    tagaProfiles[uiIndex].usRuleBusyTime=CFG_DEFAULT_PROFILE_BUSY_TIME;
+    tagaProfiles[uiIndex].caRulePowerProfile[0]='\0';
+    tagaProfiles[uiIndex].caRuleHint[0]='\0';
+    if(((iRc=iFanCtrl_ReadOptionalString_m(tagFile,
+                                           (pcCurrKey=CFGFILE_KEY_NAME_PROFILE_NAME),
+                                           tagaProfiles[uiIndex].caName,
+                                           sizeof(tagaProfiles[uiIndex].caName))) != INI_ERR_NONE) ||
+       ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                           (pcCurrKey=CFGFILE_KEY_NAME_PROFILE_RULE_BUSY),
+                                           &tagaProfiles[uiIndex].usRuleBusy)) != INI_ERR_NONE) ||
+       ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                           (pcCurrKey=CFGFILE_KEY_NAME_PROFILE_RULE_BUSY_TIME),
+                                           &tagaProfiles[uiIndex].usRuleBusyTime)) != INI_ERR_NONE) ||
+       ((iRc=iFanCtrl_ReadOptionalString_m(tagFile,
+                                           (pcCurrKey=CFGFILE_KEY_NAME_PROFILE_RULE_POWER_PROFILE),
+                                           tagaProfiles[uiIndex].caRulePowerProfile,
+                                           sizeof(tagaProfiles[uiIndex].caRulePowerProfile))) != INI_ERR_NONE) ||
+       ((iRc=iFanCtrl_ReadOptionalString_m(tagFile,
+                                           (pcCurrKey=CFGFILE_KEY_NAME_PROFILE_RULE_HINT),
+                                           tagaProfiles[uiIndex].caRuleHint,
+                                           sizeof(tagaProfiles[uiIndex].caRuleHint))) != INI_ERR_NONE))
+    {
+      ERR_PRINTF("Key \"%s\" in Section \"%s\": Failed getting Value from Key: Failure (%d): %s",
+                 pcCurrKey,
+                 caSection,
+                 iRc,
+                 IniFile_GetErrorText(iRc));
+      return(1);
+    }
+    if(!tagaProfiles[uiIndex].caName[0]) /* Unnamed, use the section name */
+      snprintf(tagaProfiles[uiIndex].caName,sizeof(tagaProfiles[uiIndex].caName),"%s",caSection);
+
+    if(iFanCtrl_ReadTempPoints_m(tagFile,
+                                 caSection,
+                                 tagaProfileTemps[uiIndex],
+                                 &tagaProfiles[uiIndex].uiTempsCount))
+      return(1);
+    tagaProfiles[uiIndex].ptagTemps=tagaProfileTemps[uiIndex];
+  }
+  *puiProfilesCount=uiIndex;
+  return(0);
+}
+
+/**
+ * Reads the per-sensor curves from the sections [SensorCurve1], [SensorCurve2], ...
+ * The sections are optional, a sensor without one uses the curve of the AMDGPU section (or the active profile).
+ *
+ * @return 0 on success, nonzero on failure.
+ */
+static int iFanCtrl_ReadSensorCurves_m(Inifile tagFile,
+                                       TagCfg_Sensor tagaSensors[MAX_SENSORS_COUNT],
+                                       TagCfg_Temperatures tagaSensorTemps[MAX_SENSORS_COUNT][MAX_TEMPERATURES_COUNT],
+                                       unsigned int uiSensorsCount)
+{
+  char caSection[sizeof(CFGFILE_SECTION_NAME_SENSOR_CURVE)+10];
+  unsigned int uiIndex;
+
+  for(uiIndex=0;uiIndex < uiSensorsCount;++uiIndex)
+  {
+    snprintf(caSection,sizeof(caSection),CFGFILE_SECTION_NAME_SENSOR_CURVE "%u",uiIndex+1);
+    if(IniFile_Iterator_FindSection(tagFile,
+                                    caSection) != INI_ERR_NONE)
+      continue;
+
+    if(iFanCtrl_ReadTempPoints_m(tagFile,
+                                 caSection,
+                                 tagaSensorTemps[uiIndex],
+                                 &tagaSensors[uiIndex].uiTempsCount))
+      return(1);
+    tagaSensors[uiIndex].ptagTemps=tagaSensorTemps[uiIndex];
+  }
+  return(0);
+}
+
+/**
+ * Reads the fan calibration from the section [Calibration], if present.
+ * Reading of the points stops at the first missing PointX key.
+ *
+ * @return 0 on success, nonzero on failure.
+ */
+static int iFanCtrl_ReadCalibration_m(Inifile tagFile,
+                                      TagCfg_Calibration *ptagCalibration)
+{
+  TagData tagCfgData;
+  char caKey[sizeof(CFGFILE_KEY_NAME_CALIBRATION_POINT)+10];
+  char caTmp[20];
+  char *pcTmp;
+  const char *pcCurrKey;
+  unsigned short usMinStartPWM=0;
+  unsigned short usMinSustainPWM=0;
+  unsigned int uiIndex;
+  long lPWM;
+  long lRPM;
+  int iRc;
+
+  memset(ptagCalibration,0,sizeof(TagCfg_Calibration));
+  if(IniFile_Iterator_FindSection(tagFile,
+                                  CFGFILE_SECTION_NAME_CALIBRATION) != INI_ERR_NONE)
+    return(0);
+
+  if(((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_CALIBRATION_MIN_START),
+                                         &usMinStartPWM)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_CALIBRATION_MIN_SUSTAIN),
+                                         &usMinSustainPWM)) != INI_ERR_NONE))
+  {
+    ERR_PRINTF("Key \"%s\" in Section \"" CFGFILE_SECTION_NAME_CALIBRATION "\": Failed getting Value from Key: Failure (%d): %s",
+               pcCurrKey,
+               iRc,
+               IniFile_GetErrorText(iRc));
+    return(1);
+  }
+  if((usMinStartPWM > UCHAR_MAX) ||
+     (usMinSustainPWM > UCHAR_MAX))
+  {
+    ERR_PRINTF("Invalid calibration: " CFGFILE_KEY_NAME_CALIBRATION_MIN_START "=%u, " CFGFILE_KEY_NAME_CALIBRATION_MIN_SUSTAIN "=%u (max. %u)",
+               usMinStartPWM,
+               usMinSustainPWM,
+               UCHAR_MAX);
+    return(1);
+  }
+  ptagCalibration->ucMinStartPWM=(unsigned char)usMinStartPWM;
+  ptagCalibration->ucMinSustainPWM=(unsigned char)usMinSustainPWM;
+
+  dataType_Set_String(&tagCfgData,
+                      caTmp,
+                      sizeof(caTmp),
+                      NULL,
+                      0,
+                      eRepr_String_Default);
+  for(uiIndex=0;uiIndex < FANCTRL_CALIBRATION_MAX_POINTS;++uiIndex)
+  {
+    snprintf(caKey,sizeof(caKey),CFGFILE_KEY_NAME_CALIBRATION_POINT "%u",uiIndex+1);
+    if(((iRc=IniFile_Iterator_FindKey(tagFile,
+                                      caKey)) != INI_ERR_NONE) &&
+       (iRc == INI_ERR_FIND_SECTION)) /* No more points */
+      break;
+    if((iRc != INI_ERR_NONE) ||
+       ((iRc=IniFile_Iterator_KeyGetValue(tagFile,
+                                          &tagCfgData)) != INI_ERR_NONE))
+    {
+      ERR_PRINTF("Key \"%s\" in Section \"" CFGFILE_SECTION_NAME_CALIBRATION "\": Failed getting Value from Key: Failure (%d): %s",
+                 caKey,
+                 iRc,
+                 IniFile_GetErrorText(iRc));
+      return(1);
+    }
+    lPWM=strtol(caTmp,&pcTmp,10);
+    if((*pcTmp == ',') &&
+       (lPWM >= 0) &&
+       (lPWM <= UCHAR_MAX))
+    {
+      ++pcTmp; /* Skip ',' */
+      lRPM=strtol(pcTmp,&pcTmp,10);
+    }
+    else
+      lRPM=-1;
+    if((*pcTmp != '\0') ||
+       (lRPM < 0) ||
+       (lRPM > USHRT_MAX))
+    {
+      ERR_PRINTF("conversion failed for value \"%s\", Correct format: " CFGFILE_KEY_NAME_CALIBRATION_POINT "X=<PWM>,<RPM>",
+                 caTmp);
+      return(1);
+    }
+    ptagCalibration->tagaPoints[uiIndex].ucPWM=(unsigned char)lPWM;
+    ptagCalibration->tagaPoints[uiIndex].usRPM=(unsigned short)lRPM;
+  }
+  /* Number and order of the points are checked by fanCtrl_AMDGPU_Init() */
+  ptagCalibration->ucPointsCount=(unsigned char)uiIndex;
   return(0);
 }
+
+static int iFanCtrl_ParseSensorFilter_m(const char *pcValue,
+                                        TagCfg_Sensor *ptagSensor)
+{
+  const char *pcParam;
+  char *pcTmp;
+  long lTmp;
+
+  if(!(pcParam=strchr(pcValue,',')))
+  {
+    if(strcmp(pcValue,CFGFILE_VALUE_FILTER_NONE) == 0)
+    {
+      ptagSensor->ucFilterType=SENSOR_FILTER_NONE;
+      return(0);
+    }
+    return(1);
+  }
+  if(((size_t)(pcParam-pcValue) == strlen(CFGFILE_VALUE_FILTER_EMA)) &&
+     (strncmp(pcValue,CFGFILE_VALUE_FILTER_EMA,pcParam-pcValue) == 0))
+    ptagSensor->ucFilterType=SENSOR_FILTER_EMA;
+  else if(((size_t)(pcParam-pcValue) == strlen(CFGFILE_VALUE_FILTER_MEDIAN)) &&
+          (strncmp(pcValue,CFGFILE_VALUE_FILTER_MEDIAN,pcParam-pcValue) == 0))
+    ptagSensor->ucFilterType=SENSOR_FILTER_MEDIAN;
+  else
+    return(1);
+
+  ++pcParam; /* Skip ',' */
+  lTmp=strtol(pcParam,&pcTmp,10);
+  if((pcTmp == pcParam) ||
+     (lTmp < 1) ||
+     (lTmp > UCHAR_MAX))
+    return(1);
+  ptagSensor->ucFilterParam=(unsigned char)lTmp;
+  if(*pcTmp == '\0')
+    return(0);
+  if((*pcTmp != ',') ||
+     (ptagSensor->ucFilterType != SENSOR_FILTER_EMA))
+    return(1);
+
+  pcParam=pcTmp+1; /* Skip ',' */
+  lTmp=strtol(pcParam,&pcTmp,10);
+  if((pcTmp == pcParam) ||
+     (*pcTmp != '\0') ||
+     (lTmp < 0) ||
+     (lTmp > USHRT_MAX))
+    return(1);
+  ptagSensor->usFilterStepBypass=(unsigned short)lTmp;
+  return(0);
+}
+
+/**
+ * Reads an optional unsigned value from the current section.
+ * If the key doesn't exist, *pusValue stays untouched.
+ *
+ * @return INI_ERR_NONE if the key was read or doesn't exist, Errorcode on failure.
+ */
+static int iFanCtrl_ReadOptionalUShort_m(Inifile tagFile,
+                                         const char *pcKey,
+                                         unsigned short *pusValue)
+{
+  TagData tagCfgData;
+  int iRc;
+
+  if((iRc=IniFile_Iterator_FindKey(tagFile,
+                                   pcKey)) != INI_ERR_NONE)
+    return((iRc == INI_ERR_FIND_SECTION)?INI_ERR_NONE:iRc);
+
+  dataType_Set_Uint(&tagCfgData,0,eRepr_Int_Default);
+  if((iRc=IniFile_Iterator_KeyGetValue(tagFile,
+                                       &tagCfgData)) != INI_ERR_NONE)
+    return(iRc);
+  if(DATA_GET_UINT(tagCfgData) > USHRT_MAX)
+    return(INI_ERR_CONVERSION);
+  *pusValue=(unsigned short)DATA_GET_UINT(tagCfgData);
+  return(INI_ERR_NONE);
+}
+
+/**
+ * Reads an optional string from the current section.
+ * If the key doesn't exist, the buffer stays untouched.
+ *
+ * @return INI_ERR_NONE if the key was read or doesn't exist, Errorcode on failure.
+ */
+static int iFanCtrl_ReadOptionalString_m(Inifile tagFile,
+                                         const char *pcKey,
+                                         char *pcBuffer,
+                                         unsigned int uiBufSize)
+{
+  TagData tagCfgData;
+  int iRc;
+
+  if((iRc=IniFile_Iterator_FindKey(tagFile,
+                                   pcKey)) != INI_ERR_NONE)
+    return((iRc == INI_ERR_FIND_SECTION)?INI_ERR_NONE:iRc);
+
+  dataType_Set_String(&tagCfgData,
+                      pcBuffer,
+                      uiBufSize,
+                      NULL,
+                      0,
+                      eRepr_String_Default);
+  return(IniFile_Iterator_KeyGetValue(tagFile,
+                                      &tagCfgData));
+}
+
+static int iFanCtrl_ReadIdentifyCfg_m(const char *pcFilePath,
+                                      const TagCfg_AMDGPU *ptagAMDGPU,
+                                      const TagCfg_Temperatures *ptagTemps,
+                                      unsigned int uiTempsCount,
+                                      TagCfg_Identify *ptagIdentify)
+{
+  Inifile tagFile;
+  const char *pcCurrSection=CFGFILE_SECTION_NAME_IDENTIFY;
+  const char *pcCurrKey=CFGFILE_KEY_NAME_IDENTIFY_SETPOINT;
+  unsigned short usFanSpeedLow;
+  unsigned short usFanSpeedHigh;
+  unsigned short usCycles;
+  int iRc;
+
+  /* Defaults: Relay between the lowest (non-zero) and highest fanspeed of the curve,
+   * abort at the critical temperature or at the hottest point of the curve */
+  memset(ptagIdentify,0,sizeof(TagCfg_Identify));
+  ptagIdentify->usHysteresis=CFG_DEFAULT_IDENTIFY_HYSTERESIS;
+  usFanSpeedLow=(ptagTemps[0].ucFanSpeedPercent)?ptagTemps[0].ucFanSpeedPercent:ptagTemps[1].ucFanSpeedPercent;
+  usFanSpeedHigh=ptagTemps[uiTempsCount-1].ucFanSpeedPercent;
+  usCycles=CFG_DEFAULT_IDENTIFY_CYCLES;
+  ptagIdentify->usSampleTime=CFG_DEFAULT_IDENTIFY_SAMPLE_TIME;
+  ptagIdentify->usSafetyTemp=(ptagAMDGPU->usCriticalTemp)?ptagAMDGPU->usCriticalTemp:
+                                                          (unsigned short)ptagTemps[uiTempsCount-1].iTemp;
+  ptagIdentify->usMaxDuration=CFG_DEFAULT_IDENTIFY_MAX_DURATION;
+
+  if((iRc=IniFile_New(&tagFile,
+                      pcFilePath,
+                      INI_OPT_CASE_SENSITIVE)) != INI_ERR_NONE)
+  {
+    ERR_PRINTF("IniFile_New(): Failed (%d): %s",
+               iRc,
+               IniFile_GetErrorText(iRc));
+    return(1);
+  }
+  if(((iRc=IniFile_Read(tagFile)) != INI_ERR_NONE) ||
+     ((iRc=IniFile_Iterator_FindSection(tagFile,
+                                        pcCurrSection)) != INI_ERR_NONE) ||
+     ((iRc=IniFile_Iterator_FindKey(tagFile,
+                                    pcCurrKey)) != INI_ERR_NONE))
+  {
+    ERR_PRINTF("Key \"%s\" in Section \"%s\" is needed for identification: Failure (%d): %s",
+               pcCurrKey,
+               pcCurrSection,
+               iRc,
+               IniFile_GetErrorText(iRc));
+    IniFile_Dispose(tagFile);
+    return(1);
+  }
+  if(((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_IDENTIFY_SETPOINT),
+                                         &ptagIdentify->usSetpoint)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_IDENTIFY_HYSTERESIS),
+                                         &ptagIdentify->usHysteresis)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_IDENTIFY_FANSPEED_LOW),
+                                         &usFanSpeedLow)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_IDENTIFY_FANSPEED_HIGH),
+                                         &usFanSpeedHigh)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_IDENTIFY_CYCLES),
+                                         &usCycles)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_IDENTIFY_SAMPLE_TIME),
+                                         &ptagIdentify->usSampleTime)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_IDENTIFY_SAFETY_TEMP),
+                                         &ptagIdentify->usSafetyTemp)) != INI_ERR_NONE) ||
+     ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                         (pcCurrKey=CFGFILE_KEY_NAME_IDENTIFY_MAX_DURATION),
+                                         &ptagIdentify->usMaxDuration)) != INI_ERR_NONE))
+  {
+    ERR_PRINTF("Key \"%s\" in Section \"%s\": Failed getting Value from Key: Failure (%d): %s",
+               pcCurrKey,
+               pcCurrSection,
+               iRc,
+               IniFile_GetErrorText(iRc));
+    IniFile_Dispose(tagFile);
+    return(1);
+  }
+  IniFile_Dispose(tagFile);
+
+  /* Range is checked by fanCtrl_Identify(), only avoid truncation here */
+  ptagIdentify->ucFanSpeedLow=(usFanSpeedLow > UCHAR_MAX)?UCHAR_MAX:(unsigned char)usFanSpeedLow;
+  ptagIdentify->ucFanSpeedHigh=(usFanSpeedHigh > UCHAR_MAX)?UCHAR_MAX:(unsigned char)usFanSpeedHigh;
+  ptagIdentify->ucCycles=(usCycles > UCHAR_MAX)?UCHAR_MAX:(unsigned char)usCycles;
+  return(0);
+}
+
+static int iFanCtrl_WriteIdentified_m(const char *pcFilePath,
+                                      const TagFanCtrl_Identified *ptagResult)
+{
+  const struct
+  {
+    const char *pcKey;
+    unsigned int uiValue;
+  }tagaValues[]={
+    {CFGFILE_KEY_NAME_IDENTIFIED_GAIN,            ptagResult->uiGain},
+    {CFGFILE_KEY_NAME_IDENTIFIED_TIME_CONSTANT,   ptagResult->uiTimeConstant},
+    {CFGFILE_KEY_NAME_IDENTIFIED_DEAD_TIME,       ptagResult->uiDeadTime},
+    {CFGFILE_KEY_NAME_IDENTIFIED_ULTIMATE_GAIN,   ptagResult->uiUltimateGain},
+    {CFGFILE_KEY_NAME_IDENTIFIED_ULTIMATE_PERIOD, ptagResult->uiUltimatePeriod},
+    {CFGFILE_KEY_NAME_IDENTIFIED_NOISE,           ptagResult->uiNoise},
+    {CFGFILE_KEY_NAME_IDENTIFIED_CURVE_SLOPE,     ptagResult->uiCurveSlope},
+    {CFGFILE_KEY_NAME_FANCTRL_UPDATETIME,         ptagResult->uiUpdateDelayTime},
+    {CFGFILE_KEY_NAME_FANCTRL_HYST_RISING,        ptagResult->tagHysteresis.usRisingDeadband},
+    {CFGFILE_KEY_NAME_FANCTRL_HYST_FALLING,       ptagResult->tagHysteresis.usFallingDeadband},
+    {CFGFILE_KEY_NAME_FANCTRL_HYST_MIN_DWELL,     ptagResult->tagHysteresis.usMinDwellTime},
+    {CFGFILE_KEY_NAME_FANCTRL_HYST_SLOPE_BYPASS,  ptagResult->tagHysteresis.usRisingSlopeBypass},
+    {CFGFILE_KEY_NAME_AMDGPU_PID_SETPOINT,        ptagResult->usPIDSetpoint},
+    {CFGFILE_KEY_NAME_AMDGPU_PID_KP,              ptagResult->usPIDKp},
+    {CFGFILE_KEY_NAME_AMDGPU_PID_KI,              ptagResult->usPIDKi},
+    {CFGFILE_KEY_NAME_AMDGPU_PID_KD,              ptagResult->usPIDKd},
+  };
+  Inifile tagFile;
+  TagData tagCfgData;
+  char caTmp[20];
+  char caBackupPath[PATH_MAX];
+  unsigned int uiIndex;
+  int iRc;
+
+  /* IniFile_Write() doesn't keep comments, so keep a copy of the original */
+  if(iFanCtrl_BackupFile_m(pcFilePath,caBackupPath,sizeof(caBackupPath)))
+    return(1);
+
+  if((iRc=IniFile_New(&tagFile,
+                      pcFilePath,
+                      INI_OPT_CASE_SENSITIVE)) != INI_ERR_NONE)
+  {
+    ERR_PRINTF("IniFile_New(): Failed (%d): %s",
+               iRc,
+               IniFile_GetErrorText(iRc));
+    return(1);
+  }
+  if((iRc=IniFile_Read(tagFile)) != INI_ERR_NONE)
+  {
+    ERR_PRINTF("Failed to read config file (%d): %s",
+               iRc,
+               IniFile_GetErrorText(iRc));
+    IniFile_Dispose(tagFile);
+    return(1);
+  }
+
+  for(uiIndex=0;uiIndex < sizeof(tagaValues)/sizeof(tagaValues[0]);++uiIndex)
+  {
+    dataType_Set_Uint(&tagCfgData,tagaValues[uiIndex].uiValue,eRepr_Int_Default);
+    if((iRc=IniFile_CreateEntry_SetValue(tagFile,
+                                         CFGFILE_SECTION_NAME_IDENTIFIED,
+                                         tagaValues[uiIndex].pcKey,
+                                         &tagCfgData)) != INI_ERR_NONE)
+      break;
+  }
+  for(uiIndex=0;(iRc == INI_ERR_NONE) && (uiIndex < FANCTRL_IDENTIFY_CURVE_POINTS);++uiIndex)
+  {
+    snprintf(caTmp,
+             sizeof(caTmp),
+             "%u,%d",
+             ptagResult->tagaCurve[uiIndex].ucFanSpeedPercent,
+             ptagResult->tagaCurve[uiIndex].iTemp);
+    dataType_Set_String(&tagCfgData,
+                        caTmp,
+                        sizeof(caTmp),
+                        caTmp,
+                        strlen(caTmp)+1,
+                        eRepr_String_Default);
+    iRc=IniFile_CreateEntry_SetValue(tagFile,
+                                     CFGFILE_SECTION_NAME_IDENTIFIED,
+                                     pcaCFGKeys_AMDGPU_Temps_m[uiIndex],
+                                     &tagCfgData);
+  }
+  if((iRc != INI_ERR_NONE) ||
+     ((iRc=IniFile_Write(tagFile)) != INI_ERR_NONE))
+  {
+    ERR_PRINTF("Failed to write section \"" CFGFILE_SECTION_NAME_IDENTIFIED "\" to config file (%d): %s",
+               iRc,
+               IniFile_GetErrorText(iRc));
+    IniFile_Dispose(tagFile);
+    return(1);
+  }
+  IniFile_Dispose(tagFile);
+  printf("fanctrl: Identification finished, recommended settings written to section [" CFGFILE_SECTION_NAME_IDENTIFIED "] of \"%s\"\n"
+         "         Original config file saved as \"%s\"\n",
+         pcFilePath,
+         caBackupPath);
+  return(0);
+}
+
+static int iFanCtrl_ReadCalibrateCfg_m(const char *pcFilePath,
+                                       const TagCfg_AMDGPU *ptagAMDGPU,
+                                       const TagCfg_Temperatures *ptagTemps,
+                                       unsigned int uiTempsCount,
+                                       TagCfg_Calibrate *ptagCalibrate)
+{
+  Inifile tagFile;
+  const char *pcCurrKey=CFGFILE_KEY_NAME_CALIBRATE_STEP;
+  unsigned short usStep=CFG_DEFAULT_CALIBRATE_STEP;
+  int iRc;
+
+  /* Defaults, abort at the critical temperature or at the hottest point of the curve */
+  memset(ptagCalibrate,0,sizeof(TagCfg_Calibrate));
+  ptagCalibrate->usSampleTime=CFG_DEFAULT_CALIBRATE_SAMPLE_TIME;
+  ptagCalibrate->usSettleTolerance=CFG_DEFAULT_CALIBRATE_SETTLE_TOLERANCE;
+  ptagCalibrate->usSettleTime=CFG_DEFAULT_CALIBRATE_SETTLE_TIME;
+  ptagCalibrate->usSafetyTemp=(ptagAMDGPU->usCriticalTemp)?ptagAMDGPU->usCriticalTemp:
+                                                           (unsigned short)ptagTemps[uiTempsCount-1].iTemp;
+
+  if((iRc=IniFile_New(&tagFile,
+                      pcFilePath,
+                      INI_OPT_CASE_SENSITIVE)) != INI_ERR_NONE)
+  {
+    ERR_PRINTF("IniFile_New(): Failed (%d): %s",
+               iRc,
+               IniFile_GetErrorText(iRc));
+    return(1);
+  }
+  if((iRc=IniFile_Read(tagFile)) != INI_ERR_NONE)
+  {
+    ERR_PRINTF("Failed to read config file (%d): %s",
+               iRc,
+               IniFile_GetErrorText(iRc));
+    IniFile_Dispose(tagFile);
+    return(1);
+  }
+  /* The section is optional, all keys have defaults */
+  if((IniFile_Iterator_FindSection(tagFile,
+                                   CFGFILE_SECTION_NAME_CALIBRATE) == INI_ERR_NONE) &&
+     (((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                          (pcCurrKey=CFGFILE_KEY_NAME_CALIBRATE_STEP),
+                                          &usStep)) != INI_ERR_NONE) ||
+      ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                          (pcCurrKey=CFGFILE_KEY_NAME_CALIBRATE_SAMPLE_TIME),
+                                          &ptagCalibrate->usSampleTime)) != INI_ERR_NONE) ||
+      ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                          (pcCurrKey=CFGFILE_KEY_NAME_CALIBRATE_SETTLE_TOLERANCE),
+                                          &ptagCalibrate->usSettleTolerance)) != INI_ERR_NONE) ||
+      ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                          (pcCurrKey=CFGFILE_KEY_NAME_CALIBRATE_SETTLE_TIME),
+                                          &ptagCalibrate->usSettleTime)) != INI_ERR_NONE) ||
+      ((iRc=iFanCtrl_ReadOptionalUShort_m(tagFile,
+                                          (pcCurrKey=CFGFILE_KEY_NAME_CALIBRATE_SAFETY_TEMP),
+                                          &ptagCalibrate->usSafetyTemp)) != INI_ERR_NONE)))
+  {
+    ERR_PRINTF("Key \"%s\" in Section \"" CFGFILE_SECTION_NAME_CALIBRATE "\": Failed getting Value from Key: Failure (%d): %s",
+               pcCurrKey,
+               iRc,
+               IniFile_GetErrorText(iRc));
+    IniFile_Dispose(tagFile);
+    return(1);
+  }
+  IniFile_Dispose(tagFile);
+
+  /* Range is checked by fanCtrl_Calibrate(), only avoid truncation here */
+  ptagCalibrate->ucStep=(usStep > UCHAR_MAX)?UCHAR_MAX:(unsigned char)usStep;
+  return(0);
+}
+
+static int iFanCtrl_WriteCalibration_m(const char *pcFilePath,
+                                       const TagCfg_Calibration *ptagResult)
+{
+  Inifile tagFile;
+  TagData tagCfgData;
+  char caKey[sizeof(CFGFILE_KEY_NAME_CALIBRATION_POINT)+10];
+  char caTmp[20];
+  char caBackupPath[PATH_MAX];
+  unsigned int uiIndex;
+  int iRc;
+
+  /* IniFile_Write() doesn't keep comments, so keep a copy of the original */
+  if(iFanCtrl_BackupFile_m(pcFilePath,caBackupPath,sizeof(caBackupPath)))
+    return(1);
+
+  if((iRc=IniFile_New(&tagFile,
+                      pcFilePath,
+                      INI_OPT_CASE_SENSITIVE)) != INI_ERR_NONE)
+  {
+    ERR_PRINTF("IniFile_New(): Failed (%d): %s",
+               iRc,
+               IniFile_GetErrorText(iRc));
+    return(1);
+  }
+  if((iRc=IniFile_Read(tagFile)) != INI_ERR_NONE)
+  {
+    ERR_PRINTF("Failed to read config file (%d): %s",
+               iRc,
+               IniFile_GetErrorText(iRc));
+    IniFile_Dispose(tagFile);
+    return(1);
+  }
+
+  /* Replace an older calibration, it may have more points */
+  IniFile_DeleteEntry_Section(tagFile,
+                              CFGFILE_SECTION_NAME_CALIBRATION);
+  dataType_Set_Uint(&tagCfgData,ptagResult->ucMinStartPWM,eRepr_Int_Default);
+  if((iRc=IniFile_CreateEntry_SetValue(tagFile,
+                                       CFGFILE_SECTION_NAME_CALIBRATION,
+                                       CFGFILE_KEY_NAME_CALIBRATION_MIN_START,
+                                       &tagCfgData)) == INI_ERR_NONE)
+  {
+    dataType_Set_Uint(&tagCfgData,ptagResult->ucMinSustainPWM,eRepr_Int_Default);
+    iRc=IniFile_CreateEntry_SetValue(tagFile,
+                                     CFGFILE_SECTION_NAME_CALIBRATION,
+                                     CFGFILE_KEY_NAME_CALIBRATION_MIN_SUSTAIN,
+                                     &tagCfgData);
+  }
+  for(uiIndex=0;(iRc == INI_ERR_NONE) && (uiIndex < ptagResult->ucPointsCount);++uiIndex)
+  {
+    snprintf(caKey,sizeof(caKey),CFGFILE_KEY_NAME_CALIBRATION_POINT "%u",uiIndex+1);
+    snprintf(caTmp,
+             sizeof(caTmp),
+             "%u,%u",
+             ptagResult->tagaPoints[uiIndex].ucPWM,
+             ptagResult->tagaPoints[uiIndex].usRPM);
+    dataType_Set_String(&tagCfgData,
+                        caTmp,
+                        sizeof(caTmp),
+                        caTmp,
+                        strlen(caTmp)+1,
+                        eRepr_String_Default);
+    iRc=IniFile_CreateEntry_SetValue(tagFile,
+                                     CFGFILE_SECTION_NAME_CALIBRATION,
+                                     caKey,
+                                     &tagCfgData);
+  }
+  if((iRc != INI_ERR_NONE) ||
+     ((iRc=IniFile_Write(tagFile)) != INI_ERR_NONE))
+  {
+    ERR_PRINTF("Failed to write section \"" CFGFILE_SECTION_NAME_CALIBRATION "\" to config file (%d): %s",
+               iRc,
+               IniFile_GetErrorText(iRc));
+    IniFile_Dispose(tagFile);
+    return(1);
+  }
+  IniFile_Dispose(tagFile);
+  printf("fanctrl: Calibration finished, min. start=%u pwm, min. sustain=%u pwm, written to section [" CFGFILE_SECTION_NAME_CALIBRATION "] of \"%s\"\n"
+         "         Original config file saved as \"%s\"\n",
+         ptagResult->ucMinStartPWM,
+         ptagResult->ucMinSustainPWM,
+         pcFilePath,
+         caBackupPath);
+  return(0);
+}
+
+/**
+ * Copies the file to <file>.bak, or to <file>.bak.1, .bak.2, ... if it exists already.
+ * An existing backup is never overwritten, so the original config file survives repeated runs.
+ *
+ * @param pcBackupPath  _OUT_ Path of the backup
+ *
+ * @return 0 on success, nonzero on error.
+ */
+static int iFanCtrl_BackupFile_m(const char *pcFilePath,
+                                 char *pcBackupPath,
+                                 size_t szBackupPathSize)
+{
+  unsigned int uiIndex;
+  int iRc;
+
+  for(uiIndex=0;uiIndex < CFGFILE_BACKUP_MAX;++uiIndex)
+  {
+    if((uiIndex == 0)?
+       ((size_t)snprintf(pcBackupPath,szBackupPathSize,"%s" CFGFILE_BACKUP_SUFFIX,pcFilePath) >= szBackupPathSize):
+       ((size_t)snprintf(pcBackupPath,szBackupPathSize,"%s" CFGFILE_BACKUP_SUFFIX ".%u",pcFilePath,uiIndex) >= szBackupPathSize))
+    {
+      ERR_PRINTF("Path too long: \"%s\"",pcFilePath);
+      return(1);
+    }
+    if((iRc=iFanCtrl_CopyFile_m(pcFilePath,pcBackupPath)) >= 0)
+      return(iRc);
+  }
+  ERR_PRINTF("Too many backups of \"%s\", remove old ones",pcFilePath);
+  return(1);
+}
+
+/**
+ * Copies the file, the destination is created and must not exist.
+ *
+ * @return 0 on success, -1 if the destination exists, 1 on error.
+ */
+static int iFanCtrl_CopyFile_m(const char *pcSrcPath,
+                               const char *pcDstPath)
+{
+  FILE *fpSrc;
+  FILE *fpDst;
+  char caBuffer[4096];
+  size_t sizeRead;
+  int iFd;
+  int iRc=0;
+
+  if((iFd=open(pcDstPath,O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,0644)) < 0)
+  {
+    if(errno == EEXIST)
+      return(-1);
+    ERR_PRINTF("Failed to create \"%s\": %s",pcDstPath,strerror(errno));
+    return(1);
+  }
+  if(!(fpDst=fdopen(iFd,"wb")))
+  {
+    ERR_PRINTF("Failed to create \"%s\": %s",pcDstPath,strerror(errno));
+    close(iFd);
+    unlink(pcDstPath);
+    return(1);
+  }
+  if(!(fpSrc=fopen(pcSrcPath,"rb")))
+  {
+    ERR_PRINTF("Failed to open \"%s\": %s",pcSrcPath,strerror(errno));
+    fclose(fpDst);
+    unlink(pcDstPath);
+    return(1);
+  }
+  while((sizeRead=fread(caBuffer,1,sizeof(caBuffer),fpSrc)) > 0)
+  {
+    if(fwrite(caBuffer,1,sizeRead,fpDst) != sizeRead)
+    {
+      iRc=1;
+      break;
+    }
+  }
+  if(ferror(fpSrc))
+    iRc=1;
+  if(fclose(fpDst))
+    iRc=1;
+  fclose(fpSrc);
+  if(iRc)
+  {
+    ERR_PRINTF("Failed to copy \"%s\" to \"%s\"",pcSrcPath,pcDstPath);
+    unlink(pcDstPath); /* Would block the name for the next backup */
+  }
+  return(iRc);
+}
+
+/**
+ * Verifies the config file and exports it to a C header, for the static build (see target fanctrl-static in the makefile).
+ * The device is not accessed, its sysfs files are verified by the static build at start.
+ *
+ * @return 0 on success, nonzero if the configuration is invalid or the header couldn't be written.
+ */
+static int iFanCtrl_ExportStatic_m(const char *pcFilePath,
+                                   const char *pcHeaderPath)
+{
+  TagCfgSet *ptagSet=&tagaCfgSets_m[0];
+  char caPathTmp[PATH_MAX];
+  FILE *fp;
+  int iRc;
+
+  if(iFanCtrl_ReadCfgSet_m(pcFilePath,ptagSet))
+  {
+    ERR_PUTS("iFanCtrl_ReadCfgFile() failed");
+    return(1);
+  }
+  if(fanCtrl_AMDGPU_Verify(ptagSet->uiUpdateTime,
+                           &ptagSet->tagHysteresis,
+                           &ptagSet->tagConfig,
+                           ptagSet->tagaSensors,
+                           ptagSet->uiSensorsCount,
+                           ptagSet->tagaTemps,
+                           ptagSet->uiTemperaturesCount,
+                           ptagSet->tagaProfiles,
+                           ptagSet->uiProfilesCount))
+  {
+    ERR_PRINTF("Invalid configuration \"%s\", not exported",
+               pcFilePath);
+    return(1);
+  }
+
+  /* Written aside, so a failed export doesn't leave a partial header for the build */
+  if(snprintf(caPathTmp,sizeof(caPathTmp),"%s.tmp",pcHeaderPath) >= (int)sizeof(caPathTmp))
+  {
+    ERR_PRINTF("Path too long: \"%s\"",pcHeaderPath);
+    return(1);
+  }
+  if(!(fp=fopen(caPathTmp,"w")))
+  {
+    ERR_PRINTF("Failed to create \"%s\": %s",caPathTmp,strerror(errno));
+    return(1);
+  }
+  iRc=iFanCtrl_WriteStaticCfg_m(fp,pcFilePath,ptagSet);
+  if(ferror(fp))
+    iRc=1;
+  if(fclose(fp))
+    iRc=1;
+  if((!iRc) &&
+     (rename(caPathTmp,pcHeaderPath) != 0))
+  {
+    ERR_PRINTF("Failed to rename \"%s\" to \"%s\": %s",caPathTmp,pcHeaderPath,strerror(errno));
+    iRc=1;
+  }
+  if(iRc)
+  {
+    unlink(caPathTmp);
+    return(1);
+  }
+  printf("fanctrl: Configuration \"%s\" exported to \"%s\"\n",
+         pcFilePath,
+         pcHeaderPath);
+  return(0);
+}
+
+/**
+ * Writes the configuration set as header: Constant structs and curve points, named tag(a)FanCtrlStatic_*,
+ * the counts and the storage size as FANCTRL_STATIC_* defines.
+ *
+ * @return 0 on success, nonzero if a config field isn't covered by the field tables.
+ */
+static int iFanCtrl_WriteStaticCfg_m(FILE *fp,
+                                     const char *pcFilePath,
+                                     const TagCfgSet *ptagSet)
+{
+  char caTemps[64];
+  unsigned int uiIndex;
+  unsigned int uiPoint;
+  int iRc=0;
+
+  fprintf(fp,
+          "/* Generated by \"fanctrl <config file> %s <header>\", do not edit. */\n"
+          "#ifndef FANCTRL_STATIC_CFG_H_INCLUDED\n"
+          "  #define FANCTRL_STATIC_CFG_H_INCLUDED\n"
+          "\n"
+          "#include \"fanctrl.h\"\n"
+          "\n"
+          "#define FANCTRL_STATIC_CFG_FILE        ",
+          tagaCLICommands_m[CLI_CMD_INDEX_EXPORT_STATIC].pcCmd);
+  vFanCtrl_WriteStaticString_m(fp,pcFilePath);
+  fprintf(fp,
+          "\n"
+          "#define FANCTRL_STATIC_UPDATE_TIME     %u\n"
+          "#define FANCTRL_STATIC_SENSORS_COUNT   %u\n"
+          "#define FANCTRL_STATIC_TEMPS_COUNT     %u\n"
+          "#define FANCTRL_STATIC_PROFILES_COUNT  %u\n"
+          "#define FANCTRL_STATIC_STORAGE_SIZE    %lu\n"
+          "\n"
+          "static const TagCfg_Hysteresis tagFanCtrlStatic_Hysteresis=",
+          ptagSet->uiUpdateTime,
+          ptagSet->uiSensorsCount,
+          ptagSet->uiTemperaturesCount,
+          ptagSet->uiProfilesCount,
+          (unsigned long)fanCtrl_AMDGPU_StorageSize(ptagSet->tagaSensors,
+                                                    ptagSet->uiSensorsCount,
+                                                    ptagSet->tagaTemps,
+                                                    ptagSet->uiTemperaturesCount,
+                                                    ptagSet->tagaProfiles,
+                                                    ptagSet->uiProfilesCount));
+  iRc|=iFanCtrl_WriteStaticStruct_m(fp,
+                                    (const unsigned char*)&ptagSet->tagHysteresis,
+                                    sizeof(TagCfg_Hysteresis),
+                                    tagaStaticFields_Hysteresis_m,
+                                    sizeof(tagaStaticFields_Hysteresis_m)/sizeof(tagaStaticFields_Hysteresis_m[0]),
+                                    NULL,
+                                    "");
+  fputs(";\n\n",fp);
+
+  /* Curve points, referred to by the structs below */
+  fputs("static const TagCfg_Temperatures tagaFanCtrlStatic_Temps[]={",fp);
+  for(uiPoint=0;uiPoint < ptagSet->uiTemperaturesCount;++uiPoint)
+  {
+    fputs((uiPoint)?",\n  ":"\n  ",fp);
+    iRc|=iFanCtrl_WriteStaticStruct_m(fp,
+                                      (const unsigned char*)&ptagSet->tagaTemps[uiPoint],
+                                      sizeof(TagCfg_Temperatures),
+                                      tagaStaticFields_Temperatures_m,
+                                      sizeof(tagaStaticFields_Temperatures_m)/sizeof(tagaStaticFields_Temperatures_m[0]),
+                                      NULL,
+                                      "");
+  }
+  fputs("\n};\n",fp);
+  for(uiIndex=0;uiIndex < ptagSet->uiSensorsCount+ptagSet->uiProfilesCount;++uiIndex)
+  {
+    const TagCfg_Temperatures *ptagTemps;
+    unsigned int uiTempsCount;
+
+    if(uiIndex < ptagSet->uiSensorsCount)
+    {
+      ptagTemps=(ptagSet->tagaSensors[uiIndex].ptagTemps)?ptagSet->tagaSensorTemps[uiIndex]:NULL;
+      uiTempsCount=ptagSet->tagaSensors[uiIndex].uiTempsCount;
+      fprintf(fp,"static const TagCfg_Temperatures tagaFanCtrlStatic_SensorTemps%u[]={",uiIndex+1);
+    }
+    else
+    {
+      ptagTemps=(ptagSet->tagaProfiles[uiIndex-ptagSet->uiSensorsCount].ptagTemps)?ptagSet->tagaProfileTemps[uiIndex-ptagSet->uiSensorsCount]:NULL;
+      uiTempsCount=ptagSet->tagaProfiles[uiIndex-ptagSet->uiSensorsCount].uiTempsCount;
+      fprintf(fp,"static const TagCfg_Temperatures tagaFanCtrlStatic_ProfileTemps%u[]={",uiIndex-ptagSet->uiSensorsCount+1);
+    }
+    if(!ptagTemps)
+    {
+      fputs("{.iTemp=0}};\n",fp); /* Unused, keeps the names consistent */
+      continue;
+    }
+    for(uiPoint=0;uiPoint < uiTempsCount;++uiPoint)
+    {
+      fputs((uiPoint)?",\n  ":"\n  ",fp);
+      iRc|=iFanCtrl_WriteStaticStruct_m(fp,
+                                        (const unsigned char*)&ptagTemps[uiPoint],
+                                        sizeof(TagCfg_Temperatures),
+                                        tagaStaticFields_Temperatures_m,
+                                        sizeof(tagaStaticFields_Temperatures_m)/sizeof(tagaStaticFields_Temperatures_m[0]),
+                                        NULL,
+                                        "");
+    }
+    fputs("\n};\n",fp);
+  }
+
+  fputs("\nstatic const TagCfg_Sensor tagaFanCtrlStatic_Sensors[]={",fp);
+  for(uiIndex=0;uiIndex < ptagSet->uiSensorsCount;++uiIndex)
+  {
+    snprintf(caTemps,sizeof(caTemps),"tagaFanCtrlStatic_SensorTemps%u",uiIndex+1);
+    fputs((uiIndex)?",\n  ":"\n  ",fp);
+    iRc|=iFanCtrl_WriteStaticStruct_m(fp,
+                                      (const unsigned char*)&ptagSet->tagaSensors[uiIndex],
+                                      sizeof(TagCfg_Sensor),
+                                      tagaStaticFields_Sensor_m,
+                                      sizeof(tagaStaticFields_Sensor_m)/sizeof(tagaStaticFields_Sensor_m[0]),
+                                      caTemps,
+                                      "");
+  }
+  fputs("\n};\n\n",fp);
+
+  /* At least one element, the count is FANCTRL_STATIC_PROFILES_COUNT */
+  fputs("static const TagCfg_Profile tagaFanCtrlStatic_Profiles[]={",fp);
+  for(uiIndex=0;uiIndex < ptagSet->uiProfilesCount;++uiIndex)
+  {
+    snprintf(caTemps,sizeof(caTemps),"tagaFanCtrlStatic_ProfileTemps%u",uiIndex+1);
+    fputs((uiIndex)?",\n  ":"\n  ",fp);
+    iRc|=iFanCtrl_WriteStaticStruct_m(fp,
+                                      (const unsigned char*)&ptagSet->tagaProfiles[uiIndex],
+                                      sizeof(TagCfg_Profile),
+                                      tagaStaticFields_Profile_m,
+                                      sizeof(tagaStaticFields_Profile_m)/sizeof(tagaStaticFields_Profile_m[0]),
+                                      caTemps,
+                                      "");
+  }
+  fputs((ptagSet->uiProfilesCount)?"\n};\n\n":"{.uiTempsCount=0}};\n\n",fp);
+
+  fputs("static const TagCfg_AMDGPU tagFanCtrlStatic_Config=",fp);
+  iRc|=iFanCtrl_WriteStaticStruct_m(fp,
+                                    (const unsigned char*)&ptagSet->tagConfig,
+                                    sizeof(TagCfg_AMDGPU),
+                                    tagaStaticFields_AMDGPU_m,
+                                    sizeof(tagaStaticFields_AMDGPU_m)/sizeof(tagaStaticFields_AMDGPU_m[0]),
+                                    NULL,
+                                    "\n  ");
+  fputs(";\n\n#endif /* FANCTRL_STATIC_CFG_H_INCLUDED */\n",fp);
+  return(iRc);
+}
+
+/**
+ * Writes a struct as initializer with designated fields, zero fields are omitted.
+ * Fails, if a nonzero byte of the struct isn't covered by the field table.
+ *
+ * @param pcTemps  _IN_ Name of the points for STATIC_FIELD_TEMPS fields, NULL if the struct has none.
+ * @param pcIndent _IN_ Separator before each field, e.g. a newline for the top level struct.
+ *
+ * @return 0 on success, nonzero if a field is missing in the table.
+ */
+static int iFanCtrl_WriteStaticStruct_m(FILE *fp,
+                                        const unsigned char *pucStruct,
+                                        unsigned int uiSize,
+                                        const TagStaticField *ptagFields,
+                                        unsigned int uiFieldsCount,
+                                        const char *pcTemps,
+                                        const char *pcIndent)
+{
+  const TagStaticField *ptagField;
+  unsigned int uiIndex;
+  unsigned int uiByte;
+  unsigned int uiElement;
+  unsigned int uiElementSize;
+  unsigned int uiElements;
+  unsigned int uiVal;
+  unsigned short usVal;
+  unsigned char ucVal;
+  int iVal;
+  int iFirst=1;
+  int iRc=0;
+
+  /* Every nonzero byte must be exported, the sets are cleared before reading, so padding is zero */
+  for(uiByte=0;uiByte < uiSize;++uiByte)
+  {
+    if(!pucStruct[uiByte])
+      continue;
+    for(uiIndex=0;uiIndex < uiFieldsCount;++uiIndex)
+    {
+      if((uiByte >= ptagFields[uiIndex].uiOffset) &&
+         (uiByte < ptagFields[uiIndex].uiOffset+ptagFields[uiIndex].uiSize))
+        break;
+    }
+    if(uiIndex == uiFieldsCount)
+    {
+      ERR_PRINTF("Static export: Config field at offset %u (struct size %u) is missing in the field table",
+                 uiByte,
+                 uiSize);
+      return(1);
+    }
+  }
+
+  fputc('{',fp);
+  for(uiIndex=0;uiIndex < uiFieldsCount;++uiIndex)
+  {
+    ptagField=&ptagFields[uiIndex];
+    for(uiByte=0;uiByte < ptagField->uiSize;++uiByte)
+    {
+      if(pucStruct[ptagField->uiOffset+uiByte])
+        break;
+    }
+    if(uiByte == ptagField->uiSize) /* Zero, omitted */
+      continue;
+    fprintf(fp,"%s%s.%s=",(iFirst)?"":",",pcIndent,ptagField->pcName);
+    iFirst=0;
+    switch(ptagField->uiType)
+    {
+      case STATIC_FIELD_UNSIGNED:
+        if(ptagField->uiSize == sizeof(ucVal))
+        {
+          memcpy(&ucVal,pucStruct+ptagField->uiOffset,sizeof(ucVal));
+          uiVal=ucVal;
+        }
+        else if(ptagField->uiSize == sizeof(usVal))
+        {
+          memcpy(&usVal,pucStruct+ptagField->uiOffset,sizeof(usVal));
+          uiVal=usVal;
+        }
+        else
+          memcpy(&uiVal,pucStruct+ptagField->uiOffset,sizeof(uiVal));
+        fprintf(fp,"%u",uiVal);
+        break;
+      case STATIC_FIELD_INT:
+        memcpy(&iVal,pucStruct+ptagField->uiOffset,sizeof(iVal));
+        fprintf(fp,"%d",iVal);
+        break;
+      case STATIC_FIELD_STRING:
+        vFanCtrl_WriteStaticString_m(fp,(const char*)pucStruct+ptagField->uiOffset);
+        break;
+      case STATIC_FIELD_TEMPS:
+        fputs(pcTemps,fp);
+        break;
+      case STATIC_FIELD_STRUCT:
+        uiElementSize=ptagField->uiSize/ptagField->uiElements;
+        if(ptagField->uiElements == 1)
+        {
+          iRc|=iFanCtrl_WriteStaticStruct_m(fp,
+                                            pucStruct+ptagField->uiOffset,
+                                            uiElementSize,
+                                            ptagField->ptagSub,
+                                            ptagField->uiSubCount,
+                                            pcTemps,
+                                            "");
+          break;
+        }
+        /* Array, up to the last nonzero element */
+        for(uiElements=ptagField->uiElements;uiElements > 0;--uiElements)
+        {
+          for(uiByte=0;uiByte < uiElementSize;++uiByte)
+          {
+            if(pucStruct[ptagField->uiOffset+(uiElements-1)*uiElementSize+uiByte])
+              break;
+          }
+          if(uiByte < uiElementSize)
+            break;
+        }
+        fputc('{',fp);
+        for(uiElement=0;uiElement < uiElements;++uiElement)
+        {
+          if(uiElement)
+            fputc(',',fp);
+          iRc|=iFanCtrl_WriteStaticStruct_m(fp,
+                                            pucStruct+ptagField->uiOffset+uiElement*uiElementSize,
+                                            uiElementSize,
+                                            ptagField->ptagSub,
+                                            ptagField->uiSubCount,
+                                            pcTemps,
+                                            "");
+        }
+        fputc('}',fp);
+        break;
+      default:
+        break;
+    }
+  }
+  if(iFirst) /* All zero, designated to avoid missing initializer warnings */
+    fprintf(fp,".%s=%s}",ptagFields[0].pcName,(ptagFields[0].uiType == STATIC_FIELD_STRING)?"\"\"":"0");
+  else
+    fputs((pcIndent[0])?"\n}":"}",fp);
+  return(iRc);
+}
+
+/**
+ * Writes a string as C string literal.
+ */
+static void vFanCtrl_WriteStaticString_m(FILE *fp,
+                                         const char *pcString)
+{
+  fputc('\"',fp);
+  for(;*pcString;++pcString)
+  {
+    if((*pcString == '\"') ||
+       (*pcString == '\\'))
+      fprintf(fp,"\\%c",*pcString);
+    else if((*pcString < ' ') ||
+            (*pcString == 0x7F))
+      fprintf(fp,"\\%03o",(unsigned char)*pcString);
+    else
+      fputc(*pcString,fp);
+  }
+  fputc('\"',fp);
+}
@@ -0,0 +1,780 @@
+#define _DEFAULT_SOURCE /* For M_PI */
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+
+#include "fanctrl.h"
+#include "fanctrl_fixp.h"
+#include "fanctrl_ctrl.h"
+
+/**
+ * Sensor Filter
+ */
+void ctrlFilter_Init(TagCtrlFilter *ptagFilter,
+                     unsigned int uiType,
+                     unsigned int uiParam,
+                     int iStepBypass)
+{
+  ptagFilter->uiType=uiType;
+  ptagFilter->uiParam=uiParam;
+  ptagFilter->iStepBypass=iStepBypass;
+  ptagFilter->lEMAState=0;
+  ptagFilter->uiWindowUsed=0;
+  ptagFilter->uiWindowPos=0;
+  ptagFilter->ulSamples=0;
+}
+
+int ctrlFilter_Update(TagCtrlFilter *ptagFilter,
+                      int iSample)
+{
+  int iaSorted[CTRL_FILTER_MEDIAN_MAX_WINDOW];
+  unsigned int uiIndex;
+  unsigned int uiPos;
+  int iTmp;
+
+  ++ptagFilter->ulSamples;
+  switch(ptagFilter->uiType)
+  {
+    case SENSOR_FILTER_EMA:
+      if((ptagFilter->ulSamples == 1) ||
+         ((ptagFilter->iStepBypass) &&
+          (iSample-fixp_ToInt(ptagFilter->lEMAState) >= ptagFilter->iStepBypass)))
+      {/* First sample or real load step: follow immediately */
+        ptagFilter->lEMAState=FIXP_FROM_INT(iSample);
+      }
+      else
+      {
+        ptagFilter->lEMAState+=fixp_DivRound((FIXP_FROM_INT(iSample)-ptagFilter->lEMAState)*(long)ptagFilter->uiParam,100);
+      }
+      return(fixp_ToInt(ptagFilter->lEMAState));
+
+    case SENSOR_FILTER_MEDIAN:
+      ptagFilter->iaWindow[ptagFilter->uiWindowPos]=iSample;
+      ptagFilter->uiWindowPos=(ptagFilter->uiWindowPos+1)%ptagFilter->uiParam;
+      if(ptagFilter->uiWindowUsed < ptagFilter->uiParam)
+        ++ptagFilter->uiWindowUsed;
+
+      /* Insertion sort, window is tiny */
+      for(uiIndex=0;uiIndex < ptagFilter->uiWindowUsed;++uiIndex)
+      {
+        iTmp=ptagFilter->iaWindow[uiIndex];
+        for(uiPos=uiIndex;(uiPos > 0) && (iaSorted[uiPos-1] > iTmp);--uiPos)
+          iaSorted[uiPos]=iaSorted[uiPos-1];
+        iaSorted[uiPos]=iTmp;
+      }
+      if(ptagFilter->uiWindowUsed & 0x1)
+        return(iaSorted[ptagFilter->uiWindowUsed/2]);
+      /* Even count: mean of both middle values */
+      return((int)fixp_DivRound((long)iaSorted[ptagFilter->uiWindowUsed/2-1]+iaSorted[ptagFilter->uiWindowUsed/2],2));
+
+    case SENSOR_FILTER_NONE:
+    default:
+      return(iSample);
+  }
+}
+
+/**
+ * Hysteresis engine
+ */
+void ctrlHysteresis_Init(TagCtrlHysteresis *ptagHyst,
+                         int iRisingDeadband,
+                         int iFallingDeadband,
+                         unsigned long ulMinDwellTimeMs,
+                         int iRisingSlopeBypass)
+{
+  ptagHyst->iRisingDeadband=iRisingDeadband;
+  ptagHyst->iFallingDeadband=iFallingDeadband;
+  ptagHyst->ulMinDwellTimeMs=ulMinDwellTimeMs;
+  ptagHyst->iRisingSlopeBypass=iRisingSlopeBypass;
+  ptagHyst->iLastUpdateTemp=0;
+  ptagHyst->ulLastUpdateMs=0;
+  ptagHyst->iPrevTemp=0;
+  ptagHyst->ulPrevMs=0;
+  ptagHyst->ulPendingSinceMs=0;
+  ptagHyst->iValid=0;
+  ptagHyst->ulAccepted=0;
+  ptagHyst->ulSuppressedDeadband=0;
+  ptagHyst->ulSuppressedDwell=0;
+  ptagHyst->ulSlopeBypass=0;
+  ptagHyst->ulMaxDwellDelayMs=0;
+}
+
+int ctrlHysteresis_Check(TagCtrlHysteresis *ptagHyst,
+                         int iTemp,
+                         unsigned long ulNowMs)
+{
+  int iSlope=0;
+  int iChange;
+
+  if(!ptagHyst->iValid) /* First sample, always update */
+  {
+    ctrlHysteresis_Force(ptagHyst,iTemp,ulNowMs);
+    ++ptagHyst->ulAccepted;
+    return(1);
+  }
+
+  /* Rising slope since previous sample, in 1/10 °C per second */
+  if(ulNowMs > ptagHyst->ulPrevMs)
+    iSlope=(int)fixp_DivRound((long)(iTemp-ptagHyst->iPrevTemp)*1000,(long)(ulNowMs-ptagHyst->ulPrevMs));
+  ptagHyst->iPrevTemp=iTemp;
+  ptagHyst->ulPrevMs=ulNowMs;
+
+  iChange=iTemp-ptagHyst->iLastUpdateTemp;
+  if(iChange == 0)
+  {
+    ptagHyst->ulPendingSinceMs=0;
+    return(0);
+  }
+
+  if((ptagHyst->iRisingSlopeBypass) &&
+     (iSlope >= ptagHyst->iRisingSlopeBypass))
+  {/* Fast rise: respond immediately, regardless of deadband and dwell time */
+    ++ptagHyst->ulSlopeBypass;
+    ++ptagHyst->ulAccepted;
+    ctrlHysteresis_Force(ptagHyst,iTemp,ulNowMs);
+    return(1);
+  }
+
+  if(((iChange > 0) && (iChange < ptagHyst->iRisingDeadband)) ||
+     ((iChange < 0) && (-iChange < ptagHyst->iFallingDeadband)))
+  {
+    ++ptagHyst->ulSuppressedDeadband;
+    ptagHyst->ulPendingSinceMs=0;
+    return(0);
+  }
+
+  if(ulNowMs-ptagHyst->ulLastUpdateMs < ptagHyst->ulMinDwellTimeMs)
+  {
+    ++ptagHyst->ulSuppressedDwell;
+    if(!ptagHyst->ulPendingSinceMs)
+      ptagHyst->ulPendingSinceMs=ulNowMs;
+    return(0);
+  }
+
+  if((ptagHyst->ulPendingSinceMs) &&
+     (ulNowMs-ptagHyst->ulPendingSinceMs > ptagHyst->ulMaxDwellDelayMs))
+    ptagHyst->ulMaxDwellDelayMs=ulNowMs-ptagHyst->ulPendingSinceMs;
+
+  ++ptagHyst->ulAccepted;
+  ctrlHysteresis_Force(ptagHyst,iTemp,ulNowMs);
+  return(1);
+}
+
+void ctrlHysteresis_Force(TagCtrlHysteresis *ptagHyst,
+                          int iTemp,
+                          unsigned long ulNowMs)
+{
+  ptagHyst->iLastUpdateTemp=iTemp;
+  ptagHyst->ulLastUpdateMs=ulNowMs;
+  ptagHyst->iPrevTemp=iTemp;
+  ptagHyst->ulPrevMs=ulNowMs;
+  ptagHyst->ulPendingSinceMs=0;
+  ptagHyst->iValid=1;
+}
+
+/**
+ * PID controller
+ */
+void ctrlPID_Init(TagCtrlPID *ptagPID,
+                  int iSetpoint,
+                  unsigned int uiKp,
+                  unsigned int uiKi,
+                  unsigned int uiKd,
+                  int iOutMin,
+                  int iOutMax)
+{
+  ptagPID->llKp=uiKp;
+  ptagPID->llKi=uiKi;
+  ptagPID->llKd=uiKd;
+  ptagPID->iSetpoint=iSetpoint;
+  ptagPID->iOutMin=iOutMin;
+  ptagPID->iOutMax=iOutMax;
+  ptagPID->llIntegral=0;
+  ptagPID->iPrevTemp=0;
+  ptagPID->iValid=0;
+  ptagPID->llLastP=0;
+  ptagPID->llLastD=0;
+  ptagPID->ulSaturated=0;
+}
+
+void ctrlPID_Track(TagCtrlPID *ptagPID,
+                   int iTemp,
+                   unsigned int uiPWM)
+{
+  /* Derivative is zero on the first update after tracking, so only P has to be compensated */
+  ptagPID->llLastP=ptagPID->llKp*(iTemp-ptagPID->iSetpoint)*FIXP_ONE/100;
+  ptagPID->llLastD=0;
+  ptagPID->llIntegral=(long long)uiPWM*FIXP_ONE-ptagPID->llLastP;
+  ptagPID->iPrevTemp=iTemp;
+  ptagPID->iValid=1;
+}
+
+unsigned int ctrlPID_Update(TagCtrlPID *ptagPID,
+                            int iTemp,
+                            unsigned long ulDtMs)
+{
+  long long llError;
+  long long llIntegral;
+  long long llOut;
+  long long llOutMin=(long long)ptagPID->iOutMin*FIXP_ONE;
+  long long llOutMax=(long long)ptagPID->iOutMax*FIXP_ONE;
+
+  if(ulDtMs == 0)
+    ulDtMs=1;
+  llError=iTemp-ptagPID->iSetpoint; /* Positive if too hot -> more fanspeed */
+
+  ptagPID->llLastP=ptagPID->llKp*llError*FIXP_ONE/100;
+  /* Derivative on measurement, in 1/10 °C per second */
+  ptagPID->llLastD=ptagPID->llKd*(iTemp-ptagPID->iPrevTemp)*1000*FIXP_ONE/((long long)ulDtMs*100);
+  ptagPID->iPrevTemp=iTemp;
+
+  llIntegral=ptagPID->llIntegral+ptagPID->llKi*llError*(long long)ulDtMs*FIXP_ONE/(100*1000);
+  llOut=ptagPID->llLastP+llIntegral+ptagPID->llLastD;
+
+  /* Anti-windup: Only integrate if it doesn't drive the output further into saturation */
+  if(((llOut > llOutMax) && (llIntegral > ptagPID->llIntegral)) ||
+     ((llOut < llOutMin) && (llIntegral < ptagPID->llIntegral)))
+  {
+    ++ptagPID->ulSaturated;
+    llOut=ptagPID->llLastP+ptagPID->llIntegral+ptagPID->llLastD;
+  }
+  else
+    ptagPID->llIntegral=llIntegral;
+
+  /* The integral is not clamped on its own: Conditional integration above keeps it bounded,
+     and the value set by ctrlPID_Track() may lie outside the output range to compensate P */
+
+  if(llOut > llOutMax)
+    llOut=llOutMax;
+  else if(llOut < llOutMin)
+    llOut=llOutMin;
+  return((unsigned int)((llOut+FIXP_ONE/2)/FIXP_ONE));
+}
+
+/**
+ * Feed-forward
+ */
+void ctrlFeedForward_Init(TagCtrlFeedForward *ptagFF,
+                          unsigned int uiGain,
+                          unsigned long ulDecayMs)
+{
+  ptagFF->llGain=uiGain;
+  ptagFF->ulDecayMs=ulDecayMs;
+  ptagFF->llFiltered=0;
+  ptagFF->iValid=0;
+}
+
+int ctrlFeedForward_Update(TagCtrlFeedForward *ptagFF,
+                           int iInput,
+                           unsigned long ulDtMs)
+{
+  long long llInput=(long long)iInput*FIXP_ONE;
+  long long llOut;
+
+  if(!ptagFF->iValid)
+  {
+    ptagFF->llFiltered=llInput;
+    ptagFF->iValid=1;
+    return(0);
+  }
+  /* First order low-pass, discretized for the actual sample interval */
+  ptagFF->llFiltered+=(llInput-ptagFF->llFiltered)*(long long)ulDtMs/(long long)(ptagFF->ulDecayMs+ulDtMs);
+
+  llOut=ptagFF->llGain*(llInput-ptagFF->llFiltered)/100; /* Q8 PWM */
+  if(llOut < 0)
+    return(-(int)((-llOut+FIXP_ONE/2)/FIXP_ONE));
+  return((int)((llOut+FIXP_ONE/2)/FIXP_ONE));
+}
+
+/**
+ * Relay identification
+ */
+void ctrlIdent_Init(TagCtrlIdent *ptagIdent,
+                    int iSetpoint,
+                    int iHysteresis,
+                    unsigned int uiPWMLow,
+                    unsigned int uiPWMHigh,
+                    unsigned int uiCycles)
+{
+  memset(ptagIdent,0,sizeof(TagCtrlIdent));
+  ptagIdent->iSetpoint=iSetpoint;
+  ptagIdent->iHysteresis=iHysteresis;
+  ptagIdent->uiPWMLow=uiPWMLow;
+  ptagIdent->uiPWMHigh=uiPWMHigh;
+  /* First two switches are the transient, the last one only ends the last half period */
+  ptagIdent->uiSwitchesMax=2*uiCycles+3;
+  if(ptagIdent->uiSwitchesMax > CTRL_IDENT_MAX_SWITCHES)
+    ptagIdent->uiSwitchesMax=CTRL_IDENT_MAX_SWITCHES;
+}
+
+unsigned int ctrlIdent_Update(TagCtrlIdent *ptagIdent,
+                              int iTemp,
+                              unsigned long ulNowMs)
+{
+  TagCtrlIdentSwitch *ptagSwitch;
+  int iDeviation;
+
+  /* Noise: Deviation of the middle sample from the line through its neighbours, doubled */
+  ptagIdent->iaLast[0]=ptagIdent->iaLast[1];
+  ptagIdent->iaLast[1]=ptagIdent->iaLast[2];
+  ptagIdent->iaLast[2]=iTemp;
+  if(!ptagIdent->ulSamples)
+    ptagIdent->ulFirstMs=ulNowMs;
+  ptagIdent->ulLastMs=ulNowMs;
+  if(++ptagIdent->ulSamples >= 3)
+  {
+    iDeviation=2*ptagIdent->iaLast[1]-ptagIdent->iaLast[0]-ptagIdent->iaLast[2];
+    if(iDeviation < 0)
+      iDeviation=-iDeviation;
+    if(iDeviation > ptagIdent->iNoiseMax)
+      ptagIdent->iNoiseMax=iDeviation;
+  }
+
+  if(!ptagIdent->iValid)
+  {
+    ptagIdent->iHigh=(iTemp > ptagIdent->iSetpoint)?1:0;
+    ptagIdent->iValid=1;
+  }
+
+  /* Track the turning point after the last switch (max. after switching to high, min. after switching to low) */
+  if(ptagIdent->uiSwitches)
+  {
+    ptagSwitch=&ptagIdent->tagaSwitches[ptagIdent->uiSwitches-1];
+    if(((ptagSwitch->iHigh) && (iTemp > ptagSwitch->iPeakTemp)) ||
+       ((!ptagSwitch->iHigh) && (iTemp < ptagSwitch->iPeakTemp)))
+    {
+      ptagSwitch->iPeakTemp=iTemp;
+      ptagSwitch->ulPeakDelayMs=ulNowMs-ptagSwitch->ulSwitchMs;
+    }
+  }
+
+  if((ptagIdent->uiSwitches < ptagIdent->uiSwitchesMax) &&
+     (((ptagIdent->iHigh) && (iTemp < ptagIdent->iSetpoint-ptagIdent->iHysteresis)) ||
+      ((!ptagIdent->iHigh) && (iTemp > ptagIdent->iSetpoint+ptagIdent->iHysteresis))))
+  {
+    ptagIdent->iHigh=!ptagIdent->iHigh;
+    ptagSwitch=&ptagIdent->tagaSwitches[ptagIdent->uiSwitches++];
+    ptagSwitch->ulSwitchMs=ulNowMs;
+    ptagSwitch->ulPeakDelayMs=0;
+    ptagSwitch->iPeakTemp=iTemp;
+    ptagSwitch->iHigh=ptagIdent->iHigh;
+  }
+  return((ptagIdent->iHigh)?ptagIdent->uiPWMHigh:ptagIdent->uiPWMLow);
+}
+
+int ctrlIdent_Done(const TagCtrlIdent *ptagIdent)
+{
+  return(ptagIdent->uiSwitches >= ptagIdent->uiSwitchesMax);
+}
+
+/**
+ * Rounds a positive value to unsigned, limited to uiMax.
+ */
+static unsigned int uiCtrlIdent_Round_m(double dVal,
+                                        unsigned int uiMax)
+{
+  if(dVal <= 0.0)
+    return(0);
+  if(dVal >= (double)uiMax)
+    return(uiMax);
+  return((unsigned int)(dVal+0.5));
+}
+
+/**
+ * Half period of a first order plus dead time process in a relay loop with hysteresis.
+ * For a given time constant, the relay output amplitude (as K*d) is calculated from the oscillation amplitude first.
+ *
+ * @param pdKd   _OUT_ K*d, in 1/10 °C
+ *
+ * @return Half period, in seconds.
+ */
+static double dCtrlIdent_HalfPeriod_m(double dTimeConstant,
+                                      double dDeadTime,
+                                      double dAmplitude,
+                                      double dHysteresis,
+                                      double *pdKd)
+{
+  double dDecay=exp(-dDeadTime/dTimeConstant);
+
+  /* Peak after crossing the hysteresis: a = Kd - (Kd - e)*e^(-L/T) */
+  *pdKd=(dAmplitude-dHysteresis*dDecay)/(1.0-dDecay);
+  /* Dead time, then decay from the peak down to the opposite hysteresis */
+  return(dDeadTime + dTimeConstant*log((dAmplitude+*pdKd)/(*pdKd-dHysteresis)));
+}
+
+int ctrlIdent_Analyze(const TagCtrlIdent *ptagIdent,
+                      unsigned int uiPWMMax,
+                      TagFanCtrl_Identified *ptagResult)
+{
+  const unsigned int uiFirst=2; /* Skip the transient */
+  unsigned int uiIndex;
+  unsigned int uiCountHigh=0;
+  unsigned int uiCountLow=0;
+  double dPeakHigh=0.0;
+  double dPeakLow=0.0;
+  double dHalfPeriod=0.0;
+  double dDeadTime=0.0;
+  double dAmplitude;
+  double dRelay;
+  double dTimeConstant;
+  double dHysteresis;
+  double dKd;
+  double dTmp;
+  double dLower;
+  double dUpper;
+  double dKu;
+  double dKc;
+  double dKp;
+  unsigned int uiPWMCenter;
+
+  if(ptagIdent->uiSwitches < uiFirst+2)
+    return(1);
+
+  for(uiIndex=uiFirst;uiIndex+1 < ptagIdent->uiSwitches;++uiIndex)
+  {
+    dHalfPeriod+=(double)(ptagIdent->tagaSwitches[uiIndex+1].ulSwitchMs-ptagIdent->tagaSwitches[uiIndex].ulSwitchMs)/1000.0;
+    dDeadTime+=(double)ptagIdent->tagaSwitches[uiIndex].ulPeakDelayMs/1000.0;
+    if(ptagIdent->tagaSwitches[uiIndex].iHigh)
+    {
+      dPeakHigh+=ptagIdent->tagaSwitches[uiIndex].iPeakTemp;
+      ++uiCountHigh;
+    }
+    else
+    {
+      dPeakLow+=ptagIdent->tagaSwitches[uiIndex].iPeakTemp;
+      ++uiCountLow;
+    }
+  }
+  if((!uiCountHigh) || (!uiCountLow))
+    return(1);
+  dHalfPeriod/=(uiCountHigh+uiCountLow);
+  dDeadTime/=(uiCountHigh+uiCountLow);
+  dAmplitude=(dPeakHigh/uiCountHigh-dPeakLow/uiCountLow)/2.0; /* In 1/10 °C */
+  dRelay=((double)ptagIdent->uiPWMHigh-(double)ptagIdent->uiPWMLow)/2.0;
+  if((dAmplitude <= 0.0) ||
+     (dRelay <= 0.0) ||
+     (dHalfPeriod <= 0.0))
+    return(1);
+
+  /* Describing function of the relay with hysteresis: Ultimate gain in PWM per 1/10 °C */
+  if(dAmplitude > ptagIdent->iHysteresis)
+    dKu=4.0*dRelay/(M_PI*sqrt(dAmplitude*dAmplitude-(double)ptagIdent->iHysteresis*ptagIdent->iHysteresis));
+  else
+    dKu=4.0*dRelay/(M_PI*dAmplitude);
+
+  /* Switching is detected on the next sample only, which adds half a sampling interval to the loop dead time */
+  if(ptagIdent->ulSamples > 1)
+    dDeadTime+=(double)(ptagIdent->ulLastMs-ptagIdent->ulFirstMs)/(ptagIdent->ulSamples-1)/2000.0;
+
+  /* Time constant: The half period rises with T from L (T=0) up to L*2a/(a-e) (T->infinite), solve by bisection */
+  if(dDeadTime <= 0.0)
+    dDeadTime=dHalfPeriod/2.0;
+  dHysteresis=(dAmplitude > ptagIdent->iHysteresis)?ptagIdent->iHysteresis:0.0;
+  dUpper=dDeadTime*CTRL_IDENT_MAX_TIME_CONSTANT_FACTOR;
+  if(dHalfPeriod <= dDeadTime)
+  {
+    dTimeConstant=0.0;
+    dKd=dAmplitude;
+  }
+  else if(dHalfPeriod >= dCtrlIdent_HalfPeriod_m(dUpper,dDeadTime,dAmplitude,dHysteresis,&dKd))
+    dTimeConstant=dUpper; /* Practically integrating, T can't be resolved */
+  else
+  {
+    dLower=dDeadTime*1e-3;
+    for(uiIndex=0;uiIndex < 64;++uiIndex)
+    {
+      dTimeConstant=(dLower+dUpper)/2.0;
+      if(dCtrlIdent_HalfPeriod_m(dTimeConstant,dDeadTime,dAmplitude,dHysteresis,&dKd) < dHalfPeriod)
+        dLower=dTimeConstant;
+      else
+        dUpper=dTimeConstant;
+    }
+  }
+
+  ptagResult->uiGain=uiCtrlIdent_Round_m(dKd/dRelay*100.0,UINT_MAX);
+  ptagResult->uiTimeConstant=uiCtrlIdent_Round_m(dTimeConstant*10.0,UINT_MAX);
+  ptagResult->uiDeadTime=uiCtrlIdent_Round_m(dDeadTime*10.0,UINT_MAX);
+  ptagResult->uiUltimateGain=uiCtrlIdent_Round_m(dKu*100.0,UINT_MAX);
+  ptagResult->uiUltimatePeriod=uiCtrlIdent_Round_m(dHalfPeriod*20.0,UINT_MAX);
+  ptagResult->uiNoise=(unsigned int)ptagIdent->iNoiseMax;
+
+  /* Curve: Proportional control with half the ultimate gain, through the mean relay output at the setpoint */
+  dKc=dKu/2.0;
+  ptagResult->uiCurveSlope=uiCtrlIdent_Round_m(dKc*100.0,UINT_MAX);
+  uiPWMCenter=(ptagIdent->uiPWMLow+ptagIdent->uiPWMHigh)/2;
+  dTmp=ptagIdent->iSetpoint-(double)(uiPWMCenter-ptagIdent->uiPWMLow)/dKc;
+  ptagResult->tagaCurve[0].iTemp=(int)uiCtrlIdent_Round_m(dTmp,INT_MAX);
+  ptagResult->tagaCurve[0].ucFanSpeedPercent=(unsigned char)fixp_DivRound(fixp_PWMToPermille(ptagIdent->uiPWMLow,0,uiPWMMax),10);
+  ptagResult->tagaCurve[1].iTemp=ptagIdent->iSetpoint;
+  ptagResult->tagaCurve[1].ucFanSpeedPercent=(unsigned char)fixp_DivRound(fixp_PWMToPermille(uiPWMCenter,0,uiPWMMax),10);
+  dTmp=ptagIdent->iSetpoint+(double)(ptagIdent->uiPWMHigh-uiPWMCenter)/dKc;
+  ptagResult->tagaCurve[2].iTemp=(int)uiCtrlIdent_Round_m(dTmp,INT_MAX);
+  ptagResult->tagaCurve[2].ucFanSpeedPercent=(unsigned char)fixp_DivRound(fixp_PWMToPermille(ptagIdent->uiPWMHigh,0,uiPWMMax),10);
+  /* Keep the points strictly ascending, even for a very steep slope */
+  if(ptagResult->tagaCurve[0].iTemp >= ptagResult->tagaCurve[1].iTemp)
+    ptagResult->tagaCurve[0].iTemp=ptagResult->tagaCurve[1].iTemp-1;
+  if(ptagResult->tagaCurve[2].iTemp <= ptagResult->tagaCurve[1].iTemp)
+    ptagResult->tagaCurve[2].iTemp=ptagResult->tagaCurve[1].iTemp+1;
+
+  /* Longest safe tick: A tenth of the dominant time, but not longer than half the dead time */
+  dTmp=(dTimeConstant+dDeadTime)/10.0;
+  if(dTmp > dDeadTime/2.0)
+    dTmp=dDeadTime/2.0;
+  ptagResult->uiUpdateDelayTime=uiCtrlIdent_Round_m(dTmp*10.0,UINT_MAX);
+  if(!ptagResult->uiUpdateDelayTime)
+    ptagResult->uiUpdateDelayTime=1;
+
+  /* Hysteresis: Above the sensor noise. Dwell time is the dead time, a change isn't visible earlier.
+   * Slope bypass at twice the slope of the oscillation. */
+  ptagResult->tagHysteresis.usRisingDeadband=(unsigned short)((ptagIdent->iNoiseMax > CTRL_IDENT_MIN_DEADBAND)?
+                                                              uiCtrlIdent_Round_m(ptagIdent->iNoiseMax,USHRT_MAX/2):
+                                                              CTRL_IDENT_MIN_DEADBAND);
+  ptagResult->tagHysteresis.usFallingDeadband=2*ptagResult->tagHysteresis.usRisingDeadband;
+  ptagResult->tagHysteresis.usMinDwellTime=(unsigned short)uiCtrlIdent_Round_m(dDeadTime*10.0,USHRT_MAX);
+  ptagResult->tagHysteresis.usRisingSlopeBypass=(unsigned short)uiCtrlIdent_Round_m(4.0*dAmplitude/dHalfPeriod,USHRT_MAX);
+
+  /* PID: Tyreus-Luyben rules, less aggressive than Ziegler-Nichols, which suits the slow thermal process */
+  dKp=dKu/2.2;
+  ptagResult->usPIDSetpoint=(unsigned short)ptagIdent->iSetpoint;
+  ptagResult->usPIDKp=(unsigned short)uiCtrlIdent_Round_m(dKp*100.0,USHRT_MAX);
+  ptagResult->usPIDKi=(unsigned short)uiCtrlIdent_Round_m(dKp/(2.2*2.0*dHalfPeriod)*100.0,USHRT_MAX);
+  ptagResult->usPIDKd=(unsigned short)uiCtrlIdent_Round_m(dKp*(2.0*dHalfPeriod/6.3)*100.0,USHRT_MAX);
+  return(0);
+}
+
+/**
+ * Model predictive control
+ */
+static void vCtrlMPC_ResetCovariance_m(TagCtrlMPC *ptagMPC)
+{
+  unsigned int uiRow;
+  unsigned int uiCol;
+
+  for(uiRow=0;uiRow < CTRL_MPC_PARAMS;++uiRow)
+  {
+    for(uiCol=0;uiCol < CTRL_MPC_PARAMS;++uiCol)
+      ptagMPC->llaCovariance[uiRow][uiCol]=(uiRow == uiCol)?(long long)CTRL_MPC_COVARIANCE_INIT*CTRL_MPC_ONE:0;
+  }
+}
+
+/**
+ * Builds the normalized regressor vector, all Q16.
+ */
+static void vCtrlMPC_Regressors_m(const TagCtrlMPC *ptagMPC,
+                                  long long llTemp,
+                                  unsigned int uiPWM,
+                                  int iPower,
+                                  long long llaPhi[CTRL_MPC_PARAMS])
+{
+  /* llTemp is Q16 1/10 °C */
+  llaPhi[0]=(llTemp-(long long)ptagMPC->iTarget*CTRL_MPC_ONE)/CTRL_MPC_SCALE_TEMP;
+  llaPhi[1]=(long long)uiPWM*CTRL_MPC_ONE/CTRL_MPC_SCALE_PWM;
+  llaPhi[2]=(long long)iPower*CTRL_MPC_ONE/CTRL_MPC_SCALE_POWER;
+  llaPhi[3]=CTRL_MPC_ONE;
+  /* Keep within [-2,2], so the 64-Bit products can't overflow */
+  if(llaPhi[0] > 2*CTRL_MPC_ONE)
+    llaPhi[0]=2*CTRL_MPC_ONE;
+  else if(llaPhi[0] < -2*CTRL_MPC_ONE)
+    llaPhi[0]=-2*CTRL_MPC_ONE;
+  if(llaPhi[2] > 2*CTRL_MPC_ONE)
+    llaPhi[2]=2*CTRL_MPC_ONE;
+}
+
+/**
+ * Predicted temperature change for one tick, in Q16 1/10 °C.
+ */
+static long long llCtrlMPC_Predict_m(const TagCtrlMPC *ptagMPC,
+                                     const long long llaPhi[CTRL_MPC_PARAMS])
+{
+  long long llSum=0;
+  unsigned int uiIndex;
+
+  for(uiIndex=0;uiIndex < CTRL_MPC_PARAMS;++uiIndex)
+    llSum+=ptagMPC->llaTheta[uiIndex]*llaPhi[uiIndex];
+  return((llSum>>CTRL_MPC_FRAC_BITS)*CTRL_MPC_SCALE_TEMP);
+}
+
+void ctrlMPC_Init(TagCtrlMPC *ptagMPC,
+                  int iTarget,
+                  unsigned int uiHorizon,
+                  unsigned int uiForgetting,
+                  int iOutMin,
+                  int iOutMax)
+{
+  memset(ptagMPC,0,sizeof(TagCtrlMPC));
+  ptagMPC->iTarget=iTarget;
+  ptagMPC->uiHorizon=uiHorizon;
+  ptagMPC->llForgetting=(long long)uiForgetting*CTRL_MPC_ONE/1000;
+  ptagMPC->iOutMin=iOutMin;
+  ptagMPC->iOutMax=iOutMax;
+  vCtrlMPC_ResetCovariance_m(ptagMPC);
+}
+
+void ctrlMPC_Observe(TagCtrlMPC *ptagMPC,
+                     int iTemp,
+                     unsigned int uiPrevPWM,
+                     int iPower)
+{
+  long long llaPhi[CTRL_MPC_PARAMS];
+  long long llaPPhi[CTRL_MPC_PARAMS];
+  long long llaGain[CTRL_MPC_PARAMS];
+  long long llDenominator;
+  long long llError;
+  int iError;
+  unsigned int uiRow;
+  unsigned int uiCol;
+
+  if(ptagMPC->iPrevValid)
+  {
+    vCtrlMPC_Regressors_m(ptagMPC,
+                          (long long)ptagMPC->iPrevTemp*CTRL_MPC_ONE,
+                          uiPrevPWM,
+                          ptagMPC->iPrevPower,
+                          llaPhi);
+    /* One step prediction error, in Q16 1/10 °C */
+    llError=(long long)(iTemp-ptagMPC->iPrevTemp)*CTRL_MPC_ONE-llCtrlMPC_Predict_m(ptagMPC,llaPhi);
+    iError=(int)(llError/CTRL_MPC_ONE);
+    ptagMPC->iLastError=iError;
+    if(iError < 0)
+      iError=-iError;
+    if(iError > ptagMPC->iMaxError)
+      ptagMPC->iMaxError=iError;
+    ptagMPC->ullErrorAbsSum+=iError;
+    ++ptagMPC->ulSamples;
+
+    /* RLS: P*phi, phi'*P*phi */
+    llDenominator=ptagMPC->llForgetting;
+    for(uiRow=0;uiRow < CTRL_MPC_PARAMS;++uiRow)
+    {
+      llaPPhi[uiRow]=0;
+      for(uiCol=0;uiCol < CTRL_MPC_PARAMS;++uiCol)
+        llaPPhi[uiRow]+=ptagMPC->llaCovariance[uiRow][uiCol]*llaPhi[uiCol];
+      llaPPhi[uiRow]>>=CTRL_MPC_FRAC_BITS;
+      llDenominator+=(llaPPhi[uiRow]*llaPhi[uiRow])>>CTRL_MPC_FRAC_BITS;
+    }
+    if(llDenominator <= 0)
+    {/* Numerically broken, start over */
+      vCtrlMPC_ResetCovariance_m(ptagMPC);
+      ++ptagMPC->ulResets;
+    }
+    else
+    {
+      /* Normalized error (model output is the change divided by CTRL_MPC_SCALE_TEMP) */
+      llError/=CTRL_MPC_SCALE_TEMP;
+      for(uiRow=0;uiRow < CTRL_MPC_PARAMS;++uiRow)
+      {
+        llaGain[uiRow]=(llaPPhi[uiRow]*CTRL_MPC_ONE)/llDenominator;
+        ptagMPC->llaTheta[uiRow]+=(llaGain[uiRow]*llError)>>CTRL_MPC_FRAC_BITS;
+      }
+      /* P=(P - K*phi'*P)/lambda, kept symmetric */
+      for(uiRow=0;uiRow < CTRL_MPC_PARAMS;++uiRow)
+      {
+        for(uiCol=uiRow;uiCol < CTRL_MPC_PARAMS;++uiCol)
+        {
+          ptagMPC->llaCovariance[uiRow][uiCol]=((ptagMPC->llaCovariance[uiRow][uiCol]-
+                                                 ((llaGain[uiRow]*llaPPhi[uiCol])>>CTRL_MPC_FRAC_BITS))*CTRL_MPC_ONE)/ptagMPC->llForgetting;
+          ptagMPC->llaCovariance[uiCol][uiRow]=ptagMPC->llaCovariance[uiRow][uiCol];
+        }
+      }
+      /* Limit the covariance growth in directions without excitation (e.g. constant power) */
+      for(uiRow=0;uiRow < CTRL_MPC_PARAMS;++uiRow)
+      {
+        if(ptagMPC->llaCovariance[uiRow][uiRow] <= 0)
+        {
+          vCtrlMPC_ResetCovariance_m(ptagMPC);
+          ++ptagMPC->ulResets;
+          break;
+        }
+        if(ptagMPC->llaCovariance[uiRow][uiRow] > (long long)CTRL_MPC_COVARIANCE_INIT*CTRL_MPC_ONE)
+        {
+          for(uiCol=0;uiCol < CTRL_MPC_PARAMS;++uiCol)
+          {
+            ptagMPC->llaCovariance[uiRow][uiCol]/=2;
+            ptagMPC->llaCovariance[uiCol][uiRow]/=2;
+          }
+        }
+      }
+    }
+  }
+  ptagMPC->iPrevTemp=iTemp;
+  ptagMPC->iPrevPower=iPower;
+  ptagMPC->iPrevValid=1;
+}
+
+void ctrlMPC_Invalidate(TagCtrlMPC *ptagMPC)
+{
+  ptagMPC->iPrevValid=0;
+}
+
+/**
+ * Checks if the predicted temperatures with the constant PWM fulfill the constraints, see ctrlMPC_Solve().
+ */
+static int iCtrlMPC_Feasible_m(const TagCtrlMPC *ptagMPC,
+                               int iTemp,
+                               int iPower,
+                               unsigned int uiPWM)
+{
+  long long llaPhi[CTRL_MPC_PARAMS];
+  long long llTemp=(long long)iTemp*CTRL_MPC_ONE;
+  long long llLimit=(long long)((iTemp > ptagMPC->iTarget)?iTemp:ptagMPC->iTarget)*CTRL_MPC_ONE;
+  unsigned int uiStep;
+
+  for(uiStep=0;uiStep < ptagMPC->uiHorizon;++uiStep)
+  {
+    vCtrlMPC_Regressors_m(ptagMPC,llTemp,uiPWM,iPower,llaPhi);
+    llTemp+=llCtrlMPC_Predict_m(ptagMPC,llaPhi);
+    if(llTemp > llLimit)
+      return(0);
+  }
+  return(llTemp <= (long long)ptagMPC->iTarget*CTRL_MPC_ONE);
+}
+
+unsigned int ctrlMPC_Solve(TagCtrlMPC *ptagMPC,
+                           int iTemp,
+                           int iPower,
+                           unsigned int uiFallbackPWM)
+{
+  unsigned int uiLow=ptagMPC->iOutMin;
+  unsigned int uiHigh=ptagMPC->iOutMax;
+  unsigned int uiMid;
+
+  /* Model needs enough samples, and more fanspeed must cool */
+  if((ptagMPC->ulSamples < CTRL_MPC_MIN_SAMPLES) ||
+     (ptagMPC->llaTheta[1] >= 0))
+  {
+    ++ptagMPC->ulFallbacks;
+    return(uiFallbackPWM);
+  }
+  if(!iCtrlMPC_Feasible_m(ptagMPC,iTemp,iPower,uiHigh))
+    return(uiHigh);
+  /* More PWM never heats with b < 0, so the feasible range is contiguous: bisection for the lowest one */
+  while(uiLow < uiHigh)
+  {
+    uiMid=(uiLow+uiHigh)/2;
+    if(iCtrlMPC_Feasible_m(ptagMPC,iTemp,iPower,uiMid))
+      uiHigh=uiMid;
+    else
+      uiLow=uiMid+1;
+  }
+  return(uiLow);
+}
+
+void ctrlMPC_GetModel(const TagCtrlMPC *ptagMPC,
+                      unsigned long ulTickMs,
+                      TagCtrlMPCModel *ptagModel)
+{
+  long long llA=ptagMPC->llaTheta[0];
+
+  ptagModel->iMeanError=(ptagMPC->ulSamples)?(int)(ptagMPC->ullErrorAbsSum/ptagMPC->ulSamples):0;
+  if(llA >= 0)
+  {/* No decay towards a steady state */
+    ptagModel->lTimeConstantMs=-1;
+    ptagModel->lGainPWM=0;
+    ptagModel->lGainPower=0;
+    return;
+  }
+  /* a = -Tick/Tau, steady state: a*dT + b*dPWM = 0 */
+  ptagModel->lTimeConstantMs=(long)(-(long long)ulTickMs*CTRL_MPC_ONE/llA);
+  ptagModel->lGainPWM=(long)(-ptagMPC->llaTheta[1]*CTRL_MPC_SCALE_TEMP*100/(llA*CTRL_MPC_SCALE_PWM));
+  ptagModel->lGainPower=(long)(-ptagMPC->llaTheta[2]*CTRL_MPC_SCALE_TEMP*100/(llA*CTRL_MPC_SCALE_POWER));
+}
@@ -0,0 +1,471 @@
+#ifndef FANCTRL_CTRL_H_INCLUDED
+  #define FANCTRL_CTRL_H_INCLUDED
+
+/**
+ * Control algorithms used by fanctrl.
+ * All functions in here work on the passed state only, they don't do any I/O.
+ * The control path is pure integer math, for the units used see fanctrl_fixp.h.
+ * Only ctrlIdent_Analyze() uses floating point, it runs once after an identification run.
+ */
+
+enum
+{
+  /* Max. window size for the median filter */
+  CTRL_FILTER_MEDIAN_MAX_WINDOW=9,
+  /* Max. number of relay switches recorded by the identification */
+  CTRL_IDENT_MAX_SWITCHES=2*FANCTRL_IDENTIFY_MAX_CYCLES+3,
+  /* Time constant limit, as multiple of the dead time. Above, the process is practically integrating */
+  CTRL_IDENT_MAX_TIME_CONSTANT_FACTOR=100,
+  /* Min. recommended deadband, in 1/10 °C */
+  CTRL_IDENT_MIN_DEADBAND=5,
+
+  /* Model predictive control: Number of model parameters (temperature, PWM, power, bias) */
+  CTRL_MPC_PARAMS=4,
+  /* Model values are Q16 fixed-point, regressors are normalized to about [-1,1] */
+  CTRL_MPC_FRAC_BITS=16,
+  CTRL_MPC_ONE=(1<<CTRL_MPC_FRAC_BITS),
+  CTRL_MPC_SCALE_TEMP=1000,       /* 100 °C in 1/10 °C */
+  CTRL_MPC_SCALE_PWM=255,
+  CTRL_MPC_SCALE_POWER=500,       /* 500 W */
+  /* Initial/max. covariance (diagonal), in units of CTRL_MPC_ONE */
+  CTRL_MPC_COVARIANCE_INIT=100,
+  /* Samples needed, before the model is used */
+  CTRL_MPC_MIN_SAMPLES=20,
+};
+
+/**
+ * State of a sensor filter.
+ */
+typedef struct
+{
+  /**
+   * Filter type, see SENSOR_FILTER_ enums in fanctrl.h
+   */
+  unsigned int uiType;
+  /**
+   * EMA: Weight of new samples, in Percent (1-100).
+   * Median: Window size (1-CTRL_FILTER_MEDIAN_MAX_WINDOW).
+   */
+  unsigned int uiParam;
+  /**
+   * EMA only: Rising step, in 1/10 °C, above which the filter follows the raw value immediately. 0 to disable.
+   */
+  int iStepBypass;
+  /**
+   * EMA state, in Q8 1/10 °C
+   */
+  long lEMAState;
+  /**
+   * Median ringbuffer
+   */
+  int iaWindow[CTRL_FILTER_MEDIAN_MAX_WINDOW];
+  unsigned int uiWindowUsed;
+  unsigned int uiWindowPos;
+  /**
+   * Number of samples processed so far
+   */
+  unsigned long ulSamples;
+}TagCtrlFilter;
+
+/**
+ * Initializes a sensor filter.
+ *
+ * @param ptagFilter _OUT_ Filter to initialize
+ * @param uiType     _IN_ Filter type, see SENSOR_FILTER_ enums in fanctrl.h
+ * @param uiParam    _IN_ Filter parameter, see TagCtrlFilter
+ * @param iStepBypass
+ *                   _IN_ Rising step to bypass the EMA, in 1/10 °C. 0 to disable.
+ */
+void ctrlFilter_Init(TagCtrlFilter *ptagFilter,
+                     unsigned int uiType,
+                     unsigned int uiParam,
+                     int iStepBypass);
+
+/**
+ * Feeds a new raw sample into the filter.
+ *
+ * @param ptagFilter _IN_ The filter
+ * @param iSample    _IN_ Raw sample, in 1/10 °C
+ *
+ * @return Filtered value, in 1/10 °C.
+ */
+int ctrlFilter_Update(TagCtrlFilter *ptagFilter,
+                      int iSample);
+
+/**
+ * State of the hysteresis engine.
+ * Decides if a temperature change is big enough to update the fanspeed.
+ */
+typedef struct
+{
+  /**
+   * Configuration, see TagCfg_Hysteresis in fanctrl.h
+   */
+  int iRisingDeadband;
+  int iFallingDeadband;
+  unsigned long ulMinDwellTimeMs;
+  int iRisingSlopeBypass;
+  /**
+   * Temperature at the last accepted change, in 1/10 °C
+   */
+  int iLastUpdateTemp;
+  unsigned long ulLastUpdateMs;
+  /**
+   * Previous sample, used to calculate the slope
+   */
+  int iPrevTemp;
+  unsigned long ulPrevMs;
+  /**
+   * Timestamp when a change was first held back by the dwell time, 0 if none is pending
+   */
+  unsigned long ulPendingSinceMs;
+  int iValid;
+  /**
+   * Statistics
+   */
+  unsigned long ulAccepted;
+  unsigned long ulSuppressedDeadband;
+  unsigned long ulSuppressedDwell;
+  unsigned long ulSlopeBypass;
+  unsigned long ulMaxDwellDelayMs;
+}TagCtrlHysteresis;
+
+/**
+ * Initializes the hysteresis engine.
+ *
+ * @param ptagHyst   _OUT_ Engine to initialize
+ * @param iRisingDeadband
+ *                   _IN_ Min. rise since last update, in 1/10 °C
+ * @param iFallingDeadband
+ *                   _IN_ Min. fall since last update, in 1/10 °C
+ * @param ulMinDwellTimeMs
+ *                   _IN_ Min. time between two updates, in ms
+ * @param iRisingSlopeBypass
+ *                   _IN_ Rising slope in 1/10 °C per second, at or above which every change is accepted immediately. 0 to disable.
+ */
+void ctrlHysteresis_Init(TagCtrlHysteresis *ptagHyst,
+                         int iRisingDeadband,
+                         int iFallingDeadband,
+                         unsigned long ulMinDwellTimeMs,
+                         int iRisingSlopeBypass);
+
+/**
+ * Checks if the fanspeed should be updated for the new temperature.
+ * If the change is accepted, the new temperature is stored as reference for the next check.
+ *
+ * @param ptagHyst   _IN_ The engine
+ * @param iTemp      _IN_ Current temperature, in 1/10 °C
+ * @param ulNowMs    _IN_ Current monotonic timestamp, in ms
+ *
+ * @return 1 if the fanspeed should be updated, 0 if the change is suppressed.
+ */
+int ctrlHysteresis_Check(TagCtrlHysteresis *ptagHyst,
+                         int iTemp,
+                         unsigned long ulNowMs);
+
+/**
+ * Forces the reference temperature, e.g. after an update which bypassed the engine.
+ */
+void ctrlHysteresis_Force(TagCtrlHysteresis *ptagHyst,
+                          int iTemp,
+                          unsigned long ulNowMs);
+
+/**
+ * State of the PID controller.
+ * Gains are in 1/100 PWM per 1/10 °C error (Kp), per 1/10 °C error and second (Ki)
+ * and per 1/10 °C per second change of the measurement (Kd).
+ * Internal values are kept as 64-Bit Q8 PWM values, to avoid overflow for long update intervals.
+ */
+typedef struct
+{
+  long long llKp;
+  long long llKi;
+  long long llKd;
+  int iSetpoint;            /* In 1/10 °C */
+  int iOutMin;              /* In PWM */
+  int iOutMax;              /* In PWM */
+  long long llIntegral;     /* In Q8 PWM */
+  int iPrevTemp;
+  int iValid;
+  /* Last terms, for debugging, in Q8 PWM */
+  long long llLastP;
+  long long llLastD;
+  unsigned long ulSaturated;
+}TagCtrlPID;
+
+/**
+ * Initializes the PID controller.
+ *
+ * @param ptagPID    _OUT_ Controller to initialize
+ * @param iSetpoint  _IN_ Target temperature, in 1/10 °C
+ * @param uiKp       _IN_ Proportional gain, see TagCtrlPID
+ * @param uiKi       _IN_ Integral gain, see TagCtrlPID
+ * @param uiKd       _IN_ Derivative gain, see TagCtrlPID
+ * @param iOutMin    _IN_ Min. output, in PWM
+ * @param iOutMax    _IN_ Max. output, in PWM
+ */
+void ctrlPID_Init(TagCtrlPID *ptagPID,
+                  int iSetpoint,
+                  unsigned int uiKp,
+                  unsigned int uiKi,
+                  unsigned int uiKd,
+                  int iOutMin,
+                  int iOutMax);
+
+/**
+ * Bumpless transfer: Sets the integral term, so the controller output equals uiPWM at the given temperature.
+ * Use this when the fanspeed was set by another control law (e.g. curve or critical temperature).
+ *
+ * @param ptagPID    _IN_ The controller
+ * @param iTemp      _IN_ Current temperature, in 1/10 °C
+ * @param uiPWM      _IN_ Current PWM
+ */
+void ctrlPID_Track(TagCtrlPID *ptagPID,
+                   int iTemp,
+                   unsigned int uiPWM);
+
+/**
+ * Calculates the new output.
+ * Uses derivative on measurement (no kick on setpoint changes) and conditional integration as anti-windup.
+ *
+ * @param ptagPID    _IN_ The controller, must be initialized by ctrlPID_Track() before
+ * @param iTemp      _IN_ Current temperature, in 1/10 °C
+ * @param ulDtMs     _IN_ Time since the last update, in ms
+ *
+ * @return New output, in PWM, clamped to [iOutMin,iOutMax].
+ */
+unsigned int ctrlPID_Update(TagCtrlPID *ptagPID,
+                            int iTemp,
+                            unsigned long ulDtMs);
+
+/**
+ * State of a feed-forward term.
+ * The input (e.g. power draw) is low-pass filtered with the decay time constant,
+ * the output is proportional to the difference between input and filtered input (lead/high-pass).
+ * So a step of the input is answered immediately and the output decays to 0, while the temperature catches up.
+ */
+typedef struct
+{
+  long long llGain;         /* In 1/100 PWM per input unit */
+  unsigned long ulDecayMs;
+  long long llFiltered;     /* Low-pass filtered input, Q8 */
+  int iValid;
+}TagCtrlFeedForward;
+
+/**
+ * Initializes a feed-forward term.
+ *
+ * @param ptagFF     _OUT_ Term to initialize
+ * @param uiGain     _IN_ Gain, in 1/100 PWM per input unit
+ * @param ulDecayMs  _IN_ Decay time constant, in ms, must be > 0
+ */
+void ctrlFeedForward_Init(TagCtrlFeedForward *ptagFF,
+                          unsigned int uiGain,
+                          unsigned long ulDecayMs);
+
+/**
+ * Feeds a new input sample and calculates the output.
+ * The first sample initializes the filter, so the output starts at 0.
+ *
+ * @param ptagFF     _IN_ The term
+ * @param iInput     _IN_ Current input
+ * @param ulDtMs     _IN_ Time since the last sample, in ms
+ *
+ * @return Output, in PWM. Negative if the input dropped.
+ */
+int ctrlFeedForward_Update(TagCtrlFeedForward *ptagFF,
+                           int iInput,
+                           unsigned long ulDtMs);
+
+/**
+ * Relay switch, recorded during the identification.
+ */
+typedef struct
+{
+  unsigned long ulSwitchMs;     /* Timestamp of the switch */
+  unsigned long ulPeakDelayMs;  /* Time from the switch to the turning point of the temperature */
+  int iPeakTemp;                /* Temperature at the turning point, in 1/10 °C */
+  int iHigh;                    /* Nonzero if switched to the high output */
+}TagCtrlIdentSwitch;
+
+/**
+ * State of the relay (bang-bang) identification experiment.
+ */
+typedef struct
+{
+  int iSetpoint;                /* In 1/10 °C */
+  int iHysteresis;              /* In 1/10 °C */
+  unsigned int uiPWMLow;
+  unsigned int uiPWMHigh;
+  unsigned int uiSwitchesMax;
+  unsigned int uiSwitches;
+  int iHigh;
+  int iValid;
+  /* Last three samples, to estimate the sensor noise */
+  int iaLast[3];
+  unsigned long ulSamples;
+  unsigned long ulFirstMs;
+  unsigned long ulLastMs;
+  int iNoiseMax;                /* Max. deviation from the local trend, in 1/10 °C */
+  TagCtrlIdentSwitch tagaSwitches[CTRL_IDENT_MAX_SWITCHES];
+}TagCtrlIdent;
+
+/**
+ * Initializes the identification experiment.
+ *
+ * @param ptagIdent  _OUT_ Experiment to initialize
+ * @param iSetpoint  _IN_ Temperature to oscillate around, in 1/10 °C
+ * @param iHysteresis
+ *                   _IN_ Relay hysteresis, in 1/10 °C
+ * @param uiPWMLow   _IN_ Low relay output, in PWM
+ * @param uiPWMHigh  _IN_ High relay output, in PWM
+ * @param uiCycles   _IN_ Number of full oscillations to record (1-FANCTRL_IDENTIFY_MAX_CYCLES),
+ *                   the first (transient) oscillation is recorded additionally.
+ */
+void ctrlIdent_Init(TagCtrlIdent *ptagIdent,
+                    int iSetpoint,
+                    int iHysteresis,
+                    unsigned int uiPWMLow,
+                    unsigned int uiPWMHigh,
+                    unsigned int uiCycles);
+
+/**
+ * Feeds a new sample into the experiment and returns the relay output.
+ *
+ * @param ptagIdent  _IN_ The experiment
+ * @param iTemp      _IN_ Current temperature, in 1/10 °C
+ * @param ulNowMs    _IN_ Current monotonic timestamp, in ms
+ *
+ * @return PWM to apply.
+ */
+unsigned int ctrlIdent_Update(TagCtrlIdent *ptagIdent,
+                              int iTemp,
+                              unsigned long ulNowMs);
+
+/**
+ * @return Nonzero if enough oscillations were recorded.
+ */
+int ctrlIdent_Done(const TagCtrlIdent *ptagIdent);
+
+/**
+ * Fits a first order plus dead time model to the recorded oscillations and derives the recommended settings.
+ *
+ * Recommended values are not limited to the allowed configuration ranges, this must be done by the caller.
+ *
+ * @param ptagIdent  _IN_ The finished experiment
+ * @param uiPWMMax   _IN_ PWM value of 100% fanspeed, used to convert the curve to Percent
+ * @param ptagResult _OUT_ Model and recommendations
+ *
+ * @return 0 on success, nonzero if the recorded oscillations can't be used (e.g. amplitude too small).
+ */
+int ctrlIdent_Analyze(const TagCtrlIdent *ptagIdent,
+                      unsigned int uiPWMMax,
+                      TagFanCtrl_Identified *ptagResult);
+
+/**
+ * State of the model predictive controller.
+ * A first order thermal model is fitted online by recursive least squares (RLS):
+ *   T[k+1]-T[k] = a*(T[k]-Target) + b*PWM[k] + c*Power[k] + d
+ * All regressors are normalized (see CTRL_MPC_SCALE_), parameters and covariance are Q16, in 64-Bit.
+ */
+typedef struct
+{
+  long long llaTheta[CTRL_MPC_PARAMS];                  /* a, b, c, d */
+  long long llaCovariance[CTRL_MPC_PARAMS][CTRL_MPC_PARAMS];
+  long long llForgetting;                               /* Q16, e.g. 0.99 */
+  int iTarget;                                          /* In 1/10 °C */
+  unsigned int uiHorizon;                               /* In ticks */
+  int iOutMin;                                          /* In PWM */
+  int iOutMax;                                          /* In PWM */
+  /* Previous sample */
+  int iPrevTemp;
+  int iPrevPower;                                       /* In W */
+  int iPrevValid;
+  /* Statistics */
+  unsigned long ulSamples;
+  int iLastError;                                       /* Last one step prediction error, in 1/10 °C */
+  int iMaxError;
+  unsigned long long ullErrorAbsSum;
+  unsigned long ulFallbacks;
+  unsigned long ulResets;
+}TagCtrlMPC;
+
+/**
+ * Model parameters in physical units, see ctrlMPC_GetModel().
+ */
+typedef struct
+{
+  long lTimeConstantMs;     /* Time constant, -1 if the model is not stable (yet) */
+  long lGainPWM;            /* Steady state temperature change, in 1/1000 °C per PWM step */
+  long lGainPower;          /* Steady state temperature change, in 1/1000 °C per W */
+  int iMeanError;           /* Mean absolute one step prediction error, in 1/10 °C */
+}TagCtrlMPCModel;
+
+/**
+ * Initializes the model predictive controller.
+ *
+ * @param ptagMPC    _OUT_ Controller to initialize
+ * @param iTarget    _IN_ Max. temperature, in 1/10 °C
+ * @param uiHorizon  _IN_ Prediction horizon, in ticks
+ * @param uiForgetting
+ *                   _IN_ RLS forgetting factor, in 1/1000 (e.g. 990)
+ * @param iOutMin    _IN_ Min. output, in PWM
+ * @param iOutMax    _IN_ Max. output, in PWM
+ */
+void ctrlMPC_Init(TagCtrlMPC *ptagMPC,
+                  int iTarget,
+                  unsigned int uiHorizon,
+                  unsigned int uiForgetting,
+                  int iOutMin,
+                  int iOutMax);
+
+/**
+ * Feeds a new sample into the model.
+ * The model is updated with the change since the previous sample, using the PWM applied in between.
+ *
+ * @param ptagMPC    _IN_ The controller
+ * @param iTemp      _IN_ Current temperature, in 1/10 °C
+ * @param uiPrevPWM  _IN_ PWM applied since the previous sample
+ * @param iPower     _IN_ Current power, in W (0 if unknown)
+ */
+void ctrlMPC_Observe(TagCtrlMPC *ptagMPC,
+                     int iTemp,
+                     unsigned int uiPrevPWM,
+                     int iPower);
+
+/**
+ * Discards the previous sample, e.g. if the tick interval changed or another control law was active.
+ */
+void ctrlMPC_Invalidate(TagCtrlMPC *ptagMPC);
+
+/**
+ * Calculates the lowest PWM, which keeps the predicted temperature at or below the target.
+ * The PWM is kept constant over the horizon. The temperature at the end of the horizon must be at or below the target,
+ * and no predicted temperature may exceed max(target, current temperature).
+ * As long as the model isn't usable (too few samples, or more PWM doesn't cool), uiFallbackPWM is returned.
+ *
+ * @param ptagMPC    _IN_ The controller
+ * @param iTemp      _IN_ Current temperature, in 1/10 °C
+ * @param iPower     _IN_ Current power, in W
+ * @param uiFallbackPWM
+ *                   _IN_ PWM to use, if the model is not usable
+ *
+ * @return PWM to apply.
+ */
+unsigned int ctrlMPC_Solve(TagCtrlMPC *ptagMPC,
+                           int iTemp,
+                           int iPower,
+                           unsigned int uiFallbackPWM);
+
+/**
+ * Converts the model to physical units.
+ *
+ * @param ptagMPC    _IN_ The controller
+ * @param ulTickMs   _IN_ Tick interval, in ms
+ * @param ptagModel  _OUT_ Model parameters
+ */
+void ctrlMPC_GetModel(const TagCtrlMPC *ptagMPC,
+                      unsigned long ulTickMs,
+                      TagCtrlMPCModel *ptagModel);
+
+#endif /* FANCTRL_CTRL_H_INCLUDED */
@@ -0,0 +1,140 @@
+#ifndef FANCTRL_FIXP_H_INCLUDED
+  #define FANCTRL_FIXP_H_INCLUDED
+
+/**
+ * Integer fixed-point helpers for the control path.
+ * None of these functions use the FPU, so the control loop also runs on cores without one.
+ *
+ * Units used throughout fanctrl:
+ *   - Temperatures are integers in 1/10 °C.
+ *   - PWM values are integers in the range of the device (AMDGPU: 0-255).
+ *   - Values which need a fractional part (e.g. filter states) are stored as Q8,
+ *     meaning the integer value multiplied by FIXP_ONE (256).
+ *
+ * All intermediate products are kept below 2^31 for the documented value ranges
+ * (max. Temperature 1500 (150 °C) * FIXP_ONE * 256 < 2^31), so plain long is sufficient,
+ * even on 32-Bit targets.
+ */
+
+#ifndef INLINE
+  #if defined (__STDC_VERSION__) && (__STDC_VERSION__ >= 199901L) /* >= C99 */
+    #define INLINE static inline
+  #elif defined (__GNUC_GNU_INLINE__)
+    #define INLINE static inline
+  #else /* Fallback, No inline available from C Standard */
+    #define INLINE  static
+  #endif /* __STDC_VERSION__ >= C99 */
+#endif /* INLINE */
+
+enum
+{
+  FIXP_FRAC_BITS =8,
+  FIXP_ONE       =(1<<FIXP_FRAC_BITS),
+};
+
+/**
+ * Converts an integer to Q8 fixed-point.
+ */
+#define FIXP_FROM_INT(x) ((long)(x)*FIXP_ONE)
+
+/**
+ * Integer division, rounded to nearest, halfway cases away from zero.
+ *
+ * @param lNum   _IN_ Numerator
+ * @param lDen   _IN_ Denominator, must be > 0
+ *
+ * @return Rounded quotient.
+ */
+INLINE long fixp_DivRound(long lNum,
+                          long lDen)
+{
+  if(lNum < 0)
+    return(-((-lNum + lDen/2) / lDen));
+  return((lNum + lDen/2) / lDen);
+}
+
+/**
+ * Converts a Q8 value to an integer, rounded to nearest.
+ */
+INLINE int fixp_ToInt(long lFixp)
+{
+  return((int)fixp_DivRound(lFixp,FIXP_ONE));
+}
+
+/**
+ * Linear interpolation between (lX0,lY0) and (lX1,lY1) at lX, with a single rounding step.
+ * lX0 must be less than lX1, lX should be within [lX0,lX1].
+ *
+ * @return Interpolated Y value, rounded to nearest.
+ */
+INLINE long fixp_Interpolate(long lX,
+                             long lX0,
+                             long lX1,
+                             long lY0,
+                             long lY1)
+{
+  return(lY0 + fixp_DivRound((lY1-lY0)*(lX-lX0),lX1-lX0));
+}
+
+/**
+ * Cubic Hermite interpolation between (lX0,lY0) and (lX1,lY1) at lX, with the slopes lM0/lM1 (Y per X, Q8) at both points.
+ * lX0 must be less than lX1, lX should be within [lX0,lX1]. Exact at both points, with a single rounding step.
+ * The cubic terms exceed 32-Bit, so long long is used, valid for X ranges up to the max. Temperature.
+ *
+ * @return Interpolated Y value, rounded to nearest.
+ */
+INLINE long fixp_Hermite(long lX,
+                         long lX0,
+                         long lX1,
+                         long lY0,
+                         long lY1,
+                         long lM0,
+                         long lM1)
+{
+  long long llS=lX-lX0;
+  long long llH=lX1-lX0;
+  long long llNum;
+  long long llDen;
+
+  /* Basis functions, scaled by h^3 */
+  llNum=FIXP_ONE*(lY0*(2*llS*llS*llS - 3*llS*llS*llH + llH*llH*llH) +
+                  lY1*(3*llS*llS*llH - 2*llS*llS*llS)) +
+        llH*(lM0*(llS*llS*llS - 2*llS*llS*llH + llS*llH*llH) +
+             lM1*(llS*llS*llS - llS*llS*llH));
+  llDen=FIXP_ONE*llH*llH*llH;
+  if(llNum < 0)
+    return((long)(-((-llNum + llDen/2) / llDen)));
+  return((long)((llNum + llDen/2) / llDen));
+}
+
+/**
+ * Calculates uiPercent percent of iVal, rounded to nearest.
+ */
+INLINE int fixp_PercentOf(int iVal,
+                          unsigned int uiPercent)
+{
+  return((int)fixp_DivRound((long)iVal*(long)uiPercent,100));
+}
+
+/**
+ * Scales a percentage (0-100) to the PWM range [uiPWMMin,uiPWMMax], rounded to nearest.
+ */
+INLINE unsigned int fixp_PercentToPWM(unsigned int uiPercent,
+                                      unsigned int uiPWMMin,
+                                      unsigned int uiPWMMax)
+{
+  return(uiPWMMin + (unsigned int)fixp_DivRound((long)uiPercent*(long)(uiPWMMax-uiPWMMin),100));
+}
+
+/**
+ * Scales a PWM value from the range [uiPWMMin,uiPWMMax] to 1/10 Percent, rounded to nearest.
+ * Used for printing only.
+ */
+INLINE unsigned int fixp_PWMToPermille(unsigned int uiPWM,
+                                       unsigned int uiPWMMin,
+                                       unsigned int uiPWMMax)
+{
+  return((unsigned int)fixp_DivRound((long)(uiPWM-uiPWMMin)*1000,(long)(uiPWMMax-uiPWMMin)));
+}
+
+#endif /* FANCTRL_FIXP_H_INCLUDED */
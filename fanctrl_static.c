@@ -0,0 +1,114 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <signal.h>
+#include <string.h>
+
+#include "fanctrl.h"
+#include "fanctrl_static_cfg.h" /* Generated by "fanctrl <config file> --export-static <header>", see target fanctrl-static */
+
+/**
+ * Static build of fanctrl: The configuration is embedded at build time, verified by the export (see fanCtrl_AMDGPU_Verify()).
+ * No config file parser, no heap: The FanCtrl-Object and its device are placed in the storage below.
+ * Usage: fanctrl-static [--debug|-d]
+ */
+
+#define STRINGIFY(x) STRINGIFY_DETAIL(x)
+#define STRINGIFY_DETAIL(x) #x
+#define ERR_PFX                                      "fanctrl_static Error: @line:" STRINGIFY(__LINE__) ": "
+#define ERR_PRINTF(str,...)                          fprintf(stderr,ERR_PFX str "\n",__VA_ARGS__)
+#define ERR_PUTS(str)                                fputs(ERR_PFX str "\n",stderr)
+
+/**
+ * Storage of the FanCtrl-Object, aligned for any type.
+ */
+static union
+{
+  unsigned char ucaData[FANCTRL_STATIC_STORAGE_SIZE];
+  long long llAlign;
+  double dAlign;
+  void *pvAlign;
+}uStorage_m;
+
+static TagFanCtrl *ptagFanCtrl_m;
+static unsigned int uiExitFanCtrlFlag_m;
+static char caStdoutBuffer_m[BUFSIZ]; /* Otherwise allocated by stdio with the first output */
+
+static void vSignalHandler_m(int iSignum);
+
+int main(int argc,char *argv[])
+{
+  unsigned int uiCreateFlags=0;
+  int iRc;
+
+  setvbuf(stdout,caStdoutBuffer_m,_IOLBF,sizeof(caStdoutBuffer_m));
+  if((argc > 2) ||
+     ((argc == 2) &&
+      (strcmp(argv[1],"--debug") != 0) &&
+      (strcmp(argv[1],"-d") != 0)))
+  {
+    printf("Usage: %s [--debug|-d]\n"
+           "  Configuration embedded at build time: \"%s\"\n",
+           argv[0],
+           FANCTRL_STATIC_CFG_FILE);
+    return(EXIT_FAILURE);
+  }
+  if(argc == 2)
+    uiCreateFlags|=CREATE_FLAG_DEBUG;
+
+  signal(SIGINT,vSignalHandler_m);   /* On CTRL+C */
+  signal(SIGTERM,vSignalHandler_m);  /* On exit using kill (SIGTERM) command */
+  signal(SIGUSR1,vSignalHandler_m);  /* Print statistics */
+
+  fanCtrl_SetStorage(&uStorage_m,sizeof(uStorage_m));
+  if(!(ptagFanCtrl_m=fanCtrl_Create(FANCTRL_STATIC_UPDATE_TIME,
+                                    &tagFanCtrlStatic_Hysteresis,
+                                    &uiExitFanCtrlFlag_m,
+                                    uiCreateFlags)))
+  {
+    ERR_PUTS("InternalError: fanCtrl_Create() failed");
+    return(EXIT_FAILURE);
+  }
+  if(fanCtrl_AMDGPU_Init(ptagFanCtrl_m,
+                         &tagFanCtrlStatic_Config,
+                         tagaFanCtrlStatic_Sensors,
+                         FANCTRL_STATIC_SENSORS_COUNT,
+                         tagaFanCtrlStatic_Temps,
+                         FANCTRL_STATIC_TEMPS_COUNT,
+                         tagaFanCtrlStatic_Profiles,
+                         FANCTRL_STATIC_PROFILES_COUNT))
+  {
+    ERR_PUTS("fanCtrl_AMDGPU_Init() failed");
+    fanCtrl_Destroy(ptagFanCtrl_m);
+    return(EXIT_FAILURE);
+  }
+
+  iRc=fanCtrl_Run(ptagFanCtrl_m);
+  if(iRc != RUN_RET_ERR_INIT)
+  {
+    fanCtrl_PrintStats(ptagFanCtrl_m,stdout);
+    if(fanCtrl_ResetDevices(ptagFanCtrl_m))
+    {
+      iRc=1;
+      ERR_PUTS("fanCtrl_AMDGPU_Reset() failed! Fanspeed stays in manual mode!");
+    }
+  }
+  fanCtrl_Destroy(ptagFanCtrl_m);
+  return((iRc)?EXIT_FAILURE:EXIT_SUCCESS);
+}
+
+static void vSignalHandler_m(int iSignum)
+{
+  switch(iSignum)
+  {
+    case SIGINT:
+    case SIGTERM:
+      uiExitFanCtrlFlag_m=1; /* Quits run function loop */
+      break;
+    case SIGUSR1:
+      if(ptagFanCtrl_m)
+        fanCtrl_RequestStats(ptagFanCtrl_m);
+      break;
+    default:
+      break;
+  }
+}
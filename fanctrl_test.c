@@ -0,0 +1,386 @@
+#include <math.h>
+
+/* The control path is tested including its static functions */
+#include "fanctrl.c"
+
+/**
+ * Test suite of the integer control path, run by "make test".
+ * Results are compared exhaustively against the float formulas the fixed-point math replaced,
+ * and against the exact rational value: Max. 0.5 PWM from the exact value, max. 1 PWM from the float code (double rounding).
+ * Exits with EXIT_FAILURE, if a check fails.
+ */
+
+#define TEST_PFX "fanctrl_test: "
+#define TEST_FAIL(str,...) (fprintf(stderr,TEST_PFX "FAILED @line:" STRINGIFY(__LINE__) ": " str "\n",__VA_ARGS__),++uiFailures_m)
+
+enum
+{
+  TEST_TEMP_MIN=-200,                 /* -20 °C, below the lowest sensible curve point */
+  TEST_TEMP_MAX=CFG_LIMIT_MAX_TEMP+100,
+  TEST_EXACT_BOUND_PPM=500000,        /* 0.5 PWM, in 1/1000000 PWM */
+};
+
+static unsigned int uiFailures_m;
+static unsigned long ulChecks_m;
+
+/* Widths of curve segments, in 1/10 °C */
+static const int iaSegmentWidths_m[]={1,2,3,7,10,25,50,99,100,333,1000,CFG_LIMIT_MAX_TEMP};
+
+/**
+ * Float reference: Percent to PWM, as before the fixed-point math.
+ */
+static unsigned int uiRef_PercentToPWM_m(unsigned int uiPercent)
+{
+  return((unsigned int)(((float)(AMDGPU_PWM_VAL_MAX-AMDGPU_PWM_VAL_MIN)/100.0)*uiPercent+0.5));
+}
+
+/**
+ * Float reference: Curve segment interpolation, as before the fixed-point math, iTemp within ]iX0,iX1[.
+ */
+static unsigned int uiRef_Interpolate_m(int iTemp,
+                                        int iX0,
+                                        int iX1,
+                                        unsigned int uiY0,
+                                        unsigned int uiY1)
+{
+  unsigned int uiCurrPWM;
+  float fTmp;
+
+  uiCurrPWM=(unsigned int)(iX1-iX0);
+  fTmp=(float)uiCurrPWM / (iTemp-iX0);
+  fTmp=((float)(uiY1-uiY0))/fTmp;
+  uiCurrPWM=(uiY0*100)+(unsigned int)(fTmp*100+0.5);
+  return((uiCurrPWM+50)/100);
+}
+
+/**
+ * Exact rational value of the interpolation, in 1/1000000 PWM.
+ */
+static long long llExact_Interpolate_m(int iTemp,
+                                       int iX0,
+                                       int iX1,
+                                       long lY0,
+                                       long lY1)
+{
+  return((long long)lY0*1000000LL + ((long long)(lY1-lY0)*(iTemp-iX0)*1000000LL)/(iX1-iX0));
+}
+
+static void vTest_PercentToPWM_m(void)
+{
+  unsigned int uiPercent;
+  unsigned int uiPWM;
+  long long llExact;
+  long long llDiff;
+
+  for(uiPercent=0;uiPercent <= 100;++uiPercent)
+  {
+    uiPWM=fixp_PercentToPWM(uiPercent,AMDGPU_PWM_VAL_MIN,AMDGPU_PWM_VAL_MAX);
+    llExact=AMDGPU_PWM_VAL_MIN*1000000LL+(long long)uiPercent*(AMDGPU_PWM_VAL_MAX-AMDGPU_PWM_VAL_MIN)*10000LL;
+    llDiff=(long long)uiPWM*1000000LL-llExact;
+    ++ulChecks_m;
+    if((llDiff > TEST_EXACT_BOUND_PPM) ||
+       (llDiff < -TEST_EXACT_BOUND_PPM))
+      TEST_FAIL("fixp_PercentToPWM(%u)=%u, exact=%lld/1000000",uiPercent,uiPWM,llExact);
+    if(abs((int)uiPWM-(int)uiRef_PercentToPWM_m(uiPercent)) > 1)
+      TEST_FAIL("fixp_PercentToPWM(%u)=%u, float=%u",uiPercent,uiPWM,uiRef_PercentToPWM_m(uiPercent));
+    /* Round trip, used for printing */
+    if(abs((int)fixp_PWMToPermille(uiPWM,AMDGPU_PWM_VAL_MIN,AMDGPU_PWM_VAL_MAX)-(int)uiPercent*10) > 2)
+      TEST_FAIL("fixp_PWMToPermille(%u)=%u for %u%%",uiPWM,fixp_PWMToPermille(uiPWM,AMDGPU_PWM_VAL_MIN,AMDGPU_PWM_VAL_MAX),uiPercent);
+  }
+}
+
+static void vTest_PWMToPermille_m(void)
+{
+  unsigned int uiPWM;
+  unsigned int uiPermille;
+  unsigned int uiRef;
+
+  for(uiPWM=AMDGPU_PWM_VAL_MIN;uiPWM <= AMDGPU_PWM_VAL_MAX;++uiPWM)
+  {
+    uiPermille=fixp_PWMToPermille(uiPWM,AMDGPU_PWM_VAL_MIN,AMDGPU_PWM_VAL_MAX);
+    /* Float formula of the debug output before: PWM/(255/100.0) percent */
+    uiRef=(unsigned int)floor(uiPWM/((float)(AMDGPU_PWM_VAL_MAX-AMDGPU_PWM_VAL_MIN)/100.0)*10.0+0.5);
+    ++ulChecks_m;
+    if(uiPermille != uiRef)
+      TEST_FAIL("fixp_PWMToPermille(%u)=%u, float=%u",uiPWM,uiPermille,uiRef);
+  }
+}
+
+static void vTest_Interpolate_m(void)
+{
+  unsigned int uiWidth;
+  unsigned int uiY0;
+  unsigned int uiY1;
+  long lResult;
+  long long llDiff;
+  int iX0=0;
+  int iX1;
+  int iTemp;
+
+  for(uiWidth=0;uiWidth < sizeof(iaSegmentWidths_m)/sizeof(iaSegmentWidths_m[0]);++uiWidth)
+  {
+    iX1=iX0+iaSegmentWidths_m[uiWidth];
+    for(uiY0=0;uiY0 <= 100;++uiY0)
+    {
+      for(uiY1=uiY0;uiY1 <= 100;++uiY1)
+      {
+        for(iTemp=iX0+1;iTemp < iX1;++iTemp)
+        {
+          lResult=fixp_Interpolate(iTemp,
+                                   iX0,
+                                   iX1,
+                                   AMDGPU_FANSPEED_PERCENT_TO_PWM(uiY0),
+                                   AMDGPU_FANSPEED_PERCENT_TO_PWM(uiY1));
+          llDiff=lResult*1000000LL-llExact_Interpolate_m(iTemp,
+                                                         iX0,
+                                                         iX1,
+                                                         AMDGPU_FANSPEED_PERCENT_TO_PWM(uiY0),
+                                                         AMDGPU_FANSPEED_PERCENT_TO_PWM(uiY1));
+          ++ulChecks_m;
+          if((llDiff > TEST_EXACT_BOUND_PPM) ||
+             (llDiff < -TEST_EXACT_BOUND_PPM))
+            TEST_FAIL("fixp_Interpolate(%d,%d,%d,%u,%u)=%ld, off by %lld/1000000 from exact",
+                      iTemp,iX0,iX1,AMDGPU_FANSPEED_PERCENT_TO_PWM(uiY0),AMDGPU_FANSPEED_PERCENT_TO_PWM(uiY1),lResult,llDiff);
+          if(labs(lResult-(long)uiRef_Interpolate_m(iTemp,
+                                                    iX0,
+                                                    iX1,
+                                                    AMDGPU_FANSPEED_PERCENT_TO_PWM(uiY0),
+                                                    AMDGPU_FANSPEED_PERCENT_TO_PWM(uiY1))) > 1)
+            TEST_FAIL("fixp_Interpolate(%d,%d,%d,%u,%u)=%ld, float=%u",
+                      iTemp,iX0,iX1,AMDGPU_FANSPEED_PERCENT_TO_PWM(uiY0),AMDGPU_FANSPEED_PERCENT_TO_PWM(uiY1),lResult,
+                      uiRef_Interpolate_m(iTemp,iX0,iX1,AMDGPU_FANSPEED_PERCENT_TO_PWM(uiY0),AMDGPU_FANSPEED_PERCENT_TO_PWM(uiY1)));
+        }
+      }
+    }
+    iX0=(iX0+37)%500; /* Segments at different offsets */
+  }
+}
+
+/**
+ * Whole curves: Clamping below/above the points, exact hits and interpolation between points.
+ */
+static void vTest_CurveGetPWM_m(void)
+{
+  TagFanCtrlTempPoint taga3Points[3];
+  unsigned int uiPercentLow;
+  unsigned int uiPercentHigh;
+  unsigned int uiIndex;
+  unsigned int uiPWM;
+  unsigned int uiRef;
+  int iTemp;
+
+  for(uiPercentLow=0;uiPercentLow <= 100;uiPercentLow+=5)
+  {
+    for(uiPercentHigh=uiPercentLow;uiPercentHigh <= 100;uiPercentHigh+=3)
+    {
+      taga3Points[0].iTemp=200;
+      taga3Points[0].uiFanSpeedPWM=AMDGPU_FANSPEED_PERCENT_TO_PWM(uiPercentLow);
+      taga3Points[1].iTemp=650;
+      taga3Points[1].uiFanSpeedPWM=AMDGPU_FANSPEED_PERCENT_TO_PWM((uiPercentLow+uiPercentHigh)/2);
+      taga3Points[2].iTemp=CFG_LIMIT_MAX_TEMP-1;
+      taga3Points[2].uiFanSpeedPWM=AMDGPU_FANSPEED_PERCENT_TO_PWM(uiPercentHigh);
+      for(iTemp=TEST_TEMP_MIN;iTemp <= TEST_TEMP_MAX;++iTemp)
+      {
+        uiPWM=uiFanCtrl_CurveGetPWM_m(taga3Points,3,iTemp);
+        /* Reference as the float code before, without its read above the highest point */
+        for(uiIndex=0;(uiIndex < 3) && (iTemp > taga3Points[uiIndex].iTemp);++uiIndex)
+          ;
+        if(uiIndex == 3)
+          uiRef=taga3Points[2].uiFanSpeedPWM;
+        else if((uiIndex == 0) ||
+                (taga3Points[uiIndex].iTemp == iTemp))
+          uiRef=taga3Points[uiIndex].uiFanSpeedPWM;
+        else
+          uiRef=uiRef_Interpolate_m(iTemp,
+                                    taga3Points[uiIndex-1].iTemp,
+                                    taga3Points[uiIndex].iTemp,
+                                    taga3Points[uiIndex-1].uiFanSpeedPWM,
+                                    taga3Points[uiIndex].uiFanSpeedPWM);
+        ++ulChecks_m;
+        if(abs((int)uiPWM-(int)uiRef) > 1)
+          TEST_FAIL("uiFanCtrl_CurveGetPWM_m(%d)=%u, float=%u (curve %u%%-%u%%)",iTemp,uiPWM,uiRef,uiPercentLow,uiPercentHigh);
+        /* Clamped and exact outside/on the points */
+        if(((uiIndex == 0) || (uiIndex == 3) || (taga3Points[(uiIndex < 3)?uiIndex:2].iTemp == iTemp)) &&
+           (uiPWM != uiRef))
+          TEST_FAIL("uiFanCtrl_CurveGetPWM_m(%d)=%u, expected %u (point/clamp)",iTemp,uiPWM,uiRef);
+        if(uiPWM > taga3Points[2].uiFanSpeedPWM)
+          TEST_FAIL("uiFanCtrl_CurveGetPWM_m(%d)=%u above the highest point",iTemp,uiPWM);
+      }
+    }
+  }
+}
+
+/**
+ * Float reference of the hysteresis decision: Deadband of the change and rising slope, without dwell time.
+ */
+static int iRef_Hysteresis_m(int iLastTemp,
+                             int iTemp,
+                             unsigned long ulDtMs,
+                             int iRising,
+                             int iFalling,
+                             int iSlopeBypass)
+{
+  double dSlope=(iTemp-iLastTemp)*1000.0/(double)ulDtMs;
+
+  if(iTemp == iLastTemp)
+    return(0);
+  if((iSlopeBypass) &&
+     ((int)floor(fabs(dSlope)+0.5)*((dSlope < 0)?-1:1) >= iSlopeBypass))
+    return(1);
+  if(iTemp > iLastTemp)
+    return((iTemp-iLastTemp >= iRising)?1:0);
+  return((iLastTemp-iTemp >= iFalling)?1:0);
+}
+
+static void vTest_Hysteresis_m(void)
+{
+  static const int iaDeadbands[]={0,1,5,10,20,CFG_LIMIT_MAX_DEADBAND};
+  static const int iaSlopes[]={0,1,20,100};
+  static const unsigned long ulaDtMs[]={100,1000,2500,3000};
+  TagCtrlHysteresis tagHyst;
+  unsigned int uiDeadband;
+  unsigned int uiSlope;
+  unsigned int uiDt;
+  int iLastTemp;
+  int iTemp;
+  int iRc;
+  int iRef;
+
+  for(uiDeadband=0;uiDeadband < sizeof(iaDeadbands)/sizeof(iaDeadbands[0]);++uiDeadband)
+  {
+    for(uiSlope=0;uiSlope < sizeof(iaSlopes)/sizeof(iaSlopes[0]);++uiSlope)
+    {
+      for(uiDt=0;uiDt < sizeof(ulaDtMs)/sizeof(ulaDtMs[0]);++uiDt)
+      {
+        for(iLastTemp=0;iLastTemp <= CFG_LIMIT_MAX_TEMP;iLastTemp+=50)
+        {
+          for(iTemp=iLastTemp-250;iTemp <= iLastTemp+250;++iTemp)
+          {
+            ctrlHysteresis_Init(&tagHyst,
+                                iaDeadbands[uiDeadband],
+                                iaDeadbands[(uiDeadband+1)%(sizeof(iaDeadbands)/sizeof(iaDeadbands[0]))],
+                                0,
+                                iaSlopes[uiSlope]);
+            if(ctrlHysteresis_Check(&tagHyst,iLastTemp,1000) != 1)
+              TEST_FAIL("ctrlHysteresis_Check() rejected the first sample %d",iLastTemp);
+            iRc=ctrlHysteresis_Check(&tagHyst,iTemp,1000+ulaDtMs[uiDt]);
+            iRef=iRef_Hysteresis_m(iLastTemp,
+                                   iTemp,
+                                   ulaDtMs[uiDt],
+                                   iaDeadbands[uiDeadband],
+                                   iaDeadbands[(uiDeadband+1)%(sizeof(iaDeadbands)/sizeof(iaDeadbands[0]))],
+                                   iaSlopes[uiSlope]);
+            ++ulChecks_m;
+            if(iRc != iRef)
+              TEST_FAIL("ctrlHysteresis_Check(%d -> %d, %lums, deadband %d/%d, slope %d)=%d, float=%d",
+                        iLastTemp,iTemp,ulaDtMs[uiDt],iaDeadbands[uiDeadband],
+                        iaDeadbands[(uiDeadband+1)%(sizeof(iaDeadbands)/sizeof(iaDeadbands[0]))],iaSlopes[uiSlope],iRc,iRef);
+            if((iRc) &&
+               (tagHyst.iLastUpdateTemp != iTemp))
+              TEST_FAIL("ctrlHysteresis_Check() accepted %d, but kept the reference %d",iTemp,tagHyst.iLastUpdateTemp);
+          }
+        }
+      }
+    }
+  }
+
+  /* Dwell time: A change within the min. dwell time is held back, accepted afterwards */
+  ctrlHysteresis_Init(&tagHyst,10,10,5000,0);
+  ctrlHysteresis_Check(&tagHyst,500,1000);
+  ++ulChecks_m;
+  if((ctrlHysteresis_Check(&tagHyst,600,3000) != 0) ||
+     (ctrlHysteresis_Check(&tagHyst,600,6000) != 1) ||
+     (tagHyst.ulMaxDwellDelayMs != 3000))
+    TEST_FAIL("ctrlHysteresis_Check() dwell time: accepted at wrong time, max. delay %lums",tagHyst.ulMaxDwellDelayMs);
+}
+
+/**
+ * Bumpless transfer: The first update after ctrlPID_Track() continues from the tracked PWM,
+ * only moved by one integration step. P and D must not cause a jump, also if they exceed the output range.
+ */
+static void vTest_PIDTrack_m(void)
+{
+  static const unsigned int uiaKp[]={0,50,200,1000,CFG_LIMIT_MAX_PID_GAIN};
+  static const unsigned int uiaKi[]={0,10,100};
+  static const unsigned int uiaKd[]={0,500};
+  TagCtrlPID tagPID;
+  unsigned int uiKp;
+  unsigned int uiKi;
+  unsigned int uiKd;
+  unsigned int uiPWM;
+  unsigned int uiOut;
+  double dExpected;
+  int iTemp;
+
+  for(uiKp=0;uiKp < sizeof(uiaKp)/sizeof(uiaKp[0]);++uiKp)
+  {
+    for(uiKi=0;uiKi < sizeof(uiaKi)/sizeof(uiaKi[0]);++uiKi)
+    {
+      for(uiKd=0;uiKd < sizeof(uiaKd)/sizeof(uiaKd[0]);++uiKd)
+      {
+        for(iTemp=TEST_TEMP_MIN;iTemp <= TEST_TEMP_MAX;iTemp+=7)
+        {
+          for(uiPWM=AMDGPU_PWM_VAL_MIN;uiPWM <= AMDGPU_PWM_VAL_MAX;++uiPWM)
+          {
+            ctrlPID_Init(&tagPID,600,uiaKp[uiKp],uiaKi[uiKi],uiaKd[uiKd],AMDGPU_PWM_VAL_MIN,AMDGPU_PWM_VAL_MAX);
+            ctrlPID_Track(&tagPID,iTemp,uiPWM);
+            uiOut=ctrlPID_Update(&tagPID,iTemp,1000);
+            /* One second of integration, held if it drives the output into saturation */
+            dExpected=uiPWM+(int)uiaKi[uiKi]*(iTemp-600)/100.0;
+            if((dExpected > AMDGPU_PWM_VAL_MAX) ||
+               (dExpected < AMDGPU_PWM_VAL_MIN))
+              dExpected=uiPWM;
+            ++ulChecks_m;
+            if(fabs(uiOut-dExpected) > 1.0)
+              TEST_FAIL("ctrlPID_Update() after ctrlPID_Track(%d,%u)=%u, expected %.2f (Kp %u, Ki %u, Kd %u)",
+                        iTemp,uiPWM,uiOut,dExpected,uiaKp[uiKp],uiaKi[uiKi],uiaKd[uiKd]);
+            /* Without integration the output holds at a constant temperature */
+            if((uiaKi[uiKi] == 0) &&
+               ((ctrlPID_Update(&tagPID,iTemp,1000) != uiPWM) ||
+                (ctrlPID_Update(&tagPID,iTemp,1000) != uiPWM)))
+              TEST_FAIL("ctrlPID_Update() after ctrlPID_Track(%d,%u) doesn't hold (Kp %u, Kd %u)",
+                        iTemp,uiPWM,uiaKp[uiKp],uiaKd[uiKd]);
+          }
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Raw sensor values (millidegree) to 1/10 °C, rounded to nearest.
+ */
+static void vTest_DivRound_m(void)
+{
+  long lRaw;
+  long lResult;
+  long lRef;
+
+  for(lRaw=TEST_TEMP_MIN*100L;lRaw <= TEST_TEMP_MAX*100L;++lRaw)
+  {
+    lResult=fixp_DivRound(lRaw,AMDGPU_RAW_TO_TENTH_CELSUIS_DIVISOR);
+    lRef=(long)((lRaw < 0)?-floor(-lRaw/100.0+0.5):floor(lRaw/100.0+0.5));
+    ++ulChecks_m;
+    if(lResult != lRef)
+      TEST_FAIL("fixp_DivRound(%ld,100)=%ld, float=%ld",lRaw,lResult,lRef);
+  }
+}
+
+int main(void)
+{
+  vTest_PercentToPWM_m();
+  vTest_PWMToPermille_m();
+  vTest_Interpolate_m();
+  vTest_CurveGetPWM_m();
+  vTest_Hysteresis_m();
+  vTest_PIDTrack_m();
+  vTest_DivRound_m();
+
+  if(uiFailures_m)
+  {
+    fprintf(stderr,TEST_PFX "%u of %lu checks FAILED\n",uiFailures_m,ulChecks_m);
+    return(EXIT_FAILURE);
+  }
+  printf(TEST_PFX "%lu checks passed\n",ulChecks_m);
+  return(EXIT_SUCCESS);
+}
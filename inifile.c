@@ -39,8 +39,8 @@
 #define SECTIONS_NEED_REALLOC(file)    (((file)->uiSectionsCount<(file)->uiSectionsMax)?0:1)
 #define KEYS_NEED_REALLOC(section)     (((section)->uiKeysCount<(section)->uiKeysMax)?0:1)
 
-#define SECTION_CALC_INDEX(file) (((file)->ptagCurrSection-(file)->ptagSections)/sizeof(struct TagIniSection*))
-#define KEY_CALC_INDEX(file)     (((file)->ptagCurrSection->ptagCurrKey-(file)->ptagCurrSection->ptagKeys)/sizeof(struct TagIniKey*))
+#define SECTION_CALC_INDEX(file) ((file)->ptagCurrSection-(file)->ptagSections)
+#define KEY_CALC_INDEX(file)     ((file)->ptagCurrSection->ptagCurrKey-(file)->ptagCurrSection->ptagKeys)
 
 #define CHECK_SECTIONNAME_VALID(str) Ini_CheckNameValid_m(str,MAX_SECTION_LENGTH-1)
 #define CHECK_KEYNAME_VALID(str)     Ini_CheckNameValid_m(str,MAX_KEYNAME_LENGTH-1)
@@ -677,7 +677,7 @@ void IniFile_Iterator_DeleteSection(Inifile file)
   /* free Keys for the section */
   free(file->ptagCurrSection->ptagKeys);
   --file->uiSectionsCount;
-  if(uiSectionIndex < file->uiSectionsCount-1)
+  if(uiSectionIndex < file->uiSectionsCount)
   {
     memmove(file->ptagCurrSection,
             file->ptagCurrSection+1,